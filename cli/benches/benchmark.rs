@@ -5,6 +5,7 @@ use std::path::{Path, PathBuf};
 use std::time::Instant;
 use std::{env, fs, str, usize};
 use tree_sitter::{Language, Parser, Query};
+use tree_sitter_cli::generate;
 use tree_sitter_loader::Loader;
 
 include!("../src/tests/helpers/dirs.rs");
@@ -17,6 +18,7 @@ lazy_static! {
     static ref REPETITION_COUNT: usize = env::var("TREE_SITTER_BENCHMARK_REPETITION_COUNT")
         .map(|s| usize::from_str_radix(&s, 10).unwrap())
         .unwrap_or(5);
+    static ref COMPARE_TABLES: bool = env::var("TREE_SITTER_BENCHMARK_COMPARE_TABLES").is_ok();
     static ref TEST_LOADER: Loader = Loader::with_parser_lib_path(SCRATCH_DIR.clone());
     static ref EXAMPLE_AND_QUERY_PATHS_BY_LANGUAGE_DIR: BTreeMap<PathBuf, (Vec<PathBuf>, Vec<PathBuf>)> = {
         fn process_dir(result: &mut BTreeMap<PathBuf, (Vec<PathBuf>, Vec<PathBuf>)>, dir: &Path) {
@@ -152,6 +154,10 @@ fn main() {
             eprintln!("  Worst Speed (errors):   {} bytes/ms", worst_error);
         }
 
+        if *COMPARE_TABLES {
+            compare_table_layouts(language_path, example_paths, max_path_length);
+        }
+
         all_normal_speeds.extend(normal_speeds);
         all_error_speeds.extend(error_speeds);
     }
@@ -205,6 +211,77 @@ fn parse(path: &Path, max_path_length: usize, mut action: impl FnMut(&[u8])) ->
     speed as usize
 }
 
+// Regenerate the parser with each parse table and lex table layout, and compare
+// the size of the compiled parsers and their parsing speed.
+fn compare_table_layouts(language_path: &Path, example_paths: &[PathBuf], max_path_length: usize) {
+    let src_dir = GRAMMARS_DIR.join(language_path).join("src");
+    let grammar_json = fs::read_to_string(src_dir.join("grammar.json"))
+        .with_context(|| format!("Failed to read grammar in {:?}", src_dir))
+        .unwrap();
+    let scanner_path = ["scanner.c", "scanner.cc"]
+        .iter()
+        .map(|name| src_dir.join(name))
+        .find(|path| path.exists());
+
+    let mut parser = Parser::new();
+    for (layout, compact_tables, table_lexer) in &[
+        ("default", false, false),
+        ("compact", true, false),
+        ("table-lexer", false, true),
+    ] {
+        let (name, parser_code) = generate::generate_parser_for_grammar_with_table_options(
+            &grammar_json,
+            *compact_tables,
+            *table_lexer,
+        )
+        .with_context(|| format!("Failed to generate parser in {:?}", src_dir))
+        .unwrap();
+
+        let lib_dir = SCRATCH_DIR.join("table-layouts").join(layout);
+        fs::create_dir_all(&lib_dir).unwrap();
+        let parser_path = lib_dir.join(format!("{}-parser.c", name));
+        if !fs::read_to_string(&parser_path)
+            .map(|content| content == parser_code)
+            .unwrap_or(false)
+        {
+            fs::write(&parser_path, &parser_code).unwrap();
+        }
+
+        let language = Loader::with_parser_lib_path(lib_dir.clone())
+            .load_language_from_sources(&name, &HEADER_DIR, &parser_path, &scanner_path)
+            .with_context(|| format!("Failed to compile parser {:?}", parser_path))
+            .unwrap();
+        let mut lib_path = lib_dir.join(&name);
+        lib_path.set_extension(if cfg!(windows) { "dll" } else { "so" });
+        let lib_size = fs::metadata(&lib_path).map_or(0, |m| m.len());
+
+        eprintln!(
+            "  Table Layout: {} (parser.c {} bytes, library {} bytes)",
+            layout,
+            parser_code.len(),
+            lib_size
+        );
+        parser.set_language(language).unwrap();
+        let mut speeds = Vec::new();
+        for example_path in example_paths {
+            if let Some(filter) = EXAMPLE_FILTER.as_ref() {
+                if !example_path.to_str().unwrap().contains(filter.as_str()) {
+                    continue;
+                }
+            }
+
+            speeds.push(parse(example_path, max_path_length, |code| {
+                parser.parse(code, None).expect("Failed to parse");
+            }));
+        }
+
+        if let Some((average, worst)) = aggregate(&speeds) {
+            eprintln!("  Average Speed ({}): {} bytes/ms", layout, average);
+            eprintln!("  Worst Speed ({}):   {} bytes/ms", layout, worst);
+        }
+    }
+}
+
 fn get_language(path: &Path) -> Language {
     let src_dir = GRAMMARS_DIR.join(path).join("src");
     TEST_LOADER
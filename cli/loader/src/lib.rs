@@ -7,10 +7,9 @@ use std::collections::HashMap;
 use std::io::BufReader;
 use std::ops::Range;
 use std::path::{Path, PathBuf};
-use std::process::Command;
+use std::process::{self, Command, Stdio};
 use std::sync::Mutex;
-use std::time::SystemTime;
-use std::{fs, mem};
+use std::{env, fs, mem};
 use tree_sitter::{Language, QueryError, QueryErrorKind};
 use tree_sitter_highlight::HighlightConfiguration;
 use tree_sitter_tags::{Error as TagsError, TagsConfiguration};
@@ -91,6 +90,7 @@ pub struct LanguageConfiguration<'a> {
     tags_config: OnceCell<Option<TagsConfiguration>>,
     highlight_names: &'a Mutex<Vec<String>>,
     use_all_highlight_names: bool,
+    parser_lib_path: PathBuf,
 }
 
 pub struct Loader {
@@ -101,6 +101,7 @@ pub struct Loader {
     highlight_names: Box<Mutex<Vec<String>>>,
     use_all_highlight_names: bool,
     debug_build: bool,
+    shared_cache_path: Option<PathBuf>,
 }
 
 unsafe impl Send for Loader {}
@@ -111,7 +112,11 @@ impl Loader {
         let parser_lib_path = dirs::cache_dir()
             .ok_or(anyhow!("Cannot determine cache directory"))?
             .join("tree-sitter/lib");
-        Ok(Self::with_parser_lib_path(parser_lib_path))
+        let mut result = Self::with_parser_lib_path(parser_lib_path);
+        if let Ok(path) = env::var("TREE_SITTER_SHARED_CACHE_DIR") {
+            result.use_shared_cache(PathBuf::from(path));
+        }
+        Ok(result)
     }
 
     pub fn with_parser_lib_path(parser_lib_path: PathBuf) -> Self {
@@ -123,6 +128,7 @@ impl Loader {
             highlight_names: Box::new(Mutex::new(Vec::new())),
             use_all_highlight_names: true,
             debug_build: false,
+            shared_cache_path: None,
         }
     }
 
@@ -355,80 +361,32 @@ impl Loader {
         let mut library_path = self.parser_lib_path.join(lib_name);
         library_path.set_extension(DYLIB_EXTENSION);
 
-        let recompile = needs_recompile(&library_path, &parser_path, &scanner_path)
-            .with_context(|| "Failed to compare source and binary timestamps")?;
-
-        if recompile {
-            fs::create_dir_all(&self.parser_lib_path)?;
-            let mut config = cc::Build::new();
-            config
-                .cpp(true)
-                .opt_level(2)
-                .cargo_metadata(false)
-                .target(BUILD_TARGET)
-                .host(BUILD_TARGET);
-            let compiler = config.get_compiler();
-            let mut command = Command::new(compiler.path());
-            for (key, value) in compiler.env() {
-                command.env(key, value);
-            }
-
-            if cfg!(windows) {
-                command.args(&["/nologo", "/LD", "/I"]).arg(header_path);
-                if self.debug_build {
-                    command.arg("/Od");
-                } else {
-                    command.arg("/O2");
-                }
-                command.arg(parser_path);
-                if let Some(scanner_path) = scanner_path.as_ref() {
-                    command.arg(scanner_path);
-                }
-                command
-                    .arg("/link")
-                    .arg(format!("/out:{}", library_path.to_str().unwrap()));
-            } else {
-                command
-                    .arg("-shared")
-                    .arg("-fPIC")
-                    .arg("-fno-exceptions")
-                    .arg("-g")
-                    .arg("-I")
-                    .arg(header_path)
-                    .arg("-o")
-                    .arg(&library_path);
-
-                if self.debug_build {
-                    command.arg("-O0");
-                } else {
-                    command.arg("-O2");
-                }
-
-                // For conditional compilation of external scanner code when
-                // used internally by `tree-siteer parse` and other sub commands.
-                command.arg("-DTREE_SITTER_INTERNAL_BUILD");
-
-                if let Some(scanner_path) = scanner_path.as_ref() {
-                    if scanner_path.extension() == Some("c".as_ref()) {
-                        command.arg("-xc").arg("-std=c99").arg(scanner_path);
-                    } else {
-                        command.arg(scanner_path);
-                    }
-                }
-                command.arg("-xc").arg(parser_path);
-            }
-
-            let output = command
-                .output()
-                .with_context(|| "Failed to execute C compiler")?;
-            if !output.status.success() {
-                return Err(anyhow!(
-                    "Parser compilation failed.\nStdout: {}\nStderr: {}",
-                    String::from_utf8_lossy(&output.stdout),
-                    String::from_utf8_lossy(&output.stderr)
-                ));
-            }
+        let mut source_paths = vec![parser_path];
+        if let Some(scanner_path) = scanner_path.as_ref() {
+            source_paths.push(scanner_path);
         }
+        let build = self.build_config();
+        let cache_key = build.cache_key(header_path, &source_paths)?;
+
+        // Reuse a library that was built from the same sources with the same flags,
+        // either in this loader's own directory or in the shared cache directory.
+        let shared_library_path = self
+            .shared_cache_path
+            .as_ref()
+            .map(|dir| dir.join(library_path.file_name().unwrap()));
+        let library_path = if read_cache_key(&library_path).as_ref() == Some(&cache_key) {
+            library_path
+        } else if let Some(path) =
+            shared_library_path.filter(|path| read_cache_key(path).as_ref() == Some(&cache_key))
+        {
+            path
+        } else {
+            fs::create_dir_all(&self.parser_lib_path)?;
+            build.compile(header_path, &source_paths, &library_path)?;
+            fs::write(cache_key_path(&library_path), &cache_key)
+                .with_context(|| "Failed to write parser cache key")?;
+            library_path
+        };
 
         let library = unsafe { Library::new(&library_path) }
             .with_context(|| format!("Error opening dynamic library {:?}", &library_path))?;
@@ -439,6 +397,21 @@ impl Loader {
                 .with_context(|| format!("Failed to load symbol {}", language_fn_name))?;
             language_fn()
         };
+
+        // Refuse to load a parser that was generated for a different ABI version,
+        // rather than letting it call lexer functions that this library lacks.
+        let version = language.version();
+        if version < tree_sitter::MIN_COMPATIBLE_LANGUAGE_VERSION
+            || version > tree_sitter::LANGUAGE_VERSION
+        {
+            return Err(anyhow!(
+                "Incompatible language version {} in {:?}. Expected minimum {}, maximum {}",
+                version,
+                &library_path,
+                tree_sitter::MIN_COMPATIBLE_LANGUAGE_VERSION,
+                tree_sitter::LANGUAGE_VERSION,
+            ));
+        }
         mem::forget(library);
         Ok(language)
     }
@@ -572,6 +545,7 @@ impl Loader {
                         tags_config: OnceCell::new(),
                         highlight_names: &*self.highlight_names,
                         use_all_highlight_names: self.use_all_highlight_names,
+                        parser_lib_path: self.parser_lib_path.clone(),
                     };
 
                     for file_type in &configuration.file_types {
@@ -606,6 +580,7 @@ impl Loader {
                 tags_config: OnceCell::new(),
                 highlight_names: &*self.highlight_names,
                 use_all_highlight_names: self.use_all_highlight_names,
+                parser_lib_path: self.parser_lib_path.clone(),
             };
             self.language_configurations
                 .push(unsafe { mem::transmute(configuration) });
@@ -660,6 +635,219 @@ impl Loader {
     pub fn use_debug_build(&mut self, flag: bool) {
         self.debug_build = flag;
     }
+
+    /// Look for compiled parsers in the given directory before compiling them.
+    ///
+    /// The directory is only read, never written, so it can be shared by many
+    /// machines. It can be populated by copying the contents of another loader's
+    /// parser library directory, which contains each compiled parser along with
+    /// a `.key` file that identifies the sources and flags that it was built from.
+    pub fn use_shared_cache(&mut self, path: PathBuf) {
+        self.shared_cache_path = Some(path);
+    }
+
+    fn build_config(&self) -> BuildConfig {
+        let mut config = cc::Build::new();
+        config
+            .cpp(true)
+            .opt_level(2)
+            .cargo_metadata(false)
+            .target(BUILD_TARGET)
+            .host(BUILD_TARGET);
+        let compiler = config.get_compiler();
+
+        let mut flags = Vec::new();
+        if cfg!(windows) {
+            flags.push("/nologo");
+            if self.debug_build {
+                flags.push("/Od");
+            } else {
+                flags.push("/O2");
+            }
+        } else {
+            flags.extend(&["-fPIC", "-fno-exceptions", "-g"]);
+            if self.debug_build {
+                flags.push("-O0");
+            } else {
+                flags.push("-O2");
+            }
+
+            // For conditional compilation of external scanner code when
+            // used internally by `tree-siteer parse` and other sub commands.
+            flags.push("-DTREE_SITTER_INTERNAL_BUILD");
+        }
+
+        BuildConfig { compiler, flags }
+    }
+}
+
+struct BuildConfig {
+    compiler: cc::Tool,
+    flags: Vec<&'static str>,
+}
+
+impl BuildConfig {
+    fn command(&self) -> Command {
+        let mut command = Command::new(self.compiler.path());
+        for (key, value) in self.compiler.env() {
+            command.env(key, value);
+        }
+        command
+    }
+
+    // The first source is always the generated parser, and any others are scanners.
+    fn source_flags(index: usize, source_path: &Path) -> &'static [&'static str] {
+        if cfg!(windows) {
+            &[]
+        } else if index == 0 {
+            &["-xc"]
+        } else if source_path.extension() == Some("c".as_ref()) {
+            &["-xc", "-std=c99"]
+        } else {
+            &[]
+        }
+    }
+
+    // Compute a key that identifies a build of the given sources. The key depends
+    // only on the contents of the files and on the compiler's name, target and flags,
+    // not on any paths or timestamps, so that it is the same on every machine.
+    fn cache_key(&self, header_path: &Path, source_paths: &[&Path]) -> Result<String> {
+        let mut hash = FNV_OFFSET_BASIS;
+        let mut add = |bytes: &[u8]| {
+            for byte in (bytes.len() as u64)
+                .to_le_bytes()
+                .iter()
+                .chain(bytes.iter())
+            {
+                hash = (hash ^ *byte as u64).wrapping_mul(FNV_PRIME);
+            }
+        };
+
+        add(BUILD_TARGET.as_bytes());
+        add(self
+            .compiler
+            .path()
+            .file_name()
+            .map_or(&[], |name| name.to_str().unwrap_or("").as_bytes()));
+        for flag in &self.flags {
+            add(flag.as_bytes());
+        }
+
+        // Include the headers that the sources are likely to include: the parser
+        // header, and any headers next to the sources themselves.
+        let mut header_paths = vec![header_path.join("tree_sitter").join("parser.h")];
+        if let Some(source_dir) = source_paths.first().and_then(|path| path.parent()) {
+            if let Ok(entries) = fs::read_dir(source_dir) {
+                for entry in entries {
+                    let path = entry?.path();
+                    if path.extension().map_or(false, |e| e == "h" || e == "hh") {
+                        header_paths.push(path);
+                    }
+                }
+            }
+        }
+        header_paths[1..].sort_unstable();
+        for path in &header_paths {
+            if let Ok(contents) = fs::read(path) {
+                add(path.file_name().unwrap().to_str().unwrap_or("").as_bytes());
+                add(&contents);
+            }
+        }
+
+        for (i, path) in source_paths.iter().enumerate() {
+            for flag in Self::source_flags(i, path) {
+                add(flag.as_bytes());
+            }
+            add(&fs::read(path).with_context(|| format!("Failed to read source {:?}", path))?);
+        }
+
+        Ok(format!("{:016x}", hash))
+    }
+
+    // Compile each source file in a separate compiler process, in parallel, and
+    // then link the object files into a dynamic library. The library is written
+    // to a temporary path and then renamed, so that other processes never load
+    // a partially written library.
+    fn compile(
+        &self,
+        header_path: &Path,
+        source_paths: &[&Path],
+        library_path: &Path,
+    ) -> Result<()> {
+        let object_extension = if cfg!(windows) { "obj" } else { "o" };
+        let temp_path = |suffix: &str| {
+            let mut path = library_path.to_owned().into_os_string();
+            path.push(format!(".{}.{}", process::id(), suffix));
+            PathBuf::from(path)
+        };
+        let object_paths = (0..source_paths.len())
+            .map(|i| temp_path(&format!("{}.{}", i, object_extension)))
+            .collect::<Vec<_>>();
+        let temp_library_path = temp_path(DYLIB_EXTENSION);
+
+        let result = (|| {
+            let mut children = Vec::new();
+            for (i, (source_path, object_path)) in
+                source_paths.iter().zip(&object_paths).enumerate()
+            {
+                let mut command = self.command();
+                command.args(&self.flags);
+                if cfg!(windows) {
+                    command
+                        .arg("/c")
+                        .arg("/I")
+                        .arg(header_path)
+                        .arg(source_path)
+                        .arg(format!("/Fo{}", object_path.to_str().unwrap()));
+                } else {
+                    command
+                        .arg("-c")
+                        .arg("-I")
+                        .arg(header_path)
+                        .args(Self::source_flags(i, source_path))
+                        .arg(source_path)
+                        .arg("-o")
+                        .arg(object_path);
+                }
+                children.push(
+                    command
+                        .stdout(Stdio::piped())
+                        .stderr(Stdio::piped())
+                        .spawn()
+                        .with_context(|| "Failed to execute C compiler")?,
+                );
+            }
+            for child in children {
+                check_compiler_output(child.wait_with_output()?, "Parser compilation failed")?;
+            }
+
+            let mut command = self.command();
+            if cfg!(windows) {
+                command
+                    .args(&["/nologo", "/LD"])
+                    .args(&object_paths)
+                    .arg("/link")
+                    .arg(format!("/out:{}", temp_library_path.to_str().unwrap()));
+            } else {
+                command
+                    .arg("-shared")
+                    .args(&object_paths)
+                    .arg("-o")
+                    .arg(&temp_library_path);
+            }
+            let output = command
+                .output()
+                .with_context(|| "Failed to execute C compiler")?;
+            check_compiler_output(output, "Parser linking failed")?;
+            fs::rename(&temp_library_path, library_path)
+                .with_context(|| format!("Failed to write library {:?}", library_path))
+        })();
+
+        for path in object_paths.iter().chain(Some(&temp_library_path)) {
+            fs::remove_file(path).ok();
+        }
+        result
+    }
 }
 
 impl<'a> LanguageConfiguration<'a> {
@@ -677,11 +865,16 @@ impl<'a> LanguageConfiguration<'a> {
                 if highlights_query.is_empty() {
                     Ok(None)
                 } else {
-                    let mut result = HighlightConfiguration::new(
+                    // Cache the compiled query alongside the compiled parsers.
+                    let cache_path = fs::create_dir_all(&self.parser_lib_path)
+                        .ok()
+                        .map(|_| self.query_cache_path("highlights"));
+                    let mut result = HighlightConfiguration::new_with_cache(
                         language,
                         &highlights_query,
                         &injections_query,
                         &locals_query,
+                        cache_path.as_deref(),
                     )
                     .map_err(|error| match error.kind {
                         QueryErrorKind::Language => Error::from(error),
@@ -783,6 +976,21 @@ impl<'a> LanguageConfiguration<'a> {
         Error::from(error).context(format!("Error in query file {:?}", path))
     }
 
+    fn query_cache_path(&self, kind: &str) -> PathBuf {
+        let name = match &self.scope {
+            Some(scope) => scope.clone(),
+            None => self
+                .root_path
+                .file_name()
+                .map_or(String::new(), |name| name.to_string_lossy().to_string()),
+        };
+        self.parser_lib_path.join(format!(
+            "{}.{}-query",
+            replace_dashes_with_underscores(&name),
+            kind
+        ))
+    }
+
     fn read_queries(
         &self,
         paths: &Option<Vec<String>>,
@@ -812,28 +1020,33 @@ impl<'a> LanguageConfiguration<'a> {
     }
 }
 
-fn needs_recompile(
-    lib_path: &Path,
-    parser_c_path: &Path,
-    scanner_path: &Option<PathBuf>,
-) -> Result<bool> {
-    if !lib_path.exists() {
-        return Ok(true);
-    }
-    let lib_mtime = mtime(lib_path)?;
-    if mtime(parser_c_path)? > lib_mtime {
-        return Ok(true);
-    }
-    if let Some(scanner_path) = scanner_path {
-        if mtime(scanner_path)? > lib_mtime {
-            return Ok(true);
-        }
+const FNV_OFFSET_BASIS: u64 = 0xcbf29ce484222325;
+const FNV_PRIME: u64 = 0x100000001b3;
+
+fn cache_key_path(library_path: &Path) -> PathBuf {
+    let mut path = library_path.to_owned().into_os_string();
+    path.push(".key");
+    PathBuf::from(path)
+}
+
+fn read_cache_key(library_path: &Path) -> Option<String> {
+    if !library_path.exists() {
+        return None;
     }
-    Ok(false)
+    fs::read_to_string(cache_key_path(library_path)).ok()
 }
 
-fn mtime(path: &Path) -> Result<SystemTime> {
-    Ok(fs::metadata(path)?.modified()?)
+fn check_compiler_output(output: process::Output, message: &str) -> Result<()> {
+    if output.status.success() {
+        Ok(())
+    } else {
+        Err(anyhow!(
+            "{}.\nStdout: {}\nStderr: {}",
+            message,
+            String::from_utf8_lossy(&output.stdout),
+            String::from_utf8_lossy(&output.stderr)
+        ))
+    }
 }
 
 fn replace_dashes_with_underscores(name: &str) -> String {
@@ -0,0 +1,191 @@
+use anyhow::Result;
+use std::collections::HashMap;
+use std::fmt;
+use std::io::{self, Write};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::mpsc;
+use std::thread;
+use std::time::Duration;
+
+const SLOWEST_FILE_COUNT: usize = 5;
+
+/// The size of one file processed by a batch command, and the time spent on it.
+#[derive(Debug, Clone)]
+pub struct FileStats {
+    pub path: String,
+    pub bytes: usize,
+    pub duration: Duration,
+}
+
+/// Aggregate statistics for a batch of files.
+#[derive(Debug, Default)]
+pub struct ThroughputStats {
+    pub files: Vec<FileStats>,
+    pub elapsed: Duration,
+}
+
+/// Resolve the value of a `--jobs` flag. Zero means one job per available CPU.
+pub fn job_count(value: Option<&str>) -> Result<usize> {
+    let count = match value {
+        Some(value) => value.parse()?,
+        None => 1,
+    };
+    if count == 0 {
+        Ok(thread::available_parallelism().map_or(1, |n| n.get()))
+    } else {
+        Ok(count)
+    }
+}
+
+/// Process the given files using up to `job_count` threads.
+///
+/// Each thread owns a state created by `new_worker`, and reuses it for every
+/// file that it processes. The `process` function writes a file's output to a
+/// buffer, which is then passed to `finish` on the calling thread. Files are
+/// always finished in the order in which they were given, so that output is
+/// deterministic regardless of the number of jobs.
+pub fn process_files<W, T, N, P, F>(
+    paths: &[String],
+    job_count: usize,
+    new_worker: N,
+    process: P,
+    mut finish: F,
+) -> Result<()>
+where
+    W: Send,
+    T: Send,
+    N: Fn() -> Result<W> + Sync,
+    P: Fn(&mut W, usize, &mut Vec<u8>) -> Result<T> + Sync,
+    F: FnMut(usize, &[u8], T) -> Result<()>,
+{
+    let job_count = job_count.min(paths.len());
+    if job_count <= 1 {
+        let mut worker = new_worker()?;
+        let mut output = Vec::new();
+        for index in 0..paths.len() {
+            output.clear();
+            let result = process(&mut worker, index, &mut output)?;
+            finish(index, &output, result)?;
+        }
+        return Ok(());
+    }
+
+    let workers = (0..job_count)
+        .map(|_| new_worker())
+        .collect::<Result<Vec<_>>>()?;
+    let next_index = AtomicUsize::new(0);
+    let halted = AtomicBool::new(false);
+    let (sender, receiver) = mpsc::channel::<(usize, Result<(Vec<u8>, T)>)>();
+    thread::scope(|scope| {
+        for mut worker in workers {
+            let sender = sender.clone();
+            let (next_index, halted, process) = (&next_index, &halted, &process);
+            scope.spawn(move || {
+                while !halted.load(Ordering::Relaxed) {
+                    let index = next_index.fetch_add(1, Ordering::Relaxed);
+                    if index >= paths.len() {
+                        break;
+                    }
+                    let mut output = Vec::new();
+                    let result = process(&mut worker, index, &mut output);
+                    if result.is_err() {
+                        halted.store(true, Ordering::Relaxed);
+                    }
+                    if sender.send((index, result.map(|r| (output, r)))).is_err() {
+                        break;
+                    }
+                }
+            });
+        }
+        drop(sender);
+
+        // Results arrive in whatever order the workers complete them. Hold
+        // each one until all of the files before it have been finished. Files
+        // are claimed in order, so every file before a failed one is still
+        // processed, and errors are reported in order as well.
+        let mut pending = HashMap::new();
+        let mut next_to_finish = 0;
+        for (index, result) in receiver.iter() {
+            pending.insert(index, result);
+            while let Some(result) = pending.remove(&next_to_finish) {
+                if let Err(error) =
+                    result.and_then(|(output, result)| finish(next_to_finish, &output, result))
+                {
+                    halted.store(true, Ordering::Relaxed);
+                    return Err(error);
+                }
+                next_to_finish += 1;
+            }
+        }
+        Ok(())
+    })
+}
+
+/// Write the output of one file to stdout.
+pub fn write_output(output: &[u8]) -> Result<()> {
+    let stdout = io::stdout();
+    let mut stdout = stdout.lock();
+    stdout.write_all(output)?;
+    stdout.flush()?;
+    Ok(())
+}
+
+impl ThroughputStats {
+    fn percentile(durations: &[Duration], percentile: usize) -> Duration {
+        if durations.is_empty() {
+            return Duration::default();
+        }
+        let rank = (durations.len() * percentile + 99) / 100;
+        durations[rank.max(1) - 1]
+    }
+}
+
+impl fmt::Display for ThroughputStats {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let total_bytes = self.files.iter().map(|file| file.bytes).sum::<usize>();
+        let elapsed = self.elapsed.as_secs_f64();
+        let bytes_per_second = if elapsed > 0.0 {
+            total_bytes as f64 / elapsed
+        } else {
+            0.0
+        };
+        let mut durations = self.files.iter().map(|f| f.duration).collect::<Vec<_>>();
+        durations.sort_unstable();
+
+        writeln!(
+            f,
+            "Total files: {}; total bytes: {}; elapsed: {:.2} ms; throughput: {:.0} bytes/s",
+            self.files.len(),
+            total_bytes,
+            elapsed * 1000.0,
+            bytes_per_second,
+        )?;
+        writeln!(
+            f,
+            "Per-file latency: p50: {:.2} ms; p99: {:.2} ms",
+            Self::percentile(&durations, 50).as_secs_f64() * 1000.0,
+            Self::percentile(&durations, 99).as_secs_f64() * 1000.0,
+        )?;
+
+        let mut slowest_files = self.files.iter().collect::<Vec<_>>();
+        slowest_files.sort_unstable_by(|a, b| b.duration.cmp(&a.duration));
+        slowest_files.truncate(SLOWEST_FILE_COUNT);
+        let max_path_length = slowest_files
+            .iter()
+            .map(|file| file.path.chars().count())
+            .max()
+            .unwrap_or(0);
+        writeln!(f, "Slowest files:")?;
+        for file in slowest_files {
+            writeln!(
+                f,
+                "  {:width$}\t{:.2} ms\t{} bytes",
+                file.path,
+                file.duration.as_secs_f64() * 1000.0,
+                file.bytes,
+                width = max_path_length
+            )?;
+        }
+        Ok(())
+    }
+}
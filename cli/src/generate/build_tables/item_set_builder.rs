@@ -1,4 +1,5 @@
 use super::item::{ParseItem, ParseItemDisplay, ParseItemSet, TokenSetDisplay};
+use super::parallel_map;
 use crate::generate::grammars::{InlinedProductionMap, LexicalGrammar, SyntaxGrammar};
 use crate::generate::rules::{Symbol, SymbolType, TokenSet};
 use std::collections::{HashMap, HashSet};
@@ -43,7 +44,7 @@ impl<'a> ParseItemSetBuilder<'a> {
             first_sets: HashMap::new(),
             last_sets: HashMap::new(),
             inlines,
-            transitive_closure_additions: vec![Vec::new(); syntax_grammar.variables.len()],
+            transitive_closure_additions: Vec::new(),
         };
 
         // For each grammar symbol, populate the FIRST and LAST sets: the set of
@@ -140,97 +141,104 @@ impl<'a> ParseItemSetBuilder<'a> {
         //      lookahead tokens can occur after `item`.
         //
         // Again, rather than computing these additions recursively, we use an explicit
-        // stack called `entries_to_process`.
-        for i in 0..syntax_grammar.variables.len() {
-            let empty_lookaheads = TokenSet::new();
-            let mut entries_to_process = vec![(i, &empty_lookaheads, true)];
+        // stack called `entries_to_process`. The additions for each non-terminal are
+        // independent of each other, so they are computed in parallel.
+        let first_sets = &result.first_sets;
+        result.transitive_closure_additions = parallel_map(
+            syntax_grammar.variables.len(),
+            || (),
+            |_, i| {
+                let empty_lookaheads = TokenSet::new();
+                let mut entries_to_process = vec![(i, &empty_lookaheads, true)];
 
-            // First, build up a map whose keys are all of the non-terminals that can
-            // appear at the beginning of non-terminal `i`, and whose values store
-            // information about the tokens that can follow each non-terminal.
-            let mut follow_set_info_by_non_terminal = HashMap::new();
-            while let Some(entry) = entries_to_process.pop() {
-                let (variable_index, lookaheads, propagates_lookaheads) = entry;
-                let existing_info = follow_set_info_by_non_terminal
-                    .entry(variable_index)
-                    .or_insert_with(|| FollowSetInfo {
-                        lookaheads: TokenSet::new(),
-                        propagates_lookaheads: false,
-                    });
+                // First, build up a map whose keys are all of the non-terminals that can
+                // appear at the beginning of non-terminal `i`, and whose values store
+                // information about the tokens that can follow each non-terminal.
+                let mut follow_set_info_by_non_terminal = HashMap::new();
+                while let Some(entry) = entries_to_process.pop() {
+                    let (variable_index, lookaheads, propagates_lookaheads) = entry;
+                    let existing_info = follow_set_info_by_non_terminal
+                        .entry(variable_index)
+                        .or_insert_with(|| FollowSetInfo {
+                            lookaheads: TokenSet::new(),
+                            propagates_lookaheads: false,
+                        });
 
-                let did_add_follow_set_info;
-                if propagates_lookaheads {
-                    did_add_follow_set_info = !existing_info.propagates_lookaheads;
-                    existing_info.propagates_lookaheads = true;
-                } else {
-                    did_add_follow_set_info = existing_info.lookaheads.insert_all(lookaheads);
-                }
+                    let did_add_follow_set_info;
+                    if propagates_lookaheads {
+                        did_add_follow_set_info = !existing_info.propagates_lookaheads;
+                        existing_info.propagates_lookaheads = true;
+                    } else {
+                        did_add_follow_set_info = existing_info.lookaheads.insert_all(lookaheads);
+                    }
 
-                if did_add_follow_set_info {
-                    for production in &syntax_grammar.variables[variable_index].productions {
-                        if let Some(symbol) = production.first_symbol() {
-                            if symbol.is_non_terminal() {
-                                if production.steps.len() == 1 {
-                                    entries_to_process.push((
-                                        symbol.index,
-                                        lookaheads,
-                                        propagates_lookaheads,
-                                    ));
-                                } else {
-                                    entries_to_process.push((
-                                        symbol.index,
-                                        &result.first_sets[&production.steps[1].symbol],
-                                        false,
-                                    ));
+                    if did_add_follow_set_info {
+                        for production in &syntax_grammar.variables[variable_index].productions {
+                            if let Some(symbol) = production.first_symbol() {
+                                if symbol.is_non_terminal() {
+                                    if production.steps.len() == 1 {
+                                        entries_to_process.push((
+                                            symbol.index,
+                                            lookaheads,
+                                            propagates_lookaheads,
+                                        ));
+                                    } else {
+                                        entries_to_process.push((
+                                            symbol.index,
+                                            &first_sets[&production.steps[1].symbol],
+                                            false,
+                                        ));
+                                    }
                                 }
                             }
                         }
                     }
                 }
-            }
 
-            // Store all of those non-terminals' productions, along with their associated
-            // lookahead info, as *additions* associated with non-terminal `i`.
-            let additions_for_non_terminal = &mut result.transitive_closure_additions[i];
-            for (variable_index, follow_set_info) in follow_set_info_by_non_terminal {
-                let variable = &syntax_grammar.variables[variable_index];
-                let non_terminal = Symbol::non_terminal(variable_index);
-                let variable_index = variable_index as u32;
-                if syntax_grammar.variables_to_inline.contains(&non_terminal) {
-                    continue;
-                }
-                for production in &variable.productions {
-                    let item = ParseItem {
-                        variable_index,
-                        production,
-                        step_index: 0,
-                        has_preceding_inherited_fields: false,
-                    };
+                // Store all of those non-terminals' productions, along with their associated
+                // lookahead info, as *additions* associated with non-terminal `i`.
+                let mut additions_for_non_terminal = Vec::new();
+                for (variable_index, follow_set_info) in follow_set_info_by_non_terminal {
+                    let variable = &syntax_grammar.variables[variable_index];
+                    let non_terminal = Symbol::non_terminal(variable_index);
+                    let variable_index = variable_index as u32;
+                    if syntax_grammar.variables_to_inline.contains(&non_terminal) {
+                        continue;
+                    }
+                    for production in &variable.productions {
+                        let item = ParseItem {
+                            variable_index,
+                            production,
+                            step_index: 0,
+                            has_preceding_inherited_fields: false,
+                        };
 
-                    if let Some(inlined_productions) =
-                        inlines.inlined_productions(item.production, item.step_index)
-                    {
-                        for production in inlined_productions {
+                        if let Some(inlined_productions) =
+                            inlines.inlined_productions(item.production, item.step_index)
+                        {
+                            for production in inlined_productions {
+                                find_or_push(
+                                    &mut additions_for_non_terminal,
+                                    TransitiveClosureAddition {
+                                        item: item.substitute_production(production),
+                                        info: follow_set_info.clone(),
+                                    },
+                                );
+                            }
+                        } else {
                             find_or_push(
-                                additions_for_non_terminal,
+                                &mut additions_for_non_terminal,
                                 TransitiveClosureAddition {
-                                    item: item.substitute_production(production),
+                                    item,
                                     info: follow_set_info.clone(),
                                 },
                             );
                         }
-                    } else {
-                        find_or_push(
-                            additions_for_non_terminal,
-                            TransitiveClosureAddition {
-                                item,
-                                info: follow_set_info.clone(),
-                            },
-                        );
                     }
                 }
-            }
-        }
+                additions_for_non_terminal
+            },
+        );
 
         result
     }
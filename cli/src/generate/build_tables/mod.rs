@@ -11,14 +11,17 @@ use self::build_parse_table::{build_parse_table, ParseStateInfo};
 use self::coincident_tokens::CoincidentTokenIndex;
 use self::minimize_parse_table::minimize_parse_table;
 use self::token_conflicts::TokenConflictMap;
+use crate::generate::cache::GenerateCache;
 use crate::generate::grammars::{InlinedProductionMap, LexicalGrammar, SyntaxGrammar};
 use crate::generate::nfa::NfaCursor;
 use crate::generate::node_types::VariableInfo;
 use crate::generate::rules::{AliasMap, Symbol, SymbolType, TokenSet};
 use crate::generate::tables::{LexTable, ParseAction, ParseTable, ParseTableEntry};
+use crate::generate::timing::PhaseTimer;
 use anyhow::Result;
 use log::info;
 use std::collections::{BTreeSet, HashMap};
+use std::thread;
 
 pub(crate) fn build_tables(
     syntax_grammar: &SyntaxGrammar,
@@ -27,10 +30,14 @@ pub(crate) fn build_tables(
     variable_info: &Vec<VariableInfo>,
     inlines: &InlinedProductionMap,
     report_symbol_name: Option<&str>,
+    cache: Option<&GenerateCache>,
 ) -> Result<(ParseTable, LexTable, LexTable, Option<Symbol>)> {
+    let mut timer = PhaseTimer::new();
     let (mut parse_table, following_tokens, parse_state_info) =
         build_parse_table(syntax_grammar, lexical_grammar, inlines, variable_info)?;
-    let token_conflict_map = TokenConflictMap::new(lexical_grammar, following_tokens);
+    timer.finish_phase("build parse table");
+    let token_conflict_map =
+        TokenConflictMap::new_with_cache(lexical_grammar, following_tokens, cache);
     let coincident_token_index = CoincidentTokenIndex::new(&parse_table, lexical_grammar);
     let keywords = identify_keywords(
         lexical_grammar,
@@ -39,6 +46,7 @@ pub(crate) fn build_tables(
         &token_conflict_map,
         &coincident_token_index,
     );
+    timer.finish_phase("analyze token conflicts");
     populate_error_state(
         &mut parse_table,
         syntax_grammar,
@@ -56,6 +64,7 @@ pub(crate) fn build_tables(
         &token_conflict_map,
         &keywords,
     );
+    timer.finish_phase("minimize parse table");
     let (main_lex_table, keyword_lex_table) = build_lex_table(
         &mut parse_table,
         syntax_grammar,
@@ -66,6 +75,7 @@ pub(crate) fn build_tables(
     );
     populate_external_lex_states(&mut parse_table, syntax_grammar);
     mark_fragile_tokens(&mut parse_table, lexical_grammar, &token_conflict_map);
+    timer.finish_phase("build lex tables");
 
     if let Some(report_symbol_name) = report_symbol_name {
         report_state_info(
@@ -84,6 +94,48 @@ pub(crate) fn build_tables(
     ))
 }
 
+/// Compute `f(i)` for each `i` in `0..count`, spreading the work across all of the
+/// available cores. Each worker thread calls `init` once to create any scratch state
+/// that `f` needs. Indices are assigned to workers in round-robin order, because the
+/// cost of computing an item often grows with its index.
+pub(super) fn parallel_map<S, T, I, F>(count: usize, init: I, f: F) -> Vec<T>
+where
+    T: Send,
+    I: Fn() -> S + Sync,
+    F: Fn(&mut S, usize) -> T + Sync,
+{
+    let thread_count = thread::available_parallelism()
+        .map_or(1, |n| n.get())
+        .min(count);
+    if thread_count <= 1 {
+        let mut state = init();
+        return (0..count).map(|i| f(&mut state, i)).collect();
+    }
+
+    let (init, f) = (&init, &f);
+    let mut results_by_thread = thread::scope(|scope| {
+        let handles = (0..thread_count)
+            .map(|thread_index| {
+                scope.spawn(move || {
+                    let mut state = init();
+                    (thread_index..count)
+                        .step_by(thread_count)
+                        .map(|i| f(&mut state, i))
+                        .collect::<Vec<_>>()
+                        .into_iter()
+                })
+            })
+            .collect::<Vec<_>>();
+        handles
+            .into_iter()
+            .map(|handle| handle.join().unwrap())
+            .collect::<Vec<_>>()
+    });
+    (0..count)
+        .map(|i| results_by_thread[i % thread_count].next().unwrap())
+        .collect()
+}
+
 fn populate_error_state(
     parse_table: &mut ParseTable,
     syntax_grammar: &SyntaxGrammar,
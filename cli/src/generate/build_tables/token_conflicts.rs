@@ -1,4 +1,6 @@
+use super::parallel_map;
 use crate::generate::build_tables::item::TokenSetDisplay;
+use crate::generate::cache::GenerateCache;
 use crate::generate::grammars::{LexicalGrammar, SyntaxGrammar};
 use crate::generate::nfa::{CharacterSet, NfaCursor, NfaTransition};
 use crate::generate::rules::TokenSet;
@@ -16,6 +18,30 @@ struct TokenConflictStatus {
     matches_different_string: bool,
 }
 
+impl TokenConflictStatus {
+    fn to_bits(&self) -> u8 {
+        (self.matches_prefix as u8)
+            | (self.does_match_continuation as u8) << 1
+            | (self.does_match_valid_continuation as u8) << 2
+            | (self.does_match_separators as u8) << 3
+            | (self.matches_same_string as u8) << 4
+            | (self.matches_different_string as u8) << 5
+    }
+
+    fn from_bits(bits: u8) -> Self {
+        Self {
+            matches_prefix: bits & 1 != 0,
+            does_match_continuation: bits & 1 << 1 != 0,
+            does_match_valid_continuation: bits & 1 << 2 != 0,
+            does_match_separators: bits & 1 << 3 != 0,
+            matches_same_string: bits & 1 << 4 != 0,
+            matches_different_string: bits & 1 << 5 != 0,
+        }
+    }
+}
+
+const CACHE_ENTRY_NAME: &'static str = "token-conflicts";
+
 pub(crate) struct TokenConflictMap<'a> {
     n: usize,
     status_matrix: Vec<TokenConflictStatus>,
@@ -33,19 +59,61 @@ impl<'a> TokenConflictMap<'a> {
     /// This analyzes the possible kinds of overlap between each pair of tokens and stores
     /// them in a matrix.
     pub fn new(grammar: &'a LexicalGrammar, following_tokens: Vec<TokenSet>) -> Self {
+        Self::new_with_cache(grammar, following_tokens, None)
+    }
+
+    /// Create a token conflict map, reusing the conflict matrix from a previous run
+    /// of the generator if the lexical grammar and the `following_token` map are
+    /// unchanged. This is usually the case when only syntactic rules have been edited.
+    pub fn new_with_cache(
+        grammar: &'a LexicalGrammar,
+        following_tokens: Vec<TokenSet>,
+        cache: Option<&GenerateCache>,
+    ) -> Self {
         let mut cursor = NfaCursor::new(&grammar.nfa, Vec::new());
         let starting_chars = get_starting_chars(&mut cursor, grammar);
         let following_chars = get_following_chars(&starting_chars, &following_tokens);
 
         let n = grammar.variables.len();
-        let mut status_matrix = vec![TokenConflictStatus::default(); n * n];
-        for i in 0..grammar.variables.len() {
-            for j in 0..i {
-                let status = compute_conflict_status(&mut cursor, grammar, &following_chars, i, j);
-                status_matrix[matrix_index(n, i, j)] = status.0;
-                status_matrix[matrix_index(n, j, i)] = status.1;
+        let cache = cache.map(|cache| (cache, GenerateCache::key(&(grammar, &following_tokens))));
+        let cached_matrix = cache
+            .and_then(|(cache, key)| cache.load(CACHE_ENTRY_NAME, key))
+            .filter(|bytes| bytes.len() == n * n)
+            .map(|bytes| {
+                bytes
+                    .into_iter()
+                    .map(TokenConflictStatus::from_bits)
+                    .collect::<Vec<_>>()
+            });
+
+        let status_matrix = cached_matrix.unwrap_or_else(|| {
+            // Each pair of tokens is analyzed independently, so the rows of the matrix
+            // are computed in parallel, each worker thread using its own NFA cursor.
+            let mut status_matrix = vec![TokenConflictStatus::default(); n * n];
+            let rows = parallel_map(
+                n,
+                || NfaCursor::new(&grammar.nfa, Vec::new()),
+                |cursor, i| {
+                    (0..i)
+                        .map(|j| compute_conflict_status(cursor, grammar, &following_chars, i, j))
+                        .collect::<Vec<_>>()
+                },
+            );
+            for (i, row) in rows.into_iter().enumerate() {
+                for (j, status) in row.into_iter().enumerate() {
+                    status_matrix[matrix_index(n, i, j)] = status.0;
+                    status_matrix[matrix_index(n, j, i)] = status.1;
+                }
             }
-        }
+            if let Some((cache, key)) = cache {
+                let bytes = status_matrix
+                    .iter()
+                    .map(TokenConflictStatus::to_bits)
+                    .collect::<Vec<_>>();
+                cache.store(CACHE_ENTRY_NAME, key, &bytes);
+            }
+            status_matrix
+        });
 
         TokenConflictMap {
             n,
@@ -0,0 +1,84 @@
+use log::info;
+use std::env;
+use std::fs;
+use std::hash::{Hash, Hasher};
+use std::path::PathBuf;
+
+const FNV_OFFSET_BASIS: u64 = 0xcbf29ce484222325;
+const FNV_PRIME: u64 = 0x100000001b3;
+
+/// A directory where the generator saves intermediate results for one grammar,
+/// so that they can be reused when the grammar is generated again.
+///
+/// Each entry is stored along with a key that identifies all of the inputs that
+/// it was computed from, including the generator itself, and it is only reused if
+/// that key matches. Only the most recent version of each entry is kept.
+pub(crate) struct GenerateCache {
+    dir: PathBuf,
+}
+
+impl GenerateCache {
+    pub fn new(language_name: &str) -> Option<Self> {
+        let dir = dirs::cache_dir()?
+            .join("tree-sitter")
+            .join("generate")
+            .join(language_name);
+        Some(Self { dir })
+    }
+
+    /// Compute a cache key for the given inputs. The key does not depend on anything
+    /// but the inputs and the identity of the running generator.
+    pub fn key(inputs: &impl Hash) -> u64 {
+        let mut hasher = StableHasher(FNV_OFFSET_BASIS);
+        env!("CARGO_PKG_VERSION").hash(&mut hasher);
+        if let Some(metadata) = env::current_exe().and_then(fs::metadata).ok() {
+            metadata.len().hash(&mut hasher);
+            metadata.modified().ok().hash(&mut hasher);
+        }
+        inputs.hash(&mut hasher);
+        hasher.finish()
+    }
+
+    pub fn load(&self, name: &str, key: u64) -> Option<Vec<u8>> {
+        let mut contents = fs::read(self.dir.join(name)).ok()?;
+        if contents.len() < 8 || contents[0..8] != key.to_le_bytes() {
+            return None;
+        }
+        info!("generate cache - reusing {}", name);
+        contents.drain(0..8);
+        Some(contents)
+    }
+
+    /// Save an entry in the cache. Failing to save an entry is not an error, since
+    /// it only means that the entry will be recomputed next time.
+    pub fn store(&self, name: &str, key: u64, contents: &[u8]) {
+        let path = self.dir.join(name);
+        let temp_path = self.dir.join(format!("{}.{}.tmp", name, std::process::id()));
+        let mut data = Vec::with_capacity(contents.len() + 8);
+        data.extend_from_slice(&key.to_le_bytes());
+        data.extend_from_slice(contents);
+        let result = fs::create_dir_all(&self.dir)
+            .and_then(|_| fs::write(&temp_path, &data))
+            .and_then(|_| fs::rename(&temp_path, &path));
+        if let Err(error) = result {
+            info!("generate cache - failed to store {}: {}", name, error);
+            fs::remove_file(&temp_path).ok();
+        }
+    }
+}
+
+// The standard library's default hasher is randomly seeded, so its results can't be
+// stored. This is a 64-bit FNV-1a hash instead.
+struct StableHasher(u64);
+
+impl Hasher for StableHasher {
+    fn write(&mut self, bytes: &[u8]) {
+        for byte in bytes {
+            self.0 = (self.0 ^ *byte as u64).wrapping_mul(FNV_PRIME);
+        }
+    }
+
+    fn finish(&self) -> u64 {
+        self.0
+    }
+}
@@ -3,7 +3,7 @@ use super::rules::{Alias, Associativity, Precedence, Rule, Symbol};
 use std::collections::HashMap;
 use std::fmt;
 
-#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord, Hash)]
 pub(crate) enum VariableType {
     Hidden,
     Auxiliary,
@@ -41,7 +41,7 @@ pub(crate) struct InputGrammar {
 
 // Extracted lexical grammar
 
-#[derive(Debug, PartialEq, Eq)]
+#[derive(Debug, PartialEq, Eq, Hash)]
 pub(crate) struct LexicalVariable {
     pub name: String,
     pub kind: VariableType,
@@ -49,7 +49,7 @@ pub(crate) struct LexicalVariable {
     pub start_state: u32,
 }
 
-#[derive(Debug, Default, PartialEq, Eq)]
+#[derive(Debug, Default, PartialEq, Eq, Hash)]
 pub(crate) struct LexicalGrammar {
     pub nfa: Nfa,
     pub variables: Vec<LexicalVariable>,
@@ -78,6 +78,10 @@ pub(crate) struct InlinedProductionMap {
     pub production_map: HashMap<(*const Production, u32), Vec<usize>>,
 }
 
+// The production pointers are only used as map keys, and are never dereferenced.
+unsafe impl Send for InlinedProductionMap {}
+unsafe impl Sync for InlinedProductionMap {}
+
 #[derive(Clone, Debug, PartialEq, Eq)]
 pub(crate) struct SyntaxVariable {
     pub name: String,
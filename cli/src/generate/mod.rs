@@ -1,5 +1,6 @@
 mod binding_files;
 mod build_tables;
+mod cache;
 mod char_tree;
 mod dedup;
 mod grammars;
@@ -10,13 +11,16 @@ mod prepare_grammar;
 mod render;
 mod rules;
 mod tables;
+mod timing;
 
 use self::build_tables::build_tables;
+use self::cache::GenerateCache;
 use self::grammars::{InlinedProductionMap, LexicalGrammar, SyntaxGrammar};
 use self::parse_grammar::parse_grammar;
 use self::prepare_grammar::prepare_grammar;
 use self::render::render_c_code;
 use self::rules::AliasMap;
+use self::timing::PhaseTimer;
 use anyhow::{anyhow, Context, Result};
 use lazy_static::lazy_static;
 use regex::{Regex, RegexBuilder};
@@ -41,7 +45,10 @@ pub fn generate_parser_in_directory(
     repo_path: &PathBuf,
     grammar_path: Option<&str>,
     next_abi: bool,
+    compact_tables: bool,
+    table_lexer: bool,
     generate_bindings: bool,
+    use_cache: bool,
     report_symbol_name: Option<&str>,
 ) -> Result<()> {
     let src_path = repo_path.join("src");
@@ -64,25 +71,63 @@ pub fn generate_parser_in_directory(
         }
     }
 
-    // Parse and preprocess the grammar.
+    let mut timer = PhaseTimer::new();
     let input_grammar = parse_grammar(&grammar_json)?;
-    let (syntax_grammar, lexical_grammar, inlines, simple_aliases) =
-        prepare_grammar(&input_grammar)?;
-    let language_name = input_grammar.name;
+    let language_name = input_grammar.name.clone();
+    let cache = if use_cache {
+        GenerateCache::new(&language_name)
+    } else {
+        None
+    };
+
+    // If the grammar hasn't changed since it was last generated, reuse the outputs.
+    let outputs_key = GenerateCache::key(&(&grammar_json, next_abi, compact_tables, table_lexer));
+    let cached_outputs = cache
+        .as_ref()
+        .filter(|_| report_symbol_name.is_none())
+        .and_then(|cache| {
+            Some(GeneratedParser {
+                c_code: String::from_utf8(cache.load("parser.c", outputs_key)?).ok()?,
+                node_types_json: String::from_utf8(cache.load("node-types.json", outputs_key)?)
+                    .ok()?,
+            })
+        });
 
-    // Generate the parser and related files.
     let GeneratedParser {
         c_code,
         node_types_json,
-    } = generate_parser_for_grammar_with_opts(
-        &language_name,
-        syntax_grammar,
-        lexical_grammar,
-        inlines,
-        simple_aliases,
-        next_abi,
-        report_symbol_name,
-    )?;
+    } = match cached_outputs {
+        Some(outputs) => outputs,
+        None => {
+            // Preprocess the grammar.
+            let (syntax_grammar, lexical_grammar, inlines, simple_aliases) =
+                prepare_grammar(&input_grammar)?;
+            timer.finish_phase("prepare grammar");
+
+            // Generate the parser and related files.
+            let outputs = generate_parser_for_grammar_with_opts(
+                &language_name,
+                syntax_grammar,
+                lexical_grammar,
+                inlines,
+                simple_aliases,
+                next_abi,
+                compact_tables,
+                table_lexer,
+                report_symbol_name,
+                cache.as_ref(),
+            )?;
+            if let Some(cache) = &cache {
+                cache.store("parser.c", outputs_key, outputs.c_code.as_bytes());
+                cache.store(
+                    "node-types.json",
+                    outputs_key,
+                    outputs.node_types_json.as_bytes(),
+                );
+            }
+            outputs
+        }
+    };
 
     write_file(&src_path.join("parser.c"), c_code)?;
     write_file(&src_path.join("node-types.json"), node_types_json)?;
@@ -99,6 +144,14 @@ pub fn generate_parser_in_directory(
 }
 
 pub fn generate_parser_for_grammar(grammar_json: &str) -> Result<(String, String)> {
+    generate_parser_for_grammar_with_table_options(grammar_json, false, false)
+}
+
+pub fn generate_parser_for_grammar_with_table_options(
+    grammar_json: &str,
+    compact_tables: bool,
+    table_lexer: bool,
+) -> Result<(String, String)> {
     let grammar_json = JSON_COMMENT_REGEX.replace_all(grammar_json, "\n");
     let input_grammar = parse_grammar(&grammar_json)?;
     let (syntax_grammar, lexical_grammar, inlines, simple_aliases) =
@@ -110,6 +163,9 @@ pub fn generate_parser_for_grammar(grammar_json: &str) -> Result<(String, String
         inlines,
         simple_aliases,
         true,
+        compact_tables,
+        table_lexer,
+        None,
         None,
     )?;
     Ok((input_grammar.name, parser.c_code))
@@ -122,8 +178,12 @@ fn generate_parser_for_grammar_with_opts(
     inlines: InlinedProductionMap,
     simple_aliases: AliasMap,
     next_abi: bool,
+    compact_tables: bool,
+    table_lexer: bool,
     report_symbol_name: Option<&str>,
+    cache: Option<&GenerateCache>,
 ) -> Result<GeneratedParser> {
+    let mut timer = PhaseTimer::new();
     let variable_info =
         node_types::get_variable_info(&syntax_grammar, &lexical_grammar, &simple_aliases)?;
     let node_types_json = node_types::generate_node_types_json(
@@ -132,6 +192,7 @@ fn generate_parser_for_grammar_with_opts(
         &simple_aliases,
         &variable_info,
     );
+    timer.finish_phase("compute node types");
     let (parse_table, main_lex_table, keyword_lex_table, keyword_capture_token) = build_tables(
         &syntax_grammar,
         &lexical_grammar,
@@ -139,7 +200,9 @@ fn generate_parser_for_grammar_with_opts(
         &variable_info,
         &inlines,
         report_symbol_name,
+        cache,
     )?;
+    let mut timer = PhaseTimer::new();
     let c_code = render_c_code(
         name,
         parse_table,
@@ -150,7 +213,10 @@ fn generate_parser_for_grammar_with_opts(
         lexical_grammar,
         simple_aliases,
         next_abi,
+        compact_tables,
+        table_lexer,
     );
+    timer.finish_phase("render C code");
     Ok(GeneratedParser {
         c_code,
         node_types_json: serde_json::to_string_pretty(&node_types_json).unwrap(),
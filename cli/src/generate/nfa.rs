@@ -13,7 +13,7 @@ pub struct CharacterSet {
 }
 
 /// A state in an NFA representing a regular grammar.
-#[derive(Debug, PartialEq, Eq)]
+#[derive(Debug, PartialEq, Eq, Hash)]
 pub enum NfaState {
     Advance {
         chars: CharacterSet,
@@ -28,7 +28,7 @@ pub enum NfaState {
     },
 }
 
-#[derive(PartialEq, Eq)]
+#[derive(PartialEq, Eq, Hash)]
 pub struct Nfa {
     pub states: Vec<NfaState>,
 }
@@ -276,6 +276,10 @@ impl CharacterSet {
         }
     }
 
+    pub fn ranges<'a>(&'a self) -> impl Iterator<Item = Range<u32>> + 'a {
+        self.ranges.iter().cloned()
+    }
+
     pub fn iter<'a>(&'a self) -> impl Iterator<Item = u32> + 'a {
         self.ranges.iter().flat_map(|r| r.clone())
     }
@@ -1,5 +1,6 @@
 use super::char_tree::{CharacterTree, Comparator};
 use super::grammars::{ExternalToken, LexicalGrammar, SyntaxGrammar, VariableType};
+use super::nfa::CharacterSet;
 use super::rules::{Alias, AliasMap, Symbol, SymbolType};
 use super::tables::{
     AdvanceAction, FieldLocation, GotoAction, LexState, LexTable, ParseAction, ParseTable,
@@ -7,12 +8,15 @@ use super::tables::{
 };
 use core::ops::Range;
 use std::cmp;
-use std::collections::{HashMap, HashSet};
+use std::collections::{BTreeSet, HashMap, HashSet};
 use std::fmt::Write;
 use std::mem::swap;
 
 const LARGE_CHARACTER_RANGE_COUNT: usize = 8;
 const SMALL_STATE_THRESHOLD: usize = 64;
+const MAX_LEX_TABLE_STATE_COUNT: usize = 0x7fff;
+const LANGUAGE_VERSION_WITH_ADVANCE_WHILE: usize = 14;
+const LANGUAGE_VERSION_WITH_LEX_TABLES: usize = 14;
 
 macro_rules! add {
     ($this: tt, $($arg: tt)*) => {{
@@ -70,12 +74,15 @@ struct Generator {
 
     #[allow(unused)]
     next_abi: bool,
+    compact_tables: bool,
+    table_lexer: bool,
 }
 
 struct TransitionSummary {
     is_included: bool,
     ranges: Vec<Range<char>>,
     call_id: Option<usize>,
+    ascii_set_id: Option<usize>,
 }
 
 struct LargeCharacterSetInfo {
@@ -229,15 +236,24 @@ impl Generator {
         }
 
         // Determine which states should use the "small state" representation, and which should
-        // use the normal array representation.
-        let threshold = cmp::min(SMALL_STATE_THRESHOLD, self.parse_table.symbols.len() / 2);
+        // use the normal array representation. By default, states with many entries use the
+        // array representation, because their actions can be looked up directly. Compact tables
+        // only use it for states where it takes up less space.
+        let symbol_count = self.parse_table.symbols.len();
+        let threshold = cmp::min(SMALL_STATE_THRESHOLD, symbol_count / 2);
+        let compact_tables = self.compact_tables;
         self.large_state_count = self
             .parse_table
             .states
             .iter()
             .enumerate()
             .take_while(|(i, s)| {
-                *i <= 1 || s.terminal_entries.len() + s.nonterminal_entries.len() > threshold
+                *i <= 1
+                    || if compact_tables {
+                        s.small_state_size() > symbol_count
+                    } else {
+                        s.terminal_entries.len() + s.nonterminal_entries.len() > threshold
+                    }
             })
             .count();
     }
@@ -290,15 +306,7 @@ impl Generator {
             })
             .count();
 
-        add_line!(
-            self,
-            "#define LANGUAGE_VERSION {}",
-            if self.next_abi {
-                tree_sitter::LANGUAGE_VERSION
-            } else {
-                tree_sitter::LANGUAGE_VERSION - 1
-            }
-        );
+        add_line!(self, "#define LANGUAGE_VERSION {}", self.language_version());
 
         add_line!(
             self,
@@ -640,21 +648,68 @@ impl Generator {
         add_line!(self, "");
     }
 
+    // A parser is stamped with the oldest ABI version that provides all of the
+    // lexer functions that it calls, so that older libraries refuse to load it
+    // instead of calling functions that they don't have.
+    fn language_version(&self) -> usize {
+        if !self.next_abi {
+            return tree_sitter::MIN_COMPATIBLE_LANGUAGE_VERSION - 1;
+        }
+
+        let mut lex_tables = vec![&self.main_lex_table];
+        if self.keyword_capture_token.is_some() {
+            lex_tables.push(&self.keyword_lex_table);
+        }
+        let uses_advance_while = lex_tables.iter().any(|lex_table| {
+            lex_table
+                .states
+                .iter()
+                .enumerate()
+                .any(|(state_id, state)| {
+                    (0..state.advance_actions.len())
+                        .any(|i| looping_ascii_set(state_id, state, i).is_some())
+                })
+        });
+        let uses_lex_tables = lex_tables
+            .iter()
+            .any(|lex_table| self.uses_lex_table(lex_table));
+
+        let mut version = tree_sitter::MIN_COMPATIBLE_LANGUAGE_VERSION;
+        if uses_advance_while {
+            version = cmp::max(version, LANGUAGE_VERSION_WITH_ADVANCE_WHILE);
+        }
+        if uses_lex_tables {
+            version = cmp::max(version, LANGUAGE_VERSION_WITH_LEX_TABLES);
+        }
+        version
+    }
+
+    fn uses_lex_table(&self, lex_table: &LexTable) -> bool {
+        self.table_lexer && self.next_abi && lex_table.states.len() < MAX_LEX_TABLE_STATE_COUNT
+    }
+
     fn add_lex_function(
         &mut self,
         name: &str,
         lex_table: LexTable,
         extract_helper_functions: bool,
     ) {
+        if self.uses_lex_table(&lex_table) {
+            self.add_lex_table(name, lex_table);
+            return;
+        }
+
         let mut ruled_out_chars = HashSet::new();
         let mut large_character_sets = Vec::<LargeCharacterSetInfo>::new();
+        let mut ascii_sets = Vec::<[u32; 4]>::new();
 
         // For each lex state, compute a summary of the code that needs to be
         // generated.
         let state_transition_summaries: Vec<Vec<TransitionSummary>> = lex_table
             .states
             .iter()
-            .map(|state| {
+            .enumerate()
+            .map(|(state_id, state)| {
                 ruled_out_chars.clear();
 
                 // For each state transition, compute the set of character ranges
@@ -662,7 +717,8 @@ impl Generator {
                 state
                     .advance_actions
                     .iter()
-                    .map(|(chars, action)| {
+                    .enumerate()
+                    .map(|(i, (chars, action))| {
                         let is_included = !chars.contains(std::char::MAX);
                         let mut ranges;
                         if is_included {
@@ -700,10 +756,25 @@ impl Generator {
                             }
                         }
 
+                        // When a transition loops back to the same state, record the
+                        // ASCII characters that it consumes, so that the lexer can
+                        // advance past runs of those characters in bulk.
+                        let mut ascii_set_id = None;
+                        if self.next_abi {
+                            if let Some(ascii_set) = looping_ascii_set(state_id, state, i) {
+                                ascii_set_id = ascii_sets.iter().position(|s| *s == ascii_set);
+                                if ascii_set_id.is_none() {
+                                    ascii_set_id = Some(ascii_sets.len());
+                                    ascii_sets.push(ascii_set);
+                                }
+                            }
+                        }
+
                         TransitionSummary {
                             is_included,
                             ranges,
                             call_id,
+                            ascii_set_id,
                         }
                     })
                     .collect()
@@ -731,6 +802,25 @@ impl Generator {
             add_line!(self, "");
         }
 
+        // Generate a bitmap of ASCII characters for each looping transition.
+        if !ascii_sets.is_empty() {
+            add_line!(self, "static const uint32_t {}_ascii_sets[][4] = {{", name);
+            indent!(self);
+            for ascii_set in &ascii_sets {
+                add_line!(
+                    self,
+                    "{{0x{:08x}, 0x{:08x}, 0x{:08x}, 0x{:08x}}},",
+                    ascii_set[0],
+                    ascii_set[1],
+                    ascii_set[2],
+                    ascii_set[3]
+                );
+            }
+            dedent!(self);
+            add_line!(self, "}};");
+            add_line!(self, "");
+        }
+
         add_line!(
             self,
             "static bool {}(TSLexer *lexer, TSStateId state) {{",
@@ -746,7 +836,12 @@ impl Generator {
         for (i, state) in lex_table.states.into_iter().enumerate() {
             add_line!(self, "case {}:", i);
             indent!(self);
-            self.add_lex_state(state, &state_transition_summaries[i], &large_character_sets);
+            self.add_lex_state(
+                name,
+                state,
+                &state_transition_summaries[i],
+                &large_character_sets,
+            );
             dedent!(self);
         }
 
@@ -763,6 +858,313 @@ impl Generator {
         add_line!(self, "");
     }
 
+    fn add_lex_table(&mut self, name: &str, lex_table: LexTable) {
+        let end = char::MAX as u32 + 1;
+        let transition_for_action = |action: &AdvanceAction| {
+            if action.in_main_token {
+                format!("LEX_ADVANCE({})", action.state)
+            } else {
+                format!("LEX_SKIP({})", action.state)
+            }
+        };
+
+        // For each state, find the transition for every range of characters. When
+        // several transitions contain the same character, the first one takes
+        // precedence, as in the generated switch statements. The null character
+        // never matches a negated character set, because it is also the lookahead
+        // character at EOF, and invalid characters only match negated sets.
+        let mut boundaries = BTreeSet::new();
+        boundaries.extend([0, 1, 128].iter().cloned());
+        let mut state_ranges = Vec::with_capacity(lex_table.states.len());
+        let mut invalid_character_transitions = Vec::with_capacity(lex_table.states.len());
+        for state in &lex_table.states {
+            let mut covered_chars = CharacterSet::empty();
+            let mut ranges = Vec::new();
+            let mut invalid_character_transition = None;
+            for (chars, action) in &state.advance_actions {
+                let mut chars = chars.clone();
+                if chars.contains(char::MAX) {
+                    chars.remove_intersection(&mut CharacterSet::from_char('\0'));
+                    if invalid_character_transition.is_none() {
+                        invalid_character_transition = Some(action);
+                    }
+                }
+                chars.remove_intersection(&mut covered_chars.clone());
+                covered_chars = covered_chars.add(&chars);
+                for range in chars.ranges() {
+                    boundaries.insert(range.start);
+                    boundaries.insert(range.end);
+                    ranges.push((range, action));
+                }
+            }
+            ranges.sort_unstable_by_key(|(range, _)| range.start);
+            state_ranges.push(ranges);
+            invalid_character_transitions.push(invalid_character_transition);
+        }
+
+        // Divide the characters into classes, such that every state has the same
+        // transition for all of the characters in a class. The last class is for
+        // invalid characters.
+        let interval_starts = boundaries
+            .into_iter()
+            .filter(|c| *c < end)
+            .collect::<Vec<_>>();
+        let mut interval_transitions =
+            vec![Vec::with_capacity(lex_table.states.len()); interval_starts.len() + 1];
+        for (state_id, ranges) in state_ranges.iter().enumerate() {
+            let mut i = 0;
+            for (interval_id, start) in interval_starts.iter().enumerate() {
+                while i < ranges.len() && ranges[i].0.end <= *start {
+                    i += 1;
+                }
+                interval_transitions[interval_id].push(
+                    ranges
+                        .get(i)
+                        .filter(|(range, _)| range.start <= *start)
+                        .map(|(_, action)| *action),
+                );
+            }
+            interval_transitions[interval_starts.len()]
+                .push(invalid_character_transitions[state_id]);
+        }
+
+        let mut class_ids_by_transitions = HashMap::new();
+        let mut class_transitions = Vec::new();
+        let interval_class_ids = interval_transitions
+            .into_iter()
+            .map(|transitions| {
+                *class_ids_by_transitions
+                    .entry(transitions.clone())
+                    .or_insert_with(|| {
+                        class_transitions.push(transitions);
+                        class_transitions.len() - 1
+                    })
+            })
+            .collect::<Vec<_>>();
+        let invalid_character_class = interval_class_ids[interval_starts.len()];
+        let ascii_class_ids = (0..128)
+            .map(|c| {
+                interval_class_ids[interval_starts.binary_search(&c).unwrap_or_else(|i| i - 1)]
+            })
+            .collect::<Vec<_>>();
+
+        // Many states have the same transitions for every class, so they can share
+        // a row of the transition table.
+        let mut rows = Vec::new();
+        let mut row_ids_by_transitions = HashMap::new();
+        let state_row_ids = (0..lex_table.states.len())
+            .map(|state_id| {
+                let row = class_transitions
+                    .iter()
+                    .map(|transitions| transitions[state_id])
+                    .collect::<Vec<_>>();
+                *row_ids_by_transitions
+                    .entry(row.clone())
+                    .or_insert_with(|| {
+                        rows.push(row);
+                        rows.len() - 1
+                    })
+            })
+            .collect::<Vec<_>>();
+
+        // When a state loops back to itself on ASCII characters, record those
+        // characters, so that the lexer can advance past runs of them in bulk.
+        let mut ascii_sets = Vec::<[u32; 4]>::new();
+        let state_ascii_set_ids = (0..lex_table.states.len())
+            .map(|state_id| {
+                let mut loops = [[0u32; 4]; 2];
+                for c in 1..128 {
+                    if let Some(action) = class_transitions[ascii_class_ids[c]][state_id] {
+                        if action.state == state_id {
+                            loops[action.in_main_token as usize][c / 32] |= 1 << (c % 32);
+                        }
+                    }
+                }
+                let ascii_set = *loops
+                    .iter()
+                    .max_by_key(|set| set.iter().map(|bits| bits.count_ones()).sum::<u32>())
+                    .unwrap();
+                if ascii_set == [0; 4] {
+                    return None;
+                }
+                Some(
+                    ascii_sets
+                        .iter()
+                        .position(|s| *s == ascii_set)
+                        .unwrap_or_else(|| {
+                            ascii_sets.push(ascii_set);
+                            ascii_sets.len() - 1
+                        }),
+                )
+            })
+            .collect::<Vec<_>>();
+
+        add_line!(
+            self,
+            "static const TSLexTableState {}_states[{}] = {{",
+            name,
+            lex_table.states.len()
+        );
+        indent!(self);
+        for (state_id, state) in lex_table.states.iter().enumerate() {
+            add_whitespace!(self);
+            add!(self, "[{}] = {{", state_id);
+            if let Some(accept_action) = state.accept_action {
+                add!(
+                    self,
+                    ".accept_symbol = {}, .accepts_token = true, ",
+                    self.symbol_ids[&accept_action]
+                );
+            }
+            if let Some(eof_action) = &state.eof_action {
+                add!(
+                    self,
+                    ".eof_transition = {}, ",
+                    transition_for_action(eof_action)
+                );
+            }
+            if let Some(ascii_set_id) = state_ascii_set_ids[state_id] {
+                add!(self, ".ascii_set = {}, ", ascii_set_id + 1);
+            }
+            add!(self, ".transition_row = {}}},\n", state_row_ids[state_id]);
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static const uint16_t {}_ascii_character_classes[128] = {{",
+            name
+        );
+        indent!(self);
+        for chunk in ascii_class_ids.chunks(16) {
+            add_whitespace!(self);
+            for (i, class_id) in chunk.iter().enumerate() {
+                if i > 0 {
+                    add!(self, " ");
+                }
+                add!(self, "{},", class_id);
+            }
+            add!(self, "\n");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        let mut character_ranges = Vec::<(u32, usize)>::new();
+        for (start, class_id) in interval_starts.iter().zip(interval_class_ids.iter()) {
+            if *start >= 128 && character_ranges.last().map(|r| r.1) != Some(*class_id) {
+                character_ranges.push((*start, *class_id));
+            }
+        }
+        add_line!(
+            self,
+            "static const TSLexTableRange {}_character_ranges[{}] = {{",
+            name,
+            character_ranges.len()
+        );
+        indent!(self);
+        for chunk in character_ranges.chunks(8) {
+            add_whitespace!(self);
+            for (i, (start, class_id)) in chunk.iter().enumerate() {
+                if i > 0 {
+                    add!(self, " ");
+                }
+                add!(self, "{{0x{:x}, {}}},", start, class_id);
+            }
+            add!(self, "\n");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static const uint16_t {}_transitions[{}][{}] = {{",
+            name,
+            rows.len(),
+            class_transitions.len()
+        );
+        indent!(self);
+        for (row_id, row) in rows.iter().enumerate() {
+            add_line!(self, "[{}] = {{", row_id);
+            indent!(self);
+            for (class_id, action) in row.iter().enumerate() {
+                if let Some(action) = action {
+                    add_line!(self, "[{}] = {},", class_id, transition_for_action(action));
+                }
+            }
+            dedent!(self);
+            add_line!(self, "}},");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        if !ascii_sets.is_empty() {
+            add_line!(self, "static const uint32_t {}_ascii_sets[][4] = {{", name);
+            indent!(self);
+            for ascii_set in &ascii_sets {
+                add_line!(
+                    self,
+                    "{{0x{:08x}, 0x{:08x}, 0x{:08x}, 0x{:08x}}},",
+                    ascii_set[0],
+                    ascii_set[1],
+                    ascii_set[2],
+                    ascii_set[3]
+                );
+            }
+            dedent!(self);
+            add_line!(self, "}};");
+            add_line!(self, "");
+        }
+
+        add_line!(self, "static const TSLexTable {}_table = {{", name);
+        indent!(self);
+        add_line!(self, ".states = {}_states,", name);
+        add_line!(
+            self,
+            ".ascii_character_classes = {}_ascii_character_classes,",
+            name
+        );
+        add_line!(self, ".character_ranges = {}_character_ranges,", name);
+        add_line!(self, ".transitions = &{}_transitions[0][0],", name);
+        if !ascii_sets.is_empty() {
+            add_line!(self, ".ascii_sets = {}_ascii_sets,", name);
+        }
+        add_line!(self, ".state_count = {},", lex_table.states.len());
+        add_line!(self, ".character_range_count = {},", character_ranges.len());
+        add_line!(
+            self,
+            ".character_class_count = {},",
+            class_transitions.len()
+        );
+        add_line!(
+            self,
+            ".invalid_character_class = {},",
+            invalid_character_class
+        );
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static bool {}(TSLexer *lexer, TSStateId state) {{",
+            name
+        );
+        indent!(self);
+        add_line!(
+            self,
+            "return lexer->run_lex_table(lexer, &{}_table, state);",
+            name
+        );
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "");
+    }
+
     fn symbol_for_advance_action(
         &self,
         action: &AdvanceAction,
@@ -788,6 +1190,7 @@ impl Generator {
 
     fn add_lex_state(
         &mut self,
+        name: &str,
         state: LexState,
         transition_info: &Vec<TransitionSummary>,
         large_character_sets: &Vec<LargeCharacterSetInfo>,
@@ -818,7 +1221,7 @@ impl Generator {
                     self.symbol_ids[&info.symbol],
                     info.index
                 );
-                self.add_advance_action(&action);
+                self.add_advance_action(name, &action, transition.ascii_set_id);
                 add!(self, "\n");
                 continue;
             }
@@ -830,7 +1233,7 @@ impl Generator {
                 self.add_character_range_conditions(&transition.ranges, transition.is_included, 2);
                 add!(self, ") ");
             }
-            self.add_advance_action(&action);
+            self.add_advance_action(name, &action, transition.ascii_set_id);
             add!(self, "\n");
         }
 
@@ -956,8 +1359,31 @@ impl Generator {
         }
     }
 
-    fn add_advance_action(&mut self, action: &AdvanceAction) {
-        if action.in_main_token {
+    fn add_advance_action(
+        &mut self,
+        name: &str,
+        action: &AdvanceAction,
+        ascii_set_id: Option<usize>,
+    ) {
+        if let Some(ascii_set_id) = ascii_set_id {
+            if action.in_main_token {
+                add!(
+                    self,
+                    "ADVANCE_WHILE({}, {}_ascii_sets[{}]);",
+                    action.state,
+                    name,
+                    ascii_set_id
+                );
+            } else {
+                add!(
+                    self,
+                    "SKIP_WHILE({}, {}_ascii_sets[{}]);",
+                    action.state,
+                    name,
+                    ascii_set_id
+                );
+            }
+        } else if action.in_main_token {
             add!(self, "ADVANCE({});", action.state);
         } else {
             add!(self, "SKIP({})", action.state);
@@ -1135,9 +1561,15 @@ impl Generator {
 
             let mut index = 0;
             let mut small_state_indices = Vec::new();
+            let mut small_state_indices_by_contents = HashMap::new();
             let mut symbols_by_value: HashMap<(usize, SymbolType), Vec<Symbol>> = HashMap::new();
-            for state in self.parse_table.states.iter().skip(self.large_state_count) {
-                small_state_indices.push(index);
+            for (i, state) in self
+                .parse_table
+                .states
+                .iter()
+                .enumerate()
+                .skip(self.large_state_count)
+            {
                 symbols_by_value.clear();
 
                 terminal_entries.clear();
@@ -1161,9 +1593,7 @@ impl Generator {
                 for (symbol, action) in &state.nonterminal_entries {
                     let state_id = match action {
                         GotoAction::Goto(i) => *i,
-                        GotoAction::ShiftExtra => {
-                            self.large_state_count + small_state_indices.len() - 1
-                        }
+                        GotoAction::ShiftExtra => i,
                     };
                     symbols_by_value
                         .entry((state_id, SymbolType::NonTerminal))
@@ -1172,21 +1602,33 @@ impl Generator {
                 }
 
                 let mut values_with_symbols = symbols_by_value.drain().collect::<Vec<_>>();
+                for (_, symbols) in values_with_symbols.iter_mut() {
+                    symbols.sort_unstable();
+                }
                 values_with_symbols.sort_unstable_by_key(|((value, kind), symbols)| {
                     (symbols.len(), *kind, *value, symbols[0])
                 });
 
+                // Many small states have exactly the same entries. These states can all
+                // share one copy of their entries.
+                if let Some(existing_index) =
+                    small_state_indices_by_contents.get(&values_with_symbols)
+                {
+                    small_state_indices.push(*existing_index);
+                    continue;
+                }
+                small_state_indices.push(index);
+
                 add_line!(self, "[{}] = {},", index, values_with_symbols.len());
                 indent!(self);
 
-                for ((value, kind), symbols) in values_with_symbols.iter_mut() {
+                for ((value, kind), symbols) in values_with_symbols.iter() {
                     if *kind == SymbolType::NonTerminal {
                         add_line!(self, "STATE({}), {},", value, symbols.len());
                     } else {
                         add_line!(self, "ACTIONS({}), {},", value, symbols.len());
                     }
 
-                    symbols.sort_unstable();
                     indent!(self);
                     for symbol in symbols {
                         add_line!(self, "{},", self.symbol_ids[symbol]);
@@ -1196,10 +1638,12 @@ impl Generator {
 
                 dedent!(self);
 
-                index += 1 + values_with_symbols
+                let size = 1 + values_with_symbols
                     .iter()
                     .map(|(_, symbols)| 2 + symbols.len())
                     .sum::<usize>();
+                small_state_indices_by_contents.insert(values_with_symbols, index);
+                index += size;
             }
 
             dedent!(self);
@@ -1587,6 +2031,36 @@ impl Generator {
     }
 }
 
+/// The ASCII characters that a lex state's transition consumes while looping
+/// back to the same state, as a bitmap. Characters that are matched by an
+/// earlier transition are excluded.
+fn looping_ascii_set(
+    state_id: usize,
+    state: &LexState,
+    transition_index: usize,
+) -> Option<[u32; 4]> {
+    let (chars, action) = &state.advance_actions[transition_index];
+    if action.state != state_id {
+        return None;
+    }
+
+    let mut ascii_set = [0u32; 4];
+    for c in (1..128u8).map(char::from) {
+        if chars.contains(c)
+            && !state.advance_actions[0..transition_index]
+                .iter()
+                .any(|(chars, _)| chars.contains(c))
+        {
+            ascii_set[c as usize / 32] |= 1 << (c as usize % 32);
+        }
+    }
+    if ascii_set == [0; 4] {
+        None
+    } else {
+        Some(ascii_set)
+    }
+}
+
 /// Returns a String of C code for the given components of a parser.
 ///
 /// # Arguments
@@ -1604,6 +2078,12 @@ impl Generator {
 ///    are the aliases that are applied to those symbols.
 /// * `next_abi` - A boolean indicating whether to opt into the new, unstable parse
 ///    table format. This is mainly used for testing, when developing Tree-sitter itself.
+/// * `compact_tables` - A boolean indicating whether to choose the representation of
+///    each parse state based only on its size, which makes the generated parser smaller
+///    at the cost of slower parse table lookups.
+/// * `table_lexer` - A boolean indicating whether to describe the lexer as a table of
+///    transitions between character classes, which is run by the library, instead of
+///    generating code for it. This requires the new parse table format.
 pub(crate) fn render_c_code(
     name: &str,
     parse_table: ParseTable,
@@ -1614,6 +2094,8 @@ pub(crate) fn render_c_code(
     lexical_grammar: LexicalGrammar,
     default_aliases: AliasMap,
     next_abi: bool,
+    compact_tables: bool,
+    table_lexer: bool,
 ) -> String {
     Generator {
         buffer: String::new(),
@@ -1634,6 +2116,8 @@ pub(crate) fn render_c_code(
         unique_aliases: Vec::new(),
         field_names: Vec::new(),
         next_abi,
+        compact_tables,
+        table_lexer,
     }
     .generate()
 }
@@ -1,6 +1,6 @@
 use super::nfa::CharacterSet;
 use super::rules::{Alias, Symbol, TokenSet};
-use std::collections::BTreeMap;
+use std::collections::{BTreeMap, HashSet};
 pub(crate) type ProductionInfoId = usize;
 pub(crate) type ParseStateId = usize;
 pub(crate) type LexStateId = usize;
@@ -70,7 +70,7 @@ pub(crate) struct ParseTable {
     pub external_lex_states: Vec<TokenSet>,
 }
 
-#[derive(Clone, Debug, PartialEq, Eq, PartialOrd, Ord)]
+#[derive(Clone, Debug, PartialEq, Eq, Hash, PartialOrd, Ord)]
 pub(crate) struct AdvanceAction {
     pub state: LexStateId,
     pub in_main_token: bool,
@@ -127,6 +127,25 @@ impl ParseState {
             }))
     }
 
+    /// The number of 16-bit values needed to store this state in the "small state"
+    /// representation of the parse table, in which lookahead symbols are grouped by
+    /// their actions.
+    pub fn small_state_size(&self) -> usize {
+        let action_count = self.terminal_entries.values().collect::<HashSet<_>>().len();
+        let goto_count = self
+            .nonterminal_entries
+            .values()
+            .map(|action| match action {
+                GotoAction::Goto(state) => Some(*state),
+                GotoAction::ShiftExtra => None,
+            })
+            .collect::<HashSet<_>>()
+            .len();
+        1 + 2 * (action_count + goto_count)
+            + self.terminal_entries.len()
+            + self.nonterminal_entries.len()
+    }
+
     pub fn update_referenced_states<F>(&mut self, mut f: F)
     where
         F: FnMut(usize, &ParseState) -> usize,
@@ -0,0 +1,51 @@
+use log::info;
+use std::time::Instant;
+
+/// Logs how long each phase of parser generation takes, along with the peak
+/// memory usage of the process at the end of the phase. These messages are
+/// shown by `tree-sitter generate --log`, and make it possible to tell which
+/// phase is responsible when a large grammar is slow to generate.
+pub(crate) struct PhaseTimer {
+    start: Instant,
+}
+
+impl PhaseTimer {
+    pub fn new() -> Self {
+        Self {
+            start: Instant::now(),
+        }
+    }
+
+    pub fn finish_phase(&mut self, name: &str) {
+        let now = Instant::now();
+        let duration = now - self.start;
+        match peak_memory_usage() {
+            Some(bytes) => info!(
+                "phase {} - {}ms, peak memory {}MB",
+                name,
+                duration.as_millis(),
+                bytes / (1024 * 1024)
+            ),
+            None => info!("phase {} - {}ms", name, duration.as_millis()),
+        }
+        self.start = now;
+    }
+}
+
+#[cfg(target_os = "linux")]
+fn peak_memory_usage() -> Option<u64> {
+    let status = std::fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find(|line| line.starts_with("VmHWM:"))?;
+    let kilobytes = line["VmHWM:".len()..]
+        .trim()
+        .trim_end_matches("kB")
+        .trim()
+        .parse::<u64>()
+        .ok()?;
+    Some(kilobytes * 1024)
+}
+
+#[cfg(not(target_os = "linux"))]
+fn peak_memory_usage() -> Option<u64> {
+    None
+}
@@ -1,10 +1,13 @@
 use anyhow::{anyhow, Context, Result};
 use clap::{App, AppSettings, Arg, SubCommand};
 use glob::glob;
-use std::path::Path;
+use std::path::{Path, PathBuf};
+use std::time::Instant;
 use std::{env, fs, u64};
+use tree_sitter::Parser;
 use tree_sitter_cli::{
-    generate, highlight, logger, parse, playground, query, tags, test, test_highlight, util, wasm,
+    batch, generate, highlight, logger, parse, playground, query, tags, test, test_highlight, util,
+    wasm,
 };
 use tree_sitter_config::Config;
 use tree_sitter_loader as loader;
@@ -74,6 +77,12 @@ fn run() -> Result<()> {
         .long("quiet")
         .short("q");
 
+    let jobs_arg = Arg::with_name("jobs")
+        .help("The number of files to process in parallel (0 uses one job per CPU)")
+        .long("jobs")
+        .short("j")
+        .takes_value(true);
+
     let matches = App::new("tree-sitter")
         .author("Max Brunsfeld <maxbrunsfeld@gmail.com>")
         .about("Generates and tests parsers")
@@ -92,6 +101,9 @@ fn run() -> Result<()> {
                 .arg(Arg::with_name("log").long("log"))
                 .arg(Arg::with_name("prev-abi").long("prev-abi"))
                 .arg(Arg::with_name("no-bindings").long("no-bindings"))
+                .arg(Arg::with_name("no-cache").long("no-cache"))
+                .arg(Arg::with_name("compact-tables").long("compact-tables"))
+                .arg(Arg::with_name("table-lexer").long("table-lexer"))
                 .arg(
                     Arg::with_name("report-states-for-rule")
                         .long("report-states-for-rule")
@@ -125,6 +137,7 @@ fn run() -> Result<()> {
                 )
                 .arg(&time_arg)
                 .arg(&quiet_arg)
+                .arg(&jobs_arg)
                 .arg(
                     Arg::with_name("edits")
                         .help("Apply edits in the format: \"row,col del_count insert_text\"")
@@ -155,7 +168,27 @@ fn run() -> Result<()> {
                 )
                 .arg(&scope_arg)
                 .arg(Arg::with_name("captures").long("captures").short("c"))
-                .arg(Arg::with_name("test").long("test")),
+                .arg(Arg::with_name("test").long("test"))
+                .arg(&time_arg)
+                .arg(&quiet_arg)
+                .arg(&jobs_arg),
+        )
+        .subcommand(
+            SubCommand::with_name("compile-query")
+                .about("Compile a query into a C file that loads it without parsing it")
+                .arg(
+                    Arg::with_name("query-path")
+                        .help("Path to a file with queries")
+                        .index(1)
+                        .required(true),
+                )
+                .arg(
+                    Arg::with_name("output")
+                        .help("Path of the C file to write")
+                        .long("output")
+                        .short("o")
+                        .takes_value(true),
+                ),
         )
         .subcommand(
             SubCommand::with_name("tags")
@@ -267,12 +300,18 @@ fn run() -> Result<()> {
                 logger::init();
             }
             let new_abi = !matches.is_present("prev-abi");
+            let compact_tables = matches.is_present("compact-tables");
+            let table_lexer = matches.is_present("table-lexer");
             let generate_bindings = !matches.is_present("no-bindings");
+            let use_cache = !matches.is_present("no-cache");
             generate::generate_parser_in_directory(
                 &current_dir,
                 grammar_path,
                 new_abi,
+                compact_tables,
+                table_lexer,
                 generate_bindings,
+                use_cache,
                 report_symbol_name,
             )?;
         }
@@ -348,42 +387,77 @@ fn run() -> Result<()> {
             let loader_config = config.get()?;
             loader.find_all_languages(&loader_config)?;
 
+            // Debug output can't be interleaved between files, so disable
+            // parallelism when it is requested.
+            let job_count = if debug || debug_graph {
+                1
+            } else {
+                batch::job_count(matches.value_of("jobs"))?
+            };
+
+            let languages = paths
+                .iter()
+                .map(|path| {
+                    loader.select_language(Path::new(path), &current_dir, matches.value_of("scope"))
+                })
+                .collect::<Result<Vec<_>>>()?;
+
             let should_track_stats = matches.is_present("stat");
             let mut stats = parse::Stats::default();
+            let mut throughput_stats = batch::ThroughputStats::default();
 
-            for path in paths {
-                let path = Path::new(&path);
-                let language =
-                    loader.select_language(path, &current_dir, matches.value_of("scope"))?;
-
-                let this_file_errored = parse::parse_file_at_path(
-                    language,
-                    path,
-                    &edits,
-                    max_path_length,
-                    quiet,
-                    time,
-                    timeout,
-                    debug,
-                    debug_graph,
-                    debug_xml,
-                    Some(&cancellation_flag),
-                )?;
-
-                if should_track_stats {
-                    stats.total_parses += 1;
-                    if !this_file_errored {
-                        stats.successful_parses += 1;
+            let start_time = Instant::now();
+            batch::process_files(
+                &paths,
+                job_count,
+                || Ok((Parser::new(), Vec::new())),
+                |(parser, source_code), index, output| {
+                    parse::parse_file_at_path(
+                        parser,
+                        languages[index],
+                        Path::new(&paths[index]),
+                        source_code,
+                        output,
+                        &edits,
+                        max_path_length,
+                        quiet,
+                        time,
+                        timeout,
+                        debug,
+                        debug_graph,
+                        debug_xml,
+                        Some(&cancellation_flag),
+                    )
+                },
+                |index, output, result| {
+                    batch::write_output(output)?;
+
+                    if should_track_stats {
+                        stats.total_parses += 1;
+                        if !result.has_error {
+                            stats.successful_parses += 1;
+                        }
                     }
-                }
 
-                has_error |= this_file_errored;
-            }
+                    throughput_stats.files.push(batch::FileStats {
+                        path: paths[index].clone(),
+                        bytes: result.bytes,
+                        duration: result.duration,
+                    });
+                    has_error |= result.has_error;
+                    Ok(())
+                },
+            )?;
+            throughput_stats.elapsed = start_time.elapsed();
 
             if should_track_stats {
                 println!("{}", stats)
             }
 
+            if time && paths.len() > 1 {
+                print!("{}", throughput_stats);
+            }
+
             if has_error {
                 return Err(anyhow!(""));
             }
@@ -412,9 +486,32 @@ fn run() -> Result<()> {
                 ordered_captures,
                 range,
                 should_test,
+                matches.is_present("quiet"),
+                matches.is_present("time"),
+                batch::job_count(matches.value_of("jobs"))?,
             )?;
         }
 
+        ("compile-query", Some(matches)) => {
+            let languages = loader.languages_at_path(&current_dir)?;
+            let language = languages
+                .first()
+                .ok_or_else(|| anyhow!("No language found"))?;
+            let query_path = Path::new(matches.value_of("query-path").unwrap());
+            let output_path = match matches.value_of("output") {
+                Some(path) => PathBuf::from(path),
+                None => {
+                    let query_name = query_path
+                        .file_stem()
+                        .ok_or_else(|| anyhow!("Invalid query path {:?}", query_path))?;
+                    let mut file_name = query_name.to_os_string();
+                    file_name.push("_query.c");
+                    current_dir.join("src").join(file_name)
+                }
+            };
+            query::compile_query_at_path(*language, &current_dir, query_path, &output_path)?;
+        }
+
         ("tags", Some(matches)) => {
             let loader_config = config.get()?;
             loader.find_all_languages(&loader_config)?;
@@ -1,10 +1,11 @@
 use super::util;
 use anyhow::{anyhow, Context, Result};
-use std::io::{self, Write};
+use std::fs::File;
+use std::io::{self, Read, Write};
 use std::path::Path;
 use std::sync::atomic::AtomicUsize;
-use std::time::Instant;
-use std::{fmt, fs, usize};
+use std::time::{Duration, Instant};
+use std::{fmt, usize};
 use tree_sitter::{InputEdit, Language, LogType, Parser, Point, Tree};
 
 #[derive(Debug)]
@@ -30,9 +31,24 @@ impl fmt::Display for Stats {
     }
 }
 
+/// The outcome of parsing a single file.
+#[derive(Debug)]
+pub struct ParseResult {
+    pub has_error: bool,
+    pub bytes: usize,
+    pub duration: Duration,
+}
+
+/// Parse the file at the given path, writing the results to `output`.
+///
+/// The given parser and source buffer are reused, so that a caller parsing
+/// many files does not need to allocate them again for each file.
 pub fn parse_file_at_path(
+    parser: &mut Parser,
     language: Language,
     path: &Path,
+    source_code: &mut Vec<u8>,
+    output: &mut impl Write,
     edits: &Vec<&str>,
     max_path_length: usize,
     quiet: bool,
@@ -42,12 +58,14 @@ pub fn parse_file_at_path(
     debug_graph: bool,
     debug_xml: bool,
     cancellation_flag: Option<&AtomicUsize>,
-) -> Result<bool> {
+) -> Result<ParseResult> {
     let mut _log_session = None;
-    let mut parser = Parser::new();
     parser.set_language(language)?;
-    let mut source_code =
-        fs::read(path).with_context(|| format!("Error reading source file {:?}", path))?;
+    source_code.clear();
+    File::open(path)
+        .and_then(|mut file| file.read_to_end(source_code))
+        .with_context(|| format!("Error reading source file {:?}", path))?;
+    let bytes = source_code.len();
 
     // If the `--cancel` flag was passed, then cancel the parse
     // when the user types a newline.
@@ -58,7 +76,7 @@ pub fn parse_file_at_path(
 
     // Render an HTML graph if `--debug-graph` was passed
     if debug_graph {
-        _log_session = Some(util::log_graphs(&mut parser, "log.html")?);
+        _log_session = Some(util::log_graphs(parser, "log.html")?);
     }
     // Log to stderr if `--debug` was passed
     else if debug {
@@ -71,27 +89,72 @@ pub fn parse_file_at_path(
     }
 
     let time = Instant::now();
-    let tree = parser.parse(&source_code, None);
+    let tree = parse_with_edits(parser, source_code, edits, debug_graph);
+    let duration = time.elapsed();
 
-    let stdout = io::stdout();
-    let mut stdout = stdout.lock();
+    // The parser may be reused for other files.
+    parser.set_logger(None);
+    parser.stop_printing_dot_graphs();
 
-    if let Some(mut tree) = tree {
-        if debug_graph && !edits.is_empty() {
-            println!("BEFORE:\n{}", String::from_utf8_lossy(&source_code));
-        }
+    let has_error = print_tree(
+        tree?,
+        duration,
+        path,
+        source_code,
+        output,
+        max_path_length,
+        quiet,
+        print_time,
+        debug_xml,
+    )?;
 
-        for (i, edit) in edits.iter().enumerate() {
-            let edit = parse_edit_flag(&source_code, edit)?;
-            perform_edit(&mut tree, &mut source_code, &edit);
-            tree = parser.parse(&source_code, Some(&tree)).unwrap();
+    Ok(ParseResult {
+        has_error,
+        bytes,
+        duration,
+    })
+}
 
-            if debug_graph {
-                println!("AFTER {}:\n{}", i, String::from_utf8_lossy(&source_code));
-            }
+fn parse_with_edits(
+    parser: &mut Parser,
+    source_code: &mut Vec<u8>,
+    edits: &Vec<&str>,
+    debug_graph: bool,
+) -> Result<Option<Tree>> {
+    let mut tree = match parser.parse(&source_code, None) {
+        Some(tree) => tree,
+        None => return Ok(None),
+    };
+
+    if debug_graph && !edits.is_empty() {
+        println!("BEFORE:\n{}", String::from_utf8_lossy(&source_code));
+    }
+
+    for (i, edit) in edits.iter().enumerate() {
+        let edit = parse_edit_flag(&source_code, edit)?;
+        perform_edit(&mut tree, source_code, &edit);
+        tree = parser.parse(&source_code, Some(&tree)).unwrap();
+
+        if debug_graph {
+            println!("AFTER {}:\n{}", i, String::from_utf8_lossy(&source_code));
         }
+    }
 
-        let duration = time.elapsed();
+    Ok(Some(tree))
+}
+
+fn print_tree(
+    tree: Option<Tree>,
+    duration: Duration,
+    path: &Path,
+    source_code: &[u8],
+    stdout: &mut impl Write,
+    max_path_length: usize,
+    quiet: bool,
+    print_time: bool,
+    debug_xml: bool,
+) -> Result<bool> {
+    if let Some(tree) = tree {
         let duration_ms = duration.as_secs() * 1000 + duration.subsec_nanos() as u64 / 1000000;
         let mut cursor = tree.walk();
 
@@ -126,10 +189,10 @@ pub fn parse_file_at_path(
                         let start = node.start_position();
                         let end = node.end_position();
                         if let Some(field_name) = cursor.field_name() {
-                            write!(&mut stdout, "{}: ", field_name)?;
+                            write!(stdout, "{}: ", field_name)?;
                         }
                         write!(
-                            &mut stdout,
+                            stdout,
                             "({} [{}, {}] - [{}, {}]",
                             node.kind(),
                             start.row,
@@ -148,7 +211,7 @@ pub fn parse_file_at_path(
                 }
             }
             cursor.reset(tree.root_node());
-            println!("");
+            writeln!(stdout)?;
         }
 
         if debug_xml {
@@ -162,7 +225,7 @@ pub fn parse_file_at_path(
                 if did_visit_children {
                     if is_named {
                         let tag = tags.pop();
-                        write!(&mut stdout, "</{}>\n", tag.expect("there is a tag"))?;
+                        write!(stdout, "</{}>\n", tag.expect("there is a tag"))?;
                         needs_newline = true;
                     }
                     if cursor.goto_next_sibling() {
@@ -181,11 +244,11 @@ pub fn parse_file_at_path(
                         for _ in 0..indent_level {
                             stdout.write(b"  ")?;
                         }
-                        write!(&mut stdout, "<{}", node.kind())?;
+                        write!(stdout, "<{}", node.kind())?;
                         if let Some(field_name) = cursor.field_name() {
-                            write!(&mut stdout, " type=\"{}\"", field_name)?;
+                            write!(stdout, " type=\"{}\"", field_name)?;
                         }
-                        write!(&mut stdout, ">")?;
+                        write!(stdout, ">")?;
                         tags.push(node.kind());
                         needs_newline = true;
                     }
@@ -198,12 +261,12 @@ pub fn parse_file_at_path(
                         let end = node.end_byte();
                         let value =
                             std::str::from_utf8(&source_code[start..end]).expect("has a string");
-                        write!(&mut stdout, "{}", html_escape::encode_text(value))?;
+                        write!(stdout, "{}", html_escape::encode_text(value))?;
                     }
                 }
             }
             cursor.reset(tree.root_node());
-            println!("");
+            writeln!(stdout)?;
         }
 
         let mut first_error = None;
@@ -225,7 +288,7 @@ pub fn parse_file_at_path(
 
         if first_error.is_some() || print_time {
             write!(
-                &mut stdout,
+                stdout,
                 "{:width$}\t{} ms",
                 path.to_str().unwrap(),
                 duration_ms,
@@ -234,35 +297,30 @@ pub fn parse_file_at_path(
             if let Some(node) = first_error {
                 let start = node.start_position();
                 let end = node.end_position();
-                write!(&mut stdout, "\t(")?;
+                write!(stdout, "\t(")?;
                 if node.is_missing() {
                     if node.is_named() {
-                        write!(&mut stdout, "MISSING {}", node.kind())?;
+                        write!(stdout, "MISSING {}", node.kind())?;
                     } else {
-                        write!(
-                            &mut stdout,
-                            "MISSING \"{}\"",
-                            node.kind().replace("\n", "\\n")
-                        )?;
+                        write!(stdout, "MISSING \"{}\"", node.kind().replace("\n", "\\n"))?;
                     }
                 } else {
-                    write!(&mut stdout, "{}", node.kind())?;
+                    write!(stdout, "{}", node.kind())?;
                 }
                 write!(
-                    &mut stdout,
+                    stdout,
                     " [{}, {}] - [{}, {}])",
                     start.row, start.column, end.row, end.column
                 )?;
             }
-            write!(&mut stdout, "\n")?;
+            write!(stdout, "\n")?;
         }
 
         return Ok(first_error.is_some());
     } else if print_time {
-        let duration = time.elapsed();
         let duration_ms = duration.as_secs() * 1000 + duration.subsec_nanos() as u64 / 1000000;
         writeln!(
-            &mut stdout,
+            stdout,
             "{:width$}\t{} ms (timed out)",
             path.to_str().unwrap(),
             duration_ms,
@@ -1,10 +1,12 @@
-use crate::query_testing;
-use anyhow::{Context, Result};
+use crate::{batch, query_testing};
+use anyhow::{anyhow, Context, Result};
 use std::{
-    fs,
-    io::{self, Write},
+    fmt::Write as _,
+    fs::{self, File},
+    io::{Read, Write},
     ops::Range,
     path::Path,
+    time::{Duration, Instant},
 };
 use tree_sitter::{Language, Parser, Query, QueryCursor};
 
@@ -15,95 +17,279 @@ pub fn query_files_at_paths(
     ordered_captures: bool,
     range: Option<Range<usize>>,
     should_test: bool,
+    quiet: bool,
+    print_time: bool,
+    job_count: usize,
 ) -> Result<()> {
-    let stdout = io::stdout();
-    let mut stdout = stdout.lock();
-
     let query_source = fs::read_to_string(query_path)
         .with_context(|| format!("Error reading query file {:?}", query_path))?;
     let query = Query::new(language, &query_source).with_context(|| "Query compilation failed")?;
 
-    let mut query_cursor = QueryCursor::new();
-    if let Some(range) = range {
-        query_cursor.set_byte_range(range);
+    // Each job has its own parser, query cursor, and source buffer.
+    let new_worker = || -> Result<_> {
+        let mut query_cursor = QueryCursor::new();
+        if let Some(range) = &range {
+            query_cursor.set_byte_range(range.clone());
+        }
+        let mut parser = Parser::new();
+        parser.set_language(language)?;
+        Ok((parser, query_cursor, Vec::new()))
+    };
+
+    let mut stats = batch::ThroughputStats::default();
+    let time = Instant::now();
+    batch::process_files(
+        &paths,
+        job_count,
+        new_worker,
+        |(parser, query_cursor, source_code), index, output| {
+            let path = &paths[index];
+            let duration = query_file_at_path(
+                parser,
+                query_cursor,
+                &query,
+                language,
+                path,
+                source_code,
+                output,
+                ordered_captures,
+                should_test,
+            )?;
+            Ok(batch::FileStats {
+                path: path.clone(),
+                bytes: source_code.len(),
+                duration,
+            })
+        },
+        |_, output, file_stats| {
+            if !quiet {
+                batch::write_output(output)?;
+            }
+            stats.files.push(file_stats);
+            Ok(())
+        },
+    )?;
+    stats.elapsed = time.elapsed();
+
+    if print_time {
+        print!("{}", stats);
     }
 
-    let mut parser = Parser::new();
-    parser.set_language(language)?;
+    Ok(())
+}
 
-    for path in paths {
-        let mut results = Vec::new();
+fn query_file_at_path(
+    parser: &mut Parser,
+    query_cursor: &mut QueryCursor,
+    query: &Query,
+    language: Language,
+    path: &str,
+    source_code: &mut Vec<u8>,
+    stdout: &mut impl Write,
+    ordered_captures: bool,
+    should_test: bool,
+) -> Result<Duration> {
+    let mut results = Vec::new();
 
-        writeln!(&mut stdout, "{}", path)?;
+    writeln!(stdout, "{}", path)?;
 
-        let source_code =
-            fs::read(&path).with_context(|| format!("Error reading source file {:?}", path))?;
-        let tree = parser.parse(&source_code, None).unwrap();
+    source_code.clear();
+    File::open(path)
+        .and_then(|mut file| file.read_to_end(source_code))
+        .with_context(|| format!("Error reading source file {:?}", path))?;
+    let time = Instant::now();
+    let tree = parser.parse(&source_code, None).unwrap();
 
-        if ordered_captures {
-            for (mat, capture_index) in
-                query_cursor.captures(&query, tree.root_node(), source_code.as_slice())
-            {
-                let capture = mat.captures[capture_index];
+    if ordered_captures {
+        for (mat, capture_index) in
+            query_cursor.captures(query, tree.root_node(), source_code.as_slice())
+        {
+            let capture = mat.captures[capture_index];
+            let capture_name = &query.capture_names()[capture.index as usize];
+            writeln!(
+                stdout,
+                "    pattern: {:>2}, capture: {} - {}, start: {}, end: {}, text: `{}`",
+                mat.pattern_index,
+                capture.index,
+                capture_name,
+                capture.node.start_position(),
+                capture.node.end_position(),
+                capture.node.utf8_text(&source_code).unwrap_or("")
+            )?;
+            results.push(query_testing::CaptureInfo {
+                name: capture_name.to_string(),
+                start: capture.node.start_position(),
+                end: capture.node.end_position(),
+            });
+        }
+    } else {
+        for m in query_cursor.matches(query, tree.root_node(), source_code.as_slice()) {
+            writeln!(stdout, "  pattern: {}", m.pattern_index)?;
+            for capture in m.captures {
+                let start = capture.node.start_position();
+                let end = capture.node.end_position();
                 let capture_name = &query.capture_names()[capture.index as usize];
-                writeln!(
-                    &mut stdout,
-                    "    pattern: {:>2}, capture: {} - {}, start: {}, end: {}, text: `{}`",
-                    mat.pattern_index,
-                    capture.index,
-                    capture_name,
-                    capture.node.start_position(),
-                    capture.node.end_position(),
-                    capture.node.utf8_text(&source_code).unwrap_or("")
-                )?;
+                if end.row == start.row {
+                    writeln!(
+                        stdout,
+                        "    capture: {} - {}, start: {}, end: {}, text: `{}`",
+                        capture.index,
+                        capture_name,
+                        start,
+                        end,
+                        capture.node.utf8_text(&source_code).unwrap_or("")
+                    )?;
+                } else {
+                    writeln!(
+                        stdout,
+                        "    capture: {}, start: {}, end: {}",
+                        capture_name, start, end,
+                    )?;
+                }
                 results.push(query_testing::CaptureInfo {
                     name: capture_name.to_string(),
                     start: capture.node.start_position(),
                     end: capture.node.end_position(),
                 });
             }
-        } else {
-            for m in query_cursor.matches(&query, tree.root_node(), source_code.as_slice()) {
-                writeln!(&mut stdout, "  pattern: {}", m.pattern_index)?;
-                for capture in m.captures {
-                    let start = capture.node.start_position();
-                    let end = capture.node.end_position();
-                    let capture_name = &query.capture_names()[capture.index as usize];
-                    if end.row == start.row {
-                        writeln!(
-                            &mut stdout,
-                            "    capture: {} - {}, start: {}, end: {}, text: `{}`",
-                            capture.index,
-                            capture_name,
-                            start,
-                            end,
-                            capture.node.utf8_text(&source_code).unwrap_or("")
-                        )?;
-                    } else {
-                        writeln!(
-                            &mut stdout,
-                            "    capture: {}, start: {}, end: {}",
-                            capture_name, start, end,
-                        )?;
-                    }
-                    results.push(query_testing::CaptureInfo {
-                        name: capture_name.to_string(),
-                        start: capture.node.start_position(),
-                        end: capture.node.end_position(),
-                    });
-                }
-            }
-        }
-        if query_cursor.did_exceed_match_limit() {
-            writeln!(
-                &mut stdout,
-                "  WARNING: Query exceeded maximum number of in-progress captures!"
-            )?;
-        }
-        if should_test {
-            query_testing::assert_expected_captures(results, path, &mut parser, language)?
         }
     }
+    let duration = time.elapsed();
+    if query_cursor.did_exceed_match_limit() {
+        writeln!(
+            stdout,
+            "  WARNING: Query exceeded maximum number of in-progress captures!"
+        )?;
+    }
+    if should_test {
+        query_testing::assert_expected_captures(results, path.to_string(), parser, language)?
+    }
+
+    Ok(duration)
+}
+
+/// Compile the query at the given path into a C source file, which can be
+/// linked with the grammar's parser in order to load the query without parsing
+/// or analyzing it at runtime.
+pub fn compile_query_at_path(
+    language: Language,
+    grammar_path: &Path,
+    query_path: &Path,
+    output_path: &Path,
+) -> Result<()> {
+    let grammar_json_path = grammar_path.join("src").join("grammar.json");
+    let grammar_json = fs::read_to_string(&grammar_json_path)
+        .with_context(|| format!("Error reading grammar file {:?}", grammar_json_path))?;
+    let grammar_json: serde_json::Value = serde_json::from_str(&grammar_json)
+        .with_context(|| format!("Error parsing grammar file {:?}", grammar_json_path))?;
+    let language_name = grammar_json["name"]
+        .as_str()
+        .ok_or_else(|| anyhow!("Missing grammar name in {:?}", grammar_json_path))?;
+
+    let query_source = fs::read_to_string(query_path)
+        .with_context(|| format!("Error reading query file {:?}", query_path))?;
+    let query_name = query_path
+        .file_stem()
+        .and_then(|stem| stem.to_str())
+        .unwrap_or("query");
+    let code = render_compiled_query(language, language_name, query_name, &query_source)?;
+    fs::write(output_path, code)
+        .with_context(|| format!("Error writing compiled query {:?}", output_path))
+}
+
+/// Render the C source for a precompiled query.
+///
+/// The file stores the query's serialized form and its source, and defines a
+/// function named `tree_sitter_<language>_<query>_query` that returns a new
+/// `TSQuery`. The serialized form can only be loaded by the same build of the
+/// library that created it, so the function falls back to compiling the query
+/// from its source when the serialized form is rejected.
+pub fn render_compiled_query(
+    language: Language,
+    language_name: &str,
+    query_name: &str,
+    query_source: &str,
+) -> Result<String> {
+    let query = Query::new(language, query_source).with_context(|| "Query compilation failed")?;
+    let data = query.serialize();
+    let language_function_name = format!("tree_sitter_{}", sanitize_identifier(language_name));
+    let query_function_name = format!(
+        "{}_{}_query",
+        language_function_name,
+        sanitize_identifier(query_name)
+    );
+
+    let mut result = String::new();
+    writeln!(
+        result,
+        "// Generated by `tree-sitter compile-query` from {}.scm. Do not edit.",
+        query_name
+    )?;
+    writeln!(result)?;
+    writeln!(result, "#include <tree_sitter/api.h>")?;
+    writeln!(result)?;
+    writeln!(
+        result,
+        "const TSLanguage *{}(void);",
+        language_function_name
+    )?;
+    writeln!(result)?;
+    write_byte_array(&mut result, "QUERY_SOURCE", query_source.as_bytes())?;
+    writeln!(result)?;
+    write_byte_array(&mut result, "QUERY_DATA", &data)?;
+    writeln!(result)?;
+    writeln!(result, "TSQuery *{}(void) {{", query_function_name)?;
+    writeln!(
+        result,
+        "  const TSLanguage *language = {}();",
+        language_function_name
+    )?;
+    writeln!(result, "  TSQuery *query = ts_query_deserialize(")?;
+    writeln!(
+        result,
+        "    (const char *)QUERY_DATA, sizeof(QUERY_DATA) - 1,"
+    )?;
+    writeln!(result, "    language,")?;
+    writeln!(
+        result,
+        "    (const char *)QUERY_SOURCE, sizeof(QUERY_SOURCE) - 1"
+    )?;
+    writeln!(result, "  );")?;
+    writeln!(result, "  if (!query) {{")?;
+    writeln!(result, "    uint32_t error_offset;")?;
+    writeln!(result, "    TSQueryError error_type;")?;
+    writeln!(result, "    query = ts_query_new(")?;
+    writeln!(result, "      language,")?;
+    writeln!(
+        result,
+        "      (const char *)QUERY_SOURCE, sizeof(QUERY_SOURCE) - 1,"
+    )?;
+    writeln!(result, "      &error_offset, &error_type")?;
+    writeln!(result, "    );")?;
+    writeln!(result, "  }}")?;
+    writeln!(result, "  return query;")?;
+    writeln!(result, "}}")?;
+    Ok(result)
+}
 
+// Write a null-terminated byte array, so that the array is never empty.
+fn write_byte_array(output: &mut String, name: &str, bytes: &[u8]) -> Result<()> {
+    writeln!(output, "static const uint8_t {}[] = {{", name)?;
+    for chunk in bytes.chunks(16) {
+        output.push_str("  ");
+        for byte in chunk {
+            write!(output, "0x{:02x}, ", byte)?;
+        }
+        output.pop();
+        output.push('\n');
+    }
+    writeln!(output, "  0x00,")?;
+    writeln!(output, "}};")?;
     Ok(())
 }
+
+fn sanitize_identifier(name: &str) -> String {
+    name.chars()
+        .map(|c| if c.is_ascii_alphanumeric() { c } else { '_' })
+        .collect()
+}
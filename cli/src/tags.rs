@@ -2,10 +2,9 @@ use super::util;
 use anyhow::{anyhow, Result};
 use std::io::{self, Write};
 use std::path::Path;
-use std::time::Instant;
-use std::{fs, str};
+use std::{fs, str, thread};
 use tree_sitter_loader::Loader;
-use tree_sitter_tags::TagsContext;
+use tree_sitter_tags::{generate_tags_in_parallel, FileTags};
 
 pub fn generate_tags(
     loader: &Loader,
@@ -22,11 +21,12 @@ pub fn generate_tags(
         }
     }
 
-    let mut context = TagsContext::new();
     let cancellation_flag = util::cancel_on_stdin();
     let stdout = io::stdout();
     let mut stdout = stdout.lock();
 
+    // Language configurations are loaded lazily, so find them all before tagging.
+    let mut files = Vec::with_capacity(paths.len());
     for path in paths {
         let path = Path::new(&path);
         let (language, language_config) = match lang {
@@ -41,24 +41,33 @@ pub fn generate_tags(
         };
 
         if let Some(tags_config) = language_config.tags_config(language)? {
-            let indent;
-            if paths.len() > 1 {
-                if !quiet {
-                    writeln!(&mut stdout, "{}", path.to_string_lossy())?;
-                }
-                indent = "\t"
-            } else {
-                indent = "";
-            };
+            files.push((tags_config, path));
+        } else {
+            eprintln!("No tags config found for path {:?}", path);
+        }
+    }
+
+    let indent = if paths.len() > 1 { "\t" } else { "" };
+    let thread_count = thread::available_parallelism().map_or(1, |n| n.get());
+    generate_tags_in_parallel(
+        &files,
+        thread_count,
+        Some(&cancellation_flag),
+        |path| Ok(fs::read(path)?),
+        |index, file_tags| {
+            let (tags_config, path) = files[index];
+            let FileTags {
+                source,
+                tags,
+                duration,
+                ..
+            } = file_tags?;
+            if paths.len() > 1 && !quiet {
+                writeln!(&mut stdout, "{}", path.to_string_lossy())?;
+            }
 
-            let source = fs::read(path)?;
-            let t0 = Instant::now();
-            for tag in context
-                .generate_tags(tags_config, &source, Some(&cancellation_flag))?
-                .0
-            {
-                let tag = tag?;
-                if !quiet {
+            if !quiet {
+                for tag in tags {
                     write!(
                         &mut stdout,
                         "{}{:<10}\t | {:<8}\t{} {} - {} `{}`",
@@ -82,17 +91,9 @@ pub fn generate_tags(
             }
 
             if time {
-                writeln!(
-                    &mut stdout,
-                    "{}time: {}ms",
-                    indent,
-                    t0.elapsed().as_millis(),
-                )?;
+                writeln!(&mut stdout, "{}time: {}ms", indent, duration.as_millis())?;
             }
-        } else {
-            eprintln!("No tags config found for path {:?}", path);
-        }
-    }
-
-    Ok(())
+            Ok(())
+        },
+    )
 }
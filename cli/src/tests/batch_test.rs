@@ -0,0 +1,97 @@
+use super::helpers::fixtures::get_language;
+use crate::batch::{process_files, FileStats, ThroughputStats};
+use std::time::Duration;
+use tree_sitter::Parser;
+
+#[test]
+fn test_processing_files_in_parallel_preserves_their_order() {
+    let language = get_language("javascript");
+    let sources = (0..100)
+        .map(|i| "let x = 1;\n".repeat(i % 17 + 1))
+        .collect::<Vec<_>>();
+    let paths = (0..sources.len())
+        .map(|i| format!("file-{}.js", i))
+        .collect::<Vec<_>>();
+
+    for job_count in &[1, 4] {
+        let mut finished = Vec::new();
+        process_files(
+            &paths,
+            *job_count,
+            || {
+                let mut parser = Parser::new();
+                parser.set_language(language)?;
+                Ok(parser)
+            },
+            |parser, index, output| {
+                let tree = parser.parse(&sources[index], None).unwrap();
+                output.extend_from_slice(paths[index].as_bytes());
+                Ok(tree.root_node().child_count())
+            },
+            |index, output, child_count| {
+                assert_eq!(output, paths[index].as_bytes());
+                finished.push((index, child_count));
+                Ok(())
+            },
+        )
+        .unwrap();
+
+        assert_eq!(
+            finished,
+            (0..sources.len())
+                .map(|i| (i, i % 17 + 1))
+                .collect::<Vec<_>>()
+        );
+    }
+}
+
+#[test]
+fn test_processing_files_in_parallel_stops_at_the_first_error() {
+    let paths = (0..50).map(|i| i.to_string()).collect::<Vec<_>>();
+    let mut finished = Vec::new();
+    let result = process_files(
+        &paths,
+        4,
+        || Ok(()),
+        |_, index, _| {
+            if index == 10 {
+                Err(anyhow::anyhow!("failed on {}", index))
+            } else {
+                Ok(index)
+            }
+        },
+        |index, _, _| {
+            finished.push(index);
+            Ok(())
+        },
+    );
+
+    assert_eq!(result.unwrap_err().to_string(), "failed on 10");
+    assert_eq!(finished, (0..10).collect::<Vec<_>>());
+}
+
+#[test]
+fn test_throughput_stats_display() {
+    let stats = ThroughputStats {
+        files: (1..=100)
+            .map(|i| FileStats {
+                path: format!("file-{}", i),
+                bytes: 1000,
+                duration: Duration::from_millis(i),
+            })
+            .collect(),
+        elapsed: Duration::from_secs(2),
+    };
+
+    let lines = stats.to_string();
+    let lines = lines.lines().collect::<Vec<_>>();
+    assert_eq!(
+        lines[0],
+        "Total files: 100; total bytes: 100000; elapsed: 2000.00 ms; throughput: 50000 bytes/s"
+    );
+    assert_eq!(lines[1], "Per-file latency: p50: 50.00 ms; p99: 99.00 ms");
+    assert_eq!(lines[2], "Slowest files:");
+    assert_eq!(lines[3], "  file-100\t100.00 ms\t1000 bytes");
+    assert_eq!(lines[4], "  file-99 \t99.00 ms\t1000 bytes");
+    assert_eq!(lines.len(), 8);
+}
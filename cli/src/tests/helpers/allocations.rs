@@ -69,6 +69,12 @@ pub fn record<T>(f: impl FnOnce() -> T) -> T {
     value
 }
 
+/// The number of allocations made within the current call to `record` that
+/// have not been freed yet.
+pub fn outstanding_allocation_count() -> usize {
+    RECORDER.with(|recorder| recorder.outstanding_allocations.lock().unwrap().len())
+}
+
 fn record_alloc(ptr: *mut c_void) {
     RECORDER.with(|recorder| {
         if recorder.enabled.load(SeqCst) {
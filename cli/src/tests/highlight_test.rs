@@ -3,8 +3,10 @@ use lazy_static::lazy_static;
 use std::ffi::CString;
 use std::sync::atomic::{AtomicUsize, Ordering};
 use std::{fs, ptr, slice, str};
+use tree_sitter::{InputEdit, Point};
 use tree_sitter_highlight::{
-    c, Error, Highlight, HighlightConfiguration, HighlightEvent, Highlighter, HtmlRenderer,
+    c, Error, Highlight, HighlightConfiguration, HighlightDelta, HighlightEvent, HighlightSession,
+    HighlightSpan, Highlighter, HtmlRenderer,
 };
 
 lazy_static! {
@@ -89,6 +91,128 @@ fn test_highlighting_javascript() {
     );
 }
 
+#[test]
+fn test_highlighting_spans_in_range() {
+    let source = "const a = function(b) { return b + c; }";
+    let mut highlighter = Highlighter::new();
+    let mut spans = Vec::new();
+
+    let mut span_strings = |range: std::ops::Range<usize>| {
+        highlighter
+            .highlight_spans(
+                &JS_HIGHLIGHT,
+                source.as_bytes(),
+                range,
+                None,
+                &test_language_for_injection_string,
+                &mut spans,
+            )
+            .unwrap();
+        spans
+            .iter()
+            .map(
+                |HighlightSpan {
+                     start,
+                     end,
+                     highlight,
+                 }| {
+                    (&source[*start..*end], HIGHLIGHT_NAMES[highlight.0].as_str())
+                },
+            )
+            .collect::<Vec<_>>()
+    };
+
+    assert_eq!(
+        span_strings(8..32),
+        &[
+            ("=", "operator"),
+            ("function", "keyword"),
+            ("(", "punctuation.bracket"),
+            ("b", "variable.parameter"),
+            (")", "punctuation.bracket"),
+            ("{", "punctuation.bracket"),
+            ("return", "keyword"),
+            ("b", "variable.parameter"),
+        ]
+    );
+
+    // Spans are clipped to the range.
+    assert_eq!(span_strings(2..7), &[("nst", "keyword"), ("a", "function")]);
+}
+
+#[test]
+fn test_highlighting_session_with_edits() {
+    let mut source = "const a = function(b) { return b + c; }".to_string();
+    let mut session = HighlightSession::new(&JS_HIGHLIGHT);
+    let mut deltas = Vec::new();
+    session
+        .update(
+            source.as_bytes(),
+            None,
+            &test_language_for_injection_string,
+            &mut deltas,
+        )
+        .unwrap();
+    assert_eq!(deltas.len(), 1);
+    let mut spans = deltas.pop().unwrap().spans;
+
+    // Rename the parameter `b` to `bee`, where it is declared.
+    source.replace_range(19..20, "bee");
+    session.edit(&InputEdit {
+        start_byte: 19,
+        old_end_byte: 20,
+        new_end_byte: 22,
+        start_position: Point::new(0, 19),
+        old_end_position: Point::new(0, 20),
+        new_end_position: Point::new(0, 22),
+    });
+    for span in &mut spans {
+        if span.start >= 20 {
+            span.start += 2;
+            span.end += 2;
+        }
+    }
+    session
+        .update(
+            source.as_bytes(),
+            None,
+            &test_language_for_injection_string,
+            &mut deltas,
+        )
+        .unwrap();
+
+    // Only part of the document was highlighted again, and that part includes the edit.
+    assert!(!deltas.is_empty());
+    assert!(deltas.iter().all(|delta| delta.range.len() < source.len()));
+    assert!(deltas
+        .iter()
+        .any(|delta| delta.range.start <= 19 && delta.range.end >= 22));
+
+    // Patching the previous spans with the deltas matches highlighting from scratch.
+    for HighlightDelta {
+        range,
+        spans: new_spans,
+    } in &deltas
+    {
+        spans.retain(|span| span.end <= range.start || span.start >= range.end);
+        spans.extend_from_slice(new_spans);
+    }
+    spans.sort_by_key(|span| span.start);
+
+    let mut expected_spans = Vec::new();
+    Highlighter::new()
+        .highlight_spans(
+            &JS_HIGHLIGHT,
+            source.as_bytes(),
+            0..source.len(),
+            None,
+            &test_language_for_injection_string,
+            &mut expected_spans,
+        )
+        .unwrap();
+    assert_eq!(spans, expected_spans);
+}
+
 #[test]
 fn test_highlighting_injected_html_in_javascript() {
     let source = vec!["const s = html `<div>${a < b}</div>`;"].join("\n");
@@ -582,6 +706,37 @@ fn test_highlighting_via_c_api() {
         ]
     );
 
+    let line_start = source_code
+        .as_bytes()
+        .iter()
+        .position(|c| *c == b'\n')
+        .unwrap()
+        + 1;
+    c::ts_highlighter_highlight_spans(
+        highlighter,
+        html_scope.as_ptr(),
+        source_code.as_ptr(),
+        source_code.as_bytes().len() as u32,
+        line_start as u32,
+        line_start as u32 + 17,
+        buffer,
+        ptr::null_mut(),
+    );
+
+    let spans = c::ts_highlight_buffer_spans(buffer);
+    let span_count = c::ts_highlight_buffer_span_count(buffer);
+    let spans = unsafe { slice::from_raw_parts(spans, span_count as usize) };
+    assert_eq!(
+        spans
+            .iter()
+            .map(|span| (
+                &source_code.to_str().unwrap()[span.start_byte as usize..span.end_byte as usize],
+                span.highlight
+            ))
+            .collect::<Vec<_>>(),
+        vec![("const", 3), ("b", 1), ("'c'", 2)]
+    );
+
     c::ts_highlighter_delete(highlighter);
     c::ts_highlight_buffer_delete(buffer);
 }
@@ -1,3 +1,4 @@
+mod batch_test;
 mod corpus_test;
 mod helpers;
 mod highlight_test;
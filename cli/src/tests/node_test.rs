@@ -2,9 +2,9 @@ use super::helpers::edits::get_random_edit;
 use super::helpers::fixtures::{fixtures_dir, get_language, get_test_language};
 use super::helpers::random::Rand;
 use crate::generate::generate_parser_for_grammar;
-use crate::parse::perform_edit;
+use crate::parse::{perform_edit, Edit};
 use std::fs;
-use tree_sitter::{Node, Parser, Point, Tree};
+use tree_sitter::{Node, NodeArray, Parser, Point, Tree};
 
 const JSON_EXAMPLE: &'static str = r#"
 
@@ -167,6 +167,153 @@ fn test_node_child() {
     assert_eq!(tree.root_node().parent(), None);
 }
 
+#[test]
+fn test_node_parent_chains() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    let mut source = "function a() { if (b) { return [c, d(e, () => { f; })]; } }\n"
+        .repeat(20)
+        .into_bytes();
+    let mut tree = parser.parse(&source, None).unwrap();
+
+    for _ in 0..2 {
+        // Walk up from every leaf, checking each of its ancestors.
+        {
+            let mut cursor = tree.walk();
+            let mut ancestors = Vec::new();
+            let mut visited_children = false;
+            loop {
+                if !visited_children {
+                    let node = cursor.node();
+                    if node.child_count() == 0 {
+                        let mut parent = node.parent();
+                        for ancestor in ancestors.iter().rev() {
+                            assert_eq!(parent, Some(*ancestor));
+                            parent = ancestor.parent();
+                        }
+                        assert_eq!(parent, None);
+                    }
+                    if cursor.goto_first_child() {
+                        ancestors.push(node);
+                        continue;
+                    }
+                }
+                if cursor.goto_next_sibling() {
+                    visited_children = false;
+                } else if cursor.goto_parent() {
+                    ancestors.pop();
+                    visited_children = true;
+                } else {
+                    break;
+                }
+            }
+        }
+
+        // Editing the tree discards the parents that were found previously.
+        perform_edit(
+            &mut tree,
+            &mut source,
+            &Edit {
+                position: 0,
+                deleted_length: 0,
+                inserted_text: b"x;\n".to_vec(),
+            },
+        );
+    }
+}
+
+#[test]
+fn test_node_export() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    let source = "function a(b) { if (b) { return [c, d(e, () => { f; })]; } }\n".repeat(20);
+    let tree = parser.parse(&source, None).unwrap();
+    let function_node = tree.root_node().child(3).unwrap();
+
+    for &(named_only, max_depth) in &[
+        (false, None),
+        (true, None),
+        (false, Some(2)),
+        (true, Some(0)),
+    ] {
+        let mut expected = Vec::new();
+        collect_exported_nodes(
+            function_node,
+            0,
+            u32::MAX,
+            0,
+            named_only,
+            max_depth,
+            &mut expected,
+        );
+        assert!(expected.iter().any(|(_, field_id, _)| *field_id != 0));
+
+        for &capacity in &[1, 7, 1000] {
+            let mut exporter = function_node.export(named_only, max_depth);
+            let mut array = NodeArray::default();
+            let mut offset = 0;
+            while exporter.next_batch(&mut array, capacity) > 0 {
+                assert!(array.len() <= capacity);
+                for i in 0..array.len() {
+                    let (node, field_id, parent_index) = expected[offset + i];
+                    assert_eq!(array.kind_ids[i], node.kind_id());
+                    assert_eq!(array.field_ids[i], field_id);
+                    assert_eq!(array.start_bytes[i] as usize, node.start_byte());
+                    assert_eq!(array.end_bytes[i] as usize, node.end_byte());
+                    assert_eq!(array.start_positions[i], node.start_position());
+                    assert_eq!(array.end_positions[i], node.end_position());
+                    assert_eq!(array.parent_indices[i], parent_index);
+                    assert_eq!(array.flags[i] & NodeArray::NAMED != 0, node.is_named());
+                    assert_eq!(
+                        array.flags[i] & NodeArray::HAS_CHILDREN != 0,
+                        node.child_count() > 0
+                    );
+                }
+                offset += array.len();
+            }
+            assert_eq!(offset, expected.len());
+            assert!(array.is_empty());
+        }
+    }
+
+    fn collect_exported_nodes<'a>(
+        node: Node<'a>,
+        field_id: u16,
+        parent_index: u32,
+        depth: usize,
+        named_only: bool,
+        max_depth: Option<usize>,
+        result: &mut Vec<(Node<'a>, u16, u32)>,
+    ) {
+        let mut index = parent_index;
+        if !named_only || node.is_named() {
+            index = result.len() as u32;
+            result.push((node, field_id, parent_index));
+        }
+        if max_depth.map_or(false, |max_depth| depth >= max_depth) {
+            return;
+        }
+        let mut cursor = node.walk();
+        if cursor.goto_first_child() {
+            loop {
+                let field_id = cursor.field_id().unwrap_or(0);
+                collect_exported_nodes(
+                    cursor.node(),
+                    field_id,
+                    index,
+                    depth + 1,
+                    named_only,
+                    max_depth,
+                    result,
+                );
+                if !cursor.goto_next_sibling() {
+                    break;
+                }
+            }
+        }
+    }
+}
+
 #[test]
 fn test_node_children() {
     let tree = parse_json_example();
@@ -199,6 +346,52 @@ fn test_node_children() {
     );
 }
 
+#[test]
+fn test_node_child_access_in_wide_nodes() {
+    // Error recovery produces nodes with many direct children, whose children
+    // are accessed through an index rather than by iterating.
+    let mut source = "[".to_string();
+    for i in 0..300 {
+        source += &format!("{} : ] {{ true, ", i);
+    }
+
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+    let tree = parser.parse(&source, None).unwrap();
+    let mut cursor = tree.walk();
+    for node in get_all_nodes(&tree) {
+        let children = node.children(&mut cursor).collect::<Vec<_>>();
+        let has_empty_children = children.iter().any(|c| c.start_byte() == c.end_byte());
+        assert_eq!(children.len(), node.child_count());
+        for (i, child) in children.iter().enumerate() {
+            assert_eq!(node.child(i), Some(*child));
+            assert_eq!(child.parent(), Some(node));
+            if !has_empty_children {
+                assert_eq!(child.prev_sibling(), i.checked_sub(1).map(|j| children[j]));
+                assert_eq!(child.next_sibling(), children.get(i + 1).cloned());
+            }
+        }
+        assert_eq!(node.child(children.len()), None);
+
+        let named_children = node.named_children(&mut cursor).collect::<Vec<_>>();
+        assert_eq!(named_children.len(), node.named_child_count());
+        for (i, child) in named_children.iter().enumerate() {
+            assert_eq!(node.named_child(i), Some(*child));
+            if !has_empty_children {
+                assert_eq!(
+                    child.prev_named_sibling(),
+                    i.checked_sub(1).map(|j| named_children[j])
+                );
+                assert_eq!(
+                    child.next_named_sibling(),
+                    named_children.get(i + 1).cloned()
+                );
+            }
+        }
+        assert_eq!(node.named_child(named_children.len()), None);
+    }
+}
+
 #[test]
 fn test_node_children_by_field_name() {
     let mut parser = Parser::new();
@@ -3,11 +3,16 @@ use super::helpers::{
     edits::ReadRecorder,
     fixtures::{get_language, get_test_grammar, get_test_language},
 };
-use crate::generate::generate_parser_for_grammar;
+use crate::generate::{
+    generate_parser_for_grammar, generate_parser_for_grammar_with_table_options,
+};
 use crate::parse::{perform_edit, Edit};
 use std::sync::atomic::{AtomicUsize, Ordering};
-use std::{thread, time};
-use tree_sitter::{IncludedRangesError, InputEdit, LogType, Parser, Point, Range};
+use std::{cell::RefCell, rc::Rc, thread, time};
+use tree_sitter::{
+    IncludedRangesError, InputEdit, LogType, ParseJob, Parser, ParserPool, ParserStats, Point,
+    Range,
+};
 
 #[test]
 fn test_parsing_simple_string() {
@@ -185,6 +190,38 @@ fn test_parsing_with_custom_utf16_input() {
     assert_eq!(root.child(0).unwrap().kind(), "function_item");
 }
 
+#[test]
+fn test_parsing_contiguous_buffer_matches_chunked_input() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    let text = "const s = 'héllo';\nfunction f(a, b) {\n  return a + b; // ✓\n}\n";
+    let tree = parser.parse(text, None).unwrap();
+    let chunked_tree = parser
+        .parse_with(
+            &mut |i, _| &text.as_bytes()[i.min(text.len())..(i + 3).min(text.len())],
+            None,
+        )
+        .unwrap();
+    assert_eq!(
+        tree.root_node().to_sexp(),
+        chunked_tree.root_node().to_sexp()
+    );
+    assert_eq!(
+        tree.root_node().end_position(),
+        chunked_tree.root_node().end_position()
+    );
+    assert_eq!(tree.root_node().end_byte(), text.len());
+
+    let utf16_text = text.encode_utf16().collect::<Vec<_>>();
+    let utf16_tree = parser.parse_utf16(&utf16_text, None).unwrap();
+    assert_eq!(tree.root_node().to_sexp(), utf16_tree.root_node().to_sexp());
+    assert_eq!(utf16_tree.root_node().end_byte(), utf16_text.len() * 2);
+
+    let empty_tree = parser.parse("", None).unwrap();
+    assert_eq!(empty_tree.root_node().to_sexp(), "(program)");
+}
+
 #[test]
 fn test_parsing_with_callback_returning_owned_strings() {
     let mut parser = Parser::new();
@@ -273,6 +310,25 @@ fn test_parsing_invalid_chars_at_eof() {
     assert_eq!(tree.root_node().to_sexp(), "(ERROR (UNEXPECTED INVALID))");
 }
 
+#[test]
+fn test_parsing_latin1_text() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    let text = b"const s = '\xe9t\xe9';\nlet caf\xe9 = 1;\n";
+    let tree = parser.parse_latin1(text, None).unwrap();
+    let root = tree.root_node();
+    assert!(!root.has_error());
+    let declarator = root.named_child(0).unwrap().named_child(0).unwrap();
+    let string = declarator.child_by_field_name("value").unwrap();
+    assert_eq!(string.kind(), "string");
+    assert_eq!(string.byte_range(), 10..15);
+    let identifier = root.named_child(1).unwrap().named_child(0).unwrap().named_child(0).unwrap();
+    assert_eq!(identifier.kind(), "identifier");
+    assert_eq!(identifier.byte_range(), 21..25);
+    assert_eq!(identifier.end_position(), Point::new(1, 8));
+}
+
 #[test]
 fn test_parsing_unexpected_null_characters_within_source() {
     let mut parser = Parser::new();
@@ -491,6 +547,44 @@ h + i
     );
 }
 
+#[test]
+fn test_parsing_after_editing_the_end_of_a_long_file() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    let statement_count = 5000;
+    let mut code = b"foo(x);\n".repeat(statement_count);
+    let mut tree = parser.parse(&code, None).unwrap();
+
+    // The statements before an edit are reused, even after the tree has been
+    // reparsed several times.
+    for i in 0..5 {
+        let position = code.len() - 3 - 8 * i;
+        perform_edit(
+            &mut tree,
+            &mut code,
+            &Edit {
+                position,
+                deleted_length: 1,
+                inserted_text: b"y".to_vec(),
+            },
+        );
+
+        let reused_node_count = parser.stats().reused_node_count;
+        tree = parser.parse(&code, Some(&tree)).unwrap();
+        assert!(parser.stats().reused_node_count - reused_node_count > 0);
+        assert_eq!(tree.root_node().named_child_count(), statement_count);
+        assert_eq!(
+            tree.root_node()
+                .named_child(statement_count - 1 - i)
+                .unwrap()
+                .utf8_text(&code)
+                .unwrap(),
+            "foo(y);"
+        );
+    }
+}
+
 // Thread safety
 
 #[test]
@@ -544,6 +638,76 @@ fn test_parsing_on_multiple_threads() {
     assert_eq!(child_count_differences, &[1, 2, 3, 4]);
 }
 
+#[test]
+fn test_parsing_frozen_tree_on_multiple_threads() {
+    let this_file_source = include_str!("parser_test.rs");
+
+    let pool = ParserPool::new(get_language("rust"), 2).unwrap();
+    let tree = pool.acquire().parse(this_file_source, None).unwrap();
+    let snapshot = tree.freeze();
+    drop(tree);
+
+    // Each thread reparses its own copy of the snapshot, using a parser from the pool.
+    let trees = thread::scope(|scope| {
+        let parse_threads = (1..5)
+            .map(|thread_id| {
+                let snapshot = &snapshot;
+                let pool = &pool;
+                scope.spawn(move || {
+                    let mut prepended_source = "struct X {}\n\n".repeat(thread_id);
+                    let mut tree = snapshot.clone();
+                    tree.edit(&InputEdit {
+                        start_byte: 0,
+                        old_end_byte: 0,
+                        new_end_byte: prepended_source.len(),
+                        start_position: Point::new(0, 0),
+                        old_end_position: Point::new(0, 0),
+                        new_end_position: Point::new(2 * thread_id, 0),
+                    });
+                    prepended_source += this_file_source;
+                    pool.acquire()
+                        .parse(&prepended_source, Some(&tree))
+                        .unwrap()
+                })
+            })
+            .collect::<Vec<_>>();
+        parse_threads
+            .into_iter()
+            .map(|thread| thread.join().unwrap())
+            .collect::<Vec<_>>()
+    });
+
+    let child_count_differences = trees
+        .iter()
+        .map(|t| t.root_node().child_count() - snapshot.root_node().child_count())
+        .collect::<Vec<_>>();
+    assert_eq!(child_count_differences, &[1, 2, 3, 4]);
+}
+
+#[test]
+fn test_parser_pool_resets_released_parsers() {
+    let pool = ParserPool::new(get_language("javascript"), 1).unwrap();
+    assert_eq!(pool.language(), get_language("javascript"));
+
+    {
+        let mut parser = pool.acquire();
+        parser.set_timeout_micros(1000);
+        parser.set_included_ranges(&[simple_range(5, 10)]).unwrap();
+        parser.set_language(get_language("json")).unwrap();
+    }
+
+    let mut parser = pool.acquire();
+    assert_eq!(parser.language(), Some(get_language("javascript")));
+    assert_eq!(parser.timeout_micros(), 0);
+
+    let tree = parser.parse("a + b", None).unwrap();
+    assert_eq!(tree.root_node().byte_range(), 0..5);
+    assert_eq!(
+        tree.root_node().to_sexp(),
+        "(program (expression_statement (binary_expression left: (identifier) right: (identifier))))"
+    );
+}
+
 #[test]
 fn test_parsing_cancelled_by_another_thread() {
     let cancellation_flag = std::sync::Arc::new(AtomicUsize::new(0));
@@ -706,6 +870,65 @@ fn test_parsing_with_a_timeout_and_a_reset() {
     );
 }
 
+#[test]
+fn test_parsing_with_a_memory_limit() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+    assert_eq!(parser.memory_limit(), 0);
+
+    // Parse an infinitely-long array, halting once its nodes use 100kB.
+    parser.set_memory_limit(100 * 1024);
+    assert_eq!(parser.memory_limit(), 100 * 1024);
+    let tree = parser.parse_with(
+        &mut |offset, _| {
+            if offset == 0 {
+                b" ["
+            } else {
+                b",0"
+            }
+        },
+        None,
+    );
+    assert!(tree.is_none());
+
+    // The halted parse is discarded rather than resumed.
+    let tree = parser.parse("[1, 2, 3]", None).unwrap();
+    assert_eq!(tree.root_node().to_sexp(), "(document (array (number) (number) (number)))");
+
+    parser.set_memory_limit(0);
+    let tree = parser.parse("[1, 2, 3]", None).unwrap();
+    assert_eq!(tree.root_node().child(0).unwrap().kind(), "array");
+}
+
+#[test]
+fn test_parsing_with_an_error_recovery_budget() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    assert_eq!(parser.error_recovery_budget(), 0);
+
+    let garbage = "a b ) } ] ( { [ = ; , . => + - ".repeat(500);
+    let source_code = format!("let a = 1;\n{}\nlet b = 2;\n", garbage);
+    let unbounded_tree = parser.parse(&source_code, None).unwrap();
+
+    parser.set_error_recovery_budget(10);
+    assert_eq!(parser.error_recovery_budget(), 10);
+    let tree = parser.parse(&source_code, None).unwrap();
+    let root = tree.root_node();
+    assert!(root.has_error());
+    assert_eq!(root.byte_range(), unbounded_tree.root_node().byte_range());
+
+    // The budget only affects documents with errors.
+    let tree = parser.parse("let a = 1;\nlet b = 2;\n", None).unwrap();
+    assert_eq!(
+        tree.root_node().to_sexp(),
+        concat!(
+            "(program ",
+            "(lexical_declaration (variable_declarator name: (identifier) value: (number))) ",
+            "(lexical_declaration (variable_declarator name: (identifier) value: (number))))"
+        )
+    );
+}
+
 #[test]
 fn test_parsing_with_a_timeout_and_implicit_reset() {
     allocations::record(|| {
@@ -756,6 +979,371 @@ fn test_parsing_with_timeout_and_no_completion() {
     });
 }
 
+#[test]
+fn test_parsing_in_slices_with_a_progress_callback() {
+    let source_code = format!(
+        "[{}]",
+        (0..2000)
+            .map(|i| i.to_string())
+            .collect::<Vec<_>>()
+            .join(", ")
+    );
+
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+    assert!(parser.provisional_tree().is_none());
+
+    // Halt the parse every time that the parser reports its progress.
+    let offsets = Rc::new(RefCell::new(Vec::new()));
+    parser.set_progress_callback(Some(Box::new({
+        let offsets = offsets.clone();
+        move |offset, version_count| {
+            assert!(version_count > 0);
+            offsets.borrow_mut().push(offset);
+            true
+        }
+    })));
+
+    let mut slice_count = 0;
+    let tree = loop {
+        if let Some(tree) = parser.parse(&source_code, None) {
+            break tree;
+        }
+        slice_count += 1;
+
+        // While the parse is halted, the parsed prefix is available as a tree.
+        let provisional_tree = parser.provisional_tree().unwrap();
+        let root = provisional_tree.root_node();
+        assert_eq!(root.kind(), "document");
+        assert_eq!(root.start_byte(), 0);
+        assert!(root.end_byte() <= *offsets.borrow().last().unwrap());
+    };
+    parser.set_progress_callback(None);
+    assert!(parser.provisional_tree().is_none());
+
+    let offsets = offsets.borrow();
+    assert!(slice_count > 10);
+    assert_eq!(offsets.len(), slice_count);
+    assert!(offsets.windows(2).all(|pair| pair[0] <= pair[1]));
+
+    let expected_tree = parser.parse(&source_code, None).unwrap();
+    assert_eq!(tree.root_node().to_sexp(), expected_tree.root_node().to_sexp());
+}
+
+// Statistics
+
+#[test]
+fn test_parser_stats_for_parse_table_cache() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+    assert_eq!(parser.stats(), ParserStats::default());
+
+    let source_code = format!("[{}]", vec!["{\"a\": [1, 2, null]}"; 100].join(", "));
+    let tree = parser.parse(&source_code, None).unwrap();
+    assert!(!tree.root_node().has_error());
+
+    // The same handful of states and tokens recur in every array element, so
+    // most lookups are answered from the cache.
+    let stats = parser.stats();
+    assert!(stats.parse_table_cache_misses > 0);
+    assert!(stats.parse_table_cache_hits > stats.parse_table_cache_misses);
+
+    // The counters accumulate across parses.
+    parser.parse(&source_code, None).unwrap();
+    assert!(parser.stats().parse_table_cache_hits > stats.parse_table_cache_hits);
+}
+
+#[test]
+fn test_parser_stats_for_parse_stack() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    // A parenthesized list is ambiguous until the parser sees whether it is
+    // followed by an arrow, so the stack splits into multiple versions.
+    let source_code = "a = (b, c) => d;\n".repeat(50);
+    let tree = parser.parse(&source_code, None).unwrap();
+    assert!(!tree.root_node().has_error());
+
+    let stats = parser.stats();
+    assert!(stats.max_stack_version_count > 1);
+    assert!(stats.stack_node_count > 0);
+    assert!(stats.stack_node_slab_count > 0);
+
+    // Stack nodes are recycled by subsequent parses, rather than allocated again.
+    parser.parse(&source_code, None).unwrap();
+    let new_stats = parser.stats();
+    assert!(new_stats.stack_node_count > stats.stack_node_count);
+    assert_eq!(new_stats.stack_node_slab_count, stats.stack_node_slab_count);
+    assert_eq!(
+        new_stats.max_stack_version_count,
+        stats.max_stack_version_count
+    );
+}
+
+#[test]
+fn test_parser_stats_for_incremental_parsing() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    let mut code = "let x = [1, 2, 3];\n".repeat(100).into_bytes();
+    let mut tree = parser.parse(&code, None).unwrap();
+    let stats = parser.stats();
+    assert!(stats.token_count > 500);
+    assert!(stats.advance_count >= stats.token_count);
+    assert!(stats.rebuilt_node_count > 500);
+    assert!(stats.subtree_allocation_count > 0);
+    assert_eq!(stats.reused_node_count, 0);
+    assert_eq!(stats.error_recovery_count, 0);
+
+    perform_edit(
+        &mut tree,
+        &mut code,
+        &Edit {
+            position: 9,
+            deleted_length: 1,
+            inserted_text: b"100".to_vec(),
+        },
+    );
+    parser.parse(&code, Some(&tree)).unwrap();
+
+    // Only the edited statement is lexed again. The rest of the statements are
+    // reused, and only the nodes that contain them are built again.
+    let new_stats = parser.stats();
+    assert!(new_stats.reused_node_count > stats.reused_node_count);
+    assert!(new_stats.token_count - stats.token_count < 50);
+    assert!(new_stats.rebuilt_node_count - stats.rebuilt_node_count < stats.rebuilt_node_count / 2);
+
+    parser.parse("let x = ;", None).unwrap();
+    assert!(parser.stats().error_recovery_count > 0);
+}
+
+// Arena allocation
+
+#[test]
+fn test_parsing_with_arena_allocation() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        assert!(!parser.arena_allocation());
+        parser.set_arena_allocation(true);
+        assert!(parser.arena_allocation());
+
+        let mut code = b"const x = [1, 2, 3];\nfoo(x);".to_vec();
+        let mut tree = parser.parse(&code, None).unwrap();
+        let sexp = tree.root_node().to_sexp();
+
+        perform_edit(
+            &mut tree,
+            &mut code,
+            &Edit {
+                position: 10,
+                deleted_length: 0,
+                inserted_text: b"0, ".to_vec(),
+            },
+        );
+        let new_tree = parser.parse(&code, Some(&tree)).unwrap();
+        let tree_copy = new_tree.clone();
+
+        // The new tree reuses nodes that were allocated during the first parse.
+        // They must outlive the tree that they were originally allocated for.
+        drop(tree);
+        drop(new_tree);
+        assert_eq!(tree_copy.root_node().to_sexp(), sexp);
+        assert_eq!(
+            tree_copy.root_node().utf8_text(&code).unwrap(),
+            "const x = [0, 1, 2, 3];\nfoo(x);"
+        );
+    });
+}
+
+#[test]
+fn test_parsing_with_arena_allocation_after_many_edits() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        parser.set_arena_allocation(true);
+
+        let mut code = b"const x = [1, 2, 3];\nfoo(x);\n".repeat(20);
+        let mut tree = parser.parse(&code, None).unwrap();
+        let mut outstanding_allocation_counts = Vec::new();
+        for i in 0..40 {
+            let edit = if i % 2 == 0 {
+                Edit {
+                    position: 11,
+                    deleted_length: 0,
+                    inserted_text: b"0, ".to_vec(),
+                }
+            } else {
+                Edit {
+                    position: 11,
+                    deleted_length: 3,
+                    inserted_text: Vec::new(),
+                }
+            };
+            perform_edit(&mut tree, &mut code, &edit);
+            tree = parser.parse(&code, Some(&tree)).unwrap();
+            outstanding_allocation_counts.push(allocations::outstanding_allocation_count());
+        }
+
+        // Re-parsing after an edit does not create a new arena that would be
+        // kept alive by every later tree.
+        assert_eq!(outstanding_allocation_counts[9], outstanding_allocation_counts[39]);
+        assert!(tree.root_node().to_sexp().starts_with("(program (lexical_declaration"));
+    });
+}
+
+// Deferred balancing
+
+#[test]
+fn test_parsing_with_deferred_balancing() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        let mut code = b"foo(x);\n".repeat(1000);
+        let balanced_tree = parser.parse(&code, None).unwrap();
+
+        assert!(!parser.deferred_balancing());
+        parser.set_deferred_balancing(true);
+        assert!(parser.deferred_balancing());
+        let mut tree = parser.parse(&code, None).unwrap();
+        assert_eq!(tree.root_node().to_sexp(), balanced_tree.root_node().to_sexp());
+
+        // A tree can't be balanced while it shares its nodes with a clone.
+        let tree_copy = tree.clone();
+        assert!(!tree.balance());
+        drop(tree_copy);
+        assert!(tree.balance());
+        assert!(tree.balance());
+        assert_eq!(tree.root_node().to_sexp(), balanced_tree.root_node().to_sexp());
+        assert_eq!(tree.root_node().named_child(500).unwrap().start_byte(), 4000);
+
+        // An unbalanced tree can be edited and reparsed.
+        let mut tree = parser.parse(&code, None).unwrap();
+        perform_edit(
+            &mut tree,
+            &mut code,
+            &Edit {
+                position: 4004,
+                deleted_length: 1,
+                inserted_text: b"y".to_vec(),
+            },
+        );
+        let new_tree = parser.parse(&code, Some(&tree)).unwrap();
+        assert_eq!(new_tree.root_node().to_sexp(), balanced_tree.root_node().to_sexp());
+        assert_eq!(
+            new_tree.root_node().named_child(500).unwrap().utf8_text(&code).unwrap(),
+            "foo(y);"
+        );
+    });
+}
+
+// Node sharing
+
+#[test]
+fn test_parsing_with_node_sharing() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        assert_eq!(parser.node_sharing_capacity(), 0);
+        parser.set_node_sharing_capacity(1000);
+        assert_eq!(parser.node_sharing_capacity(), 1024);
+
+        let code1 = "function a() { return [1, 2]; }\nfunction b() { return 3; }\n";
+        let code2 = "function a() { return [1, 2]; }\nfunction b() { return c; }\n";
+        let tree1 = parser.parse(code1, None).unwrap();
+        let shared_node_count = parser.stats().shared_node_count;
+        let tree2 = parser.parse(code2, None).unwrap();
+        assert!(parser.stats().shared_node_count > shared_node_count);
+
+        // The unchanged function is shared by both trees, so its descendants
+        // are the same nodes.
+        let body1 = tree1.root_node().child(0).unwrap().child_by_field_name("body");
+        let body2 = tree2.root_node().child(0).unwrap().child_by_field_name("body");
+        assert_eq!(body1.unwrap().id(), body2.unwrap().id());
+        let body1 = tree1.root_node().child(1).unwrap().child_by_field_name("body");
+        let body2 = tree2.root_node().child(1).unwrap().child_by_field_name("body");
+        assert_ne!(body1.unwrap().id(), body2.unwrap().id());
+        let changed_ranges = tree1.changed_ranges(&tree2).collect::<Vec<_>>();
+        assert!(!changed_ranges.is_empty());
+        assert!(changed_ranges
+            .iter()
+            .all(|range| range.start_byte >= code2.find("function b").unwrap()));
+
+        // Within one tree, identical parent nodes are not shared.
+        let code3 = "x = [1, 2];\nx = [1, 2];\n";
+        let tree3 = parser.parse(code3, None).unwrap();
+        let assignment1 = tree3.root_node().child(0).unwrap().child(0).unwrap();
+        let assignment2 = tree3.root_node().child(1).unwrap().child(0).unwrap();
+        assert_eq!(assignment1.kind(), "assignment_expression");
+        assert_ne!(assignment1.child(0).unwrap().id(), assignment2.child(0).unwrap().id());
+
+        // Shared trees can be edited and reparsed independently.
+        drop(tree1);
+        let mut code = code2.as_bytes().to_vec();
+        let mut tree = tree2.clone();
+        perform_edit(
+            &mut tree,
+            &mut code,
+            &Edit {
+                position: code2.find('c').unwrap(),
+                deleted_length: 1,
+                inserted_text: b"4".to_vec(),
+            },
+        );
+        let shared_node_count = parser.stats().shared_node_count;
+        let new_tree = parser.parse(&code, Some(&tree)).unwrap();
+        assert_eq!(parser.stats().shared_node_count, shared_node_count);
+        assert_eq!(
+            new_tree.root_node().to_sexp(),
+            parser.parse(code1, None).unwrap().root_node().to_sexp()
+        );
+        assert_eq!(
+            tree2.root_node().child(1).unwrap().utf8_text(code2.as_bytes()),
+            Ok("function b() { return c; }")
+        );
+    });
+}
+
+// Streaming
+
+#[test]
+fn test_parsing_with_a_streaming_callback() {
+    let line_count = 100;
+    let source_code = (0..line_count)
+        .map(|i| format!("{{\"id\": {}, \"tags\": [\"a\", \"b\"]}}\n", i))
+        .collect::<String>();
+
+    let mut streamed_nodes = Vec::new();
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+    parser.set_streaming_callback(Some(Box::new(|node| {
+        streamed_nodes.push((node.kind(), node.byte_range(), node.start_position().row));
+    })));
+    let tree = parser.parse(&source_code, None).unwrap();
+    parser.set_streaming_callback(None);
+    drop(parser);
+
+    // The nodes that weren't streamed remain in the tree, at their original positions.
+    let root = tree.root_node();
+    assert!(!streamed_nodes.is_empty());
+    assert!(root.child_count() < line_count);
+    assert_eq!(streamed_nodes.len() + root.child_count(), line_count);
+    assert_eq!(root.end_byte(), source_code.len());
+    assert_eq!(
+        root.child(0).unwrap().start_position().row,
+        streamed_nodes.len()
+    );
+
+    let mut offset = 0;
+    for (row, (kind, range, start_row)) in streamed_nodes.iter().enumerate() {
+        let line_length = source_code[offset..].find('\n').unwrap();
+        assert_eq!(*kind, "object");
+        assert_eq!(*range, offset..offset + line_length);
+        assert_eq!(*start_row, row);
+        offset += line_length + 1;
+    }
+}
+
 // Included Ranges
 
 #[test]
@@ -958,6 +1546,65 @@ fn test_parsing_error_in_invalid_included_ranges() {
     assert_eq!(error, IncludedRangesError(0));
 }
 
+#[test]
+fn test_parsing_with_many_included_ranges() {
+    let statement_count = 2000;
+    let source_code = "a = 1; @@ ".repeat(statement_count);
+    let mut ranges = (0..statement_count)
+        .map(|i| simple_range(i * 10, i * 10 + 6))
+        .collect::<Vec<_>>();
+
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    parser.set_included_ranges(&ranges).unwrap();
+    let tree = parser.parse(&source_code, None).unwrap();
+    assert!(!tree.root_node().has_error());
+    assert_eq!(tree.root_node().child_count(), statement_count);
+
+    // Exclude one statement in the middle of the document, and include the text
+    // after another one.
+    parser
+        .update_included_ranges(1000..1001, &[simple_range(10000, 10003)])
+        .unwrap();
+    parser
+        .update_included_ranges(1501..1501, &[simple_range(15007, 15009)])
+        .unwrap();
+    ranges.splice(1000..1001, [simple_range(10000, 10003)]);
+    ranges.insert(1501, simple_range(15007, 15009));
+
+    let tree = parser.parse(&source_code, None).unwrap();
+    assert!(tree.root_node().has_error());
+    parser.set_included_ranges(&ranges).unwrap();
+    assert_eq!(
+        parser.parse(&source_code, None).unwrap().root_node().to_sexp(),
+        tree.root_node().to_sexp()
+    );
+
+    // The new ranges must fit between their neighbors.
+    assert_eq!(
+        parser.update_included_ranges(5..6, &[simple_range(45, 55)]),
+        Err(IncludedRangesError(0))
+    );
+    assert_eq!(
+        parser.update_included_ranges(5..6, &[simple_range(55, 65)]),
+        Err(IncludedRangesError(0))
+    );
+    assert_eq!(
+        parser.update_included_ranges(5..6, &[simple_range(50, 52), simple_range(51, 53)]),
+        Err(IncludedRangesError(1))
+    );
+    assert!(parser
+        .update_included_ranges(statement_count..statement_count + 2, &[])
+        .is_err());
+
+    // Removing every range includes the entire document.
+    parser
+        .update_included_ranges(0..statement_count + 1, &[])
+        .unwrap();
+    let tree = parser.parse(&source_code, None).unwrap();
+    assert_eq!(tree.root_node().end_byte(), source_code.len());
+}
+
 #[test]
 fn test_parsing_utf16_code_with_errors_at_the_end_of_an_included_range() {
     let source_code = "<script>a.</script>";
@@ -1237,6 +1884,62 @@ fn test_parsing_with_included_ranges_and_missing_tokens() {
     assert_eq!(root.child(3).unwrap().start_byte(), 4);
 }
 
+#[test]
+fn test_parsing_included_ranges_in_parallel() {
+    let source_code = (0..50)
+        .map(|i| {
+            format!(
+                "<script>let x{} = {};</script><data>{{\"a\": [{}]}}</data>",
+                i, i, i
+            )
+        })
+        .collect::<String>();
+
+    let mut jobs = Vec::new();
+    for (i, _) in source_code.match_indices("<script>") {
+        let start = i + "<script>".len();
+        let end = start + source_code[start..].find("</script>").unwrap();
+        jobs.push(ParseJob {
+            language: get_language("javascript"),
+            ranges: vec![simple_range(start, end)],
+        });
+    }
+    for (i, _) in source_code.match_indices("<data>") {
+        let start = i + "<data>".len();
+        let end = start + source_code[start..].find("</data>").unwrap();
+        jobs.push(ParseJob {
+            language: get_language("json"),
+            ranges: vec![simple_range(start, end)],
+        });
+    }
+
+    // Jobs with invalid ranges fail without affecting the other jobs.
+    jobs.push(ParseJob {
+        language: get_language("javascript"),
+        ranges: vec![simple_range(10, 20), simple_range(5, 8)],
+    });
+
+    let trees = Parser::parse_in_parallel(&source_code, &jobs, 4, None);
+    assert_eq!(trees.len(), jobs.len());
+    assert!(trees.last().unwrap().is_none());
+
+    let mut parser = Parser::new();
+    for (job, tree) in jobs.iter().zip(trees.iter()).take(jobs.len() - 1) {
+        parser.set_language(job.language).unwrap();
+        parser.set_included_ranges(&job.ranges).unwrap();
+        let expected_tree = parser.parse(&source_code, None).unwrap();
+        let tree = tree.as_ref().unwrap();
+        assert_eq!(
+            tree.root_node().to_sexp(),
+            expected_tree.root_node().to_sexp()
+        );
+        assert_eq!(
+            tree.root_node().byte_range(),
+            expected_tree.root_node().byte_range()
+        );
+    }
+}
+
 fn simple_range(start: usize, end: usize) -> Range {
     Range {
         start_byte: start,
@@ -1245,3 +1948,180 @@ fn simple_range(start: usize, end: usize) -> Range {
         end_point: Point::new(0, end),
     }
 }
+
+#[test]
+fn test_parsing_long_runs_of_characters_in_a_single_token() {
+    let (parser_name, parser_code) = generate_parser_for_grammar(
+        r#"{
+            "name": "test_long_character_runs",
+            "rules": {
+                "program": {
+                    "type": "REPEAT",
+                    "content": {
+                        "type": "CHOICE",
+                        "members": [
+                            {"type": "SYMBOL", "name": "identifier"},
+                            {"type": "SYMBOL", "name": "string"}
+                        ]
+                    }
+                },
+                "identifier": {"type": "PATTERN", "value": "[a-z_]+"},
+                "string": {"type": "PATTERN", "value": "\"[^\"]*\""}
+            }
+        }"#,
+    )
+    .unwrap();
+    assert!(parser_code.contains("ADVANCE_WHILE("));
+    assert!(parser_code.contains("SKIP_WHILE("));
+    assert!(parser_code.contains("#define LANGUAGE_VERSION 14\n"));
+
+    let mut parser = Parser::new();
+    parser
+        .set_language(get_test_language(&parser_name, &parser_code, None))
+        .unwrap();
+
+    let identifier = "a_".repeat(40);
+    let string = format!("\"{}é{}\"", "x ".repeat(30), "y".repeat(20));
+    let source_code = format!(
+        "{}{}\n \n{}{}\n{}",
+        " ".repeat(50),
+        identifier,
+        "\t".repeat(33),
+        string,
+        identifier
+    );
+
+    let tree = parser.parse(&source_code, None).unwrap();
+    let root = tree.root_node();
+    assert_eq!(
+        root.to_sexp(),
+        "(program (identifier) (string) (identifier))"
+    );
+
+    let first = root.child(0).unwrap();
+    assert_eq!(first.start_position(), Point::new(0, 50));
+    assert_eq!(first.end_position(), Point::new(0, 130));
+
+    let second = root.child(1).unwrap();
+    assert_eq!(second.start_position(), Point::new(2, 33));
+    assert_eq!(second.end_position(), Point::new(2, 33 + string.len()));
+    assert_eq!(second.utf8_text(source_code.as_bytes()).unwrap(), string);
+
+    let third = root.child(2).unwrap();
+    assert_eq!(third.start_position(), Point::new(3, 0));
+    assert_eq!(third.end_byte(), source_code.len());
+}
+
+#[test]
+fn test_parsing_with_a_lexer_that_needs_no_newer_lexer_functions() {
+    let (parser_name, parser_code) = generate_parser_for_grammar(
+        r#"{
+            "name": "test_no_character_runs",
+            "extras": [],
+            "rules": {
+                "program": {"type": "STRING", "value": "ab"}
+            }
+        }"#,
+    )
+    .unwrap();
+    assert!(!parser_code.contains("ADVANCE_WHILE("));
+    assert!(parser_code.contains("#define LANGUAGE_VERSION 13\n"));
+
+    let mut parser = Parser::new();
+    parser
+        .set_language(get_test_language(&parser_name, &parser_code, None))
+        .unwrap();
+    let tree = parser.parse("ab", None).unwrap();
+    assert_eq!(tree.root_node().to_sexp(), "(program)");
+}
+
+#[test]
+fn test_parsing_with_a_table_lexer() {
+    let grammar = r#"{
+        "name": "GRAMMAR_NAME",
+        "word": "identifier",
+        "extras": [{"type": "PATTERN", "value": "\\s"}],
+        "rules": {
+            "program": {
+                "type": "REPEAT",
+                "content": {
+                    "type": "CHOICE",
+                    "members": [
+                        {"type": "SYMBOL", "name": "identifier"},
+                        {"type": "SYMBOL", "name": "number"},
+                        {"type": "SYMBOL", "name": "string"},
+                        {"type": "STRING", "value": "if"},
+                        {"type": "STRING", "value": "else"},
+                        {"type": "STRING", "value": "<="},
+                        {"type": "STRING", "value": "<"}
+                    ]
+                }
+            },
+            "identifier": {"type": "PATTERN", "value": "[\\p{L}_][\\p{L}\\d_]*"},
+            "number": {"type": "PATTERN", "value": "\\d+(\\.\\d+)?"},
+            "string": {"type": "PATTERN", "value": "\"([^\"\\\\]|\\\\.)*\""}
+        }
+    }"#;
+
+    let mut parsers = [false, true].iter().map(|table_lexer| {
+        let (parser_name, parser_code) = generate_parser_for_grammar_with_table_options(
+            &grammar.replace(
+                "GRAMMAR_NAME",
+                if *table_lexer {
+                    "test_table_lexer"
+                } else {
+                    "test_switch_lexer"
+                },
+            ),
+            false,
+            *table_lexer,
+        )
+        .unwrap();
+        assert_eq!(parser_code.contains("run_lex_table("), *table_lexer);
+        if *table_lexer {
+            assert!(parser_code.contains("#define LANGUAGE_VERSION 14\n"));
+        }
+
+        let mut parser = Parser::new();
+        parser
+            .set_language(get_test_language(&parser_name, &parser_code, None))
+            .unwrap();
+        parser
+    });
+    let mut switch_parser = parsers.next().unwrap();
+    let mut table_parser = parsers.next().unwrap();
+
+    let source_code = concat!(
+        "if naïve_1 <= 3.5 iffy < \"a \\\" b\" else\n",
+        "    λ ⊕ 日本 \"unterminated\n",
+        "  élan 42\u{0}",
+    );
+    let switch_tree = switch_parser.parse(source_code, None).unwrap();
+    let table_tree = table_parser.parse(source_code, None).unwrap();
+    assert_eq!(
+        table_tree.root_node().to_sexp(),
+        switch_tree.root_node().to_sexp()
+    );
+
+    let mut switch_cursor = switch_tree.walk();
+    let mut table_cursor = table_tree.walk();
+    loop {
+        let switch_node = switch_cursor.node();
+        let table_node = table_cursor.node();
+        assert_eq!(table_node.kind(), switch_node.kind());
+        assert_eq!(table_node.byte_range(), switch_node.byte_range());
+        assert_eq!(table_node.start_position(), switch_node.start_position());
+        if switch_cursor.goto_first_child() {
+            assert!(table_cursor.goto_first_child());
+            continue;
+        }
+        while !switch_cursor.goto_next_sibling() {
+            assert!(!table_cursor.goto_next_sibling());
+            if !switch_cursor.goto_parent() {
+                return;
+            }
+            assert!(table_cursor.goto_parent());
+        }
+        assert!(table_cursor.goto_next_sibling());
+    }
+}
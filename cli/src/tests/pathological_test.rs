@@ -1,10 +1,20 @@
-use super::helpers::{allocations, fixtures::get_language};
-use tree_sitter::Parser;
+use super::helpers::{
+    allocations,
+    fixtures::{fixtures_dir, get_language, get_language_queries_path},
+};
+use std::fs;
+use tree_sitter::{Parser, Query, QueryCursor};
+
+// These limits match the defaults of the performance fuzzer in `test/fuzz`.
+const MAX_OPERATIONS_PER_BYTE: u64 = 100;
+const MIN_INPUT_SIZE: usize = 64;
+
+const PATHOLOGICAL_EXAMPLE_1: &str = r#"*ss<s"ss<sqXqss<s._<s<sq<(qqX<sqss<s.ss<sqsssq<(qss<qssqXqss<s._<s<sq<(qqX<sqss<s.ss<sqsssq<(qss<sqss<sqss<s._<s<sq>(qqX<sqss<s.ss<sqsssq<(qss<sq&=ss<s<sqss<s._<s<sq<(qqX<sqss<s.ss<sqs"#;
 
 #[test]
 fn test_pathological_example_1() {
     let language = "cpp";
-    let source = r#"*ss<s"ss<sqXqss<s._<s<sq<(qqX<sqss<s.ss<sqsssq<(qss<qssqXqss<s._<s<sq<(qqX<sqss<s.ss<sqsssq<(qss<sqss<sqss<s._<s<sq>(qqX<sqss<s.ss<sqsssq<(qss<sq&=ss<s<sqss<s._<s<sq<(qqX<sqss<s.ss<sqs"#;
+    let source = PATHOLOGICAL_EXAMPLE_1;
 
     allocations::record(|| {
         let mut parser = Parser::new();
@@ -12,3 +22,67 @@ fn test_pathological_example_1() {
         parser.parse(source, None).unwrap();
     });
 }
+
+#[test]
+fn test_pathological_example_1_with_an_error_recovery_budget() {
+    let language = "cpp";
+    let source = PATHOLOGICAL_EXAMPLE_1;
+
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language(language)).unwrap();
+        parser.set_error_recovery_budget(4);
+        let tree = parser.parse(source, None).unwrap();
+        assert_eq!(tree.root_node().end_byte(), source.len());
+    });
+}
+
+#[test]
+fn test_pathological_examples_found_by_the_performance_fuzzer() {
+    let language_dirs = match fs::read_dir(fixtures_dir().join("pathological")) {
+        Ok(entries) => entries,
+        Err(_) => return,
+    };
+
+    for language_dir in language_dirs {
+        let language_dir = language_dir.unwrap().path();
+        let language_name = language_dir.file_name().unwrap().to_str().unwrap();
+        let language = get_language(language_name);
+        let query =
+            fs::read_to_string(get_language_queries_path(language_name).join("highlights.scm"))
+                .ok()
+                .map(|source| Query::new(language, &source).unwrap());
+
+        for example_path in fs::read_dir(&language_dir).unwrap() {
+            let example_path = example_path.unwrap().path();
+            let source = fs::read(&example_path).unwrap();
+            let limit = MAX_OPERATIONS_PER_BYTE * source.len().max(MIN_INPUT_SIZE) as u64;
+
+            allocations::record(|| {
+                let mut parser = Parser::new();
+                parser.set_language(language).unwrap();
+                let tree = parser.parse(&source, None).unwrap();
+                let parse_operation_count = parser.stats().advance_count;
+                assert!(
+                    parse_operation_count <= limit,
+                    "Parsing {:?} took {} operations",
+                    example_path,
+                    parse_operation_count
+                );
+
+                if let Some(query) = &query {
+                    let mut cursor = QueryCursor::new();
+                    for _ in cursor.matches(query, tree.root_node(), source.as_slice()) {}
+                    let stats = cursor.stats();
+                    let query_operation_count = stats.visited_node_count as u64 + stats.step_count;
+                    assert!(
+                        query_operation_count <= limit,
+                        "Querying {:?} took {} operations",
+                        example_path,
+                        query_operation_count
+                    );
+                }
+            });
+        }
+    }
+}
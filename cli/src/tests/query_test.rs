@@ -3,9 +3,10 @@ use super::helpers::{
     fixtures::get_language,
     query_helpers::{Match, Pattern},
 };
+use crate::query::render_compiled_query;
 use lazy_static::lazy_static;
 use rand::{prelude::StdRng, SeedableRng};
-use std::{env, fmt::Write};
+use std::{env, fmt::Write, iter};
 use tree_sitter::{
     Language, Node, Parser, Point, Query, QueryCapture, QueryCursor, QueryError, QueryErrorKind,
     QueryMatch, QueryPredicate, QueryPredicateArg, QueryProperty,
@@ -2002,6 +2003,50 @@ fn test_query_matches_with_unrooted_patterns_intersecting_byte_range() {
     });
 }
 
+#[test]
+fn test_query_matches_within_byte_range_skip_preceding_nodes() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query =
+            Query::new(language, "(call_expression (arguments (identifier) @arg))").unwrap();
+
+        let source = (0..1000)
+            .map(|i| format!("let x{} = f(a{}, b{});\n", i, i, i))
+            .collect::<String>();
+        let range_start = source.find("let x900 ").unwrap();
+        let range_end = source.find("let x910 ").unwrap();
+
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(&source, None).unwrap();
+
+        let mut cursor = QueryCursor::new();
+        let all_matches = cursor.matches(&query, tree.root_node(), source.as_bytes());
+        let expected = collect_matches(all_matches, &query, &source)
+            .into_iter()
+            .filter(|(_, captures)| {
+                let text = captures[0].1;
+                let index = text[1..].parse::<usize>().unwrap();
+                index >= 900 && index < 910
+            })
+            .collect::<Vec<_>>();
+        let full_visited_count = cursor.stats().visited_node_count;
+        let full_step_count = cursor.stats().step_count;
+
+        let matches = cursor.set_byte_range(range_start..range_end).matches(
+            &query,
+            tree.root_node(),
+            source.as_bytes(),
+        );
+        assert_eq!(collect_matches(matches, &query, &source), expected);
+        assert_eq!(expected.len(), 20);
+
+        // The statements before the range are skipped without being entered.
+        assert!(cursor.stats().visited_node_count * 20 < full_visited_count);
+        assert!(cursor.stats().step_count < full_step_count);
+    });
+}
+
 #[test]
 fn test_query_captures_within_byte_range_assigned_after_iterating() {
     allocations::record(|| {
@@ -2964,6 +3009,157 @@ fn test_query_captures_with_too_many_nested_results() {
     });
 }
 
+#[test]
+fn test_query_captures_in_streaming_mode() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query = Query::new(
+            language,
+            r#"
+            (call_expression
+              function: (member_expression
+                property: (property_identifier) @method-name))
+
+            (call_expression
+              function: (member_expression
+                property: (property_identifier) @template-tag)
+              arguments: (template_string)) @template-call
+            "#,
+        )
+        .unwrap();
+
+        let mut source = "a(b => {\n".to_string();
+        for i in 0..20 {
+            source += &format!("  b.c{}().d{} `😄`;\n", i, i);
+        }
+        source += "}).e().f ``;";
+
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(&source, None).unwrap();
+
+        let mut cursor = QueryCursor::new();
+        let captures = cursor.captures(&query, tree.root_node(), source.as_bytes());
+        let mut expected = collect_captures(captures, &query, &source);
+        assert!(cursor.stats().peak_finished_state_count > 32);
+        assert_eq!(cursor.stats().out_of_order_capture_count, 0);
+
+        // In streaming mode, the outer match is not abandoned when the match limit
+        // is reached. Instead, the buffered captures are returned early.
+        cursor.set_match_limit(32);
+        cursor.set_streaming(true);
+        let captures = cursor.captures(&query, tree.root_node(), source.as_bytes());
+        let mut captures = collect_captures(captures, &query, &source);
+        assert!(captures.contains(&("template-tag", "f")));
+
+        let stats = cursor.stats();
+        assert!(stats.peak_capture_list_count <= 32);
+        assert!(stats.out_of_order_capture_count > 0);
+
+        expected.sort();
+        captures.sort();
+        assert_eq!(captures, expected);
+    });
+}
+
+#[test]
+fn test_query_cursor_memory_reuse() {
+    let language = get_language("javascript");
+    let query = Query::new(language, "(array (identifier) @element) (number) @number").unwrap();
+    let source = "[a, [b, [c, 1], 2], [d, 3]];\n".repeat(20);
+
+    let mut parser = Parser::new();
+    parser.set_language(language).unwrap();
+    let tree = parser.parse(&source, None).unwrap();
+    let mut cursor = QueryCursor::new();
+    let expected = collect_captures(
+        cursor.captures(&query, tree.root_node(), source.as_bytes()),
+        &query,
+        &source,
+    );
+
+    // Reserving and trimming a cursor's memory doesn't affect its results.
+    allocations::record(|| {
+        let mut cursor = QueryCursor::new();
+        cursor.reserve(32, 32);
+        cursor.set_retained_capacity(0, 0);
+        for _ in 0..2 {
+            let captures = cursor.captures(&query, tree.root_node(), source.as_bytes());
+            assert_eq!(collect_captures(captures, &query, &source), expected);
+        }
+    });
+
+    // A cursor from the thread-local cache starts with the default settings, even
+    // if a previous user of the same cursor changed them.
+    QueryCursor::with_thread_local(|cursor| {
+        cursor.set_match_limit(2);
+        cursor.set_byte_range(0..10);
+        cursor
+            .captures(&query, tree.root_node(), source.as_bytes())
+            .count();
+    });
+    QueryCursor::with_thread_local(|cursor| {
+        assert_eq!(cursor.match_limit(), u32::MAX);
+        let captures = cursor.captures(&query, tree.root_node(), source.as_bytes());
+        assert_eq!(collect_captures(captures, &query, &source), expected);
+        assert!(!cursor.did_exceed_match_limit());
+    });
+}
+
+#[test]
+fn test_query_text_predicates_evaluated_by_cursor() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query = Query::new(
+            language,
+            r#"
+            ((identifier) @builtin (#eq? @builtin "require"))
+            ((identifier) @constant (#match? @constant "^FOO"))
+            ((identifier) @other (#match? @other "[0-9]$"))
+            (assignment_expression
+              left: (identifier) @left
+              right: (identifier) @right
+              (#not-eq? @left @right))
+            "#,
+        )
+        .unwrap();
+
+        let source = "require(FOO_A, x1, y); a = b; c = c; FOO = require;";
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(&source, None).unwrap();
+
+        // With the source text available, the cursor discards failing matches itself,
+        // except for those of the regex that is not a literal string.
+        let mut cursor = QueryCursor::new();
+        let matches = cursor.matches(&query, tree.root_node(), source.as_bytes());
+        let mut matches = collect_matches(matches, &query, source);
+        matches.sort();
+        assert_eq!(
+            matches,
+            &[
+                (0, vec![("builtin", "require")]),
+                (0, vec![("builtin", "require")]),
+                (1, vec![("constant", "FOO")]),
+                (1, vec![("constant", "FOO_A")]),
+                (2, vec![("other", "x1")]),
+                (3, vec![("left", "FOO"), ("right", "require")]),
+                (3, vec![("left", "a"), ("right", "b")]),
+            ]
+        );
+        assert_eq!(cursor.stats().rejected_match_count, 17);
+
+        // Text providers that aren't contiguous still produce the same results.
+        let other_matches = cursor.matches(&query, tree.root_node(), |node: Node| {
+            iter::once(&source.as_bytes()[node.byte_range()])
+        });
+        let mut other_matches = collect_matches(other_matches, &query, source);
+        other_matches.sort();
+        assert_eq!(other_matches, matches);
+        assert_eq!(cursor.stats().rejected_match_count, 0);
+    });
+}
+
 #[test]
 fn test_query_captures_with_definite_pattern_containing_many_nested_matches() {
     allocations::record(|| {
@@ -3134,6 +3330,164 @@ fn test_query_captures_and_matches_iterators_are_fused() {
     });
 }
 
+#[test]
+fn test_query_matches_in_subtrees_without_required_symbols() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query = Query::new(
+            language,
+            r#"
+            (pair key: (property_identifier) @key)
+            (call_expression
+              function: (member_expression property: (property_identifier) @method))
+            (function_declaration
+              name: (identifier) @name
+              body: (statement_block (return_statement (object))))
+            "#,
+        )
+        .unwrap();
+
+        let source = format!(
+            "
+            function a() {{ {} }}
+            function b() {{
+              return {{ key: value, other: foo.bar() }};
+            }}
+            ",
+            "x = 1; ".repeat(40)
+        );
+
+        assert_query_matches(
+            language,
+            &query,
+            &source,
+            &[
+                (2, vec![("name", "b")]),
+                (0, vec![("key", "key")]),
+                (0, vec![("key", "other")]),
+                (1, vec![("method", "bar")]),
+            ],
+        );
+    });
+}
+
+#[test]
+fn test_query_serialization() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let source = r#"
+            (function_declaration name: (identifier) @function)
+            (call_expression function: (identifier) @call (#eq? @call "two"))
+            ((identifier) @left . "," . (identifier) @right)
+        "#;
+        let query = Query::new(language, source).unwrap();
+        let data = query.serialize();
+
+        let loaded_query = Query::deserialize(language, source, &data).unwrap();
+        assert_eq!(loaded_query.pattern_count(), query.pattern_count());
+        assert_eq!(loaded_query.capture_names(), query.capture_names());
+        assert_query_matches(
+            language,
+            &loaded_query,
+            "function one(a, b) { return two(a, 'x') + three(); }",
+            &[
+                (0, vec![("function", "one")]),
+                (2, vec![("left", "a"), ("right", "b")]),
+                (1, vec![("call", "two")]),
+            ],
+        );
+
+        // The data can't be loaded for different source, or if it is corrupted.
+        assert!(Query::deserialize(language, "(identifier) @id", &data).is_none());
+        assert!(Query::deserialize(language, source, &data[..data.len() - 1]).is_none());
+        let mut corrupted_data = data.clone();
+        *corrupted_data.last_mut().unwrap() ^= 1;
+        assert!(Query::deserialize(language, source, &corrupted_data).is_none());
+    });
+}
+
+#[test]
+fn test_query_compilation_to_c() {
+    let language = get_language("javascript");
+    let source = "(function_declaration name: (identifier) @function)\n";
+    let code = render_compiled_query(language, "javascript", "tags", source).unwrap();
+    assert!(code.contains("const TSLanguage *tree_sitter_javascript(void);"));
+    assert!(code.contains("TSQuery *tree_sitter_javascript_tags_query(void) {"));
+
+    // The C file contains the query's source and its serialized form, each
+    // followed by a null terminator.
+    let read_byte_array = |name: &str| {
+        let start = code.find(&format!("{}[] = {{", name)).unwrap();
+        let end = start + code[start..].find("};").unwrap();
+        let mut bytes = code[start..end]
+            .split(|c: char| c == ',' || c == '{')
+            .skip(1)
+            .map(str::trim)
+            .filter(|byte| !byte.is_empty())
+            .map(|byte| u8::from_str_radix(&byte[2..], 16).unwrap())
+            .collect::<Vec<_>>();
+        assert_eq!(bytes.pop(), Some(0));
+        bytes
+    };
+    assert_eq!(read_byte_array("QUERY_SOURCE"), source.as_bytes());
+    let query = Query::deserialize(language, source, &read_byte_array("QUERY_DATA")).unwrap();
+    assert_query_matches(
+        language,
+        &query,
+        "function one() {}",
+        &[(0, vec![("function", "one")])],
+    );
+}
+
+#[test]
+fn test_query_captures_in_parallel() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query = Query::new(
+            language,
+            r#"
+            (function_declaration name: (identifier) @function)
+            (call_expression function: (identifier) @call)
+            ((identifier) @left . "," . (identifier) @right)
+            (string) @string
+            "#,
+        )
+        .unwrap();
+
+        let source = "
+          function one(a, b) { return two(a, 'x'); }
+          function two(c, d) { return one(d, \"y\"); }
+        "
+        .repeat(20);
+
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(&source, None).unwrap();
+
+        let mut cursor = QueryCursor::new();
+        let mut expected = cursor
+            .captures(&query, tree.root_node(), source.as_bytes())
+            .map(|(m, i)| (m.pattern_index, m.captures[i].index, m.captures[i].node))
+            .map(|(p, c, node)| (node.start_byte(), node.end_byte(), p, c))
+            .collect::<Vec<_>>();
+        expected.sort_unstable();
+
+        for thread_count in [1, 2, 5] {
+            let mut captures = QueryCursor::captures_in_parallel(
+                &query,
+                tree.root_node(),
+                source.as_bytes(),
+                thread_count,
+            )
+            .into_iter()
+            .map(|(p, c)| (c.node.start_byte(), c.node.end_byte(), p, c.index))
+            .collect::<Vec<_>>();
+            captures.sort_unstable();
+            assert_eq!(captures, expected);
+        }
+    });
+}
+
 #[test]
 fn test_query_text_callback_returns_chunks() {
     allocations::record(|| {
@@ -3248,6 +3602,79 @@ fn test_query_start_byte_for_pattern() {
     );
 }
 
+#[test]
+fn test_query_combine() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let sources = [
+            "(identifier) @name\n(number) @number",
+            "((identifier) @name (#eq? @name \"x\"))\n(call_expression function: (identifier) @function) @call",
+            "(function_declaration name: (identifier) @function)\n[\"if\" \"return\"] @keyword",
+        ];
+        let queries = sources
+            .iter()
+            .map(|source| Query::new(language, source).unwrap())
+            .collect::<Vec<_>>();
+        let combined = Query::combine(&queries.iter().collect::<Vec<_>>()).unwrap();
+
+        assert_eq!(combined.pattern_count(), 6);
+        assert_eq!(
+            combined.capture_names(),
+            &["name", "number", "function", "call", "keyword"]
+        );
+        assert_eq!(
+            (0..6)
+                .map(|i| combined.source_query_for_pattern(i))
+                .collect::<Vec<_>>(),
+            &[0, 0, 1, 1, 2, 2]
+        );
+        assert_eq!(
+            combined.start_byte_for_pattern(3),
+            sources[1].find("(call").unwrap()
+        );
+
+        // Matching the combined query visits the tree once, and produces the same
+        // matches as running each query separately.
+        let source = "function f() { if (x) return g(x, 1); }";
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+
+        let mut expected = Vec::new();
+        let mut pattern_offset = 0;
+        for query in &queries {
+            let matches = cursor.matches(query, tree.root_node(), source.as_bytes());
+            for (pattern_index, captures) in collect_matches(matches, query, source) {
+                expected.push((pattern_offset + pattern_index, captures));
+            }
+            pattern_offset += query.pattern_count();
+        }
+        expected.sort();
+
+        let matches = cursor.matches(&combined, tree.root_node(), source.as_bytes());
+        let mut matches = collect_matches(matches, &combined, source);
+        matches.sort();
+        assert_eq!(matches, expected);
+        assert!(matches.contains(&(2, vec![("name", "x")])));
+
+        // A combined query can be loaded using the concatenation of the sources
+        // of the queries that it combines.
+        let data = combined.serialize();
+        let loaded = Query::deserialize(language, &sources.concat(), &data).unwrap();
+        assert_eq!(loaded.capture_names(), combined.capture_names());
+        assert_eq!(
+            loaded.start_byte_for_pattern(3),
+            combined.start_byte_for_pattern(3)
+        );
+        let matches = cursor.matches(&loaded, tree.root_node(), source.as_bytes());
+        let mut matches = collect_matches(matches, &loaded, source);
+        matches.sort();
+        assert_eq!(matches, expected);
+        assert!(Query::deserialize(language, sources[0], &data).is_none());
+    });
+}
+
 #[test]
 fn test_query_capture_names() {
     allocations::record(|| {
@@ -7,7 +7,9 @@ use std::{
     fs, ptr, slice, str,
 };
 use tree_sitter::Point;
-use tree_sitter_tags::{c_lib as c, Error, TagsConfiguration, TagsContext};
+use tree_sitter_tags::{
+    c_lib as c, generate_tags_in_parallel, Error, TagsConfiguration, TagsContext,
+};
 
 const PYTHON_TAG_QUERY: &'static str = r#"
 (
@@ -330,6 +332,77 @@ fn test_tags_with_parse_error() {
     );
 }
 
+#[test]
+fn test_tags_in_parallel() {
+    let python_config =
+        TagsConfiguration::new(get_language("python"), PYTHON_TAG_QUERY, "").unwrap();
+    let js_config = TagsConfiguration::new(get_language("javascript"), JS_TAG_QUERY, "").unwrap();
+
+    let files = (0..20)
+        .map(|i| {
+            if i % 2 == 0 {
+                (&python_config, format!("def f{}():\n  g{}()\n", i, i))
+            } else {
+                (&js_config, format!("function f{}() {{ g{}(); }}", i, i))
+            }
+        })
+        .collect::<Vec<_>>();
+
+    let mut results = Vec::new();
+    generate_tags_in_parallel(
+        &files,
+        4,
+        None,
+        |source: &String| Ok::<_, Error>(source.as_bytes().to_vec()),
+        |index, file_tags| {
+            let file_tags = file_tags?;
+            let config = files[index].0;
+            results.push(
+                file_tags
+                    .tags
+                    .iter()
+                    .map(|tag| {
+                        (
+                            substr(&file_tags.source, &tag.name_range).to_string(),
+                            config.syntax_type_name(tag.syntax_type_id),
+                        )
+                    })
+                    .collect::<Vec<_>>(),
+            );
+            Ok(())
+        },
+    )
+    .unwrap();
+
+    // Each file's tags are reported in the original order.
+    assert_eq!(results.len(), files.len());
+    for (i, tags) in results.iter().enumerate() {
+        assert_eq!(
+            tags,
+            &[(format!("f{}", i), "function"), (format!("g{}", i), "call")]
+        );
+    }
+
+    // An error from the callback stops the remaining files from being reported.
+    let mut count = 0;
+    let result = generate_tags_in_parallel(
+        &files,
+        4,
+        None,
+        |source: &String| Ok(source.as_bytes().to_vec()),
+        |index, _| {
+            count += 1;
+            if index == 5 {
+                Err(Error::Cancelled)
+            } else {
+                Ok(())
+            }
+        },
+    );
+    assert_eq!(result, Err(Error::Cancelled));
+    assert_eq!(count, 6);
+}
+
 #[test]
 fn test_tags_via_c_api() {
     allocations::record(|| {
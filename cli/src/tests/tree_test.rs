@@ -2,7 +2,7 @@ use super::helpers::edits::invert_edit;
 use super::helpers::fixtures::get_language;
 use crate::parse::{perform_edit, Edit};
 use std::str;
-use tree_sitter::{InputEdit, Parser, Point, Range, Tree};
+use tree_sitter::{InputEdit, Node, Parser, Point, Range, Tree};
 
 #[test]
 fn test_tree_edit() {
@@ -189,6 +189,92 @@ fn test_tree_edit() {
     }
 }
 
+#[test]
+fn test_tree_edit_batch() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    let source = "a = 1;\nb = 2;\nc = [3, 4];\nd = 5;\n";
+    let tree = parser.parse(source, None).unwrap();
+
+    // Each edit is described in terms of the original source code, and they are
+    // not given in document order.
+    let edits = [
+        // delete `, 4`
+        InputEdit {
+            start_byte: 20,
+            old_end_byte: 23,
+            new_end_byte: 20,
+            start_position: Point::new(2, 6),
+            old_end_position: Point::new(2, 9),
+            new_end_position: Point::new(2, 6),
+        },
+        // replace `1` with `10`
+        InputEdit {
+            start_byte: 4,
+            old_end_byte: 5,
+            new_end_byte: 6,
+            start_position: Point::new(0, 4),
+            old_end_position: Point::new(0, 5),
+            new_end_position: Point::new(0, 6),
+        },
+        // insert a line before `d = 5;`
+        InputEdit {
+            start_byte: 26,
+            old_end_byte: 26,
+            new_end_byte: 33,
+            start_position: Point::new(3, 0),
+            old_end_position: Point::new(3, 0),
+            new_end_position: Point::new(4, 0),
+        },
+    ];
+    let new_source = "a = 10;\nb = 2;\nc = [3];\ne = 6;\nd = 5;\n";
+
+    let mut batch_tree = tree.clone();
+    batch_tree.edit_batch(&edits);
+
+    let mut sequential_tree = tree.clone();
+    for &i in &[2, 0, 1] {
+        sequential_tree.edit(&edits[i]);
+    }
+
+    assert_eq!(
+        node_positions(&batch_tree),
+        node_positions(&sequential_tree)
+    );
+
+    let statements = tree
+        .root_node()
+        .children(&mut tree.walk())
+        .collect::<Vec<_>>();
+    let mut batch_nodes = statements.clone();
+    Node::edit_batch(&mut batch_nodes, &edits);
+    for (statement, batch_node) in statements.iter().zip(batch_nodes.iter()) {
+        let mut node = *statement;
+        for &i in &[2, 0, 1] {
+            node.edit(&edits[i]);
+        }
+        assert_eq!(batch_node.start_byte(), node.start_byte());
+        assert_eq!(batch_node.start_position(), node.start_position());
+    }
+    assert_eq!(
+        batch_nodes
+            .iter()
+            .map(|n| n.start_byte())
+            .collect::<Vec<_>>(),
+        &[0, 8, 15, 31]
+    );
+
+    let new_tree = parser.parse(new_source, Some(&batch_tree)).unwrap();
+    assert_eq!(
+        new_tree.root_node().to_sexp(),
+        parser
+            .parse(new_source, None)
+            .unwrap()
+            .root_node()
+            .to_sexp()
+    );
+}
+
 #[test]
 fn test_tree_cursor() {
     let mut parser = Parser::new();
@@ -262,6 +348,78 @@ fn test_tree_cursor_fields() {
     assert_eq!(cursor.field_name(), Some("parameters"));
 }
 
+#[test]
+fn test_tree_cursor_descendants() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    let tree = parser
+        .parse(
+            "const a = {b, c: d.e};\nfunction f(g) { return g?.h ?? [i, ...j]; }\n",
+            None,
+        )
+        .unwrap();
+
+    // Record every node in preorder, along with the index of its last descendant.
+    let mut nodes = Vec::new();
+    let mut ends = Vec::new();
+    let mut open = Vec::new();
+    let mut cursor = tree.walk();
+    let mut visited_children = false;
+    loop {
+        if !visited_children {
+            assert_eq!(cursor.descendant_index(), nodes.len());
+            open.push(nodes.len());
+            nodes.push(cursor.node());
+            ends.push(0);
+            if cursor.goto_first_child() {
+                continue;
+            }
+        }
+        ends[open.pop().unwrap()] = nodes.len();
+        if cursor.goto_next_sibling() {
+            visited_children = false;
+        } else if cursor.goto_parent() {
+            visited_children = true;
+        } else {
+            break;
+        }
+    }
+
+    assert_eq!(tree.root_node().descendant_count(), nodes.len());
+    for (i, node) in nodes.iter().enumerate() {
+        assert_eq!(node.descendant_count(), ends[i] - i);
+    }
+
+    let mut other_cursor = tree.walk();
+    for i in (0..nodes.len()).rev().chain((0..nodes.len()).step_by(3)) {
+        cursor.goto_descendant(i);
+        assert_eq!(cursor.node(), nodes[i]);
+        assert_eq!(cursor.descendant_index(), i);
+
+        other_cursor.reset_to(&cursor);
+        assert_eq!(other_cursor.node(), nodes[i]);
+        if other_cursor.goto_parent() {
+            assert_eq!(Some(other_cursor.node()), nodes[i].parent());
+        }
+    }
+
+    // An index past the end leaves the cursor where it was.
+    cursor.goto_descendant(5);
+    cursor.goto_descendant(nodes.len());
+    assert_eq!(cursor.node(), nodes[5]);
+
+    // Descendant indices are relative to the node the cursor was created with.
+    let function_index = nodes
+        .iter()
+        .position(|n| n.kind() == "function_declaration")
+        .unwrap();
+    let mut cursor = nodes[function_index].walk();
+    for i in 0..nodes[function_index].descendant_count() {
+        cursor.goto_descendant(i);
+        assert_eq!(cursor.node(), nodes[function_index + i]);
+    }
+}
+
 #[test]
 fn test_tree_cursor_child_for_point() {
     let mut parser = Parser::new();
@@ -486,6 +644,175 @@ fn test_get_changed_ranges() {
         let ranges = get_changed_ranges(&mut parser, &mut tree, &mut source_code, inverse_edit1);
         assert_eq!(ranges, vec![range_of(&source_code, "null")]);
     }
+
+    // Editing one token among many reused statements
+    {
+        let mut source_code =
+            format!("{}{{a: null}};{}", "f(x); ".repeat(50), " g(y);".repeat(50)).into_bytes();
+        let mut tree = parser.parse(&source_code, None).unwrap();
+
+        let edit = Edit {
+            position: index_of(&source_code, "ull"),
+            deleted_length: 3,
+            inserted_text: b"othing".to_vec(),
+        };
+        let inverse_edit = invert_edit(&source_code, &edit);
+        let ranges = get_changed_ranges(&mut parser, &mut tree, &mut source_code, edit);
+        assert_eq!(ranges, vec![range_of(&source_code, "nothing")]);
+
+        let ranges = get_changed_ranges(&mut parser, &mut tree, &mut source_code, inverse_edit);
+        assert_eq!(ranges, vec![range_of(&source_code, "null")]);
+    }
+}
+
+#[test]
+fn test_tree_serialization() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("python")).unwrap();
+
+    let mut source_code =
+        b"def f(a):\n    if a:\n        return 1\n    return 2\n\nprint(f(3))\n".to_vec();
+    let tree = parser.parse(&source_code, None).unwrap();
+
+    let data = tree.serialize();
+    let mut loaded_tree = Tree::deserialize(&data, get_language("python")).unwrap();
+    assert_eq!(
+        loaded_tree.root_node().to_sexp(),
+        tree.root_node().to_sexp()
+    );
+    assert_eq!(loaded_tree.root_node().range(), tree.root_node().range());
+
+    // Malformed data, or data for a different language, is rejected.
+    assert!(Tree::deserialize(&data[0..data.len() - 1], get_language("python")).is_none());
+    assert!(Tree::deserialize(&data, get_language("javascript")).is_none());
+
+    // The root node is written last. Its record ends with its visible child
+    // count and other summary fields, which come after its size. Values that
+    // disagree with the node's children are rejected.
+    let summary_offset = data.len() - 28;
+    let size_offset = summary_offset - 20;
+    for offset in [summary_offset, size_offset].iter() {
+        let mut corrupted_data = data.clone();
+        corrupted_data[*offset] ^= 1;
+        assert!(Tree::deserialize(&corrupted_data, get_language("python")).is_none());
+    }
+
+    // The loaded tree can be used for an incremental parse, which reuses its
+    // scanner states and parse states.
+    let mut tree = tree;
+    let edit = Edit {
+        position: index_of(&source_code, "return 1"),
+        deleted_length: 0,
+        inserted_text: b"a = 5\n        ".to_vec(),
+    };
+    let input_edit = perform_edit(&mut tree, &mut source_code, &edit);
+    loaded_tree.edit(&input_edit);
+
+    let new_tree = parser.parse(&source_code, Some(&tree)).unwrap();
+    let new_loaded_tree = parser.parse(&source_code, Some(&loaded_tree)).unwrap();
+    assert_eq!(
+        new_loaded_tree.root_node().to_sexp(),
+        new_tree.root_node().to_sexp()
+    );
+    assert_eq!(
+        loaded_tree
+            .changed_ranges(&new_loaded_tree)
+            .collect::<Vec<_>>(),
+        tree.changed_ranges(&new_tree).collect::<Vec<_>>()
+    );
+}
+
+#[test]
+fn test_tree_memory_usage() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    let mut source_code = b"let a = [1, 2, 3];\nlet b = a.map(x => x * 2);\nconsole.log(b);\n".to_vec();
+    let mut tree = parser.parse(&source_code, None).unwrap();
+
+    let usage = tree.memory_usage();
+    assert!(usage.unique_subtree_bytes > 0);
+    assert_eq!(usage.shared_subtree_bytes, 0);
+    assert!(usage.total_bytes > usage.unique_subtree_bytes);
+
+    // A copy of the tree shares all of its nodes.
+    let copy = tree.clone();
+    let copy_usage = copy.memory_usage();
+    assert_eq!(copy_usage.unique_subtree_bytes, 0);
+    assert_eq!(copy_usage.shared_subtree_bytes, usage.unique_subtree_bytes);
+    drop(copy);
+    assert_eq!(tree.memory_usage(), usage);
+
+    // After an incremental parse, the unchanged nodes are shared with the old tree.
+    let edit = Edit {
+        position: index_of(&source_code, "console"),
+        deleted_length: 0,
+        inserted_text: b"b = 1;\n".to_vec(),
+    };
+    perform_edit(&mut tree, &mut source_code, &edit);
+    let new_tree = parser.parse(&source_code, Some(&tree)).unwrap();
+    let new_usage = new_tree.memory_usage();
+    assert!(new_usage.unique_subtree_bytes > 0);
+    assert!(new_usage.shared_subtree_bytes > 0);
+}
+
+#[test]
+fn test_tree_memory_usage_with_node_sharing() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    // Identifiers this long are stored on the heap, so they can be shared.
+    let name = "a".repeat(300);
+    let source_code = format!("[{}];", vec![name.as_str(); 10].join(", "));
+    let usage = parser.parse(&source_code, None).unwrap().memory_usage();
+
+    // The identical leaves are stored once, so they are only counted once.
+    parser.set_node_sharing_capacity(1024);
+    let tree = parser.parse(&source_code, None).unwrap();
+    assert!(parser.stats().shared_node_count > 0);
+    let shared_usage = tree.memory_usage();
+    assert!(
+        shared_usage.unique_subtree_bytes + shared_usage.shared_subtree_bytes
+            < usage.unique_subtree_bytes
+    );
+}
+
+#[test]
+fn test_tree_compact() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    let mut source_code = b"let a = [1, 2, 3];\nlet b = a.map(x => x * 2);\nconsole.log(b);\n".to_vec();
+    let tree = parser.parse(&source_code, None).unwrap();
+    let compact_tree = tree.compact();
+    let original_sexp = tree.root_node().to_sexp();
+    drop(tree);
+
+    // The compacted tree doesn't depend on the original.
+    assert_eq!(compact_tree.root_node().to_sexp(), original_sexp);
+    assert_eq!(compact_tree.root_node().end_byte(), source_code.len());
+    assert_eq!(compact_tree.memory_usage().unique_subtree_bytes, 0);
+
+    let mut cursor = compact_tree.walk();
+    assert!(cursor.goto_first_child());
+    assert!(cursor.goto_next_sibling());
+    assert_eq!(cursor.node().kind(), "lexical_declaration");
+    assert_eq!(cursor.node().start_position(), Point::new(1, 0));
+
+    // A copy of the compacted tree can be edited and reparsed.
+    let mut tree = compact_tree.clone();
+    let edit = Edit {
+        position: index_of(&source_code, "console"),
+        deleted_length: 0,
+        inserted_text: b"b = 1;\n".to_vec(),
+    };
+    perform_edit(&mut tree, &mut source_code, &edit);
+    let new_tree = parser.parse(&source_code, Some(&tree)).unwrap();
+    assert_eq!(
+        new_tree.root_node().to_sexp(),
+        parser.parse(&source_code, None).unwrap().root_node().to_sexp()
+    );
+    assert_eq!(compact_tree.root_node().to_sexp(), original_sexp);
 }
 
 fn index_of(text: &Vec<u8>, substring: &str) -> usize {
@@ -518,3 +845,26 @@ fn get_changed_ranges(
     *tree = new_tree;
     result
 }
+
+fn node_positions(tree: &Tree) -> Vec<(usize, usize, Point, Point, bool)> {
+    let mut result = Vec::new();
+    let mut cursor = tree.walk();
+    loop {
+        let node = cursor.node();
+        result.push((
+            node.start_byte(),
+            node.end_byte(),
+            node.start_position(),
+            node.end_position(),
+            node.has_changes(),
+        ));
+        if cursor.goto_first_child() {
+            continue;
+        }
+        while !cursor.goto_next_sibling() {
+            if !cursor.goto_parent() {
+                return result;
+            }
+        }
+    }
+}
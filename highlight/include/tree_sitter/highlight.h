@@ -20,6 +20,12 @@ typedef enum {
 typedef struct TSHighlighter TSHighlighter;
 typedef struct TSHighlightBuffer TSHighlightBuffer;
 
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+  uint32_t highlight;
+} TSHighlightSpan;
+
 // Construct a `TSHighlighter` by providing a list of strings containing
 // the HTML attributes that should be applied for each highlight value.
 TSHighlighter *ts_highlighter_new(
@@ -62,6 +68,21 @@ TSHighlightError ts_highlighter_highlight(
   const size_t *cancellation_flag
 );
 
+// Compute syntax highlighting for a given byte range of a document, as a
+// list of non-overlapping spans, each of which is labeled with the index
+// of its innermost highlight. Text with no highlight is omitted. You must
+// first create a `TSHighlightBuffer` to hold the output.
+TSHighlightError ts_highlighter_highlight_spans(
+  const TSHighlighter *self,
+  const char *scope_name,
+  const char *source_code,
+  uint32_t source_code_len,
+  uint32_t start_byte,
+  uint32_t end_byte,
+  TSHighlightBuffer *output,
+  const size_t *cancellation_flag
+);
+
 // TSHighlightBuffer: This struct stores the HTML output of syntax
 // highlighting. It can be reused for multiple highlighting calls.
 TSHighlightBuffer *ts_highlight_buffer_new();
@@ -75,6 +96,10 @@ const uint32_t *ts_highlight_buffer_line_offsets(const TSHighlightBuffer *);
 uint32_t ts_highlight_buffer_len(const TSHighlightBuffer *);
 uint32_t ts_highlight_buffer_line_count(const TSHighlightBuffer *);
 
+// Access the spans computed by `ts_highlighter_highlight_spans`.
+const TSHighlightSpan *ts_highlight_buffer_spans(const TSHighlightBuffer *);
+uint32_t ts_highlight_buffer_span_count(const TSHighlightBuffer *);
+
 #ifdef __cplusplus
 }
 #endif
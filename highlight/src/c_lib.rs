@@ -1,11 +1,11 @@
-use super::{Error, Highlight, HighlightConfiguration, Highlighter, HtmlRenderer};
+use super::{Error, Highlight, HighlightConfiguration, HighlightSpan, Highlighter, HtmlRenderer};
 use regex::Regex;
 use std::collections::HashMap;
 use std::ffi::CStr;
 use std::os::raw::c_char;
 use std::process::abort;
 use std::sync::atomic::AtomicUsize;
-use std::{fmt, slice, str};
+use std::{fmt, ops, slice, str};
 use tree_sitter::Language;
 
 pub struct TSHighlighter {
@@ -18,6 +18,15 @@ pub struct TSHighlighter {
 pub struct TSHighlightBuffer {
     highlighter: Highlighter,
     renderer: HtmlRenderer,
+    spans: Vec<HighlightSpan>,
+    c_spans: Vec<TSHighlightSpan>,
+}
+
+#[repr(C)]
+pub struct TSHighlightSpan {
+    pub start_byte: u32,
+    pub end_byte: u32,
+    pub highlight: u32,
 }
 
 #[repr(C)]
@@ -129,6 +138,8 @@ pub extern "C" fn ts_highlight_buffer_new() -> *mut TSHighlightBuffer {
     Box::into_raw(Box::new(TSHighlightBuffer {
         highlighter: Highlighter::new(),
         renderer: HtmlRenderer::new(),
+        spans: Vec::new(),
+        c_spans: Vec::new(),
     }))
 }
 
@@ -166,6 +177,46 @@ pub extern "C" fn ts_highlight_buffer_line_count(this: *const TSHighlightBuffer)
     this.renderer.line_offsets.len() as u32
 }
 
+#[no_mangle]
+pub extern "C" fn ts_highlight_buffer_spans(
+    this: *const TSHighlightBuffer,
+) -> *const TSHighlightSpan {
+    let this = unwrap_ptr(this);
+    this.c_spans.as_slice().as_ptr()
+}
+
+#[no_mangle]
+pub extern "C" fn ts_highlight_buffer_span_count(this: *const TSHighlightBuffer) -> u32 {
+    let this = unwrap_ptr(this);
+    this.c_spans.len() as u32
+}
+
+#[no_mangle]
+pub extern "C" fn ts_highlighter_highlight_spans(
+    this: *const TSHighlighter,
+    scope_name: *const c_char,
+    source_code: *const c_char,
+    source_code_len: u32,
+    start_byte: u32,
+    end_byte: u32,
+    output: *mut TSHighlightBuffer,
+    cancellation_flag: *const AtomicUsize,
+) -> ErrorCode {
+    let this = unwrap_ptr(this);
+    let output = unwrap_mut_ptr(output);
+    let scope_name = unwrap(unsafe { CStr::from_ptr(scope_name).to_str() });
+    let source_code =
+        unsafe { slice::from_raw_parts(source_code as *const u8, source_code_len as usize) };
+    let cancellation_flag = unsafe { cancellation_flag.as_ref() };
+    this.highlight_spans(
+        source_code,
+        scope_name,
+        start_byte as usize..end_byte as usize,
+        output,
+        cancellation_flag,
+    )
+}
+
 #[no_mangle]
 pub extern "C" fn ts_highlighter_highlight(
     this: *const TSHighlighter,
@@ -197,23 +248,12 @@ impl TSHighlighter {
             return ErrorCode::UnknownScope;
         }
         let (_, configuration) = entry.unwrap();
-        let languages = &self.languages;
 
         let highlights = output.highlighter.highlight(
             configuration,
             source_code,
             cancellation_flag,
-            move |injection_string| {
-                languages.values().find_map(|(injection_regex, config)| {
-                    injection_regex.as_ref().and_then(|regex| {
-                        if regex.is_match(injection_string) {
-                            Some(config)
-                        } else {
-                            None
-                        }
-                    })
-                })
-            },
+            move |injection_string| self.config_for_injection_string(injection_string),
         );
 
         if let Ok(highlights) = highlights {
@@ -240,6 +280,61 @@ impl TSHighlighter {
             ErrorCode::Timeout
         }
     }
+
+    fn highlight_spans(
+        &self,
+        source_code: &[u8],
+        scope_name: &str,
+        byte_range: ops::Range<usize>,
+        output: &mut TSHighlightBuffer,
+        cancellation_flag: Option<&AtomicUsize>,
+    ) -> ErrorCode {
+        let configuration = match self.languages.get(scope_name) {
+            Some((_, configuration)) => configuration,
+            None => return ErrorCode::UnknownScope,
+        };
+
+        output.c_spans.clear();
+        let result = output.highlighter.highlight_spans(
+            configuration,
+            source_code,
+            byte_range,
+            cancellation_flag,
+            move |injection_string| self.config_for_injection_string(injection_string),
+            &mut output.spans,
+        );
+        match result {
+            Ok(()) => {
+                output
+                    .c_spans
+                    .extend(output.spans.iter().map(|span| TSHighlightSpan {
+                        start_byte: span.start as u32,
+                        end_byte: span.end as u32,
+                        highlight: span.highlight.0 as u32,
+                    }));
+                ErrorCode::Ok
+            }
+            Err(Error::InvalidLanguage) => ErrorCode::InvalidLanguage,
+            Err(_) => ErrorCode::Timeout,
+        }
+    }
+
+    fn config_for_injection_string(
+        &self,
+        injection_string: &str,
+    ) -> Option<&HighlightConfiguration> {
+        self.languages
+            .values()
+            .find_map(|(injection_regex, config)| {
+                injection_regex.as_ref().and_then(|regex| {
+                    if regex.is_match(injection_string) {
+                        Some(config)
+                    } else {
+                        None
+                    }
+                })
+            })
+    }
 }
 
 fn unwrap_ptr<'a, T>(result: *const T) -> &'a T {
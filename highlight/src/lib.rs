@@ -2,12 +2,13 @@ pub mod c_lib;
 pub mod util;
 pub use c_lib as c;
 
+use std::path::Path;
 use std::sync::atomic::{AtomicUsize, Ordering};
-use std::{iter, mem, ops, str, usize};
+use std::{fs, iter, mem, ops, str, usize};
 use thiserror::Error;
 use tree_sitter::{
-    Language, LossyUtf8, Node, Parser, Point, Query, QueryCaptures, QueryCursor, QueryError,
-    QueryMatch, Range, Tree,
+    InputEdit, Language, LossyUtf8, Node, Parser, Point, Query, QueryCaptures, QueryCursor,
+    QueryError, QueryMatch, Range, Tree,
 };
 
 const CANCELLATION_CHECK_INTERVAL: usize = 100;
@@ -37,6 +38,14 @@ pub enum HighlightEvent {
     HighlightEnd,
 }
 
+/// A region of source code to which a single highlight applies.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub struct HighlightSpan {
+    pub start: usize,
+    pub end: usize,
+    pub highlight: Highlight,
+}
+
 /// Contains the data neeeded to higlight code written in a particular language.
 ///
 /// This struct is immutable and can be shared between threads.
@@ -64,6 +73,49 @@ pub struct HighlightConfiguration {
 pub struct Highlighter {
     parser: Parser,
     cursors: Vec<QueryCursor>,
+    highlight_stack: Vec<Highlight>,
+    layer_cache: Option<LayerCache>,
+}
+
+/// Highlights a document incrementally as it is edited.
+///
+/// A session keeps the syntax tree of each of the document's language layers. After
+/// the document is edited, each layer is reparsed incrementally, and highlighting is
+/// only recomputed for the regions that could have changed: the edited text, along
+/// with any ranges where the structure of a layer's syntax tree changed, or where an
+/// injected layer appeared or disappeared.
+pub struct HighlightSession<'a> {
+    config: &'a HighlightConfiguration,
+    highlighter: Highlighter,
+    pending_ranges: Vec<ops::Range<usize>>,
+}
+
+/// A region of a document whose highlighting was recomputed by a `HighlightSession`.
+///
+/// The `spans` replace any previous spans within `range`. Spans outside of all of the
+/// returned ranges are unchanged, apart from being shifted by the edits.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct HighlightDelta {
+    pub range: ops::Range<usize>,
+    pub spans: Vec<HighlightSpan>,
+}
+
+// The syntax trees for each layer of a document, which are reused by a highlighter
+// when it belongs to a `HighlightSession`.
+#[derive(Default)]
+struct LayerCache {
+    layers: Vec<CachedLayer>,
+    parsed_layers: Vec<CachedLayer>,
+    changed_ranges: Vec<ops::Range<usize>>,
+}
+
+struct CachedLayer {
+    config_address: usize,
+    depth: usize,
+    byte_range: ops::Range<usize>,
+    included_ranges: Vec<Range>,
+    tree: Tree,
+    is_up_to_date: bool,
 }
 
 /// Converts a general-purpose syntax highlighting iterator into a sequence of lines of HTML.
@@ -93,6 +145,7 @@ where
 {
     source: &'a [u8],
     byte_offset: usize,
+    byte_range: ops::Range<usize>,
     highlighter: &'a mut Highlighter,
     injection_callback: F,
     cancellation_flag: Option<&'a AtomicUsize>,
@@ -118,6 +171,8 @@ impl Highlighter {
         Highlighter {
             parser: Parser::new(),
             cursors: Vec::new(),
+            highlight_stack: Vec::new(),
+            layer_cache: None,
         }
     }
 
@@ -131,6 +186,90 @@ impl Highlighter {
         config: &'a HighlightConfiguration,
         source: &'a [u8],
         cancellation_flag: Option<&'a AtomicUsize>,
+        injection_callback: impl FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
+    ) -> Result<impl Iterator<Item = Result<HighlightEvent, Error>> + 'a, Error> {
+        self.highlight_in_range(
+            config,
+            source,
+            0..usize::MAX,
+            cancellation_flag,
+            injection_callback,
+        )
+    }
+
+    /// Compute the highlighted regions within a given byte range of a slice of source code,
+    /// and store them in `spans`, replacing its previous contents.
+    ///
+    /// Rather than a stream of nested highlight events, this produces a sorted list of
+    /// non-overlapping spans, each labeled with the innermost highlight that applies to it.
+    /// Adjacent spans with the same highlight are merged, and text with no highlight is
+    /// omitted. Only the captures that intersect the range are processed, although the
+    /// whole document is still parsed. Both the `spans` vector and the highlighter's query
+    /// cursors are reused between calls.
+    pub fn highlight_spans<'a>(
+        &mut self,
+        config: &'a HighlightConfiguration,
+        source: &'a [u8],
+        byte_range: ops::Range<usize>,
+        cancellation_flag: Option<&'a AtomicUsize>,
+        mut injection_callback: impl FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
+        spans: &mut Vec<HighlightSpan>,
+    ) -> Result<(), Error> {
+        spans.clear();
+        let mut highlight_stack = mem::take(&mut self.highlight_stack);
+        highlight_stack.clear();
+        let result = self
+            .highlight_in_range(
+                config,
+                source,
+                byte_range.clone(),
+                cancellation_flag,
+                move |name| injection_callback(name),
+            )
+            .and_then(|events| {
+                for event in events {
+                    match event? {
+                        HighlightEvent::HighlightStart(highlight) => {
+                            highlight_stack.push(highlight)
+                        }
+                        HighlightEvent::HighlightEnd => {
+                            highlight_stack.pop();
+                        }
+                        HighlightEvent::Source { start, end } => {
+                            if start >= byte_range.end {
+                                break;
+                            }
+                            let start = start.max(byte_range.start);
+                            let end = end.min(byte_range.end);
+                            if let (Some(highlight), true) = (highlight_stack.last(), start < end) {
+                                match spans.last_mut() {
+                                    Some(last)
+                                        if last.end == start && last.highlight == *highlight =>
+                                    {
+                                        last.end = end
+                                    }
+                                    _ => spans.push(HighlightSpan {
+                                        start,
+                                        end,
+                                        highlight: *highlight,
+                                    }),
+                                }
+                            }
+                        }
+                    }
+                }
+                Ok(())
+            });
+        self.highlight_stack = highlight_stack;
+        result
+    }
+
+    fn highlight_in_range<'a>(
+        &'a mut self,
+        config: &'a HighlightConfiguration,
+        source: &'a [u8],
+        byte_range: ops::Range<usize>,
+        cancellation_flag: Option<&'a AtomicUsize>,
         mut injection_callback: impl FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
     ) -> Result<impl Iterator<Item = Result<HighlightEvent, Error>> + 'a, Error> {
         let layers = HighlightIterLayer::new(
@@ -138,6 +277,7 @@ impl Highlighter {
             self,
             cancellation_flag,
             &mut injection_callback,
+            &byte_range,
             config,
             0,
             vec![Range {
@@ -151,6 +291,7 @@ impl Highlighter {
         let mut result = HighlightIter {
             source,
             byte_offset: 0,
+            byte_range,
             injection_callback,
             cancellation_flag,
             highlighter: self,
@@ -184,6 +325,28 @@ impl HighlightConfiguration {
         highlights_query: &str,
         injection_query: &str,
         locals_query: &str,
+    ) -> Result<Self, QueryError> {
+        Self::new_with_cache(
+            language,
+            highlights_query,
+            injection_query,
+            locals_query,
+            None,
+        )
+    }
+
+    /// Creates a `HighlightConfiguration` like [HighlightConfiguration::new], but uses the
+    /// file at `cache_path`, if one is given, to avoid recompiling the combined query.
+    ///
+    /// If the file contains a serialized query that was compiled from the same query strings,
+    /// then the query is loaded from it directly. Otherwise, the query is compiled, and its
+    /// serialized form is written to the file. Failures to read or write the file are ignored.
+    pub fn new_with_cache(
+        language: Language,
+        highlights_query: &str,
+        injection_query: &str,
+        locals_query: &str,
+        cache_path: Option<&Path>,
     ) -> Result<Self, QueryError> {
         // Concatenate the query strings, keeping track of the start offset of each section.
         let mut query_source = String::new();
@@ -195,7 +358,19 @@ impl HighlightConfiguration {
 
         // Construct a single query by concatenating the three query strings, but record the
         // range of pattern indices that belong to each individual string.
-        let mut query = Query::new(language, &query_source)?;
+        let cached_query = cache_path
+            .and_then(|path| fs::read(path).ok())
+            .and_then(|data| Query::deserialize(language, &query_source, &data));
+        let mut query = match cached_query {
+            Some(query) => query,
+            None => {
+                let query = Query::new(language, &query_source)?;
+                if let Some(path) = cache_path {
+                    fs::write(path, query.serialize()).ok();
+                }
+                query
+            }
+        };
         let mut locals_pattern_index = 0;
         let mut highlights_pattern_index = 0;
         for i in 0..(query.pattern_count()) {
@@ -334,6 +509,7 @@ impl<'a> HighlightIterLayer<'a> {
         highlighter: &mut Highlighter,
         cancellation_flag: Option<&'a AtomicUsize>,
         injection_callback: &mut F,
+        byte_range: &ops::Range<usize>,
         mut config: &'a HighlightConfiguration,
         mut depth: usize,
         mut ranges: Vec<Range>,
@@ -347,13 +523,32 @@ impl<'a> HighlightIterLayer<'a> {
                     .set_language(config.language)
                     .map_err(|_| Error::InvalidLanguage)?;
 
-                unsafe { highlighter.parser.set_cancellation_flag(cancellation_flag) };
-                let tree = highlighter
-                    .parser
-                    .parse(source, None)
-                    .ok_or(Error::Cancelled)?;
-                unsafe { highlighter.parser.set_cancellation_flag(None) };
+                // When highlighting as part of a session, reuse the layer's previous tree.
+                // A layer that has already been parsed since the last edit is used as-is.
+                let layer_byte_range = ranges[0].start_byte..ranges[ranges.len() - 1].end_byte;
+                let old_layer = highlighter
+                    .layer_cache
+                    .as_mut()
+                    .and_then(|cache| cache.take_layer(config, depth, layer_byte_range.start));
+                let tree = match &old_layer {
+                    Some(layer) if layer.is_up_to_date && layer.included_ranges == ranges => {
+                        layer.tree.clone()
+                    }
+                    _ => {
+                        unsafe { highlighter.parser.set_cancellation_flag(cancellation_flag) };
+                        let tree = highlighter
+                            .parser
+                            .parse(source, old_layer.as_ref().map(|layer| &layer.tree))
+                            .ok_or(Error::Cancelled)?;
+                        unsafe { highlighter.parser.set_cancellation_flag(None) };
+                        tree
+                    }
+                };
+                if let Some(cache) = &mut highlighter.layer_cache {
+                    cache.add_parsed_layer(config, depth, &ranges, &tree, old_layer);
+                }
                 let mut cursor = highlighter.cursors.pop().unwrap_or(QueryCursor::new());
+                cursor.set_byte_range(0..usize::MAX);
 
                 // Process combined injections.
                 if let Some(combined_injections_query) = &config.combined_injections_query {
@@ -390,6 +585,14 @@ impl<'a> HighlightIterLayer<'a> {
                     }
                 }
 
+                // Only captures within the requested range are needed, except that local
+                // variables can only be tracked by processing the entire document.
+                if config.locals_pattern_index < config.highlights_pattern_index {
+                    cursor.set_byte_range(0..byte_range.end);
+                } else {
+                    cursor.set_byte_range(byte_range.clone());
+                }
+
                 // The `captures` iterator borrows the `Tree` and the `QueryCursor`, which
                 // prevents them from being moved. But both of these values are really just
                 // pointers, so it's actually ok to move them.
@@ -615,6 +818,19 @@ where
     }
 }
 
+impl<'a, F> Drop for HighlightIter<'a, F>
+where
+    F: FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
+{
+    // Return the query cursors of any unfinished layers to the highlighter, so that
+    // they can be reused even if the iterator is not run to completion.
+    fn drop(&mut self) {
+        for layer in self.layers.drain(..) {
+            self.highlighter.cursors.push(layer.cursor);
+        }
+    }
+}
+
 impl<'a, F> Iterator for HighlightIter<'a, F>
 where
     F: FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
@@ -707,6 +923,7 @@ where
                                 self.highlighter,
                                 self.cancellation_flag,
                                 &mut self.injection_callback,
+                                &self.byte_range,
                                 config,
                                 self.layers[0].depth + 1,
                                 ranges,
@@ -884,6 +1101,151 @@ where
     }
 }
 
+impl<'a> HighlightSession<'a> {
+    pub fn new(config: &'a HighlightConfiguration) -> Self {
+        let mut highlighter = Highlighter::new();
+        highlighter.layer_cache = Some(LayerCache::default());
+        HighlightSession {
+            config,
+            highlighter,
+            pending_ranges: vec![0..usize::MAX],
+        }
+    }
+
+    pub fn parser(&mut self) -> &mut Parser {
+        &mut self.highlighter.parser
+    }
+
+    /// Record an edit to the document. This must be called for each edit, before the
+    /// document is highlighted again using `update`.
+    pub fn edit(&mut self, edit: &InputEdit) {
+        for range in &mut self.pending_ranges {
+            *range = edit_byte_range(range, edit);
+        }
+        self.pending_ranges
+            .push(edit.start_byte..edit.new_end_byte.max(edit.start_byte + 1));
+        if let Some(cache) = &mut self.highlighter.layer_cache {
+            for layer in &mut cache.layers {
+                layer.tree.edit(edit);
+                layer.byte_range = edit_byte_range(&layer.byte_range, edit);
+                layer.is_up_to_date = false;
+            }
+        }
+    }
+
+    /// Bring the highlighting up to date with the current contents of the document,
+    /// storing the regions whose highlighting was recomputed in `deltas`, sorted by
+    /// position. The first call computes the highlighting of the entire document.
+    pub fn update(
+        &mut self,
+        source: &[u8],
+        cancellation_flag: Option<&AtomicUsize>,
+        mut injection_callback: impl FnMut(&str) -> Option<&'a HighlightConfiguration>,
+        deltas: &mut Vec<HighlightDelta>,
+    ) -> Result<(), Error> {
+        deltas.clear();
+        let mut ranges_to_highlight = mem::take(&mut self.pending_ranges);
+        let mut highlighted_ranges = Vec::new();
+        while !ranges_to_highlight.is_empty() {
+            for range in normalize_ranges(ranges_to_highlight, source.len()) {
+                let mut spans = Vec::new();
+                let result = self.highlighter.highlight_spans(
+                    self.config,
+                    source,
+                    range.clone(),
+                    cancellation_flag,
+                    |name| injection_callback(name),
+                    &mut spans,
+                );
+                let cache = self.highlighter.layer_cache.as_mut().unwrap();
+                cache.finish_pass(&range);
+                if let Err(error) = result {
+                    // Some of the layers' changes have been lost, so the whole
+                    // document will need to be highlighted again.
+                    deltas.clear();
+                    self.pending_ranges = vec![0..usize::MAX];
+                    return Err(error);
+                }
+                highlighted_ranges.push(range.clone());
+                deltas.push(HighlightDelta { range, spans });
+            }
+
+            // Highlighting those ranges may have revealed changes in the syntax trees
+            // of other ranges, which must be highlighted as well.
+            highlighted_ranges = normalize_ranges(highlighted_ranges, source.len());
+            let cache = self.highlighter.layer_cache.as_mut().unwrap();
+            ranges_to_highlight = subtract_ranges(
+                &normalize_ranges(mem::take(&mut cache.changed_ranges), source.len()),
+                &highlighted_ranges,
+            );
+        }
+        deltas.sort_unstable_by_key(|delta| delta.range.start);
+        Ok(())
+    }
+}
+
+impl LayerCache {
+    fn take_layer(
+        &mut self,
+        config: &HighlightConfiguration,
+        depth: usize,
+        start_byte: usize,
+    ) -> Option<CachedLayer> {
+        let index = self.layers.iter().position(|layer| {
+            layer.config_address == config as *const _ as usize
+                && layer.depth == depth
+                && layer.byte_range.start == start_byte
+        })?;
+        Some(self.layers.swap_remove(index))
+    }
+
+    fn add_parsed_layer(
+        &mut self,
+        config: &HighlightConfiguration,
+        depth: usize,
+        included_ranges: &[Range],
+        tree: &Tree,
+        old_layer: Option<CachedLayer>,
+    ) {
+        let byte_range =
+            included_ranges[0].start_byte..included_ranges[included_ranges.len() - 1].end_byte;
+        match old_layer {
+            Some(old_layer)
+                if old_layer.is_up_to_date && old_layer.included_ranges == included_ranges => {}
+            Some(old_layer) => self.changed_ranges.extend(
+                old_layer
+                    .tree
+                    .changed_ranges(tree)
+                    .map(|range| range.start_byte..range.end_byte),
+            ),
+            None => self.changed_ranges.push(byte_range.clone()),
+        }
+        self.parsed_layers.push(CachedLayer {
+            config_address: config as *const _ as usize,
+            depth,
+            byte_range,
+            included_ranges: included_ranges.to_vec(),
+            tree: tree.clone(),
+            is_up_to_date: true,
+        });
+    }
+
+    // After highlighting a given range, any previous layers within that range that
+    // were not parsed again have disappeared from the document.
+    fn finish_pass(&mut self, range: &ops::Range<usize>) {
+        let changed_ranges = &mut self.changed_ranges;
+        self.layers.retain(|layer| {
+            let was_removed =
+                layer.byte_range.start < range.end && range.start < layer.byte_range.end;
+            if was_removed {
+                changed_ranges.push(layer.byte_range.clone());
+            }
+            !was_removed
+        });
+        self.layers.extend(self.parsed_layers.drain(..));
+    }
+}
+
 impl HtmlRenderer {
     pub fn new() -> Self {
         let mut result = HtmlRenderer {
@@ -1066,6 +1428,64 @@ fn injection_for_match<'a>(
     (language_name, content_node, include_children)
 }
 
+fn edit_byte_range(range: &ops::Range<usize>, edit: &InputEdit) -> ops::Range<usize> {
+    let edit_offset = |offset: usize| {
+        if offset >= edit.old_end_byte {
+            (offset - edit.old_end_byte).saturating_add(edit.new_end_byte)
+        } else if offset > edit.start_byte {
+            offset.min(edit.new_end_byte)
+        } else {
+            offset
+        }
+    };
+    edit_offset(range.start)..edit_offset(range.end)
+}
+
+// Sort the given ranges, clip them to the length of the document, and merge any
+// that overlap or touch.
+fn normalize_ranges(mut ranges: Vec<ops::Range<usize>>, len: usize) -> Vec<ops::Range<usize>> {
+    ranges.sort_unstable_by_key(|range| range.start);
+    let mut result: Vec<ops::Range<usize>> = Vec::with_capacity(ranges.len());
+    for range in ranges {
+        let range = range.start.min(len)..range.end.min(len);
+        if range.start >= range.end {
+            continue;
+        }
+        match result.last_mut() {
+            Some(last) if range.start <= last.end => last.end = last.end.max(range.end),
+            _ => result.push(range),
+        }
+    }
+    result
+}
+
+// Remove the parts of the given sorted ranges that are covered by other sorted ranges.
+fn subtract_ranges(
+    ranges: &[ops::Range<usize>],
+    covered: &[ops::Range<usize>],
+) -> Vec<ops::Range<usize>> {
+    let mut result = Vec::new();
+    for range in ranges {
+        let mut start = range.start;
+        for covered_range in covered {
+            if covered_range.end <= start {
+                continue;
+            }
+            if covered_range.start >= range.end {
+                break;
+            }
+            if start < covered_range.start {
+                result.push(start..covered_range.start);
+            }
+            start = covered_range.end;
+        }
+        if start < range.end {
+            result.push(start..range.end);
+        }
+    }
+    result
+}
+
 fn shrink_and_clear<T>(vec: &mut Vec<T>, capacity: usize) {
     if vec.len() > capacity {
         vec.truncate(capacity);
@@ -14,6 +14,11 @@ pub struct TSParser {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSParserPool {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSTree {
     _unused: [u8; 0],
 }
@@ -27,9 +32,23 @@ pub struct TSQuery {
 pub struct TSQueryCursor {
     _unused: [u8; 0],
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSNodeExporter {
+    _unused: [u8; 0],
+}
 pub const TSInputEncoding_TSInputEncodingUTF8: TSInputEncoding = 0;
 pub const TSInputEncoding_TSInputEncodingUTF16: TSInputEncoding = 1;
+pub const TSInputEncoding_TSInputEncodingLatin1: TSInputEncoding = 2;
 pub type TSInputEncoding = ::std::os::raw::c_uint;
+pub const TSAllocationCategory_TSAllocationCategorySubtree: TSAllocationCategory = 0;
+pub const TSAllocationCategory_TSAllocationCategoryStackNode: TSAllocationCategory = 1;
+pub const TSAllocationCategory_TSAllocationCategoryLexerRanges: TSAllocationCategory = 2;
+pub const TSAllocationCategory_TSAllocationCategoryQueryState: TSAllocationCategory = 3;
+pub const TSAllocationCategory_TSAllocationCategoryCaptureList: TSAllocationCategory = 4;
+pub const TSAllocationCategory_TSAllocationCategoryCursorStack: TSAllocationCategory = 5;
+pub const TSAllocationCategory_TSAllocationCategoryExternalScannerState: TSAllocationCategory = 6;
+pub type TSAllocationCategory = ::std::os::raw::c_uint;
 pub const TSSymbolType_TSSymbolTypeRegular: TSSymbolType = 0;
 pub const TSSymbolType_TSSymbolTypeAnonymous: TSSymbolType = 1;
 pub const TSSymbolType_TSSymbolTypeAuxiliary: TSSymbolType = 2;
@@ -42,6 +61,27 @@ pub struct TSPoint {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSAllocationHooks {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub allocated: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            category: TSAllocationCategory,
+            buffer: *const ::std::os::raw::c_void,
+            size: usize,
+        ),
+    >,
+    pub freed: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            category: TSAllocationCategory,
+            buffer: *const ::std::os::raw::c_void,
+            size: usize,
+        ),
+    >,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSRange {
     pub start_point: TSPoint,
     pub end_point: TSPoint,
@@ -79,6 +119,47 @@ pub struct TSLogger {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSParserStats {
+    pub parse_table_cache_hits: u64,
+    pub parse_table_cache_misses: u64,
+    pub stack_node_count: u64,
+    pub stack_node_slab_count: u64,
+    pub max_stack_version_count: u32,
+    pub advance_count: u64,
+    pub token_count: u64,
+    pub relex_count: u64,
+    pub cached_token_hits: u64,
+    pub reused_node_count: u64,
+    pub rebuilt_node_count: u64,
+    pub shared_node_count: u64,
+    pub error_recovery_count: u64,
+    pub subtree_allocation_count: u64,
+    pub parse_time_micros: u64,
+    pub balance_time_micros: u64,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSTreeMemoryUsage {
+    pub total_bytes: usize,
+    pub unique_subtree_bytes: usize,
+    pub shared_subtree_bytes: usize,
+    pub external_scanner_state_bytes: usize,
+    pub cache_bytes: usize,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSQueryCursorStats {
+    pub peak_state_count: u32,
+    pub peak_finished_state_count: u32,
+    pub peak_capture_list_count: u32,
+    pub abandoned_match_count: u32,
+    pub out_of_order_capture_count: u32,
+    pub rejected_match_count: u32,
+    pub visited_node_count: u32,
+    pub step_count: u64,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSInputEdit {
     pub start_byte: u32,
     pub old_end_byte: u32,
@@ -96,11 +177,51 @@ pub struct TSNode {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSStreamingCallback {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub node_finished: ::std::option::Option<
+        unsafe extern "C" fn(payload: *mut ::std::os::raw::c_void, node: TSNode),
+    >,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSProgressCallback {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub progress: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            byte_offset: u32,
+            version_count: u32,
+        ) -> bool,
+    >,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSTreeCursor {
     pub tree: *const ::std::os::raw::c_void,
     pub id: *const ::std::os::raw::c_void,
     pub context: [u32; 2usize],
 }
+pub const TSNodeFlag_TSNodeFlagNamed: TSNodeFlag = 1;
+pub const TSNodeFlag_TSNodeFlagExtra: TSNodeFlag = 2;
+pub const TSNodeFlag_TSNodeFlagMissing: TSNodeFlag = 4;
+pub const TSNodeFlag_TSNodeFlagHasError: TSNodeFlag = 8;
+pub const TSNodeFlag_TSNodeFlagHasChanges: TSNodeFlag = 16;
+pub const TSNodeFlag_TSNodeFlagHasChildren: TSNodeFlag = 32;
+pub type TSNodeFlag = ::std::os::raw::c_uint;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSNodeArray {
+    pub capacity: u32,
+    pub symbols: *mut TSSymbol,
+    pub field_ids: *mut TSFieldId,
+    pub start_bytes: *mut u32,
+    pub end_bytes: *mut u32,
+    pub start_points: *mut TSPoint,
+    pub end_points: *mut TSPoint,
+    pub parent_indices: *mut u32,
+    pub flags: *mut u8,
+}
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct TSQueryCapture {
@@ -182,6 +303,30 @@ extern "C" {
         length: u32,
     ) -> bool;
 }
+extern "C" {
+    #[doc = " Replace some of the ranges of text that the parser should include when"]
+    #[doc = " parsing, leaving the others as they are."]
+    #[doc = ""]
+    #[doc = " The `old_count` ranges starting at `start_index` in the parser's current"]
+    #[doc = " ranges are replaced with the `count` given ranges. Only the new ranges are"]
+    #[doc = " copied and validated, so this is much faster than calling"]
+    #[doc = " `ts_parser_set_included_ranges` with the entire set when a document has"]
+    #[doc = " many ranges and only a few of them have changed. The new ranges must be"]
+    #[doc = " ordered and must not overlap with each other or with the ranges before and"]
+    #[doc = " after them."]
+    #[doc = ""]
+    #[doc = " If the replaced ranges are not within the current ranges, or the new ranges"]
+    #[doc = " are not valid, the operation will fail, the ranges will not be changed, and"]
+    #[doc = " this function will return `false`. On success, this function returns `true`."]
+    #[doc = " If this removes every range, then the entire document will be parsed."]
+    pub fn ts_parser_update_included_ranges(
+        self_: *mut TSParser,
+        start_index: u32,
+        old_count: u32,
+        ranges: *const TSRange,
+        count: u32,
+    ) -> bool;
+}
 extern "C" {
     #[doc = " Get the ranges of text that the parser will include when parsing."]
     #[doc = ""]
@@ -212,7 +357,10 @@ extern "C" {
     #[doc = " 2. `payload`: An arbitrary pointer that will be passed to each invocation"]
     #[doc = "    of the `read` function."]
     #[doc = " 3. `encoding`: An indication of how the text is encoded. Either"]
-    #[doc = "    `TSInputEncodingUTF8` or `TSInputEncodingUTF16`."]
+    #[doc = "    `TSInputEncodingUTF8`, `TSInputEncodingUTF16`, or `TSInputEncodingLatin1`."]
+    #[doc = "    With `TSInputEncodingLatin1`, each byte is read as the code point with"]
+    #[doc = "    the same value, so any sequence of bytes can be parsed without decoding"]
+    #[doc = "    errors."]
     #[doc = ""]
     #[doc = " This function returns a syntax tree on success, and `NULL` on failure. There"]
     #[doc = " are three possible reasons for failure:"]
@@ -224,9 +372,10 @@ extern "C" {
     #[doc = "    same arguments. Or you can start parsing from scratch by first calling"]
     #[doc = "    `ts_parser_reset`."]
     #[doc = " 3. Parsing was cancelled using a cancellation flag that was set by an"]
-    #[doc = "    earlier call to `ts_parser_set_cancellation_flag`. You can resume parsing"]
-    #[doc = "    from where the parser left out by calling `ts_parser_parse` again with"]
-    #[doc = "    the same arguments."]
+    #[doc = "    earlier call to `ts_parser_set_cancellation_flag`, or by a progress"]
+    #[doc = "    callback that returned `true`. You can resume parsing from where the"]
+    #[doc = "    parser left out by calling `ts_parser_parse` again with the same"]
+    #[doc = "    arguments."]
     pub fn ts_parser_parse(
         self_: *mut TSParser,
         old_tree: *const TSTree,
@@ -238,6 +387,9 @@ extern "C" {
     #[doc = " The first two parameters are the same as in the `ts_parser_parse` function"]
     #[doc = " above. The second two parameters indicate the location of the buffer and its"]
     #[doc = " length in bytes."]
+    #[doc = ""]
+    #[doc = " The buffer is read directly, without calling an input callback, so this is"]
+    #[doc = " the fastest way to parse a document that is already in memory."]
     pub fn ts_parser_parse_string(
         self_: *mut TSParser,
         old_tree: *const TSTree,
@@ -280,6 +432,200 @@ extern "C" {
     #[doc = " Get the duration in microseconds that parsing is allowed to take."]
     pub fn ts_parser_timeout_micros(self_: *const TSParser) -> u64;
 }
+extern "C" {
+    #[doc = " Set the maximum number of bytes of syntax nodes that a single parse is"]
+    #[doc = " allowed to allocate before halting. The default of zero means no limit."]
+    #[doc = ""]
+    #[doc = " The limit is checked as often as the timeout, and applies to the nodes"]
+    #[doc = " created since the parse began, including those that were later discarded,"]
+    #[doc = " so it bounds the parse's work as well as its memory. Nodes reused from the"]
+    #[doc = " old tree are not counted. If the limit is exceeded, then parsing halts and"]
+    #[doc = " returns NULL. Unlike a timeout, the partial parse is not kept for resuming:"]
+    #[doc = " its memory is released immediately, as if `ts_parser_reset` had been called."]
+    pub fn ts_parser_set_memory_limit(self_: *mut TSParser, limit: usize);
+}
+extern "C" {
+    #[doc = " Get the maximum number of bytes of syntax nodes that a parse may allocate."]
+    pub fn ts_parser_memory_limit(self_: *const TSParser) -> usize;
+}
+extern "C" {
+    #[doc = " Set the number of error recovery operations that a single parse may perform"]
+    #[doc = " before it switches to a cheaper way of recovering. The default of zero means"]
+    #[doc = " no limit."]
+    #[doc = ""]
+    #[doc = " Each time the parser encounters an invalid token, or skips a token while"]
+    #[doc = " recovering from an error, counts as one operation. Ordinarily, the parser"]
+    #[doc = " explores several alternative ways of recovering from each error, which can"]
+    #[doc = " take a long time on large inputs with many errors, such as minified or"]
+    #[doc = " binary data. Once the budget is used up, the parser only keeps the most"]
+    #[doc = " promising interpretation of the input, and skips tokens until one of them"]
+    #[doc = " is valid in a state that it was in before the error, so the rest of the"]
+    #[doc = " parse takes time proportional to the length of the input. The resulting"]
+    #[doc = " tree is still complete, but it may contain larger ERROR nodes."]
+    pub fn ts_parser_set_error_recovery_budget(self_: *mut TSParser, budget: u32);
+}
+extern "C" {
+    #[doc = " Get the number of error recovery operations that a single parse may perform"]
+    #[doc = " before it switches to a cheaper way of recovering."]
+    pub fn ts_parser_error_recovery_budget(self_: *const TSParser) -> u32;
+}
+extern "C" {
+    #[doc = " Get counters describing the work that the parser has done."]
+    #[doc = ""]
+    #[doc = " The counters are accumulated over every parse performed with this parser,"]
+    #[doc = " and are cheap enough to be maintained at all times:"]
+    #[doc = " - `parse_table_cache_hits`, `parse_table_cache_misses` - The number of"]
+    #[doc = "   parse table lookups for compressed (\"small\") parse states that were"]
+    #[doc = "   answered by the parser's lookup cache, or that required searching"]
+    #[doc = "   the parse table."]
+    #[doc = " - `stack_node_count` - The number of parse stack nodes that were created."]
+    #[doc = " - `stack_node_slab_count` - The number of memory blocks that were allocated"]
+    #[doc = "   to hold parse stack nodes. Nodes are recycled between parses, so this"]
+    #[doc = "   stops growing once the parser has seen its peak stack usage."]
+    #[doc = " - `max_stack_version_count` - The largest number of simultaneous versions"]
+    #[doc = "   of the parse stack, which grows when the grammar's conflicts cause the"]
+    #[doc = "   parser to explore several interpretations of the input at once."]
+    #[doc = " - `advance_count` - The number of times that a version of the parse stack"]
+    #[doc = "   processed a lookahead token or node. Unlike the timing counters, this is"]
+    #[doc = "   deterministic, so the ratio of this count to the input size can be used"]
+    #[doc = "   to detect inputs that are disproportionately expensive to parse."]
+    #[doc = " - `token_count` - The number of tokens produced by the lexer."]
+    #[doc = " - `relex_count` - The number of times that a node reused from an old tree"]
+    #[doc = "   turned out to be invalid and was broken down, so that the text after it"]
+    #[doc = "   had to be lexed again."]
+    #[doc = " - `cached_token_hits` - The number of times that a token lexed for one"]
+    #[doc = "   stack version was reused by another version, instead of lexing again."]
+    #[doc = " - `reused_node_count`, `rebuilt_node_count` - The number of nodes reused"]
+    #[doc = "   from the old tree during incremental parsing, and the number of nodes"]
+    #[doc = "   built by reductions. A high proportion of rebuilt nodes after small"]
+    #[doc = "   edits indicates a grammar that does not parse incrementally well."]
+    #[doc = " - `shared_node_count` - The number of newly-built nodes that were replaced"]
+    #[doc = "   by identical nodes from earlier trees. See"]
+    #[doc = "   `ts_parser_set_node_sharing_capacity`."]
+    #[doc = " - `error_recovery_count` - The number of times that the parser had to"]
+    #[doc = "   begin recovering from a syntax error."]
+    #[doc = " - `subtree_allocation_count` - The number of syntax nodes that required"]
+    #[doc = "   memory to be allocated."]
+    #[doc = " - `parse_time_micros`, `balance_time_micros` - The time spent lexing and"]
+    #[doc = "   parsing, and the time spent rebalancing the finished trees."]
+    pub fn ts_parser_stats(self_: *const TSParser, stats: *mut TSParserStats);
+}
+extern "C" {
+    #[doc = " Set whether the parser should allocate syntax nodes from an arena."]
+    #[doc = ""]
+    #[doc = " When enabled, each call to `ts_parser_parse` carves the nodes that it"]
+    #[doc = " creates out of a small number of large memory blocks, which are owned by"]
+    #[doc = " the resulting tree and are freed all at once when the tree (and every tree"]
+    #[doc = " that shares nodes with it) has been deleted. This greatly reduces the"]
+    #[doc = " number of allocations needed to build and to delete large trees."]
+    #[doc = ""]
+    #[doc = " Arenas are only used when parsing without an old tree. When re-parsing a"]
+    #[doc = " document after edits, the nodes that are reused from the old tree keep its"]
+    #[doc = " arenas alive, so the new nodes are allocated individually instead. This"]
+    #[doc = " way, a tree never keeps alive more arenas than the last tree that was"]
+    #[doc = " parsed from scratch. Because nodes are never freed individually, memory"]
+    #[doc = " belonging to discarded nodes is only reclaimed with the whole arena, so you"]
+    #[doc = " may want to occasionally parse from scratch."]
+    pub fn ts_parser_set_arena_allocation(self_: *mut TSParser, enabled: bool);
+}
+extern "C" {
+    #[doc = " Get whether the parser allocates syntax nodes from an arena."]
+    pub fn ts_parser_arena_allocation(self_: *const TSParser) -> bool;
+}
+extern "C" {
+    #[doc = " Set whether the parser should skip balancing the trees that it produces."]
+    #[doc = ""]
+    #[doc = " After parsing, the parser normally rebalances the hidden nodes that hold"]
+    #[doc = " long sequences of repeated elements, such as the statements of a long file,"]
+    #[doc = " so that later edits and incremental parses take logarithmic rather than"]
+    #[doc = " linear time. With deferred balancing, trees are returned sooner, and can be"]
+    #[doc = " balanced later by calling `ts_tree_balance`, for example on a background"]
+    #[doc = " thread. A tree that is never balanced is still correct, but it makes later"]
+    #[doc = " incremental parses slower."]
+    pub fn ts_parser_set_deferred_balancing(self_: *mut TSParser, enabled: bool);
+}
+extern "C" {
+    #[doc = " Get whether the parser skips balancing the trees that it produces."]
+    pub fn ts_parser_deferred_balancing(self_: *const TSParser) -> bool;
+}
+extern "C" {
+    #[doc = " Set the number of nodes that the parser retains so that identical subtrees"]
+    #[doc = " can be shared between the trees that it produces."]
+    #[doc = ""]
+    #[doc = " When many similar documents are parsed with the same parser, such as the"]
+    #[doc = " revisions of a file, or vendored copies of the same code, large parts of"]
+    #[doc = " their trees are identical. With node sharing, each newly-built node is"]
+    #[doc = " looked up by its contents and the identities of its children, and is"]
+    #[doc = " replaced by an identical node from an earlier tree if one is found. Shared"]
+    #[doc = " nodes are reference counted like any other, so this reduces the memory used"]
+    #[doc = " by the trees, and lets `ts_tree_get_changed_ranges` skip over the shared"]
+    #[doc = " subtrees without comparing them."]
+    #[doc = ""]
+    #[doc = " The retained nodes are kept alive by the parser until they are evicted to"]
+    #[doc = " make room for newer ones, or until the parser's language is changed. The"]
+    #[doc = " capacity is rounded up to a power of two. The default is zero, which"]
+    #[doc = " disables node sharing. Nodes are only shared when parsing from scratch,"]
+    #[doc = " without an old tree, and not when arena allocation or deferred balancing is"]
+    #[doc = " enabled."]
+    pub fn ts_parser_set_node_sharing_capacity(self_: *mut TSParser, capacity: u32);
+}
+extern "C" {
+    #[doc = " Get the number of nodes that the parser retains for node sharing."]
+    pub fn ts_parser_node_sharing_capacity(self_: *const TSParser) -> u32;
+}
+extern "C" {
+    #[doc = " Set a callback that receives the top-level nodes of the document as soon as"]
+    #[doc = " they are finished, so that very large inputs can be processed without"]
+    #[doc = " keeping the entire syntax tree in memory."]
+    #[doc = ""]
+    #[doc = " This works for languages whose root node is a sequence of repeated items,"]
+    #[doc = " such as log files, CSV files, or JSON lines. Whenever the parser has only"]
+    #[doc = " one interpretation of the input, and a group of the root node's children can"]
+    #[doc = " no longer change, it calls the callback's `node_finished` function with each"]
+    #[doc = " of them in order, and then frees them. The nodes are only valid during the"]
+    #[doc = " call, and the callback must not use the parser."]
+    #[doc = ""]
+    #[doc = " The tree that is eventually returned only contains the root node's children"]
+    #[doc = " that were not passed to the callback. The other children are replaced by"]
+    #[doc = " hidden placeholders, so that the positions of the remaining nodes stay the"]
+    #[doc = " same. An error that is found later can cause the placeholders to be part of"]
+    #[doc = " an ERROR node."]
+    pub fn ts_parser_set_streaming_callback(self_: *mut TSParser, callback: TSStreamingCallback);
+}
+extern "C" {
+    #[doc = " Get the parser's current streaming callback."]
+    pub fn ts_parser_streaming_callback(self_: *const TSParser) -> TSStreamingCallback;
+}
+extern "C" {
+    #[doc = " Set a callback that the parser calls periodically during parsing, in order"]
+    #[doc = " to report its progress."]
+    #[doc = ""]
+    #[doc = " The callback's `progress` function receives the byte offset that the parser"]
+    #[doc = " has reached, and the number of alternative interpretations of the input that"]
+    #[doc = " it is currently considering. If the function returns `true`, then the parser"]
+    #[doc = " halts early, returning NULL, as it does when a timeout expires. It can then"]
+    #[doc = " be resumed by calling `ts_parser_parse` again, so that a long parse can be"]
+    #[doc = " split into small slices that are interleaved with other work. During the"]
+    #[doc = " call, the only parser function that may be used is"]
+    #[doc = " `ts_parser_provisional_tree`."]
+    pub fn ts_parser_set_progress_callback(self_: *mut TSParser, callback: TSProgressCallback);
+}
+extern "C" {
+    #[doc = " Get the parser's current progress callback."]
+    pub fn ts_parser_progress_callback(self_: *const TSParser) -> TSProgressCallback;
+}
+extern "C" {
+    #[doc = " Get a provisional syntax tree for the part of the document that has been"]
+    #[doc = " parsed so far, while a parse is halted or from within the progress callback."]
+    #[doc = ""]
+    #[doc = " The tree's root node spans from the start of the document to the position"]
+    #[doc = " that the parser has reached. Its children are the nodes that the parser has"]
+    #[doc = " finished, along with the tokens that it has not yet grouped into larger"]
+    #[doc = " nodes. The nodes near the end of the tree may therefore differ from the ones"]
+    #[doc = " in the final tree. This function returns NULL if no parse is in progress."]
+    #[doc = " The caller is responsible for deleting the tree."]
+    pub fn ts_parser_provisional_tree(self_: *mut TSParser) -> *mut TSTree;
+}
 extern "C" {
     #[doc = " Set the parser's current cancellation flag pointer."]
     #[doc = ""]
@@ -311,6 +657,39 @@ extern "C" {
     #[doc = " SVG output. You can turn off this logging by passing a negative number."]
     pub fn ts_parser_print_dot_graphs(self_: *mut TSParser, file: ::std::os::raw::c_int);
 }
+extern "C" {
+    #[doc = " Create a pool of parsers for the given language, which can be shared"]
+    #[doc = " between threads."]
+    #[doc = ""]
+    #[doc = " Acquiring a parser from the pool avoids the cost of creating a new parser"]
+    #[doc = " and assigning it a language for every parse. The pool keeps up to `capacity`"]
+    #[doc = " idle parsers. Returns `NULL` if the language can't be assigned to a parser,"]
+    #[doc = " for the same reasons as `ts_parser_set_language`."]
+    pub fn ts_parser_pool_new(language: *const TSLanguage, capacity: u32) -> *mut TSParserPool;
+}
+extern "C" {
+    #[doc = " Delete the pool, along with all of its idle parsers. Any parsers that are"]
+    #[doc = " still acquired from the pool must be deleted with `ts_parser_delete`."]
+    pub fn ts_parser_pool_delete(arg1: *mut TSParserPool);
+}
+extern "C" {
+    #[doc = " Get the language of the pool's parsers."]
+    pub fn ts_parser_pool_language(arg1: *const TSParserPool) -> *const TSLanguage;
+}
+extern "C" {
+    #[doc = " Take an idle parser from the pool, or create a new one if there are none."]
+    #[doc = ""]
+    #[doc = " The parser is configured with the pool's language, and otherwise has the"]
+    #[doc = " default configuration. This function is lock-free."]
+    pub fn ts_parser_pool_acquire(arg1: *mut TSParserPool) -> *mut TSParser;
+}
+extern "C" {
+    #[doc = " Give a parser back to the pool, once you are done using it."]
+    #[doc = ""]
+    #[doc = " The parser is reset, and its configuration is restored to the defaults. If"]
+    #[doc = " the pool is already full, the parser is deleted. This function is lock-free."]
+    pub fn ts_parser_pool_release(arg1: *mut TSParserPool, arg2: *mut TSParser);
+}
 extern "C" {
     #[doc = " Create a shallow copy of the syntax tree. This is very fast."]
     #[doc = ""]
@@ -318,6 +697,43 @@ extern "C" {
     #[doc = " a time, as syntax trees are not thread safe."]
     pub fn ts_tree_copy(self_: *const TSTree) -> *mut TSTree;
 }
+extern "C" {
+    #[doc = " Create a frozen snapshot of a syntax tree, which can be shared by many"]
+    #[doc = " threads without them contending over its memory."]
+    #[doc = ""]
+    #[doc = " Ordinarily, copying a tree and reusing its nodes during an incremental parse"]
+    #[doc = " both atomically update the reference counts of its nodes. The nodes of a"]
+    #[doc = " frozen tree are never reference-counted individually. Instead, they stay"]
+    #[doc = " alive until the snapshot and every tree derived from it have been deleted."]
+    #[doc = " Each thread should use `ts_tree_copy` to get its own copy of the snapshot"]
+    #[doc = " to edit and reparse."]
+    pub fn ts_tree_freeze(self_: *const TSTree) -> *mut TSTree;
+}
+extern "C" {
+    #[doc = " Create a compacted, frozen copy of a syntax tree, for trees that are kept"]
+    #[doc = " for a long time and only read."]
+    #[doc = ""]
+    #[doc = " Like `ts_tree_freeze`, the result can be shared by many threads, and its"]
+    #[doc = " nodes are not reference-counted individually. In addition, all of its nodes"]
+    #[doc = " are stored in one block of memory, in the order in which a depth-first"]
+    #[doc = " traversal visits them, and identical leaves that could not be stored inline"]
+    #[doc = " are only stored once. The copy does not share any memory with the original,"]
+    #[doc = " so the original can be deleted afterwards. Compacting takes time and"]
+    #[doc = " temporary memory proportional to the size of the tree."]
+    pub fn ts_tree_compact(self_: *const TSTree) -> *mut TSTree;
+}
+extern "C" {
+    #[doc = " Balance a syntax tree that was produced by a parser with deferred balancing."]
+    #[doc = " This does nothing if the tree is already balanced."]
+    #[doc = ""]
+    #[doc = " Balancing rearranges the tree's hidden nodes in place, so it invalidates any"]
+    #[doc = " nodes and tree cursors obtained from the tree, and the tree must not be used"]
+    #[doc = " by any other thread during the call. A tree can't be balanced while it"]
+    #[doc = " shares its nodes with a copy of itself, or if it was created by"]
+    #[doc = " `ts_tree_freeze` or `ts_tree_compact`. In that case, this function returns"]
+    #[doc = " `false`. Otherwise, it returns `true`."]
+    pub fn ts_tree_balance(self_: *mut TSTree) -> bool;
+}
 extern "C" {
     #[doc = " Delete the syntax tree, freeing all of the memory that it used."]
     pub fn ts_tree_delete(self_: *mut TSTree);
@@ -326,6 +742,26 @@ extern "C" {
     #[doc = " Get the root node of the syntax tree."]
     pub fn ts_tree_root_node(self_: *const TSTree) -> TSNode;
 }
+extern "C" {
+    #[doc = " Measure the memory used by the syntax tree:"]
+    #[doc = " - `unique_subtree_bytes` - The bytes used by syntax nodes that belong only"]
+    #[doc = "   to this tree."]
+    #[doc = " - `shared_subtree_bytes` - The bytes used by syntax nodes that this tree"]
+    #[doc = "   shares with other trees, such as the old tree that it was parsed from, or"]
+    #[doc = "   its copies. These are only freed when every tree using them is deleted."]
+    #[doc = "   Nodes of frozen trees are always counted as shared. A node that appears"]
+    #[doc = "   in several places, such as a leaf deduplicated by node sharing, is only"]
+    #[doc = "   counted once."]
+    #[doc = " - `external_scanner_state_bytes` - The bytes used by serialized external"]
+    #[doc = "   scanner states that were too large to be stored within their nodes."]
+    #[doc = " - `cache_bytes` - The bytes used by the tree's lazily-built lookup caches."]
+    #[doc = " - `total_bytes` - All of the above, plus the tree itself and its included"]
+    #[doc = "   ranges."]
+    #[doc = ""]
+    #[doc = " This walks every node of the tree that is stored on the heap, so its cost is"]
+    #[doc = " proportional to the size of the tree."]
+    pub fn ts_tree_memory_usage(self_: *const TSTree, usage: *mut TSTreeMemoryUsage);
+}
 extern "C" {
     #[doc = " Get the language that was used to parse the syntax tree."]
     pub fn ts_tree_language(arg1: *const TSTree) -> *const TSLanguage;
@@ -338,6 +774,16 @@ extern "C" {
     #[doc = " (row, column) coordinates."]
     pub fn ts_tree_edit(self_: *mut TSTree, edit: *const TSInputEdit);
 }
+extern "C" {
+    #[doc = " Edit the syntax tree to reflect several edits to the source code at once."]
+    #[doc = ""]
+    #[doc = " The edits may be given in any order, but they must not overlap, and each one"]
+    #[doc = " must be described in terms of the source code *before* any of them were made."]
+    #[doc = " The result is the same as calling `ts_tree_edit` once for each edit, from the"]
+    #[doc = " last one in the document to the first, but each affected node in the tree is"]
+    #[doc = " only copied once."]
+    pub fn ts_tree_edit_batch(self_: *mut TSTree, edits: *const TSInputEdit, edit_count: u32);
+}
 extern "C" {
     #[doc = " Compare an old edited syntax tree to a new syntax tree representing the same"]
     #[doc = " document, returning an array of ranges whose syntactic structure has changed."]
@@ -357,6 +803,34 @@ extern "C" {
         length: *mut u32,
     ) -> *mut TSRange;
 }
+extern "C" {
+    #[doc = " Serialize the syntax tree into a compact binary snapshot, which can later"]
+    #[doc = " be loaded with `ts_tree_deserialize`, for example to cache the results of"]
+    #[doc = " parsing unchanged files between processes."]
+    #[doc = ""]
+    #[doc = " The snapshot includes the tree's parse states and external scanner states,"]
+    #[doc = " so a deserialized tree can be used as the `old_tree` for an incremental"]
+    #[doc = " parse. It is only valid for the same language, and on machines with the"]
+    #[doc = " same byte order."]
+    #[doc = ""]
+    #[doc = " The returned buffer is allocated using `malloc` and the caller is"]
+    #[doc = " responsible for freeing it using `free`. The length of the buffer will be"]
+    #[doc = " written to the given `length` pointer."]
+    pub fn ts_tree_serialize(self_: *const TSTree, length: *mut u32)
+        -> *mut ::std::os::raw::c_char;
+}
+extern "C" {
+    #[doc = " Load a syntax tree from a snapshot created by `ts_tree_serialize`."]
+    #[doc = ""]
+    #[doc = " The data is not retained, so it can be read directly from a memory-mapped"]
+    #[doc = " file that is unmapped afterward. Returns `NULL` if the data is malformed or"]
+    #[doc = " was created with a different language."]
+    pub fn ts_tree_deserialize(
+        data: *const ::std::os::raw::c_char,
+        length: u32,
+        language: *const TSLanguage,
+    ) -> *mut TSTree;
+}
 extern "C" {
     #[doc = " Get the node's type as a null-terminated string."]
     pub fn ts_node_type(arg1: TSNode) -> *const ::std::os::raw::c_char;
@@ -448,6 +922,13 @@ extern "C" {
     #[doc = " See also `ts_node_is_named`."]
     pub fn ts_node_named_child_count(arg1: TSNode) -> u32;
 }
+extern "C" {
+    #[doc = " Get the number of nodes in the subtree rooted at this node, including the"]
+    #[doc = " node itself. This does not require walking the subtree."]
+    #[doc = ""]
+    #[doc = " See also `ts_tree_cursor_goto_descendant`."]
+    pub fn ts_node_descendant_count(arg1: TSNode) -> u32;
+}
 extern "C" {
     #[doc = " Get the node's child with the given field name."]
     pub fn ts_node_child_by_field_name(
@@ -516,6 +997,19 @@ extern "C" {
     #[doc = " after an edit."]
     pub fn ts_node_edit(arg1: *mut TSNode, arg2: *const TSInputEdit);
 }
+extern "C" {
+    #[doc = " Edit several nodes to keep them in sync with several edits to the source code."]
+    #[doc = ""]
+    #[doc = " The edits are described in the same way as for `ts_tree_edit_batch`. The"]
+    #[doc = " result is the same as calling `ts_node_edit` on every node for each edit,"]
+    #[doc = " from the last one in the document to the first."]
+    pub fn ts_node_edit_batch(
+        nodes: *mut TSNode,
+        node_count: u32,
+        edits: *const TSInputEdit,
+        edit_count: u32,
+    );
+}
 extern "C" {
     #[doc = " Check if two nodes are identical."]
     pub fn ts_node_eq(arg1: TSNode, arg2: TSNode) -> bool;
@@ -536,6 +1030,13 @@ extern "C" {
     #[doc = " Re-initialize a tree cursor to start at a different node."]
     pub fn ts_tree_cursor_reset(arg1: *mut TSTreeCursor, arg2: TSNode);
 }
+extern "C" {
+    #[doc = " Re-initialize a tree cursor to the same position as another cursor."]
+    #[doc = ""]
+    #[doc = " Unlike `ts_tree_cursor_reset`, this will not lose parent information and"]
+    #[doc = " allows reusing already created cursors."]
+    pub fn ts_tree_cursor_reset_to(dst: *mut TSTreeCursor, src: *const TSTreeCursor);
+}
 extern "C" {
     #[doc = " Get the tree cursor's current node."]
     pub fn ts_tree_cursor_current_node(arg1: *const TSTreeCursor) -> TSNode;
@@ -589,9 +1090,57 @@ extern "C" {
     pub fn ts_tree_cursor_goto_first_child_for_point(arg1: *mut TSTreeCursor, arg2: TSPoint)
         -> i64;
 }
+extern "C" {
+    #[doc = " Move the cursor to the node that is the nth descendant of the original node"]
+    #[doc = " that the cursor was constructed with, where zero represents the original"]
+    #[doc = " node itself, and descendants are numbered in the order that a preorder"]
+    #[doc = " traversal would visit them."]
+    #[doc = ""]
+    #[doc = " This only walks the ancestors of the current node and of the goal node, so"]
+    #[doc = " it is much faster than walking the tree to the goal node. If the index is"]
+    #[doc = " out of range, the cursor does not move."]
+    pub fn ts_tree_cursor_goto_descendant(arg1: *mut TSTreeCursor, arg2: u32);
+}
+extern "C" {
+    #[doc = " Get the index of the cursor's current node out of all of the descendants"]
+    #[doc = " of the original node that the cursor was constructed with."]
+    pub fn ts_tree_cursor_current_descendant_index(arg1: *const TSTreeCursor) -> u32;
+}
 extern "C" {
     pub fn ts_tree_cursor_copy(arg1: *const TSTreeCursor) -> TSTreeCursor;
 }
+extern "C" {
+    #[doc = " Create a new node exporter, which copies the nodes of the subtree rooted at"]
+    #[doc = " the given node into flat arrays, in the same order that a tree cursor would"]
+    #[doc = " visit them."]
+    #[doc = ""]
+    #[doc = " If `named_only` is true, anonymous nodes are skipped, but their descendants"]
+    #[doc = " are still exported. Nodes that are more than `max_depth` levels below the"]
+    #[doc = " given node are skipped entirely. Pass `UINT32_MAX` to export the whole"]
+    #[doc = " subtree."]
+    pub fn ts_node_exporter_new(
+        arg1: TSNode,
+        named_only: bool,
+        max_depth: u32,
+    ) -> *mut TSNodeExporter;
+}
+extern "C" {
+    #[doc = " Delete a node exporter, freeing all of the memory that it used."]
+    pub fn ts_node_exporter_delete(arg1: *mut TSNodeExporter);
+}
+extern "C" {
+    #[doc = " Export the next batch of nodes into the given arrays."]
+    #[doc = ""]
+    #[doc = " Up to `capacity` nodes are written to the arrays in the given `TSNodeArray`."]
+    #[doc = " Any of the array pointers may be `NULL` if that column is not needed. Each"]
+    #[doc = " node's parent index refers to the position of its nearest exported ancestor"]
+    #[doc = " across all of the batches, or is `UINT32_MAX` for the first node. The flags"]
+    #[doc = " are a combination of `TSNodeFlag` values."]
+    #[doc = ""]
+    #[doc = " This returns the number of nodes that were written. A return value of zero"]
+    #[doc = " means that the whole subtree has been exported."]
+    pub fn ts_node_exporter_next(arg1: *mut TSNodeExporter, arg2: *mut TSNodeArray) -> u32;
+}
 extern "C" {
     #[doc = " Create a new query from a string containing one or more S-expression"]
     #[doc = " patterns. The query is associated with a particular language, and can"]
@@ -614,6 +1163,49 @@ extern "C" {
     #[doc = " Delete a query, freeing all of the memory that it used."]
     pub fn ts_query_delete(arg1: *mut TSQuery);
 }
+extern "C" {
+    #[doc = " Combine several queries for the same language into one new query, so that"]
+    #[doc = " all of their patterns can be matched in a single traversal of a tree."]
+    #[doc = ""]
+    #[doc = " The combined query contains the patterns of each of the given queries, in"]
+    #[doc = " order, and its captures with equal names are merged. The original queries"]
+    #[doc = " are not modified. Use `ts_query_source_query_for_pattern` to find which of"]
+    #[doc = " the queries a pattern came from. Returns `NULL` if the queries belong to"]
+    #[doc = " different languages, or if they are too large to combine."]
+    pub fn ts_query_combine(queries: *const *const TSQuery, count: u32) -> *mut TSQuery;
+}
+extern "C" {
+    #[doc = " Serialize a compiled query, including the results of analyzing its"]
+    #[doc = " patterns, into a binary format that can be loaded with"]
+    #[doc = " `ts_query_deserialize` much more quickly than the query's source can be"]
+    #[doc = " compiled, for example to cache the query on disk."]
+    #[doc = ""]
+    #[doc = " The data is only valid for the same language, and for the same build of"]
+    #[doc = " the Tree-sitter library. The returned buffer is allocated using `malloc`"]
+    #[doc = " and the caller is responsible for freeing it using `free`. The length of"]
+    #[doc = " the buffer will be written to the given `length` pointer."]
+    pub fn ts_query_serialize(
+        self_: *const TSQuery,
+        length: *mut u32,
+    ) -> *mut ::std::os::raw::c_char;
+}
+extern "C" {
+    #[doc = " Load a query from data created by `ts_query_serialize`."]
+    #[doc = ""]
+    #[doc = " The source from which the query was compiled must also be given. For a"]
+    #[doc = " query created with `ts_query_combine`, this is the concatenation of the"]
+    #[doc = " sources of the combined queries, in order. Returns `NULL` if the data is"]
+    #[doc = " malformed, or if it was created from a different source, a different"]
+    #[doc = " language, or a different build of the library, in which case the query"]
+    #[doc = " should be compiled with `ts_query_new` instead."]
+    pub fn ts_query_deserialize(
+        data: *const ::std::os::raw::c_char,
+        length: u32,
+        language: *const TSLanguage,
+        source: *const ::std::os::raw::c_char,
+        source_len: u32,
+    ) -> *mut TSQuery;
+}
 extern "C" {
     #[doc = " Get the number of patterns, captures, or string literals in the query."]
     pub fn ts_query_pattern_count(arg1: *const TSQuery) -> u32;
@@ -631,6 +1223,12 @@ extern "C" {
     #[doc = " code strings."]
     pub fn ts_query_start_byte_for_pattern(arg1: *const TSQuery, arg2: u32) -> u32;
 }
+extern "C" {
+    #[doc = " Get the index of the query that the given pattern came from, if the query"]
+    #[doc = " was created with `ts_query_combine`. The pattern's start byte is relative"]
+    #[doc = " to the source of that query. For other queries, this returns zero."]
+    pub fn ts_query_source_query_for_pattern(arg1: *const TSQuery, arg2: u32) -> u32;
+}
 extern "C" {
     #[doc = " Get all of the predicates for the given pattern in the query."]
     #[doc = ""]
@@ -740,6 +1338,88 @@ extern "C" {
 extern "C" {
     pub fn ts_query_cursor_set_match_limit(arg1: *mut TSQueryCursor, arg2: u32);
 }
+extern "C" {
+    #[doc = " Set whether the query cursor should stream its captures."]
+    #[doc = ""]
+    #[doc = " When iterating over captures with `ts_query_cursor_next_capture`, a"]
+    #[doc = " finished match is normally held back until none of the unfinished matches"]
+    #[doc = " could still produce an earlier capture. With a match limit, this buffering"]
+    #[doc = " can exhaust the cursor's capture lists, and unfinished matches are then"]
+    #[doc = " dropped to make room. In streaming mode, the cursor instead returns the"]
+    #[doc = " earliest *finished* capture before it is known to be the earliest overall,"]
+    #[doc = " so that its capture list can be reused. Together with a match limit, this"]
+    #[doc = " bounds the cursor's memory usage on large inputs, at the cost of captures"]
+    #[doc = " occasionally being returned out of order. Matches can still be dropped if"]
+    #[doc = " the limit is exceeded by unfinished matches alone."]
+    pub fn ts_query_cursor_streaming(arg1: *const TSQueryCursor) -> bool;
+}
+extern "C" {
+    pub fn ts_query_cursor_set_streaming(arg1: *mut TSQueryCursor, arg2: bool);
+}
+extern "C" {
+    #[doc = " Provide the source code of the tree that the query cursor is executing on,"]
+    #[doc = " so that the cursor can evaluate text predicates itself."]
+    #[doc = ""]
+    #[doc = " With the text available, the cursor discards in-progress matches as soon as"]
+    #[doc = " their captures fail an `#eq?` or `#not-eq?` predicate, or a `#match?` or"]
+    #[doc = " `#not-match?` predicate whose regex is a literal string, optionally anchored"]
+    #[doc = " with `^` or `$`. Other predicates are still left to the caller. The text"]
+    #[doc = " must remain valid for as long as the cursor is executing on the tree. Pass"]
+    #[doc = " `NULL` to stop evaluating text predicates."]
+    pub fn ts_query_cursor_set_text(
+        arg1: *mut TSQueryCursor,
+        text: *const ::std::os::raw::c_char,
+        length: u32,
+    );
+}
+extern "C" {
+    #[doc = " Manage the memory that the query cursor keeps between executions."]
+    #[doc = ""]
+    #[doc = " A query cursor reuses its buffers of in-progress matches and capture lists"]
+    #[doc = " each time it is executed, so a single cursor that is executed many times"]
+    #[doc = " only allocates while it grows. `ts_query_cursor_reserve` allocates room for"]
+    #[doc = " the given numbers of in-progress matches and capture lists up front."]
+    #[doc = " `ts_query_cursor_set_retained_capacity` limits how much of that memory is"]
+    #[doc = " kept: when the cursor is next executed, any capacity beyond these counts"]
+    #[doc = " is freed, so that one unusually large execution doesn't keep its memory"]
+    #[doc = " alive for the rest of the cursor's lifetime. By default, all memory is"]
+    #[doc = " retained."]
+    pub fn ts_query_cursor_reserve(
+        arg1: *mut TSQueryCursor,
+        state_count: u32,
+        capture_list_count: u32,
+    );
+}
+extern "C" {
+    pub fn ts_query_cursor_set_retained_capacity(
+        arg1: *mut TSQueryCursor,
+        state_count: u32,
+        capture_list_count: u32,
+    );
+}
+extern "C" {
+    #[doc = " Get counters describing the resources that the query cursor has used"]
+    #[doc = " during its current execution. The counters are reset by"]
+    #[doc = " `ts_query_cursor_exec`:"]
+    #[doc = " - `peak_state_count` - The largest number of simultaneously in-progress"]
+    #[doc = "   matches."]
+    #[doc = " - `peak_finished_state_count` - The largest number of finished matches that"]
+    #[doc = "   were waiting to be returned."]
+    #[doc = " - `peak_capture_list_count` - The largest number of capture lists in use."]
+    #[doc = " - `abandoned_match_count` - The number of matches that were dropped because"]
+    #[doc = "   the match limit was exceeded."]
+    #[doc = " - `out_of_order_capture_count` - The number of captures that were returned"]
+    #[doc = "   early in streaming mode."]
+    #[doc = " - `rejected_match_count` - The number of in-progress matches that were"]
+    #[doc = "   discarded because their captures did not satisfy a text predicate."]
+    #[doc = " - `visited_node_count` - The number of nodes that the cursor entered. Nodes"]
+    #[doc = "   that end before the cursor's range are skipped without being entered"]
+    #[doc = "   when no matches are in progress."]
+    #[doc = " - `step_count` - The number of times that an in-progress match was compared"]
+    #[doc = "   against a node. Together with `visited_node_count`, this measures the work"]
+    #[doc = "   done by the cursor independently of the speed of the machine."]
+    pub fn ts_query_cursor_stats(arg1: *const TSQueryCursor, stats: *mut TSQueryCursorStats);
+}
 extern "C" {
     #[doc = " Set the range of bytes or (row, column) positions in which the query"]
     #[doc = " will be executed."]
@@ -854,6 +1534,33 @@ extern "C" {
         new_free: ::std::option::Option<unsafe extern "C" fn(arg1: *mut ::std::os::raw::c_void)>,
     );
 }
+extern "C" {
+    #[doc = " Enable or disable tracking of the library's allocations by category."]
+    #[doc = ""]
+    #[doc = " While tracking is enabled, the memory used by subtrees, parse stack nodes,"]
+    #[doc = " lexer included ranges, query cursor states and capture lists, tree cursor"]
+    #[doc = " stacks and external scanner states is attributed to the corresponding"]
+    #[doc = " `TSAllocationCategory`. The live bytes of each category can be read with"]
+    #[doc = " `ts_allocation_live_bytes`."]
+    #[doc = ""]
+    #[doc = " If `hooks` is not `NULL`, its callbacks are also invoked, on whichever"]
+    #[doc = " thread is allocating, each time memory is attributed to a category or"]
+    #[doc = " released from it, with the affected buffer and its size. This can be used"]
+    #[doc = " to build a sampling allocation profiler. The memory itself still comes from"]
+    #[doc = " the functions given to `ts_set_allocator`."]
+    #[doc = ""]
+    #[doc = " Tracking can only be enabled or disabled while the library holds no memory"]
+    #[doc = " in any category, for example before any parsers, trees or query cursors are"]
+    #[doc = " created, or after they have all been deleted. Otherwise, tracking is left"]
+    #[doc = " unchanged and `false` is returned. The hooks of an enabled tracker can be"]
+    #[doc = " replaced at any time."]
+    pub fn ts_set_allocation_tracking(enabled: bool, hooks: *const TSAllocationHooks) -> bool;
+}
+extern "C" {
+    #[doc = " Get the number of bytes currently attributed to the given allocation"]
+    #[doc = " category. See `ts_set_allocation_tracking`."]
+    pub fn ts_allocation_live_bytes(category: TSAllocationCategory) -> usize;
+}
 
-pub const TREE_SITTER_LANGUAGE_VERSION: usize = 13;
+pub const TREE_SITTER_LANGUAGE_VERSION: usize = 14;
 pub const TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION: usize = 13;
@@ -5,17 +5,20 @@ mod util;
 use std::os::unix::io::AsRawFd;
 
 use std::{
-    char, error,
+    cell::RefCell,
+    char,
+    collections::HashSet,
+    error,
     ffi::CStr,
     fmt, hash, iter,
     marker::PhantomData,
-    mem::MaybeUninit,
+    mem::{ManuallyDrop, MaybeUninit},
     ops,
     os::raw::{c_char, c_void},
     ptr::{self, NonNull},
     slice, str,
-    sync::atomic::AtomicUsize,
-    u16,
+    sync::atomic::{AtomicUsize, Ordering},
+    thread, u16,
 };
 
 /// The latest ABI version that is supported by the current version of the
@@ -33,6 +36,14 @@ pub const MIN_COMPATIBLE_LANGUAGE_VERSION: usize = ffi::TREE_SITTER_MIN_COMPATIB
 
 pub const PARSER_HEADER: &'static str = include_str!("../include/tree_sitter/parser.h");
 
+/// The number of query cursors that are kept for reuse by `QueryCursor::with_thread_local`
+/// on each thread.
+const QUERY_CURSOR_CACHE_SIZE: usize = 4;
+
+thread_local! {
+    static QUERY_CURSOR_CACHE: RefCell<Vec<QueryCursor>> = RefCell::new(Vec::new());
+}
+
 /// An opaque object that defines how to parse a particular language. The code for each
 /// `Language` is generated by the Tree-sitter CLI.
 #[derive(Clone, Copy, Debug, PartialEq, Eq)]
@@ -80,6 +91,75 @@ pub struct Node<'a>(ffi::TSNode, PhantomData<&'a ()>);
 /// A stateful object that this is used to produce a `Tree` based on some source code.
 pub struct Parser(NonNull<ffi::TSParser>);
 
+/// A pool of parsers for a single language, which can be shared between threads.
+pub struct ParserPool(NonNull<ffi::TSParserPool>);
+
+/// A [Parser] that has been acquired from a [ParserPool]. It is given back to the
+/// pool when it is dropped.
+pub struct PooledParser<'a> {
+    pool: &'a ParserPool,
+    parser: ManuallyDrop<Parser>,
+}
+
+/// A request to parse a set of ranges within a document using a particular language.
+///
+/// See [Parser::parse_in_parallel].
+#[derive(Clone, Debug)]
+pub struct ParseJob {
+    pub language: Language,
+    pub ranges: Vec<Range>,
+}
+
+/// Counters describing the work that a `Parser` has done.
+///
+/// See [Parser::stats].
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct ParserStats {
+    pub parse_table_cache_hits: u64,
+    pub parse_table_cache_misses: u64,
+    pub stack_node_count: u64,
+    pub stack_node_slab_count: u64,
+    pub max_stack_version_count: u32,
+    pub advance_count: u64,
+    pub token_count: u64,
+    pub relex_count: u64,
+    pub cached_token_hits: u64,
+    pub reused_node_count: u64,
+    pub rebuilt_node_count: u64,
+    pub shared_node_count: u64,
+    pub error_recovery_count: u64,
+    pub subtree_allocation_count: u64,
+    pub parse_time_micros: u64,
+    pub balance_time_micros: u64,
+}
+
+/// The memory used by a syntax tree.
+///
+/// See [Tree::memory_usage].
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct TreeMemoryUsage {
+    pub total_bytes: usize,
+    pub unique_subtree_bytes: usize,
+    pub shared_subtree_bytes: usize,
+    pub external_scanner_state_bytes: usize,
+    pub cache_bytes: usize,
+}
+
+/// Counters describing the resources used by a query cursor.
+///
+/// See [QueryCursor::stats].
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct QueryCursorStats {
+    pub peak_state_count: u32,
+    pub peak_finished_state_count: u32,
+    pub peak_capture_list_count: u32,
+    pub abandoned_match_count: u32,
+    pub out_of_order_capture_count: u32,
+    pub rejected_match_count: u32,
+    pub visited_node_count: u32,
+    pub step_count: u64,
+}
+
 /// A type of log message.
 #[derive(Debug, PartialEq, Eq)]
 pub enum LogType {
@@ -87,12 +167,56 @@ pub enum LogType {
     Lex,
 }
 
+/// A kind of memory that the library attributes its allocations to, while
+/// allocation tracking is enabled. See [set_allocation_tracking].
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub enum AllocationCategory {
+    Subtree,
+    StackNode,
+    LexerRanges,
+    QueryState,
+    CaptureList,
+    CursorStack,
+    ExternalScannerState,
+}
+
 /// A callback that receives log messages during parser.
 type Logger<'a> = Box<dyn FnMut(LogType, &str) + 'a>;
 
+/// A callback that receives the finished top-level nodes of a document during
+/// a streaming parse.
+type StreamingCallback<'a> = Box<dyn FnMut(Node) + 'a>;
+
+/// A callback that receives the byte offset and the number of stack versions
+/// of an ongoing parse, and returns `true` to halt it.
+type ProgressCallback<'a> = Box<dyn FnMut(usize, usize) -> bool + 'a>;
+
 /// A stateful object for walking a syntax `Tree` efficiently.
 pub struct TreeCursor<'a>(ffi::TSTreeCursor, PhantomData<&'a ()>);
 
+/// A batch of nodes copied out of a syntax tree by a [NodeExporter], stored as
+/// parallel columns.
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct NodeArray {
+    pub kind_ids: Vec<u16>,
+    pub field_ids: Vec<u16>,
+    pub start_bytes: Vec<u32>,
+    pub end_bytes: Vec<u32>,
+    pub start_positions: Vec<Point>,
+    pub end_positions: Vec<Point>,
+    pub parent_indices: Vec<u32>,
+    pub flags: Vec<u8>,
+}
+
+/// An object that copies the nodes of a syntax tree into [NodeArray]s, one
+/// batch at a time.
+pub struct NodeExporter<'a> {
+    ptr: NonNull<ffi::TSNodeExporter>,
+    start_points: Vec<ffi::TSPoint>,
+    end_points: Vec<ffi::TSPoint>,
+    _tree: PhantomData<&'a ()>,
+}
+
 /// A set of patterns that match nodes in a syntax tree.
 #[derive(Debug)]
 pub struct Query {
@@ -161,6 +285,13 @@ pub struct QueryCaptures<'a, 'tree: 'a, T: TextProvider<'a>> {
 pub trait TextProvider<'a> {
     type I: Iterator<Item = &'a [u8]> + 'a;
     fn text(&mut self, node: Node) -> Self::I;
+
+    /// The entire source text, if it is available as a single slice. This allows the
+    /// query cursor to reject matches that fail simple text predicates without
+    /// returning them first.
+    fn source(&self) -> Option<&'a [u8]> {
+        None
+    }
 }
 
 /// A particular `Node` that has been captured with a particular name within a `Query`.
@@ -411,13 +542,22 @@ impl Parser {
     ///  * The parser has not yet had a language assigned with [Parser::set_language]
     ///  * The timeout set with [Parser::set_timeout_micros] expired
     ///  * The cancellation flag set with [Parser::set_cancellation_flag] was flipped
+    ///
+    /// The text is read directly from the given buffer, without going through
+    /// an input callback. To parse text that is not stored contiguously, use
+    /// [Parser::parse_with].
     pub fn parse(&mut self, text: impl AsRef<[u8]>, old_tree: Option<&Tree>) -> Option<Tree> {
         let bytes = text.as_ref();
-        let len = bytes.len();
-        self.parse_with(
-            &mut |i, _| if i < len { &bytes[i..] } else { &[] },
-            old_tree,
-        )
+        let c_old_tree = old_tree.map_or(ptr::null_mut(), |t| t.0.as_ptr());
+        unsafe {
+            let c_new_tree = ffi::ts_parser_parse_string(
+                self.0.as_ptr(),
+                c_old_tree,
+                bytes.as_ptr() as *const c_char,
+                bytes.len() as u32,
+            );
+            NonNull::new(c_new_tree).map(Tree)
+        }
     }
 
     /// Parse a slice of UTF16 text.
@@ -434,11 +574,47 @@ impl Parser {
         old_tree: Option<&Tree>,
     ) -> Option<Tree> {
         let code_points = input.as_ref();
-        let len = code_points.len();
-        self.parse_utf16_with(
-            &mut |i, _| if i < len { &code_points[i..] } else { &[] },
-            old_tree,
-        )
+        let c_old_tree = old_tree.map_or(ptr::null_mut(), |t| t.0.as_ptr());
+        unsafe {
+            let c_new_tree = ffi::ts_parser_parse_string_encoding(
+                self.0.as_ptr(),
+                c_old_tree,
+                code_points.as_ptr() as *const c_char,
+                (code_points.len() * 2) as u32,
+                ffi::TSInputEncoding_TSInputEncodingUTF16,
+            );
+            NonNull::new(c_new_tree).map(Tree)
+        }
+    }
+
+    /// Parse a slice of Latin-1 text, or of bytes that aren't text.
+    ///
+    /// Each byte is read as the character whose code point has the same value,
+    /// so any sequence of bytes can be parsed without decoding errors.
+    ///
+    /// # Arguments:
+    /// * `text` The Latin-1 encoded text to parse.
+    /// * `old_tree` A previous syntax tree parsed from the same document.
+    ///   If the text of the document has changed since `old_tree` was
+    ///   created, then you must edit `old_tree` to match the new text using
+    ///   [Tree::edit].
+    pub fn parse_latin1(
+        &mut self,
+        input: impl AsRef<[u8]>,
+        old_tree: Option<&Tree>,
+    ) -> Option<Tree> {
+        let bytes = input.as_ref();
+        let c_old_tree = old_tree.map_or(ptr::null_mut(), |t| t.0.as_ptr());
+        unsafe {
+            let c_new_tree = ffi::ts_parser_parse_string_encoding(
+                self.0.as_ptr(),
+                c_old_tree,
+                bytes.as_ptr() as *const c_char,
+                bytes.len() as u32,
+                ffi::TSInputEncoding_TSInputEncodingLatin1,
+            );
+            NonNull::new(c_new_tree).map(Tree)
+        }
     }
 
     /// Parse UTF8 text provided in chunks by a callback.
@@ -573,6 +749,209 @@ impl Parser {
         unsafe { ffi::ts_parser_set_timeout_micros(self.0.as_ptr(), timeout_micros) }
     }
 
+    /// Get the maximum number of bytes of syntax nodes that a parse may allocate.
+    ///
+    /// This is set via [set_memory_limit](Parser::set_memory_limit).
+    pub fn memory_limit(&self) -> usize {
+        unsafe { ffi::ts_parser_memory_limit(self.0.as_ptr()) }
+    }
+
+    /// Set the maximum number of bytes of syntax nodes that a single parse is
+    /// allowed to allocate before halting. Zero means no limit.
+    ///
+    /// If a parse exceeds this, it halts and returns `None`. Unlike with a
+    /// timeout, the partial parse is discarded rather than kept for resuming.
+    pub fn set_memory_limit(&mut self, limit: usize) {
+        unsafe { ffi::ts_parser_set_memory_limit(self.0.as_ptr(), limit) }
+    }
+
+    /// Get the number of error recovery operations that a single parse may
+    /// perform before it switches to a cheaper way of recovering.
+    ///
+    /// This is set via [set_error_recovery_budget](Parser::set_error_recovery_budget).
+    pub fn error_recovery_budget(&self) -> u32 {
+        unsafe { ffi::ts_parser_error_recovery_budget(self.0.as_ptr()) }
+    }
+
+    /// Set the number of error recovery operations that a single parse may
+    /// perform before it switches to a cheaper way of recovering. Zero means
+    /// no limit.
+    ///
+    /// Once the budget is used up, the parser stops exploring alternative ways
+    /// of recovering from errors, so that the rest of the parse takes linear
+    /// time. The resulting tree may contain larger `ERROR` nodes.
+    pub fn set_error_recovery_budget(&mut self, budget: u32) {
+        unsafe { ffi::ts_parser_set_error_recovery_budget(self.0.as_ptr(), budget) }
+    }
+
+    /// Get counters describing the work that the parser has done.
+    ///
+    /// The counters are accumulated over every parse performed with this parser.
+    pub fn stats(&self) -> ParserStats {
+        let mut stats = MaybeUninit::<ffi::TSParserStats>::uninit();
+        let stats = unsafe {
+            ffi::ts_parser_stats(self.0.as_ptr(), stats.as_mut_ptr());
+            stats.assume_init()
+        };
+        ParserStats {
+            parse_table_cache_hits: stats.parse_table_cache_hits,
+            parse_table_cache_misses: stats.parse_table_cache_misses,
+            stack_node_count: stats.stack_node_count,
+            stack_node_slab_count: stats.stack_node_slab_count,
+            max_stack_version_count: stats.max_stack_version_count,
+            advance_count: stats.advance_count,
+            token_count: stats.token_count,
+            relex_count: stats.relex_count,
+            cached_token_hits: stats.cached_token_hits,
+            reused_node_count: stats.reused_node_count,
+            rebuilt_node_count: stats.rebuilt_node_count,
+            shared_node_count: stats.shared_node_count,
+            error_recovery_count: stats.error_recovery_count,
+            subtree_allocation_count: stats.subtree_allocation_count,
+            parse_time_micros: stats.parse_time_micros,
+            balance_time_micros: stats.balance_time_micros,
+        }
+    }
+
+    /// Get whether the parser allocates syntax nodes from an arena.
+    ///
+    /// This is set via [set_arena_allocation](Parser::set_arena_allocation).
+    pub fn arena_allocation(&self) -> bool {
+        unsafe { ffi::ts_parser_arena_allocation(self.0.as_ptr()) }
+    }
+
+    /// Set whether the parser should allocate syntax nodes from an arena.
+    ///
+    /// When enabled, the nodes created during a parse are carved out of a few
+    /// large memory blocks that are freed all at once when the resulting [Tree],
+    /// and every tree that shares nodes with it, has been dropped. Arenas are
+    /// only used when parsing without an old tree.
+    pub fn set_arena_allocation(&mut self, enabled: bool) {
+        unsafe { ffi::ts_parser_set_arena_allocation(self.0.as_ptr(), enabled) }
+    }
+
+    /// Set a callback that receives the top-level nodes of the document as soon
+    /// as they are finished, so that very large inputs can be processed without
+    /// keeping the entire syntax tree in memory.
+    ///
+    /// This works for languages whose root node is a sequence of repeated items,
+    /// such as log files or JSON lines. Each node is freed once the callback
+    /// returns, and the tree that is eventually returned only contains the root
+    /// node's children that were not passed to the callback.
+    pub fn set_streaming_callback(&mut self, callback: Option<StreamingCallback>) {
+        let prev_callback = unsafe { ffi::ts_parser_streaming_callback(self.0.as_ptr()) };
+        if !prev_callback.payload.is_null() {
+            drop(unsafe { Box::from_raw(prev_callback.payload as *mut StreamingCallback) });
+        }
+
+        let c_callback;
+        if let Some(callback) = callback {
+            let container = Box::new(callback);
+
+            unsafe extern "C" fn node_finished(payload: *mut c_void, c_node: ffi::TSNode) {
+                let callback = (payload as *mut StreamingCallback).as_mut().unwrap();
+                if let Some(node) = Node::new(c_node) {
+                    callback(node);
+                }
+            }
+
+            c_callback = ffi::TSStreamingCallback {
+                payload: Box::into_raw(container) as *mut c_void,
+                node_finished: Some(node_finished),
+            };
+        } else {
+            c_callback = ffi::TSStreamingCallback {
+                payload: ptr::null_mut(),
+                node_finished: None,
+            };
+        }
+
+        unsafe { ffi::ts_parser_set_streaming_callback(self.0.as_ptr(), c_callback) };
+    }
+
+    /// Set a callback that the parser calls periodically during parsing, with
+    /// the byte offset that it has reached and the number of alternative
+    /// interpretations of the input that it is considering.
+    ///
+    /// If the callback returns `true`, then parsing halts early, and the parse
+    /// can be resumed by calling one of the parsing methods again with the same
+    /// arguments. In the meantime, [Parser::provisional_tree] returns a tree for
+    /// the part of the document that has been parsed so far.
+    pub fn set_progress_callback(&mut self, callback: Option<ProgressCallback>) {
+        let prev_callback = unsafe { ffi::ts_parser_progress_callback(self.0.as_ptr()) };
+        if !prev_callback.payload.is_null() {
+            drop(unsafe { Box::from_raw(prev_callback.payload as *mut ProgressCallback) });
+        }
+
+        let c_callback;
+        if let Some(callback) = callback {
+            let container = Box::new(callback);
+
+            unsafe extern "C" fn progress(
+                payload: *mut c_void,
+                byte_offset: u32,
+                version_count: u32,
+            ) -> bool {
+                let callback = (payload as *mut ProgressCallback).as_mut().unwrap();
+                callback(byte_offset as usize, version_count as usize)
+            }
+
+            c_callback = ffi::TSProgressCallback {
+                payload: Box::into_raw(container) as *mut c_void,
+                progress: Some(progress),
+            };
+        } else {
+            c_callback = ffi::TSProgressCallback {
+                payload: ptr::null_mut(),
+                progress: None,
+            };
+        }
+
+        unsafe { ffi::ts_parser_set_progress_callback(self.0.as_ptr(), c_callback) };
+    }
+
+    /// Get a provisional syntax tree for the part of the document that has been
+    /// parsed so far, while a parse is halted.
+    ///
+    /// The nodes near the end of this tree may differ from the ones in the
+    /// final tree. Returns `None` if no parse is in progress.
+    pub fn provisional_tree(&mut self) -> Option<Tree> {
+        unsafe {
+            let ptr = ffi::ts_parser_provisional_tree(self.0.as_ptr());
+            NonNull::new(ptr).map(Tree)
+        }
+    }
+
+    /// Get whether the parser skips balancing the trees that it produces.
+    pub fn deferred_balancing(&self) -> bool {
+        unsafe { ffi::ts_parser_deferred_balancing(self.0.as_ptr()) }
+    }
+
+    /// Set whether the parser should skip balancing the trees that it produces.
+    ///
+    /// Balancing makes later edits and incremental parses of documents with
+    /// long lists of repeated elements fast. With deferred balancing, trees are
+    /// returned sooner, and can be balanced later using [Tree::balance].
+    pub fn set_deferred_balancing(&mut self, enabled: bool) {
+        unsafe { ffi::ts_parser_set_deferred_balancing(self.0.as_ptr(), enabled) }
+    }
+
+    /// Get the number of nodes that the parser retains for node sharing.
+    pub fn node_sharing_capacity(&self) -> u32 {
+        unsafe { ffi::ts_parser_node_sharing_capacity(self.0.as_ptr()) }
+    }
+
+    /// Set the number of nodes that the parser retains so that identical
+    /// subtrees can be shared between the trees that it produces.
+    ///
+    /// This reduces the memory used by the trees of many similar documents,
+    /// such as the revisions of a file, and lets [Tree::changed_ranges] skip
+    /// over the shared subtrees. Nodes are only shared when parsing without an
+    /// old tree. The default capacity is zero, which disables node sharing.
+    pub fn set_node_sharing_capacity(&mut self, capacity: u32) {
+        unsafe { ffi::ts_parser_set_node_sharing_capacity(self.0.as_ptr(), capacity) }
+    }
+
     /// Set the ranges of text that the parser should include when parsing.
     ///
     /// By default, the parser will always include entire documents. This function
@@ -617,6 +996,49 @@ impl Parser {
         }
     }
 
+    /// Replace some of the ranges of text that the parser should include when
+    /// parsing, leaving the others as they are.
+    ///
+    /// The ranges at the indices in `replaced` are replaced with the given
+    /// `ranges`. Only the new ranges are copied and validated, which is much
+    /// faster than calling [set_included_ranges](Parser::set_included_ranges)
+    /// when a document has many ranges and only a few of them have changed.
+    ///
+    /// The new ranges must be ordered, and must not overlap with each other or
+    /// with the ranges before and after them. Otherwise, this method will return
+    /// an IncludedRangesError with the offset of the first incorrect range in the
+    /// passed slice.
+    pub fn update_included_ranges(
+        &mut self,
+        replaced: ops::Range<usize>,
+        ranges: &[Range],
+    ) -> Result<(), IncludedRangesError> {
+        let ts_ranges: Vec<ffi::TSRange> =
+            ranges.iter().cloned().map(|range| range.into()).collect();
+        let result = unsafe {
+            ffi::ts_parser_update_included_ranges(
+                self.0.as_ptr(),
+                replaced.start as u32,
+                replaced.len() as u32,
+                ts_ranges.as_ptr(),
+                ts_ranges.len() as u32,
+            )
+        };
+
+        if result {
+            Ok(())
+        } else {
+            let mut prev_end_byte = 0;
+            for (i, range) in ranges.iter().enumerate() {
+                if range.start_byte < prev_end_byte || range.end_byte < range.start_byte {
+                    return Err(IncludedRangesError(i));
+                }
+                prev_end_byte = range.end_byte;
+            }
+            Err(IncludedRangesError(0))
+        }
+    }
+
     /// Get the parser's current cancellation flag pointer.
     pub unsafe fn cancellation_flag(&self) -> Option<&AtomicUsize> {
         (ffi::ts_parser_cancellation_flag(self.0.as_ptr()) as *const AtomicUsize).as_ref()
@@ -637,16 +1059,152 @@ impl Parser {
             ffi::ts_parser_set_cancellation_flag(self.0.as_ptr(), ptr::null());
         }
     }
+
+    /// Parse several sets of ranges within a document, using multiple threads.
+    ///
+    /// Each [ParseJob] specifies a language and the ranges of `text` that should
+    /// be included when parsing it (see [set_included_ranges](Parser::set_included_ranges)).
+    /// This is useful for documents that contain many independent embedded
+    /// documents, such as the `<script>` and `<style>` blocks of an HTML file.
+    ///
+    /// The jobs are distributed among at most `thread_count` threads. Each thread
+    /// creates a single parser and reuses it for all of the jobs that it processes.
+    ///
+    /// Returns one entry for each job, in the same order as `jobs`. An entry is
+    /// `None` if the job's language is incompatible with this library, if its ranges
+    /// are not valid, or if parsing was cancelled using the `cancellation_flag`.
+    pub fn parse_in_parallel(
+        text: impl AsRef<[u8]>,
+        jobs: &[ParseJob],
+        thread_count: usize,
+        cancellation_flag: Option<&AtomicUsize>,
+    ) -> Vec<Option<Tree>> {
+        let text = text.as_ref();
+        let next_job_index = AtomicUsize::new(0);
+        let work = || {
+            let mut parser = Parser::new();
+            let mut results = Vec::new();
+            loop {
+                let index = next_job_index.fetch_add(1, Ordering::Relaxed);
+                if index >= jobs.len() {
+                    break;
+                }
+                results.push((
+                    index,
+                    parser.parse_job(text, &jobs[index], cancellation_flag),
+                ));
+            }
+            results
+        };
+
+        let thread_count = thread_count.max(1).min(jobs.len());
+        let mut trees: Vec<Option<Tree>> = iter::repeat_with(|| None).take(jobs.len()).collect();
+        thread::scope(|scope| {
+            let handles = (1..thread_count)
+                .map(|_| scope.spawn(&work))
+                .collect::<Vec<_>>();
+            let results =
+                iter::once(work()).chain(handles.into_iter().map(|handle| handle.join().unwrap()));
+            for (index, tree) in results.flatten() {
+                trees[index] = tree;
+            }
+        });
+        trees
+    }
+
+    fn parse_job(
+        &mut self,
+        text: &[u8],
+        job: &ParseJob,
+        cancellation_flag: Option<&AtomicUsize>,
+    ) -> Option<Tree> {
+        self.set_language(job.language).ok()?;
+        self.set_included_ranges(&job.ranges).ok()?;
+        unsafe { self.set_cancellation_flag(cancellation_flag) };
+        let tree = self.parse(text, None);
+        unsafe { self.set_cancellation_flag(None) };
+        if tree.is_none() {
+            self.reset();
+        }
+        tree
+    }
 }
 
 impl Drop for Parser {
     fn drop(&mut self) {
         self.stop_printing_dot_graphs();
         self.set_logger(None);
+        self.set_streaming_callback(None);
+        self.set_progress_callback(None);
         unsafe { ffi::ts_parser_delete(self.0.as_ptr()) }
     }
 }
 
+impl ParserPool {
+    /// Create a pool of parsers for the given language, which keeps up to `capacity`
+    /// idle parsers.
+    ///
+    /// Returns an error if the language can't be assigned to a parser. See
+    /// [Parser::set_language].
+    pub fn new(language: Language, capacity: usize) -> Result<ParserPool, LanguageError> {
+        let version = language.version();
+        if version < MIN_COMPATIBLE_LANGUAGE_VERSION || version > LANGUAGE_VERSION {
+            return Err(LanguageError { version });
+        }
+        let pool = unsafe { ffi::ts_parser_pool_new(language.0, capacity as u32) };
+        NonNull::new(pool)
+            .map(ParserPool)
+            .ok_or(LanguageError { version })
+    }
+
+    /// Get the language of the pool's parsers.
+    pub fn language(&self) -> Language {
+        Language(unsafe { ffi::ts_parser_pool_language(self.0.as_ptr()) })
+    }
+
+    /// Take an idle parser from the pool, or create a new one if there are none.
+    ///
+    /// The parser is configured with the pool's language, and otherwise has the
+    /// default configuration.
+    pub fn acquire(&self) -> PooledParser {
+        let parser = unsafe { ffi::ts_parser_pool_acquire(self.0.as_ptr()) };
+        PooledParser {
+            pool: self,
+            parser: ManuallyDrop::new(Parser(NonNull::new(parser).unwrap())),
+        }
+    }
+}
+
+impl Drop for ParserPool {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_parser_pool_delete(self.0.as_ptr()) }
+    }
+}
+
+impl<'a> ops::Deref for PooledParser<'a> {
+    type Target = Parser;
+
+    fn deref(&self) -> &Parser {
+        &self.parser
+    }
+}
+
+impl<'a> ops::DerefMut for PooledParser<'a> {
+    fn deref_mut(&mut self) -> &mut Parser {
+        &mut self.parser
+    }
+}
+
+impl<'a> Drop for PooledParser<'a> {
+    fn drop(&mut self) {
+        self.parser.stop_printing_dot_graphs();
+        self.parser.set_logger(None);
+        self.parser.set_streaming_callback(None);
+        self.parser.set_progress_callback(None);
+        unsafe { ffi::ts_parser_pool_release(self.pool.0.as_ptr(), self.parser.0.as_ptr()) }
+    }
+}
+
 impl Tree {
     /// Get the root node of the syntax tree.
     pub fn root_node(&self) -> Node {
@@ -668,11 +1226,73 @@ impl Tree {
         unsafe { ffi::ts_tree_edit(self.0.as_ptr(), &edit) };
     }
 
+    /// Edit the syntax tree to reflect several edits to the source code at once.
+    ///
+    /// The edits may be given in any order, but they must not overlap, and each one
+    /// must be described in terms of the source code *before* any of them were made.
+    /// This is equivalent to calling [Tree::edit] for each edit, from the last one in
+    /// the document to the first, but each affected node is only copied once.
+    pub fn edit_batch(&mut self, edits: &[InputEdit]) {
+        let edits: Vec<ffi::TSInputEdit> = edits.iter().map(Into::into).collect();
+        unsafe { ffi::ts_tree_edit_batch(self.0.as_ptr(), edits.as_ptr(), edits.len() as u32) };
+    }
+
     /// Create a new [TreeCursor] starting from the root of the tree.
     pub fn walk(&self) -> TreeCursor {
         self.root_node().walk()
     }
 
+    /// Create a frozen snapshot of this syntax tree, which can be shared by many
+    /// threads without them contending over its memory.
+    ///
+    /// Cloning a tree, or reusing its nodes during an incremental parse, normally
+    /// updates the reference counts of its nodes atomically. The nodes of a frozen
+    /// tree are never reference-counted individually. They stay alive until the
+    /// snapshot and every tree derived from it have been dropped. Each thread
+    /// should [clone](Clone::clone) the snapshot to get a tree that it can edit.
+    pub fn freeze(&self) -> Tree {
+        unsafe { Tree(NonNull::new_unchecked(ffi::ts_tree_freeze(self.0.as_ptr()))) }
+    }
+
+    /// Balance a syntax tree that was produced by a parser with
+    /// [deferred balancing](Parser::set_deferred_balancing). This does nothing
+    /// if the tree is already balanced.
+    ///
+    /// A tree can't be balanced while it shares its nodes with a clone of itself,
+    /// or if it was created by [freeze](Tree::freeze) or [compact](Tree::compact).
+    /// In that case, this method returns `false`.
+    pub fn balance(&mut self) -> bool {
+        unsafe { ffi::ts_tree_balance(self.0.as_ptr()) }
+    }
+
+    /// Create a compacted, frozen copy of this syntax tree, for trees that are
+    /// kept for a long time and only read.
+    ///
+    /// Like a [frozen](Tree::freeze) tree, the copy can be shared by many threads.
+    /// In addition, its nodes are stored in one block of memory, in depth-first
+    /// order, and identical leaves are only stored once. The copy does not share
+    /// any memory with this tree.
+    pub fn compact(&self) -> Tree {
+        unsafe { Tree(NonNull::new_unchecked(ffi::ts_tree_compact(self.0.as_ptr()))) }
+    }
+
+    /// Measure the memory used by this syntax tree, distinguishing the nodes that
+    /// it shares with other trees from those that only it uses.
+    pub fn memory_usage(&self) -> TreeMemoryUsage {
+        let mut usage = MaybeUninit::<ffi::TSTreeMemoryUsage>::uninit();
+        let usage = unsafe {
+            ffi::ts_tree_memory_usage(self.0.as_ptr(), usage.as_mut_ptr());
+            usage.assume_init()
+        };
+        TreeMemoryUsage {
+            total_bytes: usage.total_bytes,
+            unique_subtree_bytes: usage.unique_subtree_bytes,
+            shared_subtree_bytes: usage.shared_subtree_bytes,
+            external_scanner_state_bytes: usage.external_scanner_state_bytes,
+            cache_bytes: usage.cache_bytes,
+        }
+    }
+
     /// Compare this old edited syntax tree to a new syntax tree representing the same
     /// document, returning a sequence of ranges whose syntactic structure has changed.
     ///
@@ -691,6 +1311,37 @@ impl Tree {
             util::CBufferIter::new(ptr, count).map(|r| r.into())
         }
     }
+
+    /// Serialize this syntax tree into a compact binary snapshot, which can be
+    /// loaded again with [Tree::deserialize].
+    ///
+    /// A deserialized tree can be passed as the `old_tree` to [Parser::parse], so
+    /// snapshots can be used to cache parse results across processes.
+    pub fn serialize(&self) -> Vec<u8> {
+        let mut length = 0u32;
+        unsafe {
+            let ptr = ffi::ts_tree_serialize(self.0.as_ptr(), &mut length);
+            let result = slice::from_raw_parts(ptr as *const u8, length as usize).to_vec();
+            (FREE_FN)(ptr as *mut c_void);
+            result
+        }
+    }
+
+    /// Load a syntax tree from a snapshot that was created with [Tree::serialize].
+    ///
+    /// Returns `None` if the data is malformed or was created with a different
+    /// language. The data is not retained, so it may be borrowed from a
+    /// memory-mapped file.
+    pub fn deserialize(data: &[u8], language: Language) -> Option<Tree> {
+        unsafe {
+            let ptr = ffi::ts_tree_deserialize(
+                data.as_ptr() as *const c_char,
+                data.len() as u32,
+                language.0,
+            );
+            NonNull::new(ptr).map(Tree)
+        }
+    }
 }
 
 impl fmt::Debug for Tree {
@@ -860,6 +1511,14 @@ impl<'tree> Node<'tree> {
         unsafe { ffi::ts_node_named_child_count(self.0) as usize }
     }
 
+    /// Get the number of nodes in the subtree rooted at this node, including this
+    /// node itself.
+    ///
+    /// See also [TreeCursor::goto_descendant].
+    pub fn descendant_count(&self) -> usize {
+        unsafe { ffi::ts_node_descendant_count(self.0) as usize }
+    }
+
     /// Get the first child with the given field name.
     ///
     /// If multiple children may have the same field name, access them using
@@ -1054,6 +1713,22 @@ impl<'tree> Node<'tree> {
         TreeCursor(unsafe { ffi::ts_tree_cursor_new(self.0) }, PhantomData)
     }
 
+    /// Create a new [NodeExporter] that copies this node and its descendants into
+    /// flat arrays.
+    ///
+    /// If `named_only` is true, anonymous nodes are skipped. If a `max_depth` is
+    /// given, nodes that are more than that many levels below this node are skipped.
+    pub fn export(&self, named_only: bool, max_depth: Option<usize>) -> NodeExporter<'tree> {
+        let max_depth = max_depth.map_or(u32::MAX, |depth| depth.min(u32::MAX as usize) as u32);
+        let ptr = unsafe { ffi::ts_node_exporter_new(self.0, named_only, max_depth) };
+        NodeExporter {
+            ptr: NonNull::new(ptr).unwrap(),
+            start_points: Vec::new(),
+            end_points: Vec::new(),
+            _tree: PhantomData,
+        }
+    }
+
     /// Edit this node to keep it in-sync with source code that has been edited.
     ///
     /// This function is only rarely needed. When you edit a syntax tree with the
@@ -1065,6 +1740,23 @@ impl<'tree> Node<'tree> {
         let edit = edit.into();
         unsafe { ffi::ts_node_edit(&mut self.0 as *mut ffi::TSNode, &edit) }
     }
+
+    /// Edit several nodes to keep them in sync with several edits to the source code.
+    ///
+    /// The edits are described in the same way as for [Tree::edit_batch]. This is
+    /// equivalent to calling [Node::edit] on every node for each edit, from the last
+    /// one in the document to the first.
+    pub fn edit_batch(nodes: &mut [Node<'tree>], edits: &[InputEdit]) {
+        let edits: Vec<ffi::TSInputEdit> = edits.iter().map(Into::into).collect();
+        unsafe {
+            ffi::ts_node_edit_batch(
+                nodes.as_mut_ptr() as *mut ffi::TSNode,
+                nodes.len() as u32,
+                edits.as_ptr(),
+                edits.len() as u32,
+            )
+        }
+    }
 }
 
 impl<'a> PartialEq for Node<'a> {
@@ -1186,10 +1878,31 @@ impl<'a> TreeCursor<'a> {
         }
     }
 
+    /// Move this cursor to the nth descendant of the node that it was created
+    /// with, where zero is that node itself and descendants are numbered in
+    /// preorder.
+    ///
+    /// If the index is out of range, the cursor does not move.
+    pub fn goto_descendant(&mut self, descendant_index: usize) {
+        unsafe { ffi::ts_tree_cursor_goto_descendant(&mut self.0, descendant_index as u32) }
+    }
+
+    /// Get the preorder index of this cursor's current node among the descendants
+    /// of the node that it was created with.
+    pub fn descendant_index(&self) -> usize {
+        unsafe { ffi::ts_tree_cursor_current_descendant_index(&self.0) as usize }
+    }
+
     /// Re-initialize this tree cursor to start at a different node.
     pub fn reset(&mut self, node: Node<'a>) {
         unsafe { ffi::ts_tree_cursor_reset(&mut self.0, node.0) };
     }
+
+    /// Move this cursor to the same position as another cursor, reusing this
+    /// cursor's memory.
+    pub fn reset_to(&mut self, cursor: &TreeCursor<'a>) {
+        unsafe { ffi::ts_tree_cursor_reset_to(&mut self.0, &cursor.0) };
+    }
 }
 
 impl<'a> Clone for TreeCursor<'a> {
@@ -1204,6 +1917,82 @@ impl<'a> Drop for TreeCursor<'a> {
     }
 }
 
+impl NodeArray {
+    pub const NAMED: u8 = ffi::TSNodeFlag_TSNodeFlagNamed as u8;
+    pub const EXTRA: u8 = ffi::TSNodeFlag_TSNodeFlagExtra as u8;
+    pub const MISSING: u8 = ffi::TSNodeFlag_TSNodeFlagMissing as u8;
+    pub const HAS_ERROR: u8 = ffi::TSNodeFlag_TSNodeFlagHasError as u8;
+    pub const HAS_CHANGES: u8 = ffi::TSNodeFlag_TSNodeFlagHasChanges as u8;
+    pub const HAS_CHILDREN: u8 = ffi::TSNodeFlag_TSNodeFlagHasChildren as u8;
+
+    /// Get the number of nodes in this array.
+    pub fn len(&self) -> usize {
+        self.kind_ids.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.kind_ids.is_empty()
+    }
+}
+
+impl<'a> NodeExporter<'a> {
+    /// Replace the contents of the given [NodeArray] with the next batch of at
+    /// most `capacity` nodes.
+    ///
+    /// Each node's parent index refers to the position of its nearest exported
+    /// ancestor across all of the batches, or is `u32::MAX` for the first node.
+    /// This returns the number of nodes that were exported, which is zero once
+    /// the whole subtree has been exported.
+    pub fn next_batch(&mut self, array: &mut NodeArray, capacity: usize) -> usize {
+        let capacity = capacity.min(u32::MAX as usize);
+        let empty_point = ffi::TSPoint { row: 0, column: 0 };
+        array.kind_ids.resize(capacity, 0);
+        array.field_ids.resize(capacity, 0);
+        array.start_bytes.resize(capacity, 0);
+        array.end_bytes.resize(capacity, 0);
+        array.parent_indices.resize(capacity, 0);
+        array.flags.resize(capacity, 0);
+        self.start_points.resize(capacity, empty_point);
+        self.end_points.resize(capacity, empty_point);
+
+        let mut raw_array = ffi::TSNodeArray {
+            capacity: capacity as u32,
+            symbols: array.kind_ids.as_mut_ptr(),
+            field_ids: array.field_ids.as_mut_ptr(),
+            start_bytes: array.start_bytes.as_mut_ptr(),
+            end_bytes: array.end_bytes.as_mut_ptr(),
+            start_points: self.start_points.as_mut_ptr(),
+            end_points: self.end_points.as_mut_ptr(),
+            parent_indices: array.parent_indices.as_mut_ptr(),
+            flags: array.flags.as_mut_ptr(),
+        };
+        let count =
+            unsafe { ffi::ts_node_exporter_next(self.ptr.as_ptr(), &mut raw_array) } as usize;
+
+        array.kind_ids.truncate(count);
+        array.field_ids.truncate(count);
+        array.start_bytes.truncate(count);
+        array.end_bytes.truncate(count);
+        array.parent_indices.truncate(count);
+        array.flags.truncate(count);
+        array.start_positions.clear();
+        array
+            .start_positions
+            .extend(self.start_points[..count].iter().map(|p| Point::from(*p)));
+        array.end_positions.clear();
+        array
+            .end_positions
+            .extend(self.end_points[..count].iter().map(|p| Point::from(*p)));
+        count
+    }
+}
+
+impl<'a> Drop for NodeExporter<'a> {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_node_exporter_delete(self.ptr.as_ptr()) }
+    }
+}
+
 impl Query {
     /// Create a new query from a string containing one or more S-expression
     /// patterns.
@@ -1300,6 +2089,67 @@ impl Query {
             });
         }
 
+        Self::from_raw(ptr, source)
+    }
+
+    /// Serialize the compiled query into a binary format that can be loaded
+    /// with [Query::deserialize] much more quickly than the query's source can be
+    /// compiled, for example in order to cache the query on disk.
+    pub fn serialize(&self) -> Vec<u8> {
+        let mut length = 0u32;
+        unsafe {
+            let ptr = ffi::ts_query_serialize(self.ptr.as_ptr(), &mut length);
+            let result = slice::from_raw_parts(ptr as *const u8, length as usize).to_vec();
+            (FREE_FN)(ptr as *mut c_void);
+            result
+        }
+    }
+
+    /// Load a query from data that was created with [Query::serialize].
+    ///
+    /// The source from which the query was compiled must also be given. For a
+    /// query created with [Query::combine], this is the concatenation of the
+    /// sources of the combined queries. Returns `None` if the data is malformed,
+    /// or if it was created from a different source, for a different language,
+    /// or by a different version of the library. In that case, the query should
+    /// be compiled with [Query::new].
+    pub fn deserialize(language: Language, source: &str, data: &[u8]) -> Option<Self> {
+        let ptr = unsafe {
+            ffi::ts_query_deserialize(
+                data.as_ptr() as *const c_char,
+                data.len() as u32,
+                language.0,
+                source.as_ptr() as *const c_char,
+                source.len() as u32,
+            )
+        };
+        if ptr.is_null() {
+            return None;
+        }
+        Self::from_raw(ptr, source).ok()
+    }
+
+    /// Combine several queries for the same language into one query, so that all of their
+    /// patterns can be matched in a single traversal of a tree.
+    ///
+    /// The combined query contains the patterns of each of the given queries, in order.
+    /// Captures with the same name are merged, so capture indices generally differ from
+    /// those of the original queries. Use
+    /// [source_query_for_pattern](Query::source_query_for_pattern) to find which query
+    /// a match came from. Returns `None` if the queries belong to different languages.
+    pub fn combine(queries: &[&Query]) -> Option<Self> {
+        let ptrs = queries
+            .iter()
+            .map(|query| query.ptr.as_ptr() as *const ffi::TSQuery)
+            .collect::<Vec<_>>();
+        let ptr = unsafe { ffi::ts_query_combine(ptrs.as_ptr(), ptrs.len() as u32) };
+        if ptr.is_null() {
+            return None;
+        }
+        Self::from_raw(ptr, "").ok()
+    }
+
+    fn from_raw(ptr: *mut ffi::TSQuery, source: &str) -> Result<Self, QueryError> {
         let string_count = unsafe { ffi::ts_query_string_count(ptr) };
         let capture_count = unsafe { ffi::ts_query_capture_count(ptr) };
         let pattern_count = unsafe { ffi::ts_query_pattern_count(ptr) as usize };
@@ -1500,6 +2350,21 @@ impl Query {
         Ok(result)
     }
 
+    /// Get the index of the query that the given pattern came from, when this query was
+    /// created with [Query::combine].
+    pub fn source_query_for_pattern(&self, pattern_index: usize) -> usize {
+        if pattern_index >= self.text_predicates.len() {
+            panic!(
+                "Pattern index is {} but the pattern count is {}",
+                pattern_index,
+                self.text_predicates.len(),
+            );
+        }
+        unsafe {
+            ffi::ts_query_source_query_for_pattern(self.ptr.as_ptr(), pattern_index as u32) as usize
+        }
+    }
+
     /// Get the byte offset where the given pattern starts in the query's source.
     pub fn start_byte_for_pattern(&self, pattern_index: usize) -> usize {
         if pattern_index >= self.text_predicates.len() {
@@ -1681,6 +2546,104 @@ impl QueryCursor {
         unsafe { ffi::ts_query_cursor_did_exceed_match_limit(self.ptr.as_ptr()) }
     }
 
+    /// Set whether this cursor should stream its captures.
+    ///
+    /// In streaming mode, when the match limit is reached while iterating over captures, the
+    /// cursor returns finished captures early, possibly out of order, instead of dropping
+    /// unfinished matches. Combined with [set_match_limit](QueryCursor::set_match_limit), this
+    /// bounds the memory used when querying very large trees.
+    pub fn set_streaming(&mut self, streaming: bool) {
+        unsafe {
+            ffi::ts_query_cursor_set_streaming(self.ptr.as_ptr(), streaming);
+        }
+    }
+
+    /// Check if this cursor is in streaming mode.
+    pub fn streaming(&self) -> bool {
+        unsafe { ffi::ts_query_cursor_streaming(self.ptr.as_ptr()) }
+    }
+
+    /// Allocate room for the given numbers of in-progress matches and capture lists up front,
+    /// so that executing queries with this cursor doesn't need to grow its buffers.
+    pub fn reserve(&mut self, state_count: u32, capture_list_count: u32) {
+        unsafe {
+            ffi::ts_query_cursor_reserve(self.ptr.as_ptr(), state_count, capture_list_count);
+        }
+    }
+
+    /// Limit the memory that this cursor keeps between executions.
+    ///
+    /// When the cursor is next executed, any capacity beyond the given numbers of in-progress
+    /// matches and capture lists is freed. By default, all memory is kept for reuse.
+    pub fn set_retained_capacity(&mut self, state_count: u32, capture_list_count: u32) {
+        unsafe {
+            ffi::ts_query_cursor_set_retained_capacity(
+                self.ptr.as_ptr(),
+                state_count,
+                capture_list_count,
+            );
+        }
+    }
+
+    /// Run the given function with a query cursor that is shared by all callers on the
+    /// current thread.
+    ///
+    /// Creating a cursor for every short query means allocating its buffers again each time.
+    /// This instead takes a cursor from a small per-thread cache, with all of its settings
+    /// restored to their defaults, and returns it to the cache afterward, keeping the memory
+    /// that it has already allocated. Nested calls each receive their own cursor.
+    pub fn with_thread_local<R>(f: impl FnOnce(&mut QueryCursor) -> R) -> R {
+        let mut cursor = QUERY_CURSOR_CACHE
+            .try_with(|cache| cache.borrow_mut().pop())
+            .ok()
+            .flatten()
+            .unwrap_or_else(QueryCursor::new);
+        let result = f(&mut cursor);
+        cursor.reset_settings();
+        let _ = QUERY_CURSOR_CACHE.try_with(|cache| {
+            let mut cache = cache.borrow_mut();
+            if cache.len() < QUERY_CURSOR_CACHE_SIZE {
+                cache.push(cursor);
+            }
+        });
+        result
+    }
+
+    fn reset_settings(&mut self) {
+        let ptr = self.ptr.as_ptr();
+        unsafe {
+            ffi::ts_query_cursor_set_byte_range(ptr, 0, u32::MAX);
+            ffi::ts_query_cursor_set_point_range(
+                ptr,
+                Point::new(0, 0).into(),
+                Point::new(0, 0).into(),
+            );
+            ffi::ts_query_cursor_set_match_limit(ptr, u32::MAX);
+            ffi::ts_query_cursor_set_streaming(ptr, false);
+            ffi::ts_query_cursor_set_retained_capacity(ptr, u32::MAX, u32::MAX);
+            ffi::ts_query_cursor_set_text(ptr, ptr::null(), 0);
+        }
+    }
+
+    /// Get counters describing the resources that this cursor used during its last execution.
+    pub fn stats(&self) -> QueryCursorStats {
+        let mut stats = MaybeUninit::<ffi::TSQueryCursorStats>::uninit();
+        let stats = unsafe {
+            ffi::ts_query_cursor_stats(self.ptr.as_ptr(), stats.as_mut_ptr());
+            stats.assume_init()
+        };
+        QueryCursorStats {
+            peak_state_count: stats.peak_state_count,
+            peak_finished_state_count: stats.peak_finished_state_count,
+            peak_capture_list_count: stats.peak_capture_list_count,
+            abandoned_match_count: stats.abandoned_match_count,
+            out_of_order_capture_count: stats.out_of_order_capture_count,
+            rejected_match_count: stats.rejected_match_count,
+            visited_node_count: stats.visited_node_count,
+            step_count: stats.step_count,
+        }
+    }
+
     /// Iterate over all of the matches in the order that they were found.
     ///
     /// Each match contains the index of the pattern that matched, and a list of captures.
@@ -1693,7 +2656,10 @@ impl QueryCursor {
         text_provider: T,
     ) -> QueryMatches<'a, 'tree, T> {
         let ptr = self.ptr.as_ptr();
-        unsafe { ffi::ts_query_cursor_exec(ptr, query.ptr.as_ptr(), node.0) };
+        unsafe {
+            ffi::ts_query_cursor_exec(ptr, query.ptr.as_ptr(), node.0);
+            set_cursor_text(ptr, &text_provider);
+        }
         QueryMatches {
             ptr,
             query,
@@ -1715,7 +2681,10 @@ impl QueryCursor {
         text_provider: T,
     ) -> QueryCaptures<'a, 'tree, T> {
         let ptr = self.ptr.as_ptr();
-        unsafe { ffi::ts_query_cursor_exec(self.ptr.as_ptr(), query.ptr.as_ptr(), node.0) };
+        unsafe {
+            ffi::ts_query_cursor_exec(ptr, query.ptr.as_ptr(), node.0);
+            set_cursor_text(ptr, &text_provider);
+        }
         QueryCaptures {
             ptr,
             query,
@@ -1749,6 +2718,116 @@ impl QueryCursor {
         }
         self
     }
+
+    /// Find all of the captures of a query within a node, using multiple threads.
+    ///
+    /// The node's byte range is split into shards, and each shard is searched by a
+    /// separate cursor whose [byte range](QueryCursor::set_byte_range) is limited to
+    /// that shard. The shards are distributed among at most `thread_count` threads.
+    /// A match that crosses a shard boundary is found in every shard that it
+    /// intersects, so duplicate matches are removed before the captures are merged.
+    ///
+    /// Returns each capture along with the index of the pattern that produced it,
+    /// ordered by the start position of the captured nodes.
+    pub fn captures_in_parallel<'tree>(
+        query: &Query,
+        node: Node<'tree>,
+        text: &[u8],
+        thread_count: usize,
+    ) -> Vec<(usize, QueryCapture<'tree>)> {
+        // Raw nodes can be sent between threads because each thread uses its
+        // own copy of the tree.
+        #[derive(Clone, Copy)]
+        struct RawNode(ffi::TSNode);
+        unsafe impl Send for RawNode {}
+        unsafe impl Sync for RawNode {}
+
+        let thread_count = thread_count.max(1);
+        let shard_count = (thread_count * 4).min(node.byte_range().len().max(1));
+        let (start_byte, end_byte) = (node.start_byte(), node.end_byte());
+        let boundaries = (0..=shard_count)
+            .map(|i| start_byte + (end_byte - start_byte) * i / shard_count)
+            .collect::<Vec<_>>();
+
+        let raw_node = RawNode(node.0);
+        let next_shard_index = AtomicUsize::new(0);
+        let work = || {
+            let mut results = Vec::new();
+            let tree = unsafe { ffi::ts_tree_copy(raw_node.0.tree as *const ffi::TSTree) };
+            let node = Node::new(ffi::TSNode {
+                tree: tree as *const _,
+                ..raw_node.0
+            })
+            .unwrap();
+            let mut cursor = QueryCursor::new();
+            loop {
+                let index = next_shard_index.fetch_add(1, Ordering::Relaxed);
+                if index >= shard_count {
+                    break;
+                }
+
+                // Zero-width nodes only intersect a range if they are strictly inside
+                // of it, so extend each shard by one byte to include the nodes at its
+                // end. The first and last shards are unbounded, just like the default
+                // range.
+                let shard_start = if index == 0 { 0 } else { boundaries[index] };
+                let shard_end = if index + 1 == shard_count {
+                    u32::MAX as usize
+                } else {
+                    boundaries[index + 1] + 1
+                };
+                cursor.set_byte_range(shard_start..shard_end);
+                for m in cursor.matches(query, node, text) {
+                    let captures = m
+                        .captures
+                        .iter()
+                        .map(|c| (c.index, RawNode(c.node.0)))
+                        .collect::<Vec<_>>();
+                    results.push((index, m.pattern_index, captures));
+                }
+            }
+            drop(cursor);
+            unsafe { ffi::ts_tree_delete(tree) };
+            results
+        };
+
+        let mut matches = Vec::new();
+        thread::scope(|scope| {
+            let handles = (1..thread_count.min(shard_count))
+                .map(|_| scope.spawn(&work))
+                .collect::<Vec<_>>();
+            matches.extend(work());
+            for handle in handles {
+                matches.extend(handle.join().unwrap());
+            }
+        });
+        matches.sort_by_key(|(shard_index, _, _)| *shard_index);
+
+        let mut seen_matches = HashSet::new();
+        let mut result = Vec::new();
+        for (_, pattern_index, captures) in matches {
+            let key = (
+                pattern_index,
+                captures
+                    .iter()
+                    .map(|(index, node)| (*index, node.0.id as usize))
+                    .collect::<Vec<_>>(),
+            );
+            if !seen_matches.insert(key) {
+                continue;
+            }
+            for (index, raw_node) in captures {
+                let node = Node::new(ffi::TSNode {
+                    tree: node.0.tree,
+                    ..raw_node.0
+                })
+                .unwrap();
+                result.push((pattern_index, QueryCapture { node, index }));
+            }
+        }
+        result.sort_by_key(|(pattern_index, capture)| (capture.node.start_byte(), *pattern_index));
+        result
+    }
 }
 
 impl<'a, 'tree> QueryMatch<'a, 'tree> {
@@ -1978,6 +3057,10 @@ impl<'a> TextProvider<'a> for &'a [u8] {
     fn text(&mut self, node: Node) -> Self::I {
         iter::once(&self[node.byte_range()])
     }
+
+    fn source(&self) -> Option<&'a [u8]> {
+        Some(self)
+    }
 }
 
 impl PartialEq for Query {
@@ -2109,6 +3192,19 @@ impl<'a> Iterator for LossyUtf8<'a> {
     }
 }
 
+// Give the query cursor direct access to the source text when it is contiguous, or
+// clear any text that was provided for a previous execution.
+unsafe fn set_cursor_text<'a>(ptr: *mut ffi::TSQueryCursor, text_provider: &impl TextProvider<'a>) {
+    match text_provider.source() {
+        Some(source) => ffi::ts_query_cursor_set_text(
+            ptr,
+            source.as_ptr() as *const c_char,
+            source.len().min(u32::MAX as usize) as u32,
+        ),
+        None => ffi::ts_query_cursor_set_text(ptr, ptr::null(), 0),
+    }
+}
+
 fn predicate_error(row: usize, message: String) -> QueryError {
     QueryError {
         kind: QueryErrorKind::Predicate,
@@ -2177,17 +3273,47 @@ pub unsafe fn set_allocator(
     ffi::ts_set_allocator(new_malloc, new_calloc, new_realloc, new_free);
 }
 
+/// Enable or disable tracking of the library's allocations by category.
+///
+/// While tracking is enabled, [allocation_live_bytes] returns the number of
+/// bytes attributed to each [AllocationCategory]. If `hooks` are given, their
+/// callbacks are invoked for every allocation and release in a category.
+///
+/// Tracking can only be enabled or disabled while the library holds no memory
+/// in any category, for example before any parsers, trees or query cursors are
+/// created. Otherwise, tracking is left unchanged and `false` is returned.
+///
+/// # Safety
+///
+/// This changes global state, so it must not be called while other threads
+/// are using the library. The hooks' callbacks must be safe to call from any
+/// thread, with their payload, for as long as tracking is enabled.
+pub unsafe fn set_allocation_tracking(
+    enabled: bool,
+    hooks: Option<&ffi::TSAllocationHooks>,
+) -> bool {
+    ffi::ts_set_allocation_tracking(enabled, hooks.map_or(ptr::null(), |h| h as *const _))
+}
+
+/// Get the number of bytes currently attributed to the given allocation
+/// category. This is always zero unless allocation tracking is enabled.
+pub fn allocation_live_bytes(category: AllocationCategory) -> usize {
+    unsafe { ffi::ts_allocation_live_bytes(category as ffi::TSAllocationCategory) }
+}
+
 impl error::Error for IncludedRangesError {}
 impl error::Error for LanguageError {}
 impl error::Error for QueryError {}
 
 unsafe impl Send for Language {}
 unsafe impl Send for Parser {}
+unsafe impl Send for ParserPool {}
 unsafe impl Send for Query {}
 unsafe impl Send for QueryCursor {}
 unsafe impl Send for Tree {}
 unsafe impl Sync for Language {}
 unsafe impl Sync for Parser {}
+unsafe impl Sync for ParserPool {}
 unsafe impl Sync for Query {}
 unsafe impl Sync for QueryCursor {}
 unsafe impl Sync for Tree {}
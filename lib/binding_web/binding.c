@@ -564,6 +564,86 @@ void ts_node_descendants_of_type_wasm(
   TRANSFER_BUFFER[1] = result.contents;
 }
 
+// Export a node and all of its descendants within the given range, in
+// document order, so that JS can traverse a large tree without calling into
+// WASM for every node. Each node is written as its marshaled form, followed by
+// its symbol, its end index and end point, its flags, and its depth relative
+// to the given node.
+void ts_node_export_wasm(
+  const TSTree *tree,
+  uint32_t start_row,
+  uint32_t start_column,
+  uint32_t end_row,
+  uint32_t end_column
+) {
+  TSNode node = unmarshal_node(tree);
+  TSPoint start_point = {start_row, code_unit_to_byte(start_column)};
+  TSPoint end_point = {end_row, code_unit_to_byte(end_column)};
+  if (end_point.row == 0 && end_point.column == 0) {
+    end_point = (TSPoint) {UINT32_MAX, UINT32_MAX};
+  }
+
+  Array(const void *) result = array_new();
+
+  ts_tree_cursor_reset(&scratch_cursor, node);
+  uint32_t depth = 0;
+  bool already_visited_children = false;
+  while (true) {
+    TSNode descendant = ts_tree_cursor_current_node(&scratch_cursor);
+
+    if (!already_visited_children) {
+      if (point_lte(ts_node_end_point(descendant), start_point)) {
+        if (ts_tree_cursor_goto_next_sibling(&scratch_cursor)) {
+          already_visited_children = false;
+        } else {
+          if (!ts_tree_cursor_goto_parent(&scratch_cursor)) break;
+          depth--;
+          already_visited_children = true;
+        }
+        continue;
+      }
+
+      if (point_lte(end_point, ts_node_start_point(descendant))) break;
+
+      TSPoint descendant_end_point = ts_node_end_point(descendant);
+      uint32_t flags =
+        (ts_node_is_named(descendant) ? 1 : 0) |
+        (ts_node_is_missing(descendant) ? 2 : 0) |
+        (ts_node_has_error(descendant) ? 4 : 0);
+      array_grow_by(&result, 11);
+      const void **address = result.contents + result.size - 11;
+      marshal_node(address, descendant);
+      address[5] = (const void *)(uint32_t)ts_node_symbol(descendant);
+      address[6] = (const void *)byte_to_code_unit(ts_node_end_byte(descendant));
+      address[7] = (const void *)descendant_end_point.row;
+      address[8] = (const void *)byte_to_code_unit(descendant_end_point.column);
+      address[9] = (const void *)flags;
+      address[10] = (const void *)depth;
+
+      if (ts_tree_cursor_goto_first_child(&scratch_cursor)) {
+        depth++;
+        already_visited_children = false;
+      } else if (ts_tree_cursor_goto_next_sibling(&scratch_cursor)) {
+        already_visited_children = false;
+      } else {
+        if (!ts_tree_cursor_goto_parent(&scratch_cursor)) break;
+        depth--;
+        already_visited_children = true;
+      }
+    } else {
+      if (ts_tree_cursor_goto_next_sibling(&scratch_cursor)) {
+        already_visited_children = false;
+      } else {
+        if (!ts_tree_cursor_goto_parent(&scratch_cursor)) break;
+        depth--;
+      }
+    }
+  }
+
+  TRANSFER_BUFFER[0] = (const void *)(result.size / 11);
+  TRANSFER_BUFFER[1] = result.contents;
+}
+
 int ts_node_is_named_wasm(const TSTree *tree) {
   TSNode node = unmarshal_node(tree);
   return ts_node_is_named(node);
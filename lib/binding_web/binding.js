@@ -388,6 +388,56 @@ class Node {
     return result;
   }
 
+  exportNodes(startPosition, endPosition) {
+    if (!startPosition) startPosition = ZERO_POINT;
+    if (!endPosition) endPosition = ZERO_POINT;
+
+    marshalNode(this);
+    C._ts_node_export_wasm(
+      this.tree[0],
+      startPosition.row,
+      startPosition.column,
+      endPosition.row,
+      endPosition.column
+    );
+
+    // Each exported node is followed by its symbol, end index, end point,
+    // flags, and depth, so that none of them require another call into WASM.
+    const count = getValue(TRANSFER_BUFFER, 'i32');
+    const buffer = getValue(TRANSFER_BUFFER + SIZE_OF_INT, 'i32');
+    const typesBySymbol = this.tree.language.types;
+    const result = new Array(count);
+    if (count > 0) {
+      let address = buffer;
+      for (let i = 0; i < count; i++) {
+        const node = unmarshalNode(this.tree, address);
+        address += SIZE_OF_NODE;
+        const typeId = getValue(address, 'i32');
+        const endIndex = getValue(address + SIZE_OF_INT, 'i32');
+        const endRow = getValue(address + 2 * SIZE_OF_INT, 'i32');
+        const endColumn = getValue(address + 3 * SIZE_OF_INT, 'i32');
+        const flags = getValue(address + 4 * SIZE_OF_INT, 'i32');
+        const depth = getValue(address + 5 * SIZE_OF_INT, 'i32');
+        address += 6 * SIZE_OF_INT;
+        result[i] = {
+          node,
+          typeId,
+          type: typesBySymbol[typeId] || 'ERROR',
+          startIndex: node.startIndex,
+          endIndex,
+          startPosition: node.startPosition,
+          endPosition: {row: endRow, column: endColumn},
+          isNamed: (flags & 1) !== 0,
+          isMissing: (flags & 2) !== 0,
+          hasError: (flags & 4) !== 0,
+          depth
+        };
+      }
+      C._free(buffer);
+    }
+    return result;
+  }
+
   get nextSibling() {
     marshalNode(this);
     C._ts_node_next_sibling_wasm(this.tree[0]);
@@ -875,55 +925,102 @@ class Language {
   }
 
   static load(input) {
-    let bytes;
-    if (input instanceof Uint8Array) {
-      bytes = Promise.resolve(input);
-    } else {
-      const url = input;
-      if (
-        typeof process !== 'undefined' &&
-        process.versions &&
-        process.versions.node
-      ) {
-        const fs = require('fs');
-        bytes = Promise.resolve(fs.readFileSync(url));
-      } else {
-        bytes = fetch(url)
-          .then(response => response.arrayBuffer()
-            .then(buffer => {
-              if (response.ok) {
-                return new Uint8Array(buffer);
-              } else {
-                const body = new TextDecoder('utf-8').decode(buffer);
-                throw new Error(`Language.load failed with status ${response.status}.\n\n${body}`)
-              }
-            }));
+    // Loading the same URL again reuses the language that was already loaded,
+    // so that every parser on the page shares a single module instance.
+    if (typeof input === 'string') {
+      let language = loadedLanguages.get(input);
+      if (!language) {
+        language = loadLanguage(loadBytes(input));
+        loadedLanguages.set(input, language);
+        language.catch(() => loadedLanguages.delete(input));
       }
+      return language;
     }
 
-    // emscripten-core/emscripten#12969
-    const loadModule =
-      typeof loadSideModule === 'function'
-      ? loadSideModule
-      : loadWebAssemblyModule;
-
-    return bytes
-      .then(bytes => loadModule(bytes, {loadAsync: true}))
-      .then(mod => {
-        const symbolNames = Object.keys(mod)
-        const functionName = symbolNames.find(key =>
-          LANGUAGE_FUNCTION_REGEX.test(key) &&
-          !key.includes("external_scanner_")
-        );
-        if (!functionName) {
-          console.log(`Couldn't find language function in WASM file. Symbols:\n${JSON.stringify(symbolNames, null, 2)}`)
+    return loadLanguage(Promise.resolve(input));
+  }
+
+  static compile(input) {
+    if (input instanceof Uint8Array) {
+      return WebAssembly.compile(input);
+    }
+
+    // Compile the module while it is still downloading when the server
+    // sends it with the `application/wasm` content type.
+    if (
+      typeof WebAssembly.compileStreaming === 'function' &&
+      typeof fetch === 'function' &&
+      !isNode()
+    ) {
+      return fetch(input).then(response => {
+        const contentType = response.headers.get('Content-Type');
+        if (response.ok && contentType && contentType.startsWith('application/wasm')) {
+          return WebAssembly.compileStreaming(response);
         }
-        const languageAddress = mod[functionName]();
-        return new Language(INTERNAL, languageAddress);
+        return responseBytes(response).then(bytes => WebAssembly.compile(bytes));
       });
+    }
+
+    return loadBytes(input).then(bytes => WebAssembly.compile(bytes));
   }
 }
 
+const loadedLanguages = new Map();
+
+function isNode() {
+  return (
+    typeof process !== 'undefined' &&
+    process.versions &&
+    process.versions.node
+  );
+}
+
+function loadBytes(url) {
+  if (isNode()) {
+    const fs = require('fs');
+    return Promise.resolve(fs.readFileSync(url));
+  } else {
+    return fetch(url).then(responseBytes);
+  }
+}
+
+function responseBytes(response) {
+  return response.arrayBuffer()
+    .then(buffer => {
+      if (response.ok) {
+        return new Uint8Array(buffer);
+      } else {
+        const body = new TextDecoder('utf-8').decode(buffer);
+        throw new Error(`Language.load failed with status ${response.status}.\n\n${body}`)
+      }
+    });
+}
+
+// Instantiate a language from either the bytes of a WASM file or a
+// `WebAssembly.Module` that was already compiled.
+function loadLanguage(input) {
+  // emscripten-core/emscripten#12969
+  const loadModule =
+    typeof loadSideModule === 'function'
+    ? loadSideModule
+    : loadWebAssemblyModule;
+
+  return input
+    .then(binary => loadModule(binary, {loadAsync: true}))
+    .then(mod => {
+      const symbolNames = Object.keys(mod)
+      const functionName = symbolNames.find(key =>
+        LANGUAGE_FUNCTION_REGEX.test(key) &&
+        !key.includes("external_scanner_")
+      );
+      if (!functionName) {
+        console.log(`Couldn't find language function in WASM file. Symbols:\n${JSON.stringify(symbolNames, null, 2)}`)
+      }
+      const languageAddress = mod[functionName]();
+      return new Language(INTERNAL, languageAddress);
+    });
+}
+
 class Query {
   constructor(
     internal, address, captureNames, textPredicates, predicates,
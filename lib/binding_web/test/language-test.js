@@ -1,8 +1,36 @@
 const { assert } = require("chai");
-let JavaScript;
+let JavaScript, Parser, languageURL;
 
 describe("Language", () => {
-  before(async () => ({ JavaScript } = await require("./helper")));
+  before(async () => ({ JavaScript, Parser, languageURL } = await require("./helper")));
+
+  describe(".load", () => {
+    it("reuses the language when the same URL is loaded again", async () => {
+      const language = await Parser.Language.load(languageURL("javascript"));
+      assert.strictEqual(language, JavaScript);
+    });
+
+    it("loads a language from a compiled module", async () => {
+      const module = await Parser.Language.compile(languageURL("python"));
+      assert.instanceOf(module, WebAssembly.Module);
+      const language = await Parser.Language.load(module);
+
+      const parser = new Parser();
+      parser.setLanguage(language);
+      const tree = parser.parse("def a():\n  b()");
+      assert.equal(
+        tree.rootNode.toString(),
+        "(module (function_definition " +
+          "name: (identifier) " +
+          "parameters: (parameters) " +
+          "body: (block (expression_statement (call " +
+            "function: (identifier) " +
+            "arguments: (argument_list))))))"
+      );
+      tree.delete();
+      parser.delete();
+    }).timeout(5000);
+  });
 
   describe(".fieldIdForName, .fieldNameForId", () => {
     it("converts between the string and integer representations of fields", () => {
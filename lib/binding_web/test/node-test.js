@@ -364,6 +364,55 @@ describe("Node", () => {
     })
   });
 
+  describe('.exportNodes(min, max)', () => {
+    it('returns the node and its descendants in document order, with their properties', () => {
+      tree = parser.parse("a + 1 * b * 2 + c + 3");
+      const outerSum = tree.rootNode.firstChild.firstChild;
+      let nodes = outerSum.exportNodes();
+      const expected = [];
+      const cursor = outerSum.walk();
+      let depth = 0;
+      for (;;) {
+        const node = cursor.currentNode();
+        expected.push({
+          type: node.type,
+          startIndex: node.startIndex,
+          endIndex: node.endIndex,
+          endPosition: node.endPosition,
+          isNamed: node.isNamed(),
+          depth,
+        });
+        if (cursor.gotoFirstChild()) {
+          depth++;
+          continue;
+        }
+        while (!cursor.gotoNextSibling()) {
+          if (depth === 0 || !cursor.gotoParent()) break;
+          depth--;
+        }
+        if (depth === 0) break;
+      }
+      assert.deepEqual(
+        nodes.map(({type, startIndex, endIndex, endPosition, isNamed, depth}) =>
+          ({type, startIndex, endIndex, endPosition, isNamed, depth})),
+        expected
+      );
+      assert(nodes[0].node.equals(outerSum));
+
+      nodes = outerSum.exportNodes({row: 0, column: 12}, {row: 0, column: 15});
+      assert.deepEqual(
+        nodes.filter(({isNamed}) => isNamed).map(({type, startIndex}) => [type, startIndex]),
+        [
+          ['binary_expression', 0],
+          ['binary_expression', 0],
+          ['binary_expression', 0],
+          ['binary_expression', 4],
+          ['number', 12],
+        ]
+      );
+    });
+  });
+
   describe.skip('.closest(type)', () => {
     it('returns the closest ancestor of the given type', () => {
       tree = parser.parse("a(b + -d.e)");
@@ -91,6 +91,7 @@ declare module 'web-tree-sitter' {
       descendantForIndex(index: number): SyntaxNode;
       descendantForIndex(startIndex: number, endIndex: number): SyntaxNode;
       descendantsOfType(type: string | Array<string>, startPosition?: Point, endPosition?: Point): Array<SyntaxNode>;
+      exportNodes(startPosition?: Point, endPosition?: Point): Array<ExportedNode>;
       namedDescendantForIndex(index: number): SyntaxNode;
       namedDescendantForIndex(startIndex: number, endIndex: number): SyntaxNode;
       descendantForPosition(position: Point): SyntaxNode;
@@ -101,6 +102,20 @@ declare module 'web-tree-sitter' {
       walk(): TreeCursor;
     }
 
+    export interface ExportedNode {
+      node: SyntaxNode;
+      typeId: number;
+      type: string;
+      startIndex: number;
+      endIndex: number;
+      startPosition: Point;
+      endPosition: Point;
+      isNamed: boolean;
+      isMissing: boolean;
+      hasError: boolean;
+      depth: number;
+    }
+
     export interface TreeCursor {
       nodeType: string;
       nodeTypeId: number;
@@ -137,7 +152,8 @@ declare module 'web-tree-sitter' {
     }
 
     class Language {
-      static load(input: string | Uint8Array): Promise<Language>;
+      static load(input: string | Uint8Array | WebAssembly.Module): Promise<Language>;
+      static compile(input: string | Uint8Array): Promise<WebAssembly.Module>;
 
       readonly version: number;
       readonly fieldCount: number;
@@ -21,7 +21,7 @@ extern "C" {
  * The Tree-sitter library is generally backwards-compatible with languages
  * generated using older CLI versions, but is not forwards-compatible.
  */
-#define TREE_SITTER_LANGUAGE_VERSION 13
+#define TREE_SITTER_LANGUAGE_VERSION 14
 
 /**
  * The earliest ABI version that is supported by the current version of the
@@ -37,15 +37,30 @@ typedef uint16_t TSSymbol;
 typedef uint16_t TSFieldId;
 typedef struct TSLanguage TSLanguage;
 typedef struct TSParser TSParser;
+typedef struct TSParserPool TSParserPool;
 typedef struct TSTree TSTree;
 typedef struct TSQuery TSQuery;
 typedef struct TSQueryCursor TSQueryCursor;
+typedef struct TSNodeExporter TSNodeExporter;
 
 typedef enum {
   TSInputEncodingUTF8,
   TSInputEncodingUTF16,
+  TSInputEncodingLatin1,
 } TSInputEncoding;
 
+typedef enum {
+  TSAllocationCategorySubtree,
+  TSAllocationCategoryStackNode,
+  TSAllocationCategoryLexerRanges,
+  TSAllocationCategoryQueryState,
+  TSAllocationCategoryCaptureList,
+  TSAllocationCategoryCursorStack,
+  TSAllocationCategoryExternalScannerState,
+} TSAllocationCategory;
+
+#define TS_ALLOCATION_CATEGORY_COUNT 7
+
 typedef enum {
   TSSymbolTypeRegular,
   TSSymbolTypeAnonymous,
@@ -57,6 +72,22 @@ typedef struct {
   uint32_t column;
 } TSPoint;
 
+typedef struct {
+  void *payload;
+  void (*allocated)(
+    void *payload,
+    TSAllocationCategory category,
+    const void *buffer,
+    size_t size
+  );
+  void (*freed)(
+    void *payload,
+    TSAllocationCategory category,
+    const void *buffer,
+    size_t size
+  );
+} TSAllocationHooks;
+
 typedef struct {
   TSPoint start_point;
   TSPoint end_point;
@@ -80,6 +111,44 @@ typedef struct {
   void (*log)(void *payload, TSLogType, const char *);
 } TSLogger;
 
+typedef struct {
+  uint64_t parse_table_cache_hits;
+  uint64_t parse_table_cache_misses;
+  uint64_t stack_node_count;
+  uint64_t stack_node_slab_count;
+  uint32_t max_stack_version_count;
+  uint64_t advance_count;
+  uint64_t token_count;
+  uint64_t relex_count;
+  uint64_t cached_token_hits;
+  uint64_t reused_node_count;
+  uint64_t rebuilt_node_count;
+  uint64_t shared_node_count;
+  uint64_t error_recovery_count;
+  uint64_t subtree_allocation_count;
+  uint64_t parse_time_micros;
+  uint64_t balance_time_micros;
+} TSParserStats;
+
+typedef struct {
+  size_t total_bytes;
+  size_t unique_subtree_bytes;
+  size_t shared_subtree_bytes;
+  size_t external_scanner_state_bytes;
+  size_t cache_bytes;
+} TSTreeMemoryUsage;
+
+typedef struct {
+  uint32_t peak_state_count;
+  uint32_t peak_finished_state_count;
+  uint32_t peak_capture_list_count;
+  uint32_t abandoned_match_count;
+  uint32_t out_of_order_capture_count;
+  uint32_t rejected_match_count;
+  uint32_t visited_node_count;
+  uint64_t step_count;
+} TSQueryCursorStats;
+
 typedef struct {
   uint32_t start_byte;
   uint32_t old_end_byte;
@@ -95,12 +164,43 @@ typedef struct {
   const TSTree *tree;
 } TSNode;
 
+typedef struct {
+  void *payload;
+  void (*node_finished)(void *payload, TSNode node);
+} TSStreamingCallback;
+
+typedef struct {
+  void *payload;
+  bool (*progress)(void *payload, uint32_t byte_offset, uint32_t version_count);
+} TSProgressCallback;
+
 typedef struct {
   const void *tree;
   const void *id;
   uint32_t context[2];
 } TSTreeCursor;
 
+typedef enum {
+  TSNodeFlagNamed = 1,
+  TSNodeFlagExtra = 2,
+  TSNodeFlagMissing = 4,
+  TSNodeFlagHasError = 8,
+  TSNodeFlagHasChanges = 16,
+  TSNodeFlagHasChildren = 32,
+} TSNodeFlag;
+
+typedef struct {
+  uint32_t capacity;
+  TSSymbol *symbols;
+  TSFieldId *field_ids;
+  uint32_t *start_bytes;
+  uint32_t *end_bytes;
+  TSPoint *start_points;
+  TSPoint *end_points;
+  uint32_t *parent_indices;
+  uint8_t *flags;
+} TSNodeArray;
+
 typedef struct {
   TSNode node;
   uint32_t index;
@@ -192,6 +292,31 @@ bool ts_parser_set_included_ranges(
   uint32_t length
 );
 
+/**
+ * Replace some of the ranges of text that the parser should include when
+ * parsing, leaving the others as they are.
+ *
+ * The `old_count` ranges starting at `start_index` in the parser's current
+ * ranges are replaced with the `count` given ranges. Only the new ranges are
+ * copied and validated, so this is much faster than calling
+ * `ts_parser_set_included_ranges` with the entire set when a document has
+ * many ranges and only a few of them have changed. The new ranges must be
+ * ordered and must not overlap with each other or with the ranges before and
+ * after them.
+ *
+ * If the replaced ranges are not within the current ranges, or the new ranges
+ * are not valid, the operation will fail, the ranges will not be changed, and
+ * this function will return `false`. On success, this function returns `true`.
+ * If this removes every range, then the entire document will be parsed.
+ */
+bool ts_parser_update_included_ranges(
+  TSParser *self,
+  uint32_t start_index,
+  uint32_t old_count,
+  const TSRange *ranges,
+  uint32_t count
+);
+
 /**
  * Get the ranges of text that the parser will include when parsing.
  *
@@ -226,7 +351,10 @@ const TSRange *ts_parser_included_ranges(
  * 2. `payload`: An arbitrary pointer that will be passed to each invocation
  *    of the `read` function.
  * 3. `encoding`: An indication of how the text is encoded. Either
- *    `TSInputEncodingUTF8` or `TSInputEncodingUTF16`.
+ *    `TSInputEncodingUTF8`, `TSInputEncodingUTF16`, or `TSInputEncodingLatin1`.
+ *    With `TSInputEncodingLatin1`, each byte is read as the code point with
+ *    the same value, so any sequence of bytes can be parsed without decoding
+ *    errors.
  *
  * This function returns a syntax tree on success, and `NULL` on failure. There
  * are three possible reasons for failure:
@@ -238,9 +366,10 @@ const TSRange *ts_parser_included_ranges(
  *    same arguments. Or you can start parsing from scratch by first calling
  *    `ts_parser_reset`.
  * 3. Parsing was cancelled using a cancellation flag that was set by an
- *    earlier call to `ts_parser_set_cancellation_flag`. You can resume parsing
- *    from where the parser left out by calling `ts_parser_parse` again with
- *    the same arguments.
+ *    earlier call to `ts_parser_set_cancellation_flag`, or by a progress
+ *    callback that returned `true`. You can resume parsing from where the
+ *    parser left out by calling `ts_parser_parse` again with the same
+ *    arguments.
  */
 TSTree *ts_parser_parse(
   TSParser *self,
@@ -253,6 +382,9 @@ TSTree *ts_parser_parse(
  * The first two parameters are the same as in the `ts_parser_parse` function
  * above. The second two parameters indicate the location of the buffer and its
  * length in bytes.
+ *
+ * The buffer is read directly, without calling an input callback, so this is
+ * the fastest way to parse a document that is already in memory.
  */
 TSTree *ts_parser_parse_string(
   TSParser *self,
@@ -300,6 +432,216 @@ void ts_parser_set_timeout_micros(TSParser *self, uint64_t timeout);
  */
 uint64_t ts_parser_timeout_micros(const TSParser *self);
 
+/**
+ * Set the maximum number of bytes of syntax nodes that a single parse is
+ * allowed to allocate before halting. The default of zero means no limit.
+ *
+ * The limit is checked as often as the timeout, and applies to the nodes
+ * created since the parse began, including those that were later discarded,
+ * so it bounds the parse's work as well as its memory. Nodes reused from the
+ * old tree are not counted. If the limit is exceeded, then parsing halts and
+ * returns NULL. Unlike a timeout, the partial parse is not kept for resuming:
+ * its memory is released immediately, as if `ts_parser_reset` had been called.
+ */
+void ts_parser_set_memory_limit(TSParser *self, size_t limit);
+
+/**
+ * Get the maximum number of bytes of syntax nodes that a parse may allocate.
+ */
+size_t ts_parser_memory_limit(const TSParser *self);
+
+/**
+ * Set the number of error recovery operations that a single parse may perform
+ * before it switches to a cheaper way of recovering. The default of zero means
+ * no limit.
+ *
+ * Each time the parser encounters an invalid token, or skips a token while
+ * recovering from an error, counts as one operation. Ordinarily, the parser
+ * explores several alternative ways of recovering from each error, which can
+ * take a long time on large inputs with many errors, such as minified or
+ * binary data. Once the budget is used up, the parser only keeps the most
+ * promising interpretation of the input, and skips tokens until one of them
+ * is valid in a state that it was in before the error, so the rest of the
+ * parse takes time proportional to the length of the input. The resulting
+ * tree is still complete, but it may contain larger ERROR nodes.
+ */
+void ts_parser_set_error_recovery_budget(TSParser *self, uint32_t budget);
+
+/**
+ * Get the number of error recovery operations that a single parse may perform
+ * before it switches to a cheaper way of recovering.
+ */
+uint32_t ts_parser_error_recovery_budget(const TSParser *self);
+
+/**
+ * Get counters describing the work that the parser has done.
+ *
+ * The counters are accumulated over every parse performed with this parser,
+ * and are cheap enough to be maintained at all times:
+ * - `parse_table_cache_hits`, `parse_table_cache_misses` - The number of
+ *   parse table lookups for compressed ("small") parse states that were
+ *   answered by the parser's lookup cache, or that required searching
+ *   the parse table.
+ * - `stack_node_count` - The number of parse stack nodes that were created.
+ * - `stack_node_slab_count` - The number of memory blocks that were allocated
+ *   to hold parse stack nodes. Nodes are recycled between parses, so this
+ *   stops growing once the parser has seen its peak stack usage.
+ * - `max_stack_version_count` - The largest number of simultaneous versions
+ *   of the parse stack, which grows when the grammar's conflicts cause the
+ *   parser to explore several interpretations of the input at once.
+ * - `advance_count` - The number of times that a version of the parse stack
+ *   processed a lookahead token or node. Unlike the timing counters, this is
+ *   deterministic, so the ratio of this count to the input size can be used
+ *   to detect inputs that are disproportionately expensive to parse.
+ * - `token_count` - The number of tokens produced by the lexer.
+ * - `relex_count` - The number of times that a node reused from an old tree
+ *   turned out to be invalid and was broken down, so that the text after it
+ *   had to be lexed again.
+ * - `cached_token_hits` - The number of times that a token lexed for one
+ *   stack version was reused by another version, instead of lexing again.
+ * - `reused_node_count`, `rebuilt_node_count` - The number of nodes reused
+ *   from the old tree during incremental parsing, and the number of nodes
+ *   built by reductions. A high proportion of rebuilt nodes after small
+ *   edits indicates a grammar that does not parse incrementally well.
+ * - `shared_node_count` - The number of newly-built nodes that were replaced
+ *   by identical nodes from earlier trees. See
+ *   `ts_parser_set_node_sharing_capacity`.
+ * - `error_recovery_count` - The number of times that the parser had to
+ *   begin recovering from a syntax error.
+ * - `subtree_allocation_count` - The number of syntax nodes that required
+ *   memory to be allocated.
+ * - `parse_time_micros`, `balance_time_micros` - The time spent lexing and
+ *   parsing, and the time spent rebalancing the finished trees.
+ */
+void ts_parser_stats(const TSParser *self, TSParserStats *stats);
+
+/**
+ * Set whether the parser should allocate syntax nodes from an arena.
+ *
+ * When enabled, each call to `ts_parser_parse` carves the nodes that it
+ * creates out of a small number of large memory blocks, which are owned by
+ * the resulting tree and are freed all at once when the tree (and every tree
+ * that shares nodes with it) has been deleted. This greatly reduces the
+ * number of allocations needed to build and to delete large trees.
+ *
+ * Arenas are only used when parsing without an old tree. When re-parsing a
+ * document after edits, the nodes that are reused from the old tree keep its
+ * arenas alive, so the new nodes are allocated individually instead. This
+ * way, a tree never keeps alive more arenas than the last tree that was
+ * parsed from scratch. Because nodes are never freed individually, memory
+ * belonging to discarded nodes is only reclaimed with the whole arena, so you
+ * may want to occasionally parse from scratch.
+ */
+void ts_parser_set_arena_allocation(TSParser *self, bool enabled);
+
+/**
+ * Get whether the parser allocates syntax nodes from an arena.
+ */
+bool ts_parser_arena_allocation(const TSParser *self);
+
+/**
+ * Set whether the parser should skip balancing the trees that it produces.
+ *
+ * After parsing, the parser normally rebalances the hidden nodes that hold
+ * long sequences of repeated elements, such as the statements of a long file,
+ * so that later edits and incremental parses take logarithmic rather than
+ * linear time. With deferred balancing, trees are returned sooner, and can be
+ * balanced later by calling `ts_tree_balance`, for example on a background
+ * thread. A tree that is never balanced is still correct, but it makes later
+ * incremental parses slower.
+ */
+void ts_parser_set_deferred_balancing(TSParser *self, bool enabled);
+
+/**
+ * Get whether the parser skips balancing the trees that it produces.
+ */
+bool ts_parser_deferred_balancing(const TSParser *self);
+
+/**
+ * Set the number of nodes that the parser retains so that identical subtrees
+ * can be shared between the trees that it produces.
+ *
+ * When many similar documents are parsed with the same parser, such as the
+ * revisions of a file, or vendored copies of the same code, large parts of
+ * their trees are identical. With node sharing, each newly-built node is
+ * looked up by its contents and the identities of its children, and is
+ * replaced by an identical node from an earlier tree if one is found. Shared
+ * nodes are reference counted like any other, so this reduces the memory used
+ * by the trees, and lets `ts_tree_get_changed_ranges` skip over the shared
+ * subtrees without comparing them.
+ *
+ * The retained nodes are kept alive by the parser until they are evicted to
+ * make room for newer ones, or until the parser's language is changed. The
+ * capacity is rounded up to a power of two. The default is zero, which
+ * disables node sharing. Nodes are only shared when parsing from scratch,
+ * without an old tree, and not when arena allocation or deferred balancing is
+ * enabled.
+ */
+void ts_parser_set_node_sharing_capacity(TSParser *self, uint32_t capacity);
+
+/**
+ * Get the number of nodes that the parser retains for node sharing.
+ */
+uint32_t ts_parser_node_sharing_capacity(const TSParser *self);
+
+/**
+ * Set a callback that receives the top-level nodes of the document as soon as
+ * they are finished, so that very large inputs can be processed without
+ * keeping the entire syntax tree in memory.
+ *
+ * This works for languages whose root node is a sequence of repeated items,
+ * such as log files, CSV files, or JSON lines. Whenever the parser has only
+ * one interpretation of the input, and a group of the root node's children can
+ * no longer change, it calls the callback's `node_finished` function with each
+ * of them in order, and then frees them. The nodes are only valid during the
+ * call, and the callback must not use the parser.
+ *
+ * The tree that is eventually returned only contains the root node's children
+ * that were not passed to the callback. The other children are replaced by
+ * hidden placeholders, so that the positions of the remaining nodes stay the
+ * same. An error that is found later can cause the placeholders to be part of
+ * an ERROR node.
+ */
+void ts_parser_set_streaming_callback(TSParser *self, TSStreamingCallback callback);
+
+/**
+ * Get the parser's current streaming callback.
+ */
+TSStreamingCallback ts_parser_streaming_callback(const TSParser *self);
+
+/**
+ * Set a callback that the parser calls periodically during parsing, in order
+ * to report its progress.
+ *
+ * The callback's `progress` function receives the byte offset that the parser
+ * has reached, and the number of alternative interpretations of the input that
+ * it is currently considering. If the function returns `true`, then the parser
+ * halts early, returning NULL, as it does when a timeout expires. It can then
+ * be resumed by calling `ts_parser_parse` again, so that a long parse can be
+ * split into small slices that are interleaved with other work. During the
+ * call, the only parser function that may be used is
+ * `ts_parser_provisional_tree`.
+ */
+void ts_parser_set_progress_callback(TSParser *self, TSProgressCallback callback);
+
+/**
+ * Get the parser's current progress callback.
+ */
+TSProgressCallback ts_parser_progress_callback(const TSParser *self);
+
+/**
+ * Get a provisional syntax tree for the part of the document that has been
+ * parsed so far, while a parse is halted or from within the progress callback.
+ *
+ * The tree's root node spans from the start of the document to the position
+ * that the parser has reached. Its children are the nodes that the parser has
+ * finished, along with the tokens that it has not yet grouped into larger
+ * nodes. The nodes near the end of the tree may therefore differ from the ones
+ * in the final tree. This function returns NULL if no parse is in progress.
+ * The caller is responsible for deleting the tree.
+ */
+TSTree *ts_parser_provisional_tree(TSParser *self);
+
 /**
  * Set the parser's current cancellation flag pointer.
  *
@@ -336,6 +678,48 @@ TSLogger ts_parser_logger(const TSParser *self);
  */
 void ts_parser_print_dot_graphs(TSParser *self, int file);
 
+/*************************/
+/* Section - Parser Pool */
+/*************************/
+
+/**
+ * Create a pool of parsers for the given language, which can be shared
+ * between threads.
+ *
+ * Acquiring a parser from the pool avoids the cost of creating a new parser
+ * and assigning it a language for every parse. The pool keeps up to `capacity`
+ * idle parsers. Returns `NULL` if the language can't be assigned to a parser,
+ * for the same reasons as `ts_parser_set_language`.
+ */
+TSParserPool *ts_parser_pool_new(const TSLanguage *language, uint32_t capacity);
+
+/**
+ * Delete the pool, along with all of its idle parsers. Any parsers that are
+ * still acquired from the pool must be deleted with `ts_parser_delete`.
+ */
+void ts_parser_pool_delete(TSParserPool *);
+
+/**
+ * Get the language of the pool's parsers.
+ */
+const TSLanguage *ts_parser_pool_language(const TSParserPool *);
+
+/**
+ * Take an idle parser from the pool, or create a new one if there are none.
+ *
+ * The parser is configured with the pool's language, and otherwise has the
+ * default configuration. This function is lock-free.
+ */
+TSParser *ts_parser_pool_acquire(TSParserPool *);
+
+/**
+ * Give a parser back to the pool, once you are done using it.
+ *
+ * The parser is reset, and its configuration is restored to the defaults. If
+ * the pool is already full, the parser is deleted. This function is lock-free.
+ */
+void ts_parser_pool_release(TSParserPool *, TSParser *);
+
 /******************/
 /* Section - Tree */
 /******************/
@@ -348,11 +732,72 @@ void ts_parser_print_dot_graphs(TSParser *self, int file);
  */
 TSTree *ts_tree_copy(const TSTree *self);
 
+/**
+ * Create a frozen snapshot of a syntax tree, which can be shared by many
+ * threads without them contending over its memory.
+ *
+ * Ordinarily, copying a tree and reusing its nodes during an incremental parse
+ * both atomically update the reference counts of its nodes. The nodes of a
+ * frozen tree are never reference-counted individually. Instead, they stay
+ * alive until the snapshot and every tree derived from it have been deleted.
+ * Each thread should use `ts_tree_copy` to get its own copy of the snapshot
+ * to edit and reparse.
+ */
+TSTree *ts_tree_freeze(const TSTree *self);
+
+/**
+ * Create a compacted, frozen copy of a syntax tree, for trees that are kept
+ * for a long time and only read.
+ *
+ * Like `ts_tree_freeze`, the result can be shared by many threads, and its
+ * nodes are not reference-counted individually. In addition, all of its nodes
+ * are stored in one block of memory, in the order in which a depth-first
+ * traversal visits them, and identical leaves that could not be stored inline
+ * are only stored once. The copy does not share any memory with the original,
+ * so the original can be deleted afterwards. Compacting takes time and
+ * temporary memory proportional to the size of the tree.
+ */
+TSTree *ts_tree_compact(const TSTree *self);
+
+/**
+ * Balance a syntax tree that was produced by a parser with deferred balancing.
+ * This does nothing if the tree is already balanced.
+ *
+ * Balancing rearranges the tree's hidden nodes in place, so it invalidates any
+ * nodes and tree cursors obtained from the tree, and the tree must not be used
+ * by any other thread during the call. A tree can't be balanced while it
+ * shares its nodes with a copy of itself, or if it was created by
+ * `ts_tree_freeze` or `ts_tree_compact`. In that case, this function returns
+ * `false`. Otherwise, it returns `true`.
+ */
+bool ts_tree_balance(TSTree *self);
+
 /**
  * Delete the syntax tree, freeing all of the memory that it used.
  */
 void ts_tree_delete(TSTree *self);
 
+/**
+ * Measure the memory used by the syntax tree:
+ * - `unique_subtree_bytes` - The bytes used by syntax nodes that belong only
+ *   to this tree.
+ * - `shared_subtree_bytes` - The bytes used by syntax nodes that this tree
+ *   shares with other trees, such as the old tree that it was parsed from, or
+ *   its copies. These are only freed when every tree using them is deleted.
+ *   Nodes of frozen trees are always counted as shared. A node that appears
+ *   in several places, such as a leaf deduplicated by node sharing, is only
+ *   counted once.
+ * - `external_scanner_state_bytes` - The bytes used by serialized external
+ *   scanner states that were too large to be stored within their nodes.
+ * - `cache_bytes` - The bytes used by the tree's lazily-built lookup caches.
+ * - `total_bytes` - All of the above, plus the tree itself and its included
+ *   ranges.
+ *
+ * This walks every node of the tree that is stored on the heap, so its cost is
+ * proportional to the size of the tree.
+ */
+void ts_tree_memory_usage(const TSTree *self, TSTreeMemoryUsage *usage);
+
 /**
  * Get the root node of the syntax tree.
  */
@@ -372,6 +817,17 @@ const TSLanguage *ts_tree_language(const TSTree *);
  */
 void ts_tree_edit(TSTree *self, const TSInputEdit *edit);
 
+/**
+ * Edit the syntax tree to reflect several edits to the source code at once.
+ *
+ * The edits may be given in any order, but they must not overlap, and each one
+ * must be described in terms of the source code *before* any of them were made.
+ * The result is the same as calling `ts_tree_edit` once for each edit, from the
+ * last one in the document to the first, but each affected node in the tree is
+ * only copied once.
+ */
+void ts_tree_edit_batch(TSTree *self, const TSInputEdit *edits, uint32_t edit_count);
+
 /**
  * Compare an old edited syntax tree to a new syntax tree representing the same
  * document, returning an array of ranges whose syntactic structure has changed.
@@ -397,6 +853,31 @@ TSRange *ts_tree_get_changed_ranges(
  */
 void ts_tree_print_dot_graph(const TSTree *, FILE *);
 
+/**
+ * Serialize the syntax tree into a compact binary snapshot, which can later
+ * be loaded with `ts_tree_deserialize`, for example to cache the results of
+ * parsing unchanged files between processes.
+ *
+ * The snapshot includes the tree's parse states and external scanner states,
+ * so a deserialized tree can be used as the `old_tree` for an incremental
+ * parse. It is only valid for the same language, and on machines with the
+ * same byte order.
+ *
+ * The returned buffer is allocated using `malloc` and the caller is
+ * responsible for freeing it using `free`. The length of the buffer will be
+ * written to the given `length` pointer.
+ */
+char *ts_tree_serialize(const TSTree *self, uint32_t *length);
+
+/**
+ * Load a syntax tree from a snapshot created by `ts_tree_serialize`.
+ *
+ * The data is not retained, so it can be read directly from a memory-mapped
+ * file that is unmapped afterward. Returns `NULL` if the data is malformed or
+ * was created with a different language.
+ */
+TSTree *ts_tree_deserialize(const char *data, uint32_t length, const TSLanguage *language);
+
 /******************/
 /* Section - Node */
 /******************/
@@ -511,6 +992,14 @@ TSNode ts_node_named_child(TSNode, uint32_t);
  */
 uint32_t ts_node_named_child_count(TSNode);
 
+/**
+ * Get the number of nodes in the subtree rooted at this node, including the
+ * node itself. This does not require walking the subtree.
+ *
+ * See also `ts_tree_cursor_goto_descendant`.
+ */
+uint32_t ts_node_descendant_count(TSNode);
+
 /**
  * Get the node's child with the given field name.
  */
@@ -575,6 +1064,20 @@ TSNode ts_node_named_descendant_for_point_range(TSNode, TSPoint, TSPoint);
  */
 void ts_node_edit(TSNode *, const TSInputEdit *);
 
+/**
+ * Edit several nodes to keep them in sync with several edits to the source code.
+ *
+ * The edits are described in the same way as for `ts_tree_edit_batch`. The
+ * result is the same as calling `ts_node_edit` on every node for each edit,
+ * from the last one in the document to the first.
+ */
+void ts_node_edit_batch(
+  TSNode *nodes,
+  uint32_t node_count,
+  const TSInputEdit *edits,
+  uint32_t edit_count
+);
+
 /**
  * Check if two nodes are identical.
  */
@@ -603,6 +1106,14 @@ void ts_tree_cursor_delete(TSTreeCursor *);
  */
 void ts_tree_cursor_reset(TSTreeCursor *, TSNode);
 
+/**
+ * Re-initialize a tree cursor to the same position as another cursor.
+ *
+ * Unlike `ts_tree_cursor_reset`, this will not lose parent information and
+ * allows reusing already created cursors.
+ */
+void ts_tree_cursor_reset_to(TSTreeCursor *dst, const TSTreeCursor *src);
+
 /**
  * Get the tree cursor's current node.
  */
@@ -658,8 +1169,57 @@ bool ts_tree_cursor_goto_first_child(TSTreeCursor *);
 int64_t ts_tree_cursor_goto_first_child_for_byte(TSTreeCursor *, uint32_t);
 int64_t ts_tree_cursor_goto_first_child_for_point(TSTreeCursor *, TSPoint);
 
+/**
+ * Move the cursor to the node that is the nth descendant of the original node
+ * that the cursor was constructed with, where zero represents the original
+ * node itself, and descendants are numbered in the order that a preorder
+ * traversal would visit them.
+ *
+ * This only walks the ancestors of the current node and of the goal node, so
+ * it is much faster than walking the tree to the goal node. If the index is
+ * out of range, the cursor does not move.
+ */
+void ts_tree_cursor_goto_descendant(TSTreeCursor *, uint32_t);
+
+/**
+ * Get the index of the cursor's current node out of all of the descendants
+ * of the original node that the cursor was constructed with.
+ */
+uint32_t ts_tree_cursor_current_descendant_index(const TSTreeCursor *);
+
 TSTreeCursor ts_tree_cursor_copy(const TSTreeCursor *);
 
+/**
+ * Create a new node exporter, which copies the nodes of the subtree rooted at
+ * the given node into flat arrays, in the same order that a tree cursor would
+ * visit them.
+ *
+ * If `named_only` is true, anonymous nodes are skipped, but their descendants
+ * are still exported. Nodes that are more than `max_depth` levels below the
+ * given node are skipped entirely. Pass `UINT32_MAX` to export the whole
+ * subtree.
+ */
+TSNodeExporter *ts_node_exporter_new(TSNode, bool named_only, uint32_t max_depth);
+
+/**
+ * Delete a node exporter, freeing all of the memory that it used.
+ */
+void ts_node_exporter_delete(TSNodeExporter *);
+
+/**
+ * Export the next batch of nodes into the given arrays.
+ *
+ * Up to `capacity` nodes are written to the arrays in the given `TSNodeArray`.
+ * Any of the array pointers may be `NULL` if that column is not needed. Each
+ * node's parent index refers to the position of its nearest exported ancestor
+ * across all of the batches, or is `UINT32_MAX` for the first node. The flags
+ * are a combination of `TSNodeFlag` values.
+ *
+ * This returns the number of nodes that were written. A return value of zero
+ * means that the whole subtree has been exported.
+ */
+uint32_t ts_node_exporter_next(TSNodeExporter *, TSNodeArray *);
+
 /*******************/
 /* Section - Query */
 /*******************/
@@ -688,6 +1248,49 @@ TSQuery *ts_query_new(
  */
 void ts_query_delete(TSQuery *);
 
+/**
+ * Combine several queries for the same language into one new query, so that
+ * all of their patterns can be matched in a single traversal of a tree.
+ *
+ * The combined query contains the patterns of each of the given queries, in
+ * order, and its captures with equal names are merged. The original queries
+ * are not modified. Use `ts_query_source_query_for_pattern` to find which of
+ * the queries a pattern came from. Returns `NULL` if the queries belong to
+ * different languages, or if they are too large to combine.
+ */
+TSQuery *ts_query_combine(const TSQuery *const *queries, uint32_t count);
+
+/**
+ * Serialize a compiled query, including the results of analyzing its
+ * patterns, into a binary format that can be loaded with
+ * `ts_query_deserialize` much more quickly than the query's source can be
+ * compiled, for example to cache the query on disk.
+ *
+ * The data is only valid for the same language, and for the same build of
+ * the Tree-sitter library. The returned buffer is allocated using `malloc`
+ * and the caller is responsible for freeing it using `free`. The length of
+ * the buffer will be written to the given `length` pointer.
+ */
+char *ts_query_serialize(const TSQuery *self, uint32_t *length);
+
+/**
+ * Load a query from data created by `ts_query_serialize`.
+ *
+ * The source from which the query was compiled must also be given. For a
+ * query created with `ts_query_combine`, this is the concatenation of the
+ * sources of the combined queries, in order. Returns `NULL` if the data is
+ * malformed, or if it was created from a different source, a different
+ * language, or a different build of the library, in which case the query
+ * should be compiled with `ts_query_new` instead.
+ */
+TSQuery *ts_query_deserialize(
+  const char *data,
+  uint32_t length,
+  const TSLanguage *language,
+  const char *source,
+  uint32_t source_len
+);
+
 /**
  * Get the number of patterns, captures, or string literals in the query.
  */
@@ -703,6 +1306,13 @@ uint32_t ts_query_string_count(const TSQuery *);
  */
 uint32_t ts_query_start_byte_for_pattern(const TSQuery *, uint32_t);
 
+/**
+ * Get the index of the query that the given pattern came from, if the query
+ * was created with `ts_query_combine`. The pattern's start byte is relative
+ * to the source of that query. For other queries, this returns zero.
+ */
+uint32_t ts_query_source_query_for_pattern(const TSQuery *, uint32_t);
+
 /**
  * Get all of the predicates for the given pattern in the query.
  *
@@ -812,6 +1422,80 @@ bool ts_query_cursor_did_exceed_match_limit(const TSQueryCursor *);
 uint32_t ts_query_cursor_match_limit(const TSQueryCursor *);
 void ts_query_cursor_set_match_limit(TSQueryCursor *, uint32_t);
 
+/**
+ * Set whether the query cursor should stream its captures.
+ *
+ * When iterating over captures with `ts_query_cursor_next_capture`, a
+ * finished match is normally held back until none of the unfinished matches
+ * could still produce an earlier capture. With a match limit, this buffering
+ * can exhaust the cursor's capture lists, and unfinished matches are then
+ * dropped to make room. In streaming mode, the cursor instead returns the
+ * earliest *finished* capture before it is known to be the earliest overall,
+ * so that its capture list can be reused. Together with a match limit, this
+ * bounds the cursor's memory usage on large inputs, at the cost of captures
+ * occasionally being returned out of order. Matches can still be dropped if
+ * the limit is exceeded by unfinished matches alone.
+ */
+bool ts_query_cursor_streaming(const TSQueryCursor *);
+void ts_query_cursor_set_streaming(TSQueryCursor *, bool);
+
+/**
+ * Provide the source code of the tree that the query cursor is executing on,
+ * so that the cursor can evaluate text predicates itself.
+ *
+ * With the text available, the cursor discards in-progress matches as soon as
+ * their captures fail an `#eq?` or `#not-eq?` predicate, or a `#match?` or
+ * `#not-match?` predicate whose regex is a literal string, optionally anchored
+ * with `^` or `$`. Other predicates are still left to the caller. The text
+ * must remain valid for as long as the cursor is executing on the tree. Pass
+ * `NULL` to stop evaluating text predicates.
+ */
+void ts_query_cursor_set_text(TSQueryCursor *, const char *text, uint32_t length);
+
+/**
+ * Manage the memory that the query cursor keeps between executions.
+ *
+ * A query cursor reuses its buffers of in-progress matches and capture lists
+ * each time it is executed, so a single cursor that is executed many times
+ * only allocates while it grows. `ts_query_cursor_reserve` allocates room for
+ * the given numbers of in-progress matches and capture lists up front.
+ * `ts_query_cursor_set_retained_capacity` limits how much of that memory is
+ * kept: when the cursor is next executed, any capacity beyond these counts
+ * is freed, so that one unusually large execution doesn't keep its memory
+ * alive for the rest of the cursor's lifetime. By default, all memory is
+ * retained.
+ */
+void ts_query_cursor_reserve(TSQueryCursor *, uint32_t state_count, uint32_t capture_list_count);
+void ts_query_cursor_set_retained_capacity(
+  TSQueryCursor *,
+  uint32_t state_count,
+  uint32_t capture_list_count
+);
+
+/**
+ * Get counters describing the resources that the query cursor has used
+ * during its current execution. The counters are reset by
+ * `ts_query_cursor_exec`:
+ * - `peak_state_count` - The largest number of simultaneously in-progress
+ *   matches.
+ * - `peak_finished_state_count` - The largest number of finished matches that
+ *   were waiting to be returned.
+ * - `peak_capture_list_count` - The largest number of capture lists in use.
+ * - `abandoned_match_count` - The number of matches that were dropped because
+ *   the match limit was exceeded.
+ * - `out_of_order_capture_count` - The number of captures that were returned
+ *   early in streaming mode.
+ * - `rejected_match_count` - The number of in-progress matches that were
+ *   discarded because their captures did not satisfy a text predicate.
+ * - `visited_node_count` - The number of nodes that the cursor entered. Nodes
+ *   that end before the cursor's range are skipped without being entered
+ *   when no matches are in progress.
+ * - `step_count` - The number of times that an in-progress match was compared
+ *   against a node. Together with `visited_node_count`, this measures the work
+ *   done by the cursor independently of the speed of the machine.
+ */
+void ts_query_cursor_stats(const TSQueryCursor *, TSQueryCursorStats *stats);
+
 /**
  * Set the range of bytes or (row, column) positions in which the query
  * will be executed.
@@ -923,6 +1607,35 @@ void ts_set_allocator(
 	void (*new_free)(void *)
 );
 
+/**
+ * Enable or disable tracking of the library's allocations by category.
+ *
+ * While tracking is enabled, the memory used by subtrees, parse stack nodes,
+ * lexer included ranges, query cursor states and capture lists, tree cursor
+ * stacks and external scanner states is attributed to the corresponding
+ * `TSAllocationCategory`. The live bytes of each category can be read with
+ * `ts_allocation_live_bytes`.
+ *
+ * If `hooks` is not `NULL`, its callbacks are also invoked, on whichever
+ * thread is allocating, each time memory is attributed to a category or
+ * released from it, with the affected buffer and its size. This can be used
+ * to build a sampling allocation profiler. The memory itself still comes from
+ * the functions given to `ts_set_allocator`.
+ *
+ * Tracking can only be enabled or disabled while the library holds no memory
+ * in any category, for example before any parsers, trees or query cursors are
+ * created, or after they have all been deleted. Otherwise, tracking is left
+ * unchanged and `false` is returned. The hooks of an enabled tracker can be
+ * replaced at any time.
+ */
+bool ts_set_allocation_tracking(bool enabled, const TSAllocationHooks *hooks);
+
+/**
+ * Get the number of bytes currently attributed to the given allocation
+ * category. See `ts_set_allocation_tracking`.
+ */
+size_t ts_allocation_live_bytes(TSAllocationCategory category);
+
 #ifdef __cplusplus
 }
 #endif
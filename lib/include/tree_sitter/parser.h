@@ -38,6 +38,31 @@ typedef struct {
   bool supertype;
 } TSSymbolMetadata;
 
+typedef struct {
+  TSSymbol accept_symbol;
+  bool accepts_token;
+  uint16_t eof_transition;
+  uint16_t transition_row;
+  uint16_t ascii_set;
+} TSLexTableState;
+
+typedef struct {
+  int32_t start;
+  uint16_t character_class;
+} TSLexTableRange;
+
+typedef struct {
+  const TSLexTableState *states;
+  const uint16_t *ascii_character_classes;
+  const TSLexTableRange *character_ranges;
+  const uint16_t *transitions;
+  const uint32_t (*ascii_sets)[4];
+  uint32_t state_count;
+  uint32_t character_range_count;
+  uint16_t character_class_count;
+  uint16_t invalid_character_class;
+} TSLexTable;
+
 typedef struct TSLexer TSLexer;
 
 struct TSLexer {
@@ -48,6 +73,10 @@ struct TSLexer {
   uint32_t (*get_column)(TSLexer *);
   bool (*is_at_included_range_start)(const TSLexer *);
   bool (*eof)(const TSLexer *);
+
+  // Only provided to languages with ABI version 14 or later.
+  void (*advance_while)(TSLexer *, const uint32_t *, bool);
+  bool (*run_lex_table)(TSLexer *, const TSLexTable *, TSStateId);
 };
 
 typedef enum {
@@ -154,6 +183,20 @@ struct TSLanguage {
     goto next_state;      \
   }
 
+#define ADVANCE_WHILE(state_value, character_set)      \
+  {                                                    \
+    state = state_value;                               \
+    lexer->advance_while(lexer, character_set, false); \
+    goto start;                                        \
+  }
+
+#define SKIP_WHILE(state_value, character_set)        \
+  {                                                   \
+    state = state_value;                              \
+    lexer->advance_while(lexer, character_set, true); \
+    goto start;                                       \
+  }
+
 #define ACCEPT_TOKEN(symbol_value)     \
   result = true;                       \
   lexer->result_symbol = symbol_value; \
@@ -161,6 +204,16 @@ struct TSLanguage {
 
 #define END_STATE() return result;
 
+/*
+ *  Lex Table Macros
+ */
+
+#define LEX_TABLE_SKIP 0x8000
+
+#define LEX_ADVANCE(state_value) ((state_value) + 1)
+
+#define LEX_SKIP(state_value) (((state_value) + 1) | LEX_TABLE_SKIP)
+
 /*
  *  Parse Table Macros
  */
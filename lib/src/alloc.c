@@ -1,4 +1,5 @@
 #include "alloc.h"
+#include "atomic.h"
 #include <stdlib.h>
 
 static void *ts_malloc_default(size_t size) {
@@ -46,3 +47,58 @@ void ts_set_allocator(
   ts_current_free = new_free ? new_free : free;
 }
 
+
+// Allocation tracking
+
+static bool ts_allocation_tracking_enabled = false;
+static TSAllocationHooks ts_allocation_hooks;
+static volatile size_t ts_allocation_live_byte_counts[TS_ALLOCATION_CATEGORY_COUNT];
+
+// The total size of the live buffers in all categories is maintained even
+// while tracking is disabled, so that tracking is only switched on or off while
+// no buffers are live. Otherwise, a buffer that was allocated while tracking was
+// disabled, but released while it was enabled, would make its category's count
+// wrap around.
+static volatile size_t ts_allocation_total_live_bytes;
+
+bool ts_set_allocation_tracking(bool enabled, const TSAllocationHooks *hooks) {
+  if (
+    enabled != ts_allocation_tracking_enabled &&
+    atomic_load(&ts_allocation_total_live_bytes) > 0
+  ) return false;
+
+  ts_allocation_tracking_enabled = false;
+  if (hooks) {
+    ts_allocation_hooks = *hooks;
+  } else {
+    ts_allocation_hooks = (TSAllocationHooks) {NULL, NULL, NULL};
+  }
+  ts_allocation_tracking_enabled = enabled;
+  return true;
+}
+
+size_t ts_allocation_live_bytes(TSAllocationCategory category) {
+  if ((unsigned)category >= TS_ALLOCATION_CATEGORY_COUNT) return 0;
+  return atomic_load(&ts_allocation_live_byte_counts[category]);
+}
+
+void ts_allocation__record(
+  TSAllocationCategory category,
+  const void *buffer,
+  size_t size,
+  bool is_free
+) {
+  atomic_add(&ts_allocation_total_live_bytes, is_free ? -size : size);
+  if (!ts_allocation_tracking_enabled) return;
+  if (is_free) {
+    atomic_add(&ts_allocation_live_byte_counts[category], -size);
+    if (ts_allocation_hooks.freed) {
+      ts_allocation_hooks.freed(ts_allocation_hooks.payload, category, buffer, size);
+    }
+  } else {
+    atomic_add(&ts_allocation_live_byte_counts[category], size);
+    if (ts_allocation_hooks.allocated) {
+      ts_allocation_hooks.allocated(ts_allocation_hooks.payload, category, buffer, size);
+    }
+  }
+}
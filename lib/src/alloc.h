@@ -30,6 +30,18 @@ extern void (*ts_current_free)(void *);
 #define ts_free    ts_current_free
 #endif
 
+void ts_allocation__record(TSAllocationCategory, const void *, size_t, bool);
+
+// Attribute memory to an allocation category, or release it from the category.
+// These must be called with the same size for a given buffer.
+static inline void ts_track_allocate(TSAllocationCategory category, const void *buffer, size_t size) {
+  if (size > 0) ts_allocation__record(category, buffer, size, false);
+}
+
+static inline void ts_track_free(TSAllocationCategory category, const void *buffer, size_t size) {
+  if (size > 0) ts_allocation__record(category, buffer, size, true);
+}
+
 #ifdef __cplusplus
 }
 #endif
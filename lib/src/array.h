@@ -40,6 +40,9 @@ extern "C" {
 // Free any memory allocated for this array.
 #define array_delete(self) array__delete((VoidArray *)self)
 
+#define array_shrink(self, new_capacity) \
+  array__shrink((VoidArray *)(self), array__elem_size(self), new_capacity)
+
 #define array_push(self, element)                            \
   (array__grow((VoidArray *)(self), 1, array__elem_size(self)), \
    (self)->contents[(self)->size++] = (element))
@@ -125,6 +128,30 @@ extern "C" {
     if (!exists) array_insert(self, index, value); \
   } while (0)
 
+// Variants of the operations that can allocate or free an array's memory,
+// which attribute that memory to the given `TSAllocationCategory`. An array
+// that is tracked must only be resized with these.
+#define array_reserve_tracked(self, category, new_capacity) \
+  array__reserve_tracked((VoidArray *)(self), array__elem_size(self), new_capacity, category)
+
+#define array_shrink_tracked(self, category, new_capacity) \
+  array__shrink_tracked((VoidArray *)(self), array__elem_size(self), new_capacity, category)
+
+#define array_delete_tracked(self, category) \
+  array__delete_tracked((VoidArray *)(self), array__elem_size(self), category)
+
+#define array_push_tracked(self, category, element)                                    \
+  (array__grow_tracked((VoidArray *)(self), 1, array__elem_size(self), category), \
+   (self)->contents[(self)->size++] = (element))
+
+#define array_push_all_tracked(self, category, other)                                            \
+  (array__grow_tracked((VoidArray *)(self), (other)->size, array__elem_size(self), category), \
+   array_push_all(self, other))
+
+#define array_insert_tracked(self, category, index, element)                           \
+  (array__grow_tracked((VoidArray *)(self), 1, array__elem_size(self), category), \
+   array_insert(self, index, element))
+
 // Private
 
 typedef Array(void) VoidArray;
@@ -158,6 +185,19 @@ static inline void array__reserve(VoidArray *self, size_t element_size, uint32_t
   }
 }
 
+static inline void array__shrink(VoidArray *self, size_t element_size, uint32_t new_capacity) {
+  if (new_capacity < self->size) new_capacity = self->size;
+  if (new_capacity < self->capacity) {
+    if (new_capacity == 0) {
+      ts_free(self->contents);
+      self->contents = NULL;
+    } else {
+      self->contents = ts_realloc(self->contents, new_capacity * element_size);
+    }
+    self->capacity = new_capacity;
+  }
+}
+
 static inline void array__assign(VoidArray *self, const VoidArray *other, size_t element_size) {
   array__reserve(self, element_size, other->size);
   self->size = other->size;
@@ -180,6 +220,43 @@ static inline void array__grow(VoidArray *self, size_t count, size_t element_siz
   }
 }
 
+static inline void array__reserve_tracked(VoidArray *self, size_t element_size,
+                                          uint32_t new_capacity, TSAllocationCategory category) {
+  if (new_capacity > self->capacity) {
+    ts_track_free(category, self->contents, self->capacity * element_size);
+    array__reserve(self, element_size, new_capacity);
+    ts_track_allocate(category, self->contents, self->capacity * element_size);
+  }
+}
+
+static inline void array__shrink_tracked(VoidArray *self, size_t element_size,
+                                         uint32_t new_capacity, TSAllocationCategory category) {
+  uint32_t old_capacity = self->capacity;
+  void *old_contents = self->contents;
+  array__shrink(self, element_size, new_capacity);
+  if (self->capacity != old_capacity) {
+    ts_track_free(category, old_contents, old_capacity * element_size);
+    ts_track_allocate(category, self->contents, self->capacity * element_size);
+  }
+}
+
+static inline void array__delete_tracked(VoidArray *self, size_t element_size,
+                                         TSAllocationCategory category) {
+  ts_track_free(category, self->contents, self->capacity * element_size);
+  array__delete(self);
+}
+
+static inline void array__grow_tracked(VoidArray *self, size_t count, size_t element_size,
+                                       TSAllocationCategory category) {
+  if (self->size + count > self->capacity) {
+    uint32_t old_capacity = self->capacity;
+    void *old_contents = self->contents;
+    array__grow(self, count, element_size);
+    ts_track_free(category, old_contents, old_capacity * element_size);
+    ts_track_allocate(category, self->contents, self->capacity * element_size);
+  }
+}
+
 static inline void array__splice(VoidArray *self, size_t element_size,
                                  uint32_t index, uint32_t old_count,
                                  uint32_t new_count, const void *elements) {
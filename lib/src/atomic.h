@@ -1,6 +1,7 @@
 #ifndef TREE_SITTER_ATOMIC_H_
 #define TREE_SITTER_ATOMIC_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __TINYC__
@@ -9,6 +10,15 @@ static inline size_t atomic_load(const volatile size_t *p) {
   return *p;
 }
 
+static inline void *atomic_load_ptr(void *volatile const *p) {
+  return *p;
+}
+
+static inline size_t atomic_add(volatile size_t *p, size_t count) {
+  *p += count;
+  return *p;
+}
+
 static inline uint32_t atomic_inc(volatile uint32_t *p) {
   *p += 1;
   return *p;
@@ -19,6 +29,12 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   return *p;
 }
 
+static inline bool atomic_compare_exchange_ptr(void *volatile *p, void *expected, void *desired) {
+  if (*p != expected) return false;
+  *p = desired;
+  return true;
+}
+
 #elif defined(_WIN32)
 
 #include <windows.h>
@@ -27,6 +43,18 @@ static inline size_t atomic_load(const volatile size_t *p) {
   return *p;
 }
 
+static inline void *atomic_load_ptr(void *volatile const *p) {
+  return *p;
+}
+
+static inline size_t atomic_add(volatile size_t *p, size_t count) {
+#ifdef _WIN64
+  return (size_t)InterlockedExchangeAdd64((LONG64 volatile *)p, (LONG64)count) + count;
+#else
+  return (size_t)InterlockedExchangeAdd((LONG volatile *)p, (LONG)count) + count;
+#endif
+}
+
 static inline uint32_t atomic_inc(volatile uint32_t *p) {
   return InterlockedIncrement((long volatile *)p);
 }
@@ -35,6 +63,10 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   return InterlockedDecrement((long volatile *)p);
 }
 
+static inline bool atomic_compare_exchange_ptr(void *volatile *p, void *expected, void *desired) {
+  return InterlockedCompareExchangePointer(p, desired, expected) == expected;
+}
+
 #else
 
 static inline size_t atomic_load(const volatile size_t *p) {
@@ -45,6 +77,18 @@ static inline size_t atomic_load(const volatile size_t *p) {
 #endif
 }
 
+static inline void *atomic_load_ptr(void *volatile const *p) {
+#ifdef __ATOMIC_RELAXED
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+#else
+  return __sync_val_compare_and_swap((void *volatile *)p, NULL, NULL);
+#endif
+}
+
+static inline size_t atomic_add(volatile size_t *p, size_t count) {
+  return __sync_add_and_fetch(p, count);
+}
+
 static inline uint32_t atomic_inc(volatile uint32_t *p) {
   return __sync_add_and_fetch(p, 1u);
 }
@@ -53,6 +97,10 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   return __sync_sub_and_fetch(p, 1u);
 }
 
+static inline bool atomic_compare_exchange_ptr(void *volatile *p, void *expected, void *desired) {
+  return __sync_bool_compare_and_swap(p, expected, desired);
+}
+
 #endif
 
 #endif  // TREE_SITTER_ATOMIC_H_
@@ -48,6 +48,10 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self > other;
 }
 
+static inline TSDuration clock_duration(TSClock start, TSClock end) {
+  return end - start;
+}
+
 #elif defined(CLOCK_MONOTONIC) && !defined(__APPLE__)
 
 // POSIX with monotonic clock support (Linux)
@@ -95,6 +99,13 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self.tv_nsec > other.tv_nsec;
 }
 
+static inline TSDuration clock_duration(TSClock start, TSClock end) {
+  int64_t micros =
+    (int64_t)(end.tv_sec - start.tv_sec) * 1000000 +
+    (int64_t)(end.tv_nsec - start.tv_nsec) / 1000;
+  return micros > 0 ? (TSDuration)micros : 0;
+}
+
 #else
 
 // macOS or POSIX without monotonic clock support
@@ -136,6 +147,10 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self > other;
 }
 
+static inline TSDuration clock_duration(TSClock start, TSClock end) {
+  return end - start;
+}
+
 #endif
 
 #endif  // TREE_SITTER_CLOCK_H_
@@ -25,14 +25,18 @@ static void ts_range_array_add(TSRangeArray *self, Length start, Length end) {
 
 bool ts_range_array_intersects(const TSRangeArray *self, unsigned start_index,
                                uint32_t start_byte, uint32_t end_byte) {
-  for (unsigned i = start_index; i < self->size; i++) {
-    TSRange *range = &self->contents[i];
-    if (range->end_byte > start_byte) {
-      if (range->start_byte >= end_byte) break;
-      return true;
+  // The ranges are ordered and disjoint, so binary search for the first one
+  // that ends after the start byte.
+  unsigned start = start_index, end = self->size;
+  while (start < end) {
+    unsigned middle = start + (end - start) / 2;
+    if (self->contents[middle].end_byte > start_byte) {
+      end = middle;
+    } else {
+      start = middle + 1;
     }
   }
-  return false;
+  return start < self->size && self->contents[start].start_byte < end_byte;
 }
 
 void ts_range_array_get_changed_ranges(
@@ -104,7 +108,7 @@ typedef struct {
 
 static Iterator iterator_new(TreeCursor *cursor, const Subtree *tree, const TSLanguage *language) {
   array_clear(&cursor->stack);
-  array_push(&cursor->stack, ((TreeCursorEntry){
+  array_push_tracked(&cursor->stack, TSAllocationCategoryCursorStack, ((TreeCursorEntry){
     .subtree = tree,
     .position = length_zero(),
     .child_index = 0,
@@ -210,7 +214,7 @@ static bool iterator_descend(Iterator *self, uint32_t goal_position) {
       Length child_right = length_add(child_left, ts_subtree_size(*child));
 
       if (child_right.bytes > goal_position) {
-        array_push(&self->cursor.stack, ((TreeCursorEntry){
+        array_push_tracked(&self->cursor.stack, TSAllocationCategoryCursorStack, ((TreeCursorEntry){
           .subtree = child,
           .position = position,
           .child_index = i,
@@ -262,7 +266,7 @@ static void iterator_advance(Iterator *self) {
       if (!ts_subtree_extra(*entry.subtree)) structural_child_index++;
       const Subtree *next_child = &ts_subtree_children(*parent)[child_index];
 
-      array_push(&self->cursor.stack, ((TreeCursorEntry){
+      array_push_tracked(&self->cursor.stack, TSAllocationCategoryCursorStack, ((TreeCursorEntry){
         .subtree = next_child,
         .position = position,
         .child_index = child_index,
@@ -283,10 +287,83 @@ static void iterator_advance(Iterator *self) {
   }
 }
 
+// Get the alias that the iterator's parent node applies to the entry at the
+// given depth of the iterator's stack.
+static TSSymbol iterator_alias_at(const Iterator *self, uint32_t index) {
+  TreeCursorEntry *entry = &self->cursor.stack.contents[index];
+  if (index == 0 || ts_subtree_extra(*entry->subtree)) return 0;
+  const Subtree *parent = self->cursor.stack.contents[index - 1].subtree;
+  return ts_language_alias_at(
+    self->language,
+    parent->ptr->production_id,
+    entry->structural_child_index
+  );
+}
+
+// Get the number of visible nodes in the iterator's stack that are strict
+// ancestors of the entry at the given depth.
+static unsigned iterator_visible_depth_at(const Iterator *self, uint32_t index) {
+  unsigned result = self->visible_depth;
+  for (uint32_t i = self->cursor.stack.size - 1; i >= index; i--) {
+    Subtree tree = *self->cursor.stack.contents[i].subtree;
+    if (ts_subtree_visible(tree) || iterator_alias_at(self, i)) result--;
+    if (i == 0) break;
+  }
+  return result;
+}
+
+// Find the outermost subtree that starts at the current position and that
+// is shared by both trees. The parser reuses subtrees from the old tree by
+// reference, and with node sharing enabled, it also replaces newly-built
+// subtrees with identical ones from earlier trees. Either way, a shared
+// subtree that starts at the same position and has the same visible ancestors
+// in both trees is identical in both trees.
+static bool iterator_find_shared_subtree(
+  const Iterator *old_iter,
+  const Iterator *new_iter,
+  uint32_t position,
+  uint32_t *old_index,
+  uint32_t *new_index
+) {
+  if (old_iter->in_padding || new_iter->in_padding) return false;
+
+  bool result = false;
+  for (uint32_t i = old_iter->cursor.stack.size - 1; i + 1 > 0; i--) {
+    TreeCursorEntry *old_entry = &old_iter->cursor.stack.contents[i];
+    Subtree old_tree = *old_entry->subtree;
+    if (old_entry->position.bytes + ts_subtree_padding(old_tree).bytes != position) break;
+    if (old_tree.data.is_inline) continue;
+
+    for (uint32_t j = new_iter->cursor.stack.size - 1; j + 1 > 0; j--) {
+      TreeCursorEntry *new_entry = &new_iter->cursor.stack.contents[j];
+      Subtree new_tree = *new_entry->subtree;
+      if (new_entry->position.bytes + ts_subtree_padding(new_tree).bytes != position) break;
+      if (
+        new_tree.ptr == old_tree.ptr &&
+        iterator_alias_at(old_iter, i) == iterator_alias_at(new_iter, j) &&
+        iterator_visible_depth_at(old_iter, i) == iterator_visible_depth_at(new_iter, j)
+      ) {
+        *old_index = i;
+        *new_index = j;
+        result = true;
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+// Move the iterator past the entire subtree at the given depth of its stack.
+static void iterator_skip_subtree(Iterator *self, uint32_t index) {
+  while (self->cursor.stack.size > index + 1) iterator_ascend(self);
+  iterator_advance(self);
+}
+
 typedef enum {
   IteratorDiffers,
   IteratorMayDiffer,
   IteratorMatches,
+  IteratorShared,
 } IteratorComparison;
 
 static IteratorComparison iterator_compare(const Iterator *old_iter, const Iterator *new_iter) {
@@ -370,8 +447,33 @@ unsigned ts_subtree_get_changed_ranges(const Subtree *old_tree, const Subtree *n
     puts("");
     #endif
 
+    // If both iterators are at the start of a subtree that is shared by both
+    // trees, then that entire subtree can be skipped at once,
+    // rather than comparing all of its descendants.
+    uint32_t old_shared_index, new_shared_index;
+    Length shared_end = length_zero();
+    bool is_shared = iterator_find_shared_subtree(
+      &old_iter,
+      &new_iter,
+      position.bytes,
+      &old_shared_index,
+      &new_shared_index
+    );
+    if (is_shared) {
+      TreeCursorEntry *entry = &old_iter.cursor.stack.contents[old_shared_index];
+      shared_end = length_add(entry->position, ts_subtree_total_size(*entry->subtree));
+      is_shared = !ts_range_array_intersects(
+        included_range_differences,
+        included_range_difference_index,
+        position.bytes,
+        shared_end.bytes
+      );
+    }
+
     // Compare the old and new subtrees.
-    IteratorComparison comparison = iterator_compare(&old_iter, &new_iter);
+    IteratorComparison comparison = is_shared
+      ? IteratorShared
+      : iterator_compare(&old_iter, &new_iter);
 
     // Even if the two subtrees appear to be identical, they could differ
     // internally if they contain a range of text that was previously
@@ -387,6 +489,14 @@ unsigned ts_subtree_get_changed_ranges(const Subtree *old_tree, const Subtree *n
 
     bool is_changed = false;
     switch (comparison) {
+      // If the subtrees are the same shared subtree, move past it in both
+      // trees.
+      case IteratorShared:
+        iterator_skip_subtree(&old_iter, old_shared_index);
+        iterator_skip_subtree(&new_iter, new_shared_index);
+        next_position = shared_end;
+        break;
+
       // If the subtrees are definitely identical, move to the end
       // of both subtrees.
       case IteratorMatches:
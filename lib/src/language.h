@@ -10,6 +10,9 @@ extern "C" {
 
 #define ts_builtin_sym_error_repeat (ts_builtin_sym_error - 1)
 
+#define LANGUAGE_VERSION_WITH_ADVANCE_WHILE 14
+#define LANGUAGE_VERSION_WITH_LEX_TABLES 14
+
 typedef struct {
   const TSParseAction *actions;
   uint32_t action_count;
@@ -18,6 +18,10 @@ static inline bool length_is_undefined(Length length) {
   return length.bytes == 0 && length.extent.column != 0;
 }
 
+static inline bool length_eq(Length len1, Length len2) {
+  return len1.bytes == len2.bytes && point_eq(len1.extent, len2.extent);
+}
+
 static inline Length length_min(Length len1, Length len2) {
   return (len1.bytes < len2.bytes) ? len1 : len2;
 }
@@ -1,9 +1,18 @@
 #include <stdio.h>
+#include "./language.h"
 #include "./lexer.h"
 #include "./subtree.h"
 #include "./length.h"
 #include "./unicode.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TS_LEXER_SIMD_SSSE3
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define TS_LEXER_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 #define LOG(message, character)              \
   if (self->logger.log) {                    \
     snprintf(                                \
@@ -53,8 +62,23 @@ static void ts_lexer__clear_chunk(Lexer *self) {
 }
 
 // Call the lexer's input callback to obtain a new chunk of source code
-// for the current position.
+// for the current position. When the whole document is stored in one
+// contiguous buffer, that buffer is used as the chunk instead.
 static void ts_lexer__get_chunk(Lexer *self) {
+  if (!self->input.read) {
+    if (self->current_position.bytes < self->buffer_size) {
+      self->chunk_start = 0;
+      self->chunk = self->buffer;
+      self->chunk_size = self->buffer_size;
+    } else {
+      self->current_included_range_index = self->included_range_count;
+      self->chunk_start = self->current_position.bytes;
+      self->chunk = NULL;
+      self->chunk_size = 0;
+    }
+    return;
+  }
+
   self->chunk_start = self->current_position.bytes;
   self->chunk = self->input.read(
     self->input.payload,
@@ -82,15 +106,40 @@ static void ts_lexer__get_lookahead(Lexer *self) {
   }
 
   const uint8_t *chunk = (const uint8_t *)self->chunk + position_in_chunk;
-  UnicodeDecodeFunction decode = self->input.encoding == TSInputEncodingUTF8
-    ? ts_decode_utf8
-    : ts_decode_utf16;
 
+  // Most characters are ASCII, or at least outside of the surrogate range in
+  // UTF16, so read them directly rather than calling the decode function.
+  switch (self->input.encoding) {
+    case TSInputEncodingUTF8:
+      if (chunk[0] < 0x80) {
+        self->data.lookahead = chunk[0];
+        self->lookahead_size = 1;
+        return;
+      }
+      break;
+    case TSInputEncodingUTF16:
+      if (size >= 2) {
+        uint16_t code_unit;
+        memcpy(&code_unit, chunk, sizeof(code_unit));
+        if ((code_unit & 0xf800) != 0xd800) {
+          self->data.lookahead = code_unit;
+          self->lookahead_size = 2;
+          return;
+        }
+      }
+      break;
+    case TSInputEncodingLatin1:
+      self->data.lookahead = chunk[0];
+      self->lookahead_size = 1;
+      return;
+  }
+
+  UnicodeDecodeFunction decode = self->decode;
   self->lookahead_size = decode(chunk, size, &self->data.lookahead);
 
   // If this chunk ended in the middle of a multi-byte character,
   // try again with a fresh chunk.
-  if (self->data.lookahead == TS_DECODE_ERROR && size < 4) {
+  if (self->data.lookahead == TS_DECODE_ERROR && size < 4 && self->input.read) {
     ts_lexer__get_chunk(self);
     chunk = (const uint8_t *)self->chunk;
     size = self->chunk_size;
@@ -102,28 +151,50 @@ static void ts_lexer__get_lookahead(Lexer *self) {
   }
 }
 
+// Find the index of the first included range that ends after the given byte,
+// or the number of included ranges if there is no such range.
+//
+// The lexer is usually repositioned within the range that it is already in, or
+// the one after it, so those are checked before doing a binary search.
+static uint32_t ts_lexer__find_included_range(const Lexer *self, uint32_t byte) {
+  const TSRange *ranges = self->included_ranges;
+  uint32_t count = self->included_range_count;
+  uint32_t hint = self->current_included_range_index;
+  for (uint32_t i = hint; i < count && i < hint + 2; i++) {
+    if (ranges[i].end_byte > byte) {
+      if (i == 0 || ranges[i - 1].end_byte <= byte) return i;
+      break;
+    }
+  }
+
+  uint32_t start = 0, end = count;
+  while (start < end) {
+    uint32_t middle = start + (end - start) / 2;
+    if (ranges[middle].end_byte > byte) {
+      end = middle;
+    } else {
+      start = middle + 1;
+    }
+  }
+  return start;
+}
+
 static void ts_lexer_goto(Lexer *self, Length position) {
   self->current_position = position;
-  bool found_included_range = false;
 
   // Move to the first valid position at or after the given position.
-  for (unsigned i = 0; i < self->included_range_count; i++) {
-    TSRange *included_range = &self->included_ranges[i];
-    if (included_range->end_byte > position.bytes) {
-      if (included_range->start_byte >= position.bytes) {
-        self->current_position = (Length) {
-          .bytes = included_range->start_byte,
-          .extent = included_range->start_point,
-        };
-      }
-
-      self->current_included_range_index = i;
-      found_included_range = true;
-      break;
+  uint32_t index = ts_lexer__find_included_range(self, position.bytes);
+  bool found_included_range = index < self->included_range_count;
+  if (found_included_range) {
+    TSRange *included_range = &self->included_ranges[index];
+    if (included_range->start_byte >= position.bytes) {
+      self->current_position = (Length) {
+        .bytes = included_range->start_byte,
+        .extent = included_range->start_point,
+      };
     }
-  }
+    self->current_included_range_index = index;
 
-  if (found_included_range) {
     // If the current position is outside of the current chunk of text,
     // then clear out the current chunk of text.
     if (self->chunk && (
@@ -205,6 +276,191 @@ static void ts_lexer__advance(TSLexer *_self, bool skip) {
   }
 }
 
+static inline bool ts_lexer__ascii_set_contains(const uint32_t *set, int32_t c) {
+  return c > 0 && c < 128 && ((set[c >> 5] >> (c & 31)) & 1);
+}
+
+#if defined(TS_LEXER_SIMD_SSSE3) || defined(TS_LEXER_SIMD_NEON)
+
+// Build the lookup tables for classifying bytes sixteen at a time. A byte
+// with high nibble `h` and low nibble `l` is in the set if bit `h` of
+// `low_table[l]` is set. Bytes outside of the ASCII range have a high
+// nibble of 8 or more, so they can never match.
+static void ts_lexer__ascii_set_tables(
+  const uint32_t *set,
+  uint8_t *low_table,
+  uint8_t *high_table
+) {
+  for (unsigned l = 0; l < 16; l++) {
+    uint8_t bits = 0;
+    for (unsigned h = 0; h < 8; h++) {
+      if (ts_lexer__ascii_set_contains(set, (h << 4) | l)) bits |= 1 << h;
+    }
+    low_table[l] = bits;
+    high_table[l] = l < 8 ? 1 << l : 0;
+  }
+}
+
+#endif
+
+#ifdef TS_LEXER_SIMD_SSSE3
+
+__attribute__((target("ssse3")))
+static uint32_t ts_lexer__ascii_run_length_ssse3(
+  const uint8_t *bytes,
+  uint32_t size,
+  const uint32_t *set
+) {
+  uint8_t low_table[16], high_table[16];
+  ts_lexer__ascii_set_tables(set, low_table, high_table);
+  __m128i low_lookup = _mm_loadu_si128((const __m128i *)low_table);
+  __m128i high_lookup = _mm_loadu_si128((const __m128i *)high_table);
+  __m128i nibble_mask = _mm_set1_epi8(0x0f);
+  __m128i zero = _mm_setzero_si128();
+
+  uint32_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)&bytes[i]);
+    __m128i low = _mm_shuffle_epi8(low_lookup, _mm_and_si128(chunk, nibble_mask));
+    __m128i high = _mm_shuffle_epi8(
+      high_lookup,
+      _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble_mask)
+    );
+    __m128i misses = _mm_cmpeq_epi8(_mm_and_si128(low, high), zero);
+    unsigned mask = (unsigned)_mm_movemask_epi8(misses);
+    if (mask) return i + (uint32_t)__builtin_ctz(mask);
+  }
+  return i;
+}
+
+#endif
+
+#ifdef TS_LEXER_SIMD_NEON
+
+static uint32_t ts_lexer__ascii_run_length_neon(
+  const uint8_t *bytes,
+  uint32_t size,
+  const uint32_t *set
+) {
+  uint8_t low_table[16], high_table[16];
+  ts_lexer__ascii_set_tables(set, low_table, high_table);
+  uint8x16_t low_lookup = vld1q_u8(low_table);
+  uint8x16_t high_lookup = vld1q_u8(high_table);
+  uint8x16_t nibble_mask = vdupq_n_u8(0x0f);
+
+  uint32_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t chunk = vld1q_u8(&bytes[i]);
+    uint8x16_t low = vqtbl1q_u8(low_lookup, vandq_u8(chunk, nibble_mask));
+    uint8x16_t high = vqtbl1q_u8(high_lookup, vshrq_n_u8(chunk, 4));
+    uint8x16_t misses = vceqq_u8(vandq_u8(low, high), vdupq_n_u8(0));
+    if (vmaxvq_u8(misses)) break;
+  }
+  return i;
+}
+
+#endif
+
+// Determine whether the CPU supports the vectorized search for runs of
+// characters. This is checked once per lexer, when it is initialized.
+static bool ts_lexer__cpu_has_simd(void) {
+#if defined(TS_LEXER_SIMD_SSSE3)
+  return __builtin_cpu_supports("ssse3");
+#elif defined(TS_LEXER_SIMD_NEON)
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Find the length of the run of bytes at the given location that are
+// all ASCII characters in the given set.
+static uint32_t ts_lexer__ascii_run_length(
+  const uint8_t *bytes,
+  uint32_t size,
+  const uint32_t *set,
+  bool has_simd
+) {
+  uint32_t i = 0;
+
+  // Most runs are short, so check the first few bytes one at a time
+  // before setting up the vectorized search.
+  for (; i < size && i < 16; i++) {
+    if (!ts_lexer__ascii_set_contains(set, bytes[i])) return i;
+  }
+
+#if defined(TS_LEXER_SIMD_SSSE3)
+  if (has_simd && i < size) {
+    i += ts_lexer__ascii_run_length_ssse3(&bytes[i], size - i, set);
+  }
+#elif defined(TS_LEXER_SIMD_NEON)
+  if (has_simd && i < size) {
+    i += ts_lexer__ascii_run_length_neon(&bytes[i], size - i, set);
+  }
+#else
+  (void)has_simd;
+#endif
+
+  for (; i < size; i++) {
+    if (!ts_lexer__ascii_set_contains(set, bytes[i])) break;
+  }
+  return i;
+}
+
+// Advance past the current lookahead character, and then past all of the
+// immediately following characters that belong to the given set of ASCII
+// characters. The set is a bitmap with one bit for each ASCII character.
+//
+// This lets generated lexers consume runs of whitespace or identifier
+// characters in bulk, instead of calling `advance` for every character.
+static void ts_lexer__advance_while(TSLexer *_self, const uint32_t *set, bool skip) {
+  Lexer *self = (Lexer *)_self;
+  ts_lexer__advance(_self, skip);
+
+  // Log every character individually when logging is enabled.
+  if (self->logger.log || self->input.encoding == TSInputEncodingUTF16) {
+    while (self->chunk && ts_lexer__ascii_set_contains(set, self->data.lookahead)) {
+      ts_lexer__advance(_self, skip);
+    }
+    return;
+  }
+
+  while (self->chunk && ts_lexer__ascii_set_contains(set, self->data.lookahead)) {
+    const TSRange *current_range = &self->included_ranges[self->current_included_range_index];
+    uint32_t position_in_chunk = self->current_position.bytes - self->chunk_start;
+    uint32_t size = self->chunk_size - position_in_chunk;
+    uint32_t size_in_range = current_range->end_byte - self->current_position.bytes;
+    if (size_in_range < size) size = size_in_range;
+
+    const uint8_t *run = (const uint8_t *)self->chunk + position_in_chunk;
+    uint32_t length = ts_lexer__ascii_run_length(run, size, set, self->has_simd);
+    if (length == 0) break;
+
+    // Jump directly to the last character of the run. Then advance past that
+    // character in the usual way, which handles the boundaries of chunks and
+    // included ranges, and decodes the next character.
+    uint32_t skipped = length - 1;
+    const uint8_t *newline = NULL;
+    if (ts_lexer__ascii_set_contains(set, '\n')) {
+      for (uint32_t i = 0; i < skipped; i++) {
+        if (run[i] == '\n') {
+          self->current_position.extent.row++;
+          newline = &run[i];
+        }
+      }
+    }
+    self->current_position.bytes += skipped;
+    if (newline) {
+      self->current_position.extent.column = (uint32_t)(&run[skipped] - newline - 1);
+    } else {
+      self->current_position.extent.column += skipped;
+    }
+    self->data.lookahead = run[skipped];
+    self->lookahead_size = 1;
+    ts_lexer__advance(_self, skip);
+  }
+}
+
 // Mark that a token match has completed. This can be called multiple
 // times if a longer match is found later.
 static void ts_lexer__mark_end(TSLexer *_self) {
@@ -231,6 +487,74 @@ static void ts_lexer__mark_end(TSLexer *_self) {
   self->token_end_position = self->current_position;
 }
 
+static inline uint16_t ts_lexer__character_class(const TSLexTable *table, int32_t c) {
+  if (c < 0) return table->invalid_character_class;
+  if (c < 128) return table->ascii_character_classes[c];
+
+  // The remaining characters are divided into ranges, sorted by their
+  // first character. Find the last range that starts at or before `c`.
+  const TSLexTableRange *ranges = table->character_ranges;
+  uint32_t index = 0;
+  uint32_t size = table->character_range_count;
+  while (size > 1) {
+    uint32_t half_size = size / 2;
+    uint32_t mid_index = index + half_size;
+    if (ranges[mid_index].start <= c) index = mid_index;
+    size -= half_size;
+  }
+  return ranges[index].character_class;
+}
+
+// Run a lexer that is described by a table, rather than by a generated
+// function. Characters are grouped into classes that every lex state treats
+// the same way, and each state refers to a row of transitions, indexed by
+// class. States with identical transitions share a row.
+// A transition stores one plus the next state's id, with the LEX_TABLE_SKIP
+// bit set if the character is not part of the token, or zero if the state
+// has no transition for that class.
+//
+// This follows the generated lexers' semantics exactly: each state first
+// accepts its token if it has one, then takes its EOF transition if the
+// lexer is at EOF, and otherwise takes the transition for the lookahead
+// character's class. States that loop on runs of ASCII characters also
+// store the set of those characters, so that they can be consumed in bulk.
+static bool ts_lexer__run_lex_table(TSLexer *_self, const TSLexTable *table, TSStateId state) {
+  bool result = false;
+  while (state < table->state_count) {
+    const TSLexTableState *entry = &table->states[state];
+    if (entry->accepts_token) {
+      result = true;
+      _self->result_symbol = entry->accept_symbol;
+      ts_lexer__mark_end(_self);
+    }
+
+    int32_t lookahead = _self->lookahead;
+    uint16_t transition;
+    if (entry->eof_transition && ts_lexer__eof(_self)) {
+      transition = entry->eof_transition;
+    } else {
+      uint16_t character_class = ts_lexer__character_class(table, lookahead);
+      transition = table->transitions[
+        entry->transition_row * table->character_class_count + character_class
+      ];
+
+      // The state's set of looping characters all lead back to this state.
+      if (entry->ascii_set) {
+        const uint32_t *set = table->ascii_sets[entry->ascii_set - 1];
+        if (ts_lexer__ascii_set_contains(set, lookahead)) {
+          ts_lexer__advance_while(_self, set, transition & LEX_TABLE_SKIP);
+          continue;
+        }
+      }
+    }
+
+    if (!transition) break;
+    state = (transition & ~LEX_TABLE_SKIP) - 1;
+    ts_lexer__advance(_self, transition & LEX_TABLE_SKIP);
+  }
+  return result;
+}
+
 static uint32_t ts_lexer__get_column(TSLexer *_self) {
   Lexer *self = (Lexer *)_self;
   self->did_get_column = true;
@@ -261,30 +585,82 @@ void ts_lexer_init(Lexer *self) {
       .get_column = ts_lexer__get_column,
       .is_at_included_range_start = ts_lexer__is_at_included_range_start,
       .eof = ts_lexer__eof,
+      .advance_while = NULL,
+      .run_lex_table = NULL,
       .lookahead = 0,
       .result_symbol = 0,
     },
     .chunk = NULL,
     .chunk_size = 0,
     .chunk_start = 0,
+    .buffer = NULL,
+    .buffer_size = 0,
     .current_position = {0, {0, 0}},
     .logger = {
       .payload = NULL,
       .log = NULL
     },
+    .decode = ts_decode_utf8,
     .included_ranges = NULL,
     .included_range_count = 0,
     .current_included_range_index = 0,
+    .has_simd = ts_lexer__cpu_has_simd(),
   };
   ts_lexer_set_included_ranges(self, NULL, 0);
 }
 
+// Provide the functions that were added to `TSLexer` after the oldest
+// supported ABI version only to languages that were generated for them.
+// Languages generated for an older version are compiled against a smaller
+// `TSLexer` struct, and could also be loaded by a library that lacks them.
+void ts_lexer_set_language(Lexer *self, const TSLanguage *language) {
+  uint32_t version = language ? language->version : 0;
+  self->data.advance_while = version >= LANGUAGE_VERSION_WITH_ADVANCE_WHILE
+    ? ts_lexer__advance_while
+    : NULL;
+  self->data.run_lex_table = version >= LANGUAGE_VERSION_WITH_LEX_TABLES
+    ? ts_lexer__run_lex_table
+    : NULL;
+}
+
 void ts_lexer_delete(Lexer *self) {
+  ts_track_free(
+    TSAllocationCategoryLexerRanges,
+    self->included_ranges,
+    self->included_range_count * sizeof(TSRange)
+  );
   ts_free(self->included_ranges);
 }
 
+static UnicodeDecodeFunction ts_lexer__decode_function(TSInputEncoding encoding) {
+  switch (encoding) {
+    case TSInputEncodingUTF16: return ts_decode_utf16;
+    case TSInputEncodingLatin1: return ts_decode_latin1;
+    default: return ts_decode_utf8;
+  }
+}
+
 void ts_lexer_set_input(Lexer *self, TSInput input) {
   self->input = input;
+  self->decode = ts_lexer__decode_function(input.encoding);
+  self->buffer = NULL;
+  self->buffer_size = 0;
+  ts_lexer__clear_chunk(self);
+  ts_lexer_goto(self, self->current_position);
+}
+
+// Read the source code directly from a buffer that contains the entire
+// document, rather than retrieving it in chunks via the input callback.
+void ts_lexer_set_input_buffer(
+  Lexer *self,
+  const char *buffer,
+  uint32_t size,
+  TSInputEncoding encoding
+) {
+  self->input = (TSInput) {NULL, NULL, encoding};
+  self->decode = ts_lexer__decode_function(encoding);
+  self->buffer = buffer;
+  self->buffer_size = size;
   ts_lexer__clear_chunk(self);
   ts_lexer_goto(self, self->current_position);
 }
@@ -342,6 +718,37 @@ void ts_lexer_mark_end(Lexer *self) {
   ts_lexer__mark_end(&self->data);
 }
 
+// Check that the given ranges are ordered, don't overlap, and fit between
+// the given bytes.
+static bool ts_lexer__ranges_are_valid(
+  const TSRange *ranges,
+  uint32_t count,
+  uint32_t min_byte,
+  uint32_t max_byte
+) {
+  uint32_t previous_byte = min_byte;
+  for (unsigned i = 0; i < count; i++) {
+    const TSRange *range = &ranges[i];
+    if (
+      range->start_byte < previous_byte ||
+      range->end_byte < range->start_byte
+    ) return false;
+    previous_byte = range->end_byte;
+  }
+  return previous_byte <= max_byte;
+}
+
+static void ts_lexer__resize_included_ranges(Lexer *self, uint32_t count) {
+  size_t size = count * sizeof(TSRange);
+  ts_track_free(
+    TSAllocationCategoryLexerRanges,
+    self->included_ranges,
+    self->included_range_count * sizeof(TSRange)
+  );
+  self->included_ranges = ts_realloc(self->included_ranges, size);
+  ts_track_allocate(TSAllocationCategoryLexerRanges, self->included_ranges, size);
+}
+
 bool ts_lexer_set_included_ranges(
   Lexer *self,
   const TSRange *ranges,
@@ -350,26 +757,57 @@ bool ts_lexer_set_included_ranges(
   if (count == 0 || !ranges) {
     ranges = &DEFAULT_RANGE;
     count = 1;
-  } else {
-    uint32_t previous_byte = 0;
-    for (unsigned i = 0; i < count; i++) {
-      const TSRange *range = &ranges[i];
-      if (
-        range->start_byte < previous_byte ||
-        range->end_byte < range->start_byte
-      ) return false;
-      previous_byte = range->end_byte;
-    }
+  } else if (!ts_lexer__ranges_are_valid(ranges, count, 0, UINT32_MAX)) {
+    return false;
   }
 
-  size_t size = count * sizeof(TSRange);
-  self->included_ranges = ts_realloc(self->included_ranges, size);
-  memcpy(self->included_ranges, ranges, size);
+  ts_lexer__resize_included_ranges(self, count);
+  memcpy(self->included_ranges, ranges, count * sizeof(TSRange));
   self->included_range_count = count;
   ts_lexer_goto(self, self->current_position);
   return true;
 }
 
+bool ts_lexer_update_included_ranges(
+  Lexer *self,
+  uint32_t start_index,
+  uint32_t old_count,
+  const TSRange *ranges,
+  uint32_t count
+) {
+  if (
+    start_index > self->included_range_count ||
+    old_count > self->included_range_count - start_index ||
+    (count > 0 && !ranges)
+  ) return false;
+
+  // Only the new ranges and their neighbors need to be validated.
+  uint32_t end_index = start_index + old_count;
+  uint32_t min_byte = start_index > 0
+    ? self->included_ranges[start_index - 1].end_byte
+    : 0;
+  uint32_t max_byte = end_index < self->included_range_count
+    ? self->included_ranges[end_index].start_byte
+    : UINT32_MAX;
+  if (!ts_lexer__ranges_are_valid(ranges, count, min_byte, max_byte)) return false;
+
+  uint32_t new_range_count = self->included_range_count - old_count + count;
+  if (new_range_count == 0) return ts_lexer_set_included_ranges(self, NULL, 0);
+
+  uint32_t tail_count = self->included_range_count - end_index;
+  if (count > old_count) ts_lexer__resize_included_ranges(self, new_range_count);
+  memmove(
+    &self->included_ranges[start_index + count],
+    &self->included_ranges[end_index],
+    tail_count * sizeof(TSRange)
+  );
+  if (count < old_count) ts_lexer__resize_included_ranges(self, new_range_count);
+  memcpy(&self->included_ranges[start_index], ranges, count * sizeof(TSRange));
+  self->included_range_count = new_range_count;
+  ts_lexer_goto(self, self->current_position);
+  return true;
+}
+
 TSRange *ts_lexer_included_ranges(const Lexer *self, uint32_t *count) {
   *count = self->included_range_count;
   return self->included_ranges;
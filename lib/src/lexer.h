@@ -7,6 +7,7 @@ extern "C" {
 
 #include "./length.h"
 #include "./subtree.h"
+#include "./unicode.h"
 #include "tree_sitter/api.h"
 #include "tree_sitter/parser.h"
 
@@ -18,28 +19,35 @@ typedef struct {
 
   TSRange *included_ranges;
   const char *chunk;
+  const char *buffer;
   TSInput input;
   TSLogger logger;
+  UnicodeDecodeFunction decode;
 
   uint32_t included_range_count;
   uint32_t current_included_range_index;
   uint32_t chunk_start;
   uint32_t chunk_size;
+  uint32_t buffer_size;
   uint32_t lookahead_size;
   bool did_get_column;
+  bool has_simd;
 
   char debug_buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
 } Lexer;
 
 void ts_lexer_init(Lexer *);
 void ts_lexer_delete(Lexer *);
+void ts_lexer_set_language(Lexer *, const TSLanguage *);
 void ts_lexer_set_input(Lexer *, TSInput);
+void ts_lexer_set_input_buffer(Lexer *, const char *, uint32_t, TSInputEncoding);
 void ts_lexer_reset(Lexer *, Length);
 void ts_lexer_start(Lexer *);
 void ts_lexer_finish(Lexer *, uint32_t *);
 void ts_lexer_advance_to_end(Lexer *);
 void ts_lexer_mark_end(Lexer *);
 bool ts_lexer_set_included_ranges(Lexer *self, const TSRange *ranges, uint32_t count);
+bool ts_lexer_update_included_ranges(Lexer *self, uint32_t start_index, uint32_t old_count, const TSRange *ranges, uint32_t count);
 TSRange *ts_lexer_included_ranges(const Lexer *self, uint32_t *count);
 
 #ifdef __cplusplus
@@ -133,6 +133,147 @@ static inline uint32_t ts_node__relevant_child_count(
   }
 }
 
+// ChildIndex
+
+static inline uint32_t child_index_entry_count(
+  const ChildIndexEntry *self,
+  bool include_anonymous
+) {
+  return include_anonymous ? self->visible_child_count : self->named_child_count;
+}
+
+// Get the index of a wide node's children, building it if necessary. Returns
+// NULL if the tree's caches are in use on another thread.
+static const ChildIndexEntry *ts_node__child_index(const TSNode *self) {
+  if (!ts_tree_try_lock_caches(self->tree)) return NULL;
+  Subtree subtree = ts_node__subtree(*self);
+  const ChildIndexEntry *result = ts_tree_child_index(self->tree, subtree.ptr);
+  if (result) {
+    ts_tree_unlock_caches(self->tree);
+    return result;
+  }
+
+  ChildIndexEntry *entries = ts_malloc((subtree.ptr->child_count + 1) * sizeof(ChildIndexEntry));
+  uint32_t visible_child_count = 0;
+  uint32_t named_child_count = 0;
+  TSNode child;
+  NodeChildIterator iterator = ts_node_iterate_children(self);
+  iterator.position = length_zero();
+  for (;;) {
+    entries[iterator.child_index] = (ChildIndexEntry) {
+      .position = iterator.position,
+      .structural_child_index = iterator.structural_child_index,
+      .visible_child_count = visible_child_count,
+      .named_child_count = named_child_count,
+    };
+    if (!ts_node_child_iterator_next(&iterator, &child)) break;
+    visible_child_count += ts_node__is_relevant(child, true)
+      ? 1
+      : ts_node__relevant_child_count(child, true);
+    named_child_count += ts_node__is_relevant(child, false)
+      ? 1
+      : ts_node__relevant_child_count(child, false);
+  }
+  ts_tree_set_child_index(self->tree, subtree.ptr, entries);
+  ts_tree_unlock_caches(self->tree);
+  return entries;
+}
+
+// Check if the iterator's node has enough children that they are indexed.
+static inline bool ts_node_child_iterator_is_indexed(const NodeChildIterator *self) {
+  return self->parent.ptr && self->parent.ptr->child_count >= TS_MIN_INDEXED_CHILD_COUNT;
+}
+
+// Move a new iterator directly to the given child, using the node's child index.
+static inline void ts_node_child_iterator_seek(
+  NodeChildIterator *self,
+  const ChildIndexEntry *entries,
+  uint32_t child_index
+) {
+  assert(self->child_index == 0);
+  self->position = length_add(self->position, entries[child_index].position);
+  self->structural_child_index = entries[child_index].structural_child_index;
+  self->child_index = child_index;
+}
+
+// Move a new iterator past all of a wide node's children that end before the
+// given byte offset.
+static inline void ts_node_child_iterator_skip_to_byte(
+  NodeChildIterator *self,
+  const TSNode *node,
+  uint32_t end_byte
+) {
+  if (!ts_node_child_iterator_is_indexed(self)) return;
+  uint32_t start_byte = ts_node_start_byte(*node);
+  if (end_byte <= start_byte) return;
+  const ChildIndexEntry *entries = ts_node__child_index(node);
+  if (!entries) return;
+  uint32_t relative_end_byte = end_byte - start_byte;
+  uint32_t left = 0, right = self->parent.ptr->child_count;
+  while (left < right) {
+    uint32_t mid = left + (right - left) / 2;
+    if (entries[mid + 1].position.bytes < relative_end_byte) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  ts_node_child_iterator_seek(self, entries, left);
+}
+
+// Move a new iterator past all of a wide node's children that end before the
+// given point, or at or before the given exclusive point.
+static inline void ts_node_child_iterator_skip_to_point(
+  NodeChildIterator *self,
+  const TSNode *node,
+  TSPoint end_point,
+  TSPoint exclusive_end_point
+) {
+  if (!ts_node_child_iterator_is_indexed(self)) return;
+  const ChildIndexEntry *entries = ts_node__child_index(node);
+  if (!entries) return;
+  TSPoint start_point = ts_node_start_point(*node);
+  uint32_t left = 0, right = self->parent.ptr->child_count;
+  while (left < right) {
+    uint32_t mid = left + (right - left) / 2;
+    TSPoint child_end_point = point_add(start_point, entries[mid + 1].position.extent);
+    if (point_lt(child_end_point, end_point) || point_lte(child_end_point, exclusive_end_point)) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  ts_node_child_iterator_seek(self, entries, left);
+}
+
+// Move a new iterator to the child of a wide node that is or contains the
+// relevant descendant with the given index, and get the number of relevant
+// descendants before that child. Returns false if there is no such child.
+static bool ts_node_child_iterator_skip_to_descendant(
+  NodeChildIterator *self,
+  const ChildIndexEntry *entries,
+  uint32_t descendant_index,
+  bool include_anonymous,
+  uint32_t *preceding_descendant_count
+) {
+  uint32_t count = self->parent.ptr->child_count;
+  if (descendant_index >= child_index_entry_count(&entries[count], include_anonymous)) {
+    return false;
+  }
+  uint32_t left = 0, right = count;
+  while (left + 1 < right) {
+    uint32_t mid = left + (right - left) / 2;
+    if (child_index_entry_count(&entries[mid], include_anonymous) <= descendant_index) {
+      left = mid;
+    } else {
+      right = mid;
+    }
+  }
+  *preceding_descendant_count = child_index_entry_count(&entries[left], include_anonymous);
+  ts_node_child_iterator_seek(self, entries, left);
+  return true;
+}
+
 static inline TSNode ts_node__child(
   TSNode self,
   uint32_t child_index,
@@ -147,6 +288,20 @@ static inline TSNode ts_node__child(
     TSNode child;
     uint32_t index = 0;
     NodeChildIterator iterator = ts_node_iterate_children(&result);
+
+    // For wide nodes, skip directly to the child that is or contains the
+    // requested node.
+    const ChildIndexEntry *entries = ts_node_child_iterator_is_indexed(&iterator)
+      ? ts_node__child_index(&result)
+      : NULL;
+    if (entries && !ts_node_child_iterator_skip_to_descendant(
+      &iterator,
+      entries,
+      child_index,
+      include_anonymous,
+      &index
+    )) break;
+
     while (ts_node_child_iterator_next(&iterator, &child)) {
       if (ts_node__is_relevant(child, include_anonymous)) {
         if (index == child_index) {
@@ -200,6 +355,32 @@ static inline TSNode ts_node__prev_sibling(TSNode self, bool include_anonymous)
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+
+    // For wide nodes, skip the children that end before the target, keeping
+    // track of the last one that is or contains a relevant node.
+    const ChildIndexEntry *entries = ts_node_child_iterator_is_indexed(&iterator)
+      ? ts_node__child_index(&node)
+      : NULL;
+    if (entries) {
+      NodeChildIterator skipped_iterator = iterator;
+      ts_node_child_iterator_skip_to_byte(&iterator, &node, target_end_byte);
+      uint32_t count = child_index_entry_count(&entries[iterator.child_index], include_anonymous);
+      if (count > 0) {
+        uint32_t left = 0, right = iterator.child_index;
+        while (left + 1 < right) {
+          uint32_t mid = left + (right - left) / 2;
+          if (child_index_entry_count(&entries[mid], include_anonymous) < count) {
+            left = mid;
+          } else {
+            right = mid;
+          }
+        }
+        ts_node_child_iterator_seek(&skipped_iterator, entries, left);
+        ts_node_child_iterator_next(&skipped_iterator, &earlier_child);
+        earlier_child_is_relevant = ts_node__is_relevant(earlier_child, include_anonymous);
+      }
+    }
+
     while (ts_node_child_iterator_next(&iterator, &child)) {
       if (child.id == self.id) break;
       if (iterator.position.bytes > target_end_byte) {
@@ -257,6 +438,7 @@ static inline TSNode ts_node__next_sibling(TSNode self, bool include_anonymous)
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+    ts_node_child_iterator_skip_to_byte(&iterator, &node, target_end_byte);
     while (ts_node_child_iterator_next(&iterator, &child)) {
       if (iterator.position.bytes < target_end_byte) continue;
       if (ts_node_start_byte(child) <= ts_node_start_byte(self)) {
@@ -307,6 +489,7 @@ static inline TSNode ts_node__first_child_for_byte(
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+    if (goal < UINT32_MAX) ts_node_child_iterator_skip_to_byte(&iterator, &node, goal + 1);
     while (ts_node_child_iterator_next(&iterator, &child)) {
       if (ts_node_end_byte(child) > goal) {
         if (ts_node__is_relevant(child, include_anonymous)) {
@@ -338,6 +521,11 @@ static inline TSNode ts_node__descendant_for_byte_range(
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+    ts_node_child_iterator_skip_to_byte(
+      &iterator,
+      &node,
+      range_start < range_end || range_start == UINT32_MAX ? range_end : range_start + 1
+    );
     while (ts_node_child_iterator_next(&iterator, &child)) {
       uint32_t node_end = iterator.position.bytes;
 
@@ -377,6 +565,7 @@ static inline TSNode ts_node__descendant_for_point_range(
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+    ts_node_child_iterator_skip_to_point(&iterator, &node, range_end, range_start);
     while (ts_node_child_iterator_next(&iterator, &child)) {
       TSPoint node_end = iterator.position.extent;
 
@@ -463,13 +652,19 @@ TSNode ts_node_parent(TSNode self) {
   uint32_t end_byte = ts_node_end_byte(self);
   if (node.id == self.id) return ts_node__null();
 
-  TSNode last_visible_node = node;
+  TSNode last_visible_node;
+  if (ts_tree_cached_parent(self.tree, self.id, &last_visible_node)) {
+    return last_visible_node;
+  }
+
+  last_visible_node = node;
   bool did_descend = true;
   while (did_descend) {
     did_descend = false;
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+    ts_node_child_iterator_skip_to_byte(&iterator, &node, end_byte);
     while (ts_node_child_iterator_next(&iterator, &child)) {
       if (
         ts_node_start_byte(child) > ts_node_start_byte(self) ||
@@ -478,6 +673,12 @@ TSNode ts_node_parent(TSNode self) {
       if (iterator.position.bytes >= end_byte) {
         node = child;
         if (ts_node__is_relevant(child, true)) {
+          // A search for the parent of any non-empty ancestor would follow
+          // this same path, so cache its parent as well. This makes walking
+          // up through a node's ancestors linear in the tree's depth.
+          if (ts_node_start_byte(child) < iterator.position.bytes) {
+            ts_tree_cache_parent(self.tree, child.id, last_visible_node);
+          }
           last_visible_node = node;
         }
         did_descend = true;
@@ -486,6 +687,7 @@ TSNode ts_node_parent(TSNode self) {
     }
   }
 
+  ts_tree_cache_parent(self.tree, self.id, last_visible_node);
   return last_visible_node;
 }
 
@@ -617,6 +819,10 @@ uint32_t ts_node_named_child_count(TSNode self) {
   }
 }
 
+uint32_t ts_node_descendant_count(TSNode self) {
+  return ts_subtree_visible_descendant_count(ts_node__subtree(self)) + 1;
+}
+
 TSNode ts_node_next_sibling(TSNode self) {
   return ts_node__next_sibling(self, true);
 }
@@ -673,19 +879,103 @@ TSNode ts_node_named_descendant_for_point_range(
   return ts_node__descendant_for_point_range(self, start, end, false);
 }
 
+static inline void ts_node__edit_position(
+  uint32_t *start_byte,
+  TSPoint *start_point,
+  const TSInputEdit *edit
+) {
+  if (*start_byte >= edit->old_end_byte) {
+    *start_byte = edit->new_end_byte + (*start_byte - edit->old_end_byte);
+    *start_point = point_add(edit->new_end_point, point_sub(*start_point, edit->old_end_point));
+  } else if (*start_byte > edit->start_byte) {
+    *start_byte = edit->new_end_byte;
+    *start_point = edit->new_end_point;
+  }
+}
+
+static inline void ts_node__set_position(TSNode *self, uint32_t start_byte, TSPoint start_point) {
+  self->context[0] = start_byte;
+  self->context[1] = start_point.row;
+  self->context[2] = start_point.column;
+}
+
 void ts_node_edit(TSNode *self, const TSInputEdit *edit) {
   uint32_t start_byte = ts_node_start_byte(*self);
   TSPoint start_point = ts_node_start_point(*self);
+  ts_node__edit_position(&start_byte, &start_point, edit);
+  ts_node__set_position(self, start_byte, start_point);
+}
 
-  if (start_byte >= edit->old_end_byte) {
-    start_byte = edit->new_end_byte + (start_byte - edit->old_end_byte);
-    start_point = point_add(edit->new_end_point, point_sub(start_point, edit->old_end_point));
-  } else if (start_byte > edit->start_byte) {
-    start_byte = edit->new_end_byte;
-    start_point = edit->new_end_point;
+static int ts_node__compare_edits(const void *a, const void *b) {
+  const TSInputEdit *left = a, *right = b;
+  if (left->start_byte != right->start_byte) {
+    return left->start_byte < right->start_byte ? -1 : 1;
+  }
+  if (left->old_end_byte != right->old_end_byte) {
+    return left->old_end_byte < right->old_end_byte ? -1 : 1;
   }
+  return 0;
+}
 
-  self->context[0] = start_byte;
-  self->context[1] = start_point.row;
-  self->context[2] = start_point.column;
+void ts_node_edit_batch(
+  TSNode *nodes,
+  uint32_t node_count,
+  const TSInputEdit *edits,
+  uint32_t edit_count
+) {
+  if (node_count == 0 || edit_count == 0) return;
+
+  TSInputEdit *sorted_edits = ts_malloc(edit_count * sizeof(TSInputEdit));
+  memcpy(sorted_edits, edits, edit_count * sizeof(TSInputEdit));
+  qsort(sorted_edits, edit_count, sizeof(TSInputEdit), ts_node__compare_edits);
+
+  // For each prefix of the sorted edits, store the total number of bytes and rows
+  // that the edits add to the document.
+  int64_t *byte_deltas = ts_malloc(2 * (edit_count + 1) * sizeof(int64_t));
+  int64_t *row_deltas = byte_deltas + edit_count + 1;
+  byte_deltas[0] = 0;
+  row_deltas[0] = 0;
+  for (uint32_t i = 0; i < edit_count; i++) {
+    const TSInputEdit *edit = &sorted_edits[i];
+    byte_deltas[i + 1] = byte_deltas[i] + edit->new_end_byte - edit->old_end_byte;
+    row_deltas[i + 1] = row_deltas[i] + edit->new_end_point.row - edit->old_end_point.row;
+  }
+
+  for (uint32_t i = 0; i < node_count; i++) {
+    TSNode *node = &nodes[i];
+    uint32_t start_byte = ts_node_start_byte(*node);
+    TSPoint start_point = ts_node_start_point(*node);
+
+    // Find the edits that start at or before this node. No others can move it.
+    uint32_t edit_index = 0, size = edit_count;
+    while (size > 0) {
+      uint32_t half_size = size / 2;
+      if (sorted_edits[edit_index + half_size].start_byte <= start_byte) {
+        edit_index += half_size + 1;
+        size -= half_size + 1;
+      } else {
+        size = half_size;
+      }
+    }
+
+    // Apply those edits from last to first, as if they had been passed to
+    // `ts_node_edit` one at a time. Once an edit ends on an earlier row than
+    // the node, that edit and all of the ones before it just shift the node
+    // by a fixed number of bytes and rows.
+    while (edit_index > 0) {
+      const TSInputEdit *edit = &sorted_edits[edit_index - 1];
+      if (start_byte >= edit->old_end_byte && edit->old_end_point.row < start_point.row) {
+        start_byte = (uint32_t)(start_byte + byte_deltas[edit_index]);
+        start_point.row = (uint32_t)(start_point.row + row_deltas[edit_index]);
+        break;
+      }
+      ts_node__edit_position(&start_byte, &start_point, edit);
+      edit_index--;
+    }
+
+    ts_node__set_position(node, start_byte, start_point);
+  }
+
+  ts_free(byte_deltas);
+  ts_free(sorted_edits);
 }
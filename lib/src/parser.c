@@ -77,12 +77,34 @@ static const unsigned MAX_SUMMARY_DEPTH = 16;
 static const unsigned MAX_COST_DIFFERENCE = 16 * ERROR_COST_PER_SKIPPED_TREE;
 static const unsigned OP_COUNT_PER_TIMEOUT_CHECK = 100;
 
+#define TABLE_CACHE_SIZE 256
+#define TOKEN_CACHE_SIZE 8
+#define EXTERNAL_SCANNER_STATE_CACHE_SIZE 64
+
 typedef struct {
   Subtree token;
   Subtree last_external_token;
   uint32_t byte_index;
+} TokenCacheEntry;
+
+// The most recently lexed tokens, shared by all of the stack versions. When
+// the stack has split, or during error recovery, several versions often need
+// a token at the same position in states with different lex modes; keeping
+// more than one token lets each of them find its own instead of relexing.
+typedef struct {
+  TokenCacheEntry entries[TOKEN_CACHE_SIZE];
+  uint32_t next_index;
 } TokenCache;
 
+// A direct-mapped cache of recent parse table lookups for 'small' parse
+// states, whose actions can only be found by scanning the state's symbol
+// groups.
+typedef struct {
+  TSStateId state;
+  TSSymbol symbol;
+  TableEntry entry;
+} TableCacheEntry;
+
 struct TSParser {
   Lexer lexer;
   Stack *stack;
@@ -102,9 +124,29 @@ struct TSParser {
   unsigned accept_count;
   unsigned operation_count;
   const volatile size_t *cancellation_flag;
+  size_t memory_limit;
+  uint64_t parse_start_allocated_bytes;
+  bool exceeded_memory_limit;
+  uint32_t error_recovery_budget;
+  uint32_t error_recovery_count;
   Subtree old_tree;
   TSRangeArray included_range_differences;
   unsigned included_range_difference_index;
+  bool arena_allocation;
+  bool deferred_balancing;
+  TSStreamingCallback streaming_callback;
+  TSProgressCallback progress_callback;
+  TSSymbol streaming_symbol;
+  bool streaming_symbol_is_top_level;
+  SubtreeArenaArray arenas;
+  SubtreeSharingTable shared_nodes;
+  TableCacheEntry table_cache[TABLE_CACHE_SIZE];
+  TSParserStats stats;
+  TSDuration parse_duration;
+  TSDuration balance_duration;
+  ExternalScannerState external_scanner_states[EXTERNAL_SCANNER_STATE_CACHE_SIZE];
+  ExternalScannerState external_scanner_state;
+  bool has_external_scanner_state;
 };
 
 typedef struct {
@@ -122,30 +164,6 @@ typedef enum {
   ErrorComparisonTakeRight,
 } ErrorComparison;
 
-typedef struct {
-  const char *string;
-  uint32_t length;
-} TSStringInput;
-
-// StringInput
-
-static const char *ts_string_input_read(
-  void *_self,
-  uint32_t byte,
-  TSPoint pt,
-  uint32_t *length
-) {
-  (void)pt;
-  TSStringInput *self = (TSStringInput *)_self;
-  if (byte >= self->length) {
-    *length = 0;
-    return "";
-  } else {
-    *length = self->length - byte;
-    return self->string + byte;
-  }
-}
-
 // Parser - Private
 
 static void ts_parser__log(TSParser *self) {
@@ -167,6 +185,39 @@ static void ts_parser__log(TSParser *self) {
   }
 }
 
+static void ts_parser__clear_table_cache(TSParser *self) {
+  for (unsigned i = 0; i < TABLE_CACHE_SIZE; i++) {
+    self->table_cache[i].state = TS_TREE_STATE_NONE;
+  }
+}
+
+// Look up the parse actions for a given state and symbol, consulting
+// the table cache before scanning a small parse state's symbol groups.
+static inline void ts_parser__table_entry(
+  TSParser *self,
+  TSStateId state,
+  TSSymbol symbol,
+  TableEntry *result
+) {
+  if (state < self->language->large_state_count) {
+    ts_language_table_entry(self->language, state, symbol, result);
+    return;
+  }
+
+  TableCacheEntry *cache_entry = &self->table_cache[
+    ((uint32_t)state * 31 + symbol) & (TABLE_CACHE_SIZE - 1)
+  ];
+  if (cache_entry->state == state && cache_entry->symbol == symbol) {
+    self->stats.parse_table_cache_hits++;
+  } else {
+    self->stats.parse_table_cache_misses++;
+    ts_language_table_entry(self->language, state, symbol, &cache_entry->entry);
+    cache_entry->state = state;
+    cache_entry->symbol = symbol;
+  }
+  *result = cache_entry->entry;
+}
+
 static bool ts_parser__breakdown_top_of_stack(
   TSParser *self,
   StackVersion version
@@ -332,19 +383,81 @@ static bool ts_parser__better_version_exists(
   return false;
 }
 
+// Record the state that the external scanner is known to be in, so that
+// restoring that same state again doesn't require calling `deserialize`.
+static void ts_parser__set_external_scanner_state(
+  TSParser *self,
+  const ExternalScannerState *state
+) {
+  ts_external_scanner_state_delete(&self->external_scanner_state);
+  if (state) {
+    self->external_scanner_state = ts_external_scanner_state_copy(state);
+    self->has_external_scanner_state = true;
+  } else {
+    ts_external_scanner_state_init(&self->external_scanner_state, NULL, 0);
+    self->has_external_scanner_state = false;
+  }
+}
+
 static void ts_parser__restore_external_scanner(
   TSParser *self,
   Subtree external_token
 ) {
+  ExternalScannerState empty_state;
+  const ExternalScannerState *state;
   if (external_token.ptr) {
-    self->language->external_scanner.deserialize(
-      self->external_scanner_payload,
-      ts_external_scanner_state_data(&external_token.ptr->external_scanner_state),
-      external_token.ptr->external_scanner_state.length
-    );
+    state = &external_token.ptr->external_scanner_state;
   } else {
-    self->language->external_scanner.deserialize(self->external_scanner_payload, NULL, 0);
+    ts_external_scanner_state_init(&empty_state, NULL, 0);
+    state = &empty_state;
+  }
+
+  if (
+    self->has_external_scanner_state &&
+    ts_external_scanner_state_eq(&self->external_scanner_state, state)
+  ) return;
+
+  self->language->external_scanner.deserialize(
+    self->external_scanner_payload,
+    ts_external_scanner_state_data(state),
+    state->length
+  );
+  ts_parser__set_external_scanner_state(self, state);
+}
+
+// Initialize the external scanner state of a new token. A long state that is
+// equal to one of the recent ones is shared with it rather than copied.
+static void ts_parser__init_external_scanner_state(
+  TSParser *self,
+  ExternalScannerState *result,
+  const char *data,
+  unsigned length
+) {
+  if (length <= sizeof(result->short_data)) {
+    ts_external_scanner_state_init(result, data, length);
+    return;
   }
+
+  uint32_t hash = ts_external_scanner_state_hash(data, length);
+  ExternalScannerState *entry =
+    &self->external_scanner_states[hash % EXTERNAL_SCANNER_STATE_CACHE_SIZE];
+  if (
+    entry->length != length ||
+    entry->hash != hash ||
+    memcmp(ts_external_scanner_state_data(entry), data, length)
+  ) {
+    ts_external_scanner_state_delete(entry);
+    ts_external_scanner_state_init(entry, data, length);
+  }
+  *result = ts_external_scanner_state_copy(entry);
+}
+
+static void ts_parser__clear_external_scanner_states(TSParser *self) {
+  for (unsigned i = 0; i < EXTERNAL_SCANNER_STATE_CACHE_SIZE; i++) {
+    ts_external_scanner_state_delete(&self->external_scanner_states[i]);
+    ts_external_scanner_state_init(&self->external_scanner_states[i], NULL, 0);
+  }
+  ts_parser__set_external_scanner_state(self, NULL);
 }
 
 static bool ts_parser__can_reuse_first_leaf(
@@ -429,6 +542,10 @@ static Subtree ts_parser__lex(
       );
       ts_lexer_finish(&self->lexer, &lookahead_end_byte);
 
+      // Scanning may have changed the scanner's state. If a token is found,
+      // its state is recorded once it has been serialized below.
+      ts_parser__set_external_scanner_state(self, NULL);
+
       // Zero-length external tokens are generally allowed, but they're not
       // allowed right after a syntax error. This is for two reasons:
       // 1. After a syntax error, the lexer is looking for any possible token,
@@ -558,11 +675,9 @@ static Subtree ts_parser__lex(
         self->external_scanner_payload,
         self->lexer.debug_buffer
       );
-      ts_external_scanner_state_init(
-        &((SubtreeHeapData *)result.ptr)->external_scanner_state,
-        self->lexer.debug_buffer,
-        length
-      );
+      ExternalScannerState *state = &((SubtreeHeapData *)result.ptr)->external_scanner_state;
+      ts_parser__init_external_scanner_state(self, state, self->lexer.debug_buffer, length);
+      ts_parser__set_external_scanner_state(self, state);
     }
 
     LOG_LOOKAHEAD(
@@ -582,14 +697,20 @@ static Subtree ts_parser__get_cached_token(
   TableEntry *table_entry
 ) {
   TokenCache *cache = &self->token_cache;
-  if (
-    cache->token.ptr && cache->byte_index == position &&
-    ts_subtree_external_scanner_state_eq(cache->last_external_token, last_external_token)
-  ) {
-    ts_language_table_entry(self->language, state, ts_subtree_symbol(cache->token), table_entry);
-    if (ts_parser__can_reuse_first_leaf(self, state, cache->token, table_entry)) {
-      ts_subtree_retain(cache->token);
-      return cache->token;
+
+  // Search from the most recently lexed token to the oldest.
+  for (uint32_t i = 1; i <= TOKEN_CACHE_SIZE; i++) {
+    TokenCacheEntry *entry = &cache->entries[(cache->next_index + TOKEN_CACHE_SIZE - i) % TOKEN_CACHE_SIZE];
+    if (
+      entry->token.ptr && entry->byte_index == position &&
+      ts_subtree_external_scanner_state_eq(entry->last_external_token, last_external_token)
+    ) {
+      ts_parser__table_entry(self, state, ts_subtree_symbol(entry->token), table_entry);
+      if (ts_parser__can_reuse_first_leaf(self, state, entry->token, table_entry)) {
+        ts_subtree_retain(entry->token);
+        self->stats.cached_token_hits++;
+        return entry->token;
+      }
     }
   }
   return NULL_SUBTREE;
@@ -602,13 +723,26 @@ static void ts_parser__set_cached_token(
   Subtree token
 ) {
   TokenCache *cache = &self->token_cache;
-  if (token.ptr) ts_subtree_retain(token);
+  TokenCacheEntry *entry = &cache->entries[cache->next_index];
+  cache->next_index = (cache->next_index + 1) % TOKEN_CACHE_SIZE;
+  ts_subtree_retain(token);
   if (last_external_token.ptr) ts_subtree_retain(last_external_token);
-  if (cache->token.ptr) ts_subtree_release(&self->tree_pool, cache->token);
-  if (cache->last_external_token.ptr) ts_subtree_release(&self->tree_pool, cache->last_external_token);
-  cache->token = token;
-  cache->byte_index = byte_index;
-  cache->last_external_token = last_external_token;
+  if (entry->token.ptr) ts_subtree_release(&self->tree_pool, entry->token);
+  if (entry->last_external_token.ptr) ts_subtree_release(&self->tree_pool, entry->last_external_token);
+  entry->token = token;
+  entry->byte_index = byte_index;
+  entry->last_external_token = last_external_token;
+}
+
+static void ts_parser__clear_token_cache(TSParser *self) {
+  TokenCache *cache = &self->token_cache;
+  for (uint32_t i = 0; i < TOKEN_CACHE_SIZE; i++) {
+    TokenCacheEntry *entry = &cache->entries[i];
+    if (entry->token.ptr) ts_subtree_release(&self->tree_pool, entry->token);
+    if (entry->last_external_token.ptr) ts_subtree_release(&self->tree_pool, entry->last_external_token);
+    *entry = (TokenCacheEntry) {NULL_SUBTREE, NULL_SUBTREE, 0};
+  }
+  cache->next_index = 0;
 }
 
 static bool ts_parser__has_included_range_difference(
@@ -648,7 +782,9 @@ static Subtree ts_parser__reuse_node(
 
     if (byte_offset < position) {
       LOG("past_reusable_node symbol:%s", TREE_NAME(result));
-      if (end_byte_offset <= position || !reusable_node_descend(&self->reusable_node)) {
+      if (end_byte_offset <= position) {
+        reusable_node_advance_to(&self->reusable_node, position);
+      } else if (!reusable_node_descend(&self->reusable_node)) {
         reusable_node_advance(&self->reusable_node);
       }
       continue;
@@ -684,7 +820,7 @@ static Subtree ts_parser__reuse_node(
     }
 
     TSSymbol leaf_symbol = ts_subtree_leaf_symbol(result);
-    ts_language_table_entry(self->language, *state, leaf_symbol, table_entry);
+    ts_parser__table_entry(self, *state, leaf_symbol, table_entry);
     if (!ts_parser__can_reuse_first_leaf(self, *state, result, table_entry)) {
       LOG(
         "cant_reuse_node symbol:%s, first_leaf_symbol:%s",
@@ -697,6 +833,7 @@ static Subtree ts_parser__reuse_node(
 
     LOG("reuse_node symbol:%s", TREE_NAME(result));
     ts_subtree_retain(result);
+    self->stats.reused_node_count++;
     return result;
   }
 
@@ -766,6 +903,7 @@ static bool ts_parser__select_children(
   // room for its own heap data. The scratch tree is never explicitly released,
   // so the same 'scratch trees' array can be reused again later.
   MutableSubtree scratch_tree = ts_subtree_new_node(
+    NULL,
     ts_subtree_symbol(left),
     &self->scratch_trees,
     0,
@@ -849,8 +987,9 @@ static StackVersion ts_parser__reduce(
     ts_subtree_array_remove_trailing_extras(&children, &self->trailing_extras);
 
     MutableSubtree parent = ts_subtree_new_node(
-      symbol, &children, production_id, self->language
+      &self->tree_pool, symbol, &children, production_id, self->language
     );
+    self->stats.rebuilt_node_count++;
 
     // This pop operation may have caused multiple stack versions to collapse
     // into one, because they all diverged from a common state. In that case,
@@ -873,7 +1012,7 @@ static StackVersion ts_parser__reduce(
         ts_subtree_release(&self->tree_pool, ts_subtree_from_mut(parent));
         array_swap(&self->trailing_extras, &self->trailing_extras2);
         parent = ts_subtree_new_node(
-          symbol, &children, production_id, self->language
+          &self->tree_pool, symbol, &children, production_id, self->language
         );
       } else {
         array_clear(&self->trailing_extras2);
@@ -941,6 +1080,7 @@ static void ts_parser__accept(
         }
         array_splice(&trees, j, 1, child_count, children);
         root = ts_subtree_from_mut(ts_subtree_new_node(
+          &self->tree_pool,
           ts_subtree_symbol(tree),
           &trees,
           tree.ptr->production_id,
@@ -970,6 +1110,23 @@ static void ts_parser__accept(
   ts_stack_halt(self->stack, version);
 }
 
+// Count an error recovery operation against the parser's budget, and return
+// whether the budget has been used up. After that, the parser stops exploring
+// alternative ways of recovering from errors, and only keeps one stack version,
+// so that the rest of the parse takes linear time.
+static bool ts_parser__exhausted_error_recovery_budget(TSParser *self) {
+  if (!self->error_recovery_budget) return false;
+  if (self->error_recovery_count < self->error_recovery_budget) {
+    self->error_recovery_count++;
+    return false;
+  }
+  if (self->error_recovery_count == self->error_recovery_budget) {
+    self->error_recovery_count++;
+    LOG("exhausted_error_recovery_budget");
+  }
+  return true;
+}
+
 static bool ts_parser__do_all_potential_reductions(
   TSParser *self,
   StackVersion starting_version,
@@ -1066,11 +1223,13 @@ static void ts_parser__handle_error(
   TSSymbol lookahead_symbol
 ) {
   uint32_t previous_version_count = ts_stack_version_count(self->stack);
+  self->stats.error_recovery_count++;
+  bool exhausted_budget = ts_parser__exhausted_error_recovery_budget(self);
 
   // Perform any reductions that can happen in this state, regardless of the lookahead. After
   // skipping one or more invalid tokens, the parser might find a token that would have allowed
   // a reduction to take place.
-  ts_parser__do_all_potential_reductions(self, version, 0);
+  if (!exhausted_budget) ts_parser__do_all_potential_reductions(self, version, 0);
   uint32_t version_count = ts_stack_version_count(self->stack);
   Length position = ts_stack_position(self->stack, version);
 
@@ -1078,7 +1237,7 @@ static void ts_parser__handle_error(
   // were created in the previous step.
   bool did_insert_missing_token = false;
   for (StackVersion v = version; v < version_count;) {
-    if (!did_insert_missing_token) {
+    if (!did_insert_missing_token && !exhausted_budget) {
       TSStateId state = ts_stack_state(self->stack, v);
       for (TSSymbol missing_symbol = 1;
            missing_symbol < self->language->token_count;
@@ -1183,7 +1342,7 @@ static bool ts_parser__recover_to_state(
     ts_subtree_array_remove_trailing_extras(&slice.subtrees, &self->trailing_extras);
 
     if (slice.subtrees.size > 0) {
-      Subtree error = ts_subtree_new_error_node(&slice.subtrees, true, self->language);
+      Subtree error = ts_subtree_new_error_node(&self->tree_pool, &slice.subtrees, true, self->language);
       ts_stack_push(self->stack, slice.version, error, false, goal_state);
     } else {
       array_delete(&slice.subtrees);
@@ -1211,6 +1370,7 @@ static void ts_parser__recover(
   StackSummary *summary = ts_stack_get_summary(self->stack, version);
   unsigned node_count_since_error = ts_stack_node_count_since_error(self->stack, version);
   unsigned current_error_cost = ts_stack_error_cost(self->stack, version);
+  bool exhausted_budget = ts_parser__exhausted_error_recovery_budget(self);
 
   // When the parser is in the error state, there are two strategies for recovering with a
   // given lookahead token:
@@ -1279,8 +1439,12 @@ static void ts_parser__recover(
   // the current lookahead token. Now, in addition, try strategy 2 described above: skip the
   // current lookahead token by wrapping it in an ERROR node.
 
-  // Don't pursue this additional strategy if there are already too many stack versions.
-  if (did_recover && ts_stack_version_count(self->stack) > MAX_VERSION_COUNT) {
+  // Don't pursue this additional strategy if there are already too many stack versions,
+  // or if the error recovery budget has been used up.
+  if (did_recover && (
+    ts_stack_version_count(self->stack) > MAX_VERSION_COUNT ||
+    exhausted_budget
+  )) {
     ts_stack_halt(self->stack, version);
     ts_subtree_release(&self->tree_pool, lookahead);
     return;
@@ -1291,7 +1455,7 @@ static void ts_parser__recover(
   if (ts_subtree_is_eof(lookahead)) {
     LOG("recover_eof");
     SubtreeArray children = array_new();
-    Subtree parent = ts_subtree_new_error_node(&children, false, self->language);
+    Subtree parent = ts_subtree_new_error_node(&self->tree_pool, &children, false, self->language);
     ts_stack_push(self->stack, version, parent, false, 1);
     ts_parser__accept(self, version, lookahead);
     return;
@@ -1324,6 +1488,7 @@ static void ts_parser__recover(
   array_reserve(&children, 1);
   array_push(&children, lookahead);
   MutableSubtree error_repeat = ts_subtree_new_node(
+    &self->tree_pool,
     ts_builtin_sym_error_repeat,
     &children,
     0,
@@ -1352,6 +1517,7 @@ static void ts_parser__recover(
     ts_stack_renumber_version(self->stack, pop.contents[0].version, version);
     array_push(&pop.contents[0].subtrees, ts_subtree_from_mut(error_repeat));
     error_repeat = ts_subtree_new_node(
+      &self->tree_pool,
       ts_builtin_sym_error_repeat,
       &pop.contents[0].subtrees,
       0,
@@ -1373,6 +1539,7 @@ static bool ts_parser__advance(
   StackVersion version,
   bool allow_node_reuse
 ) {
+  self->stats.advance_count++;
   TSStateId state = ts_stack_state(self->stack, version);
   uint32_t position = ts_stack_position(self->stack, version).bytes;
   Subtree last_external_token = ts_stack_last_external_token(self->stack, version);
@@ -1405,15 +1572,16 @@ static bool ts_parser__advance(
       lookahead = ts_parser__lex(self, version, state);
 
       if (lookahead.ptr) {
+        self->stats.token_count++;
         ts_parser__set_cached_token(self, position, last_external_token, lookahead);
-        ts_language_table_entry(self->language, state, ts_subtree_symbol(lookahead), &table_entry);
+        ts_parser__table_entry(self, state, ts_subtree_symbol(lookahead), &table_entry);
       }
 
       // When parsing a non-terminal extra, a null lookahead indicates the
       // end of the rule. The reduction is stored in the EOF table entry.
       // After the reduction, the lexer needs to be run again.
       else {
-        ts_language_table_entry(self->language, state, ts_builtin_sym_end, &table_entry);
+        ts_parser__table_entry(self, state, ts_builtin_sym_end, &table_entry);
       }
     }
 
@@ -1422,13 +1590,27 @@ static bool ts_parser__advance(
     if (++self->operation_count == OP_COUNT_PER_TIMEOUT_CHECK) {
       self->operation_count = 0;
     }
-    if (
-      self->operation_count == 0 &&
-      ((self->cancellation_flag && atomic_load(self->cancellation_flag)) ||
-       (!clock_is_null(self->end_clock) && clock_is_gt(clock_now(), self->end_clock)))
-    ) {
-      ts_subtree_release(&self->tree_pool, lookahead);
-      return false;
+    if (self->operation_count == 0) {
+      if (
+        self->memory_limit &&
+        self->tree_pool.allocated_bytes - self->parse_start_allocated_bytes > self->memory_limit
+      ) {
+        self->exceeded_memory_limit = true;
+        ts_subtree_release(&self->tree_pool, lookahead);
+        return false;
+      }
+      if (
+        (self->cancellation_flag && atomic_load(self->cancellation_flag)) ||
+        (!clock_is_null(self->end_clock) && clock_is_gt(clock_now(), self->end_clock)) ||
+        (self->progress_callback.progress && self->progress_callback.progress(
+          self->progress_callback.payload,
+          ts_stack_position(self->stack, version).bytes,
+          ts_stack_version_count(self->stack)
+        ))
+      ) {
+        ts_subtree_release(&self->tree_pool, lookahead);
+        return false;
+      }
     }
 
     // Process each parse action for the current lookahead token in
@@ -1513,8 +1695,8 @@ static bool ts_parser__advance(
         continue;
       }
 
-      ts_language_table_entry(
-        self->language,
+      ts_parser__table_entry(
+        self,
         state,
         ts_subtree_leaf_symbol(lookahead),
         &table_entry
@@ -1535,7 +1717,7 @@ static bool ts_parser__advance(
       ts_subtree_is_keyword(lookahead) &&
       ts_subtree_symbol(lookahead) != self->language->keyword_capture_token
     ) {
-      ts_language_table_entry(self->language, state, self->language->keyword_capture_token, &table_entry);
+      ts_parser__table_entry(self, state, self->language->keyword_capture_token, &table_entry);
       if (table_entry.action_count > 0) {
         LOG(
           "switch from_keyword:%s, to_word_token:%s",
@@ -1566,6 +1748,7 @@ static bool ts_parser__advance(
     if (ts_parser__breakdown_top_of_stack(self, version)) {
       state = ts_stack_state(self->stack, version);
       ts_subtree_release(&self->tree_pool, lookahead);
+      self->stats.relex_count++;
       needs_lex = true;
       continue;
     }
@@ -1582,6 +1765,78 @@ static bool ts_parser__advance(
   }
 }
 
+// Determine whether a node with the given symbol, at the start of the document
+// and followed by the end of the input, is accepted as the root node.
+static bool ts_parser__is_root_symbol(TSParser *self, TSSymbol symbol) {
+  TableEntry entry;
+  TSStateId state = ts_language_next_state(self->language, 1, symbol);
+  ts_language_table_entry(self->language, state, ts_builtin_sym_end, &entry);
+  return entry.action_count > 0 && entry.actions[0].type == TSParseActionTypeAccept;
+}
+
+// Determine whether a node with the given symbol, at the bottom of the stack,
+// holds a repetition of the root node's children, so that it can only ever be
+// incorporated into the root node. This is the case when, at the start of the
+// document, the node is followed by the end of the input, and can be reduced
+// to a node that is accepted as the root.
+static bool ts_parser__is_top_level_repetition(TSParser *self, TSSymbol symbol) {
+  if (symbol == self->streaming_symbol) return self->streaming_symbol_is_top_level;
+
+  bool result = false;
+  if (
+    symbol >= self->language->token_count &&
+    !ts_language_symbol_metadata(self->language, symbol).visible
+  ) {
+    TableEntry entry;
+    TSStateId state = ts_language_next_state(self->language, 1, symbol);
+    ts_language_table_entry(self->language, state, ts_builtin_sym_end, &entry);
+    for (uint32_t i = 0; i < entry.action_count; i++) {
+      TSParseAction action = entry.actions[i];
+      if (
+        action.type == TSParseActionTypeReduce &&
+        action.reduce.child_count == 1 &&
+        ts_parser__is_root_symbol(self, action.reduce.symbol)
+      ) result = true;
+    }
+  }
+
+  self->streaming_symbol = symbol;
+  self->streaming_symbol_is_top_level = result;
+  return result;
+}
+
+// In streaming mode, pass the top-level nodes that can no longer change to the
+// streaming callback, and then release them. They are replaced on the stack by
+// a placeholder of the same size.
+static void ts_parser__stream_finished_nodes(TSParser *self) {
+  if (
+    ts_stack_version_count(self->stack) != 1 ||
+    !ts_stack_is_active(self->stack, 0) ||
+    ts_stack_state(self->stack, 0) == ERROR_STATE
+  ) return;
+
+  Subtree *bottom = ts_stack_bottom_subtree(self->stack, 0);
+  if (!bottom || ts_subtree_child_count(*bottom) == 0) return;
+  if (!ts_parser__is_top_level_repetition(self, ts_subtree_symbol(*bottom))) return;
+
+  Subtree finished_tree = *bottom;
+  ts_subtree_retain(finished_tree);
+  TSTree *tree = ts_tree_new(finished_tree, self->language, self->lexer.included_ranges, 0);
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  if (ts_tree_cursor_goto_first_child(&cursor)) {
+    do {
+      TSNode node = ts_tree_cursor_current_node(&cursor);
+      LOG("stream_node symbol:%s, end_byte:%u", SYM_NAME(ts_node_symbol(node)), ts_node_end_byte(node));
+      self->streaming_callback.node_finished(self->streaming_callback.payload, node);
+    } while (ts_tree_cursor_goto_next_sibling(&cursor));
+  }
+  ts_tree_cursor_delete(&cursor);
+  ts_tree_delete(tree);
+
+  *bottom = ts_subtree_new_placeholder(&self->tree_pool, finished_tree);
+  ts_subtree_release(&self->tree_pool, finished_tree);
+}
+
 static unsigned ts_parser__condense_stack(TSParser *self) {
   bool made_changes = false;
   unsigned min_error_cost = UINT_MAX;
@@ -1644,9 +1899,15 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
   }
 
   // Enfore a hard upper bound on the number of stack versions by
-  // discarding the least promising versions.
-  while (ts_stack_version_count(self->stack) > MAX_VERSION_COUNT) {
-    ts_stack_remove_version(self->stack, MAX_VERSION_COUNT);
+  // discarding the least promising versions. Once the error recovery
+  // budget has been used up, only keep the most promising version.
+  unsigned max_version_count = MAX_VERSION_COUNT;
+  if (
+    self->error_recovery_budget &&
+    self->error_recovery_count > self->error_recovery_budget
+  ) max_version_count = 1;
+  while (ts_stack_version_count(self->stack) > max_version_count) {
+    ts_stack_remove_version(self->stack, max_version_count);
     made_changes = true;
   }
 
@@ -1703,12 +1964,23 @@ TSParser *ts_parser_new(void) {
   self->dot_graph_file = NULL;
   self->cancellation_flag = NULL;
   self->timeout_duration = 0;
+  self->memory_limit = 0;
+  self->error_recovery_budget = 0;
+  self->error_recovery_count = 0;
   self->end_clock = clock_null();
   self->operation_count = 0;
   self->old_tree = NULL_SUBTREE;
   self->included_range_differences = (TSRangeArray) array_new();
   self->included_range_difference_index = 0;
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  self->arena_allocation = false;
+  self->deferred_balancing = false;
+  self->streaming_callback = (TSStreamingCallback) {NULL, NULL};
+  self->progress_callback = (TSProgressCallback) {NULL, NULL};
+  self->streaming_symbol = 0;
+  self->streaming_symbol_is_top_level = false;
+  self->arenas = (SubtreeArenaArray) array_new();
+  self->shared_nodes = (SubtreeSharingTable) {NULL, 0, 0};
+  ts_parser__clear_token_cache(self);
   return self;
 }
 
@@ -1728,12 +2000,14 @@ void ts_parser_delete(TSParser *self) {
     self->old_tree = NULL_SUBTREE;
   }
   ts_lexer_delete(&self->lexer);
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_token_cache(self);
+  ts_subtree_sharing_table_set_capacity(&self->shared_nodes, 0, &self->tree_pool);
   ts_subtree_pool_delete(&self->tree_pool);
   reusable_node_delete(&self->reusable_node);
   array_delete(&self->trailing_extras);
   array_delete(&self->trailing_extras2);
   array_delete(&self->scratch_trees);
+  array_delete(&self->arenas);
   ts_free(self);
 }
 
@@ -1758,6 +2032,10 @@ bool ts_parser_set_language(TSParser *self, const TSLanguage *language) {
   }
 
   self->language = language;
+  ts_lexer_set_language(&self->lexer, language);
+  self->streaming_symbol = 0;
+  ts_parser__clear_table_cache(self);
+  ts_subtree_sharing_table_clear(&self->shared_nodes, &self->tree_pool);
   ts_parser_reset(self);
   return true;
 }
@@ -1798,6 +2076,73 @@ void ts_parser_set_timeout_micros(TSParser *self, uint64_t timeout_micros) {
   self->timeout_duration = duration_from_micros(timeout_micros);
 }
 
+size_t ts_parser_memory_limit(const TSParser *self) {
+  return self->memory_limit;
+}
+
+void ts_parser_set_memory_limit(TSParser *self, size_t limit) {
+  self->memory_limit = limit;
+}
+
+uint32_t ts_parser_error_recovery_budget(const TSParser *self) {
+  return self->error_recovery_budget;
+}
+
+void ts_parser_set_error_recovery_budget(TSParser *self, uint32_t budget) {
+  self->error_recovery_budget = budget;
+}
+
+void ts_parser_stats(const TSParser *self, TSParserStats *stats) {
+  *stats = self->stats;
+  StackStats stack_stats = ts_stack_stats(self->stack);
+  stats->stack_node_count = stack_stats.node_count;
+  stats->stack_node_slab_count = stack_stats.node_slab_count;
+  stats->max_stack_version_count = stack_stats.max_version_count;
+  stats->subtree_allocation_count = self->tree_pool.allocation_count;
+  stats->parse_time_micros = duration_to_micros(self->parse_duration);
+  stats->balance_time_micros = duration_to_micros(self->balance_duration);
+}
+
+bool ts_parser_arena_allocation(const TSParser *self) {
+  return self->arena_allocation;
+}
+
+void ts_parser_set_arena_allocation(TSParser *self, bool enabled) {
+  self->arena_allocation = enabled;
+}
+
+TSStreamingCallback ts_parser_streaming_callback(const TSParser *self) {
+  return self->streaming_callback;
+}
+
+void ts_parser_set_streaming_callback(TSParser *self, TSStreamingCallback callback) {
+  self->streaming_callback = callback;
+}
+
+TSProgressCallback ts_parser_progress_callback(const TSParser *self) {
+  return self->progress_callback;
+}
+
+void ts_parser_set_progress_callback(TSParser *self, TSProgressCallback callback) {
+  self->progress_callback = callback;
+}
+
+bool ts_parser_deferred_balancing(const TSParser *self) {
+  return self->deferred_balancing;
+}
+
+void ts_parser_set_deferred_balancing(TSParser *self, bool enabled) {
+  self->deferred_balancing = enabled;
+}
+
+uint32_t ts_parser_node_sharing_capacity(const TSParser *self) {
+  return self->shared_nodes.capacity;
+}
+
+void ts_parser_set_node_sharing_capacity(TSParser *self, uint32_t capacity) {
+  ts_subtree_sharing_table_set_capacity(&self->shared_nodes, capacity, &self->tree_pool);
+}
+
 bool ts_parser_set_included_ranges(
   TSParser *self,
   const TSRange *ranges,
@@ -1806,13 +2151,27 @@ bool ts_parser_set_included_ranges(
   return ts_lexer_set_included_ranges(&self->lexer, ranges, count);
 }
 
+bool ts_parser_update_included_ranges(
+  TSParser *self,
+  uint32_t start_index,
+  uint32_t old_count,
+  const TSRange *ranges,
+  uint32_t count
+) {
+  return ts_lexer_update_included_ranges(&self->lexer, start_index, old_count, ranges, count);
+}
+
 const TSRange *ts_parser_included_ranges(const TSParser *self, uint32_t *count) {
   return ts_lexer_included_ranges(&self->lexer, count);
 }
 
 void ts_parser_reset(TSParser *self) {
+  ts_parser__clear_external_scanner_states(self);
   if (self->language && self->language->external_scanner.deserialize) {
     self->language->external_scanner.deserialize(self->external_scanner_payload, NULL, 0);
+    ExternalScannerState empty_state;
+    ts_external_scanner_state_init(&empty_state, NULL, 0);
+    ts_parser__set_external_scanner_state(self, &empty_state);
   }
 
   if (self->old_tree.ptr) {
@@ -1823,23 +2182,20 @@ void ts_parser_reset(TSParser *self) {
   reusable_node_clear(&self->reusable_node);
   ts_lexer_reset(&self->lexer, length_zero());
   ts_stack_clear(self->stack);
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_token_cache(self);
   if (self->finished_tree.ptr) {
     ts_subtree_release(&self->tree_pool, self->finished_tree);
     self->finished_tree = NULL_SUBTREE;
   }
+  self->tree_pool.arena = NULL;
+  ts_subtree_arena_array_clear(&self->arenas);
   self->accept_count = 0;
+  self->parse_start_allocated_bytes = self->tree_pool.allocated_bytes;
+  self->exceeded_memory_limit = false;
+  self->error_recovery_count = 0;
 }
 
-TSTree *ts_parser_parse(
-  TSParser *self,
-  const TSTree *old_tree,
-  TSInput input
-) {
-  if (!self->language || !input.read) return NULL;
-
-  ts_lexer_set_input(&self->lexer, input);
-
+static TSTree *ts_parser__parse(TSParser *self, const TSTree *old_tree) {
   array_clear(&self->included_range_differences);
   self->included_range_difference_index = 0;
 
@@ -1848,6 +2204,7 @@ TSTree *ts_parser_parse(
   } else if (old_tree) {
     ts_subtree_retain(old_tree->root);
     self->old_tree = old_tree->root;
+    ts_subtree_arena_array_copy(&old_tree->arenas, &self->arenas);
     ts_range_array_get_changed_ranges(
       old_tree->included_ranges, old_tree->included_range_count,
       self->lexer.included_ranges, self->lexer.included_range_count,
@@ -1865,10 +2222,20 @@ TSTree *ts_parser_parse(
     LOG("new_parse");
   }
 
+  // When resuming, the arena of the interrupted parse is still in use. After
+  // an edit, the new nodes are allocated individually, because the new tree
+  // keeps the old tree's arenas alive. Otherwise, every tree in a long editing
+  // session would keep the arenas of all of its predecessors alive.
+  if (self->arena_allocation && !self->tree_pool.arena && !self->old_tree.ptr) {
+    self->tree_pool.arena = ts_subtree_arena_new();
+    array_push(&self->arenas, self->tree_pool.arena);
+  }
+
   uint32_t position = 0, last_position = 0, version_count = 0;
   self->operation_count = 0;
+  TSClock start_clock = clock_now();
   if (self->timeout_duration) {
-    self->end_clock = clock_after(clock_now(), self->timeout_duration);
+    self->end_clock = clock_after(start_clock, self->timeout_duration);
   } else {
     self->end_clock = clock_null();
   }
@@ -1885,7 +2252,14 @@ TSTree *ts_parser_parse(
             ts_stack_position(self->stack, version).extent.row,
             ts_stack_position(self->stack, version).extent.column);
 
-        if (!ts_parser__advance(self, version, allow_node_reuse)) return NULL;
+        if (!ts_parser__advance(self, version, allow_node_reuse)) {
+          self->parse_duration += clock_duration(start_clock, clock_now());
+          if (self->exceeded_memory_limit) {
+            LOG("exceeded_memory_limit");
+            ts_parser_reset(self);
+          }
+          return NULL;
+        }
         LOG_STACK();
 
         position = ts_stack_position(self->stack, version).bytes;
@@ -1901,6 +2275,10 @@ TSTree *ts_parser_parse(
       break;
     }
 
+    if (self->streaming_callback.node_finished && !self->finished_tree.ptr) {
+      ts_parser__stream_finished_nodes(self);
+    }
+
     while (self->included_range_difference_index < self->included_range_differences.size) {
       TSRange *range = &self->included_range_differences.contents[self->included_range_difference_index];
       if (range->end_byte <= position) {
@@ -1911,21 +2289,55 @@ TSTree *ts_parser_parse(
     }
   } while (version_count != 0);
 
-  ts_subtree_balance(self->finished_tree, &self->tree_pool, self->language);
+  TSClock balance_clock = clock_now();
+  self->parse_duration += clock_duration(start_clock, balance_clock);
+  if (!self->deferred_balancing) {
+    ts_subtree_balance(self->finished_tree, &self->tree_pool, self->language);
+    self->balance_duration += clock_duration(balance_clock, clock_now());
+  }
   LOG("done");
   LOG_TREE(self->finished_tree);
 
+  // Nodes that were reused from an old tree may already appear in the sharing
+  // table, and could then be shared twice within the new tree. Unbalanced and
+  // arena-allocated trees are not shared either, because shared nodes can no
+  // longer be balanced in place, and must outlive any one arena.
+  bool should_share_nodes =
+    !self->old_tree.ptr &&
+    !self->deferred_balancing &&
+    !self->arena_allocation;
+
   TSTree *result = ts_tree_new(
     self->finished_tree,
     self->language,
     self->lexer.included_ranges,
     self->lexer.included_range_count
   );
+  ts_subtree_arena_array_copy(&self->arenas, &result->arenas);
+  result->is_balanced = !self->deferred_balancing;
   self->finished_tree = NULL_SUBTREE;
   ts_parser_reset(self);
+  if (should_share_nodes) {
+    result->root = ts_subtree_share(
+      result->root,
+      &self->shared_nodes,
+      &self->tree_pool,
+      &self->stats.shared_node_count
+    );
+  }
   return result;
 }
 
+TSTree *ts_parser_parse(
+  TSParser *self,
+  const TSTree *old_tree,
+  TSInput input
+) {
+  if (!self->language || !input.read) return NULL;
+  ts_lexer_set_input(&self->lexer, input);
+  return ts_parser__parse(self, old_tree);
+}
+
 TSTree *ts_parser_parse_string(
   TSParser *self,
   const TSTree *old_tree,
@@ -1937,12 +2349,122 @@ TSTree *ts_parser_parse_string(
 
 TSTree *ts_parser_parse_string_encoding(TSParser *self, const TSTree *old_tree,
                                         const char *string, uint32_t length, TSInputEncoding encoding) {
-  TSStringInput input = {string, length};
-  return ts_parser_parse(self, old_tree, (TSInput) {
-    &input,
-    ts_string_input_read,
-    encoding,
-  });
+  if (!self->language) return NULL;
+  ts_lexer_set_input_buffer(&self->lexer, string, length, encoding);
+  return ts_parser__parse(self, old_tree);
+}
+
+TSTree *ts_parser_provisional_tree(TSParser *self) {
+  if (!self->language || !ts_parser_has_outstanding_parse(self)) return NULL;
+
+  TSSymbol root_symbol = ts_builtin_sym_error;
+  for (TSSymbol symbol = self->language->token_count; symbol < self->language->symbol_count; symbol++) {
+    if (ts_parser__is_root_symbol(self, symbol)) {
+      root_symbol = symbol;
+      break;
+    }
+  }
+
+  SubtreeArray children = ts_stack_subtrees(self->stack, 0);
+  Subtree root = ts_subtree_from_mut(ts_subtree_new_node(
+    &self->tree_pool,
+    root_symbol,
+    &children,
+    0,
+    self->language
+  ));
+  TSTree *result = ts_tree_new(
+    root,
+    self->language,
+    self->lexer.included_ranges,
+    self->lexer.included_range_count
+  );
+  ts_subtree_arena_array_copy(&self->arenas, &result->arenas);
+  result->is_balanced = false;
+  return result;
+}
+
+// TSParserPool
+
+struct TSParserPool {
+  const TSLanguage *language;
+  void *volatile *parsers;
+  uint32_t capacity;
+};
+
+TSParserPool *ts_parser_pool_new(const TSLanguage *language, uint32_t capacity) {
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, language)) {
+    ts_parser_delete(parser);
+    return NULL;
+  }
+
+  TSParserPool *self = ts_malloc(sizeof(TSParserPool));
+  self->language = language;
+  self->capacity = capacity;
+  self->parsers = ts_calloc(capacity, sizeof(void *));
+  if (capacity > 0) {
+    self->parsers[0] = parser;
+  } else {
+    ts_parser_delete(parser);
+  }
+  return self;
+}
+
+void ts_parser_pool_delete(TSParserPool *self) {
+  if (!self) return;
+  for (uint32_t i = 0; i < self->capacity; i++) {
+    ts_parser_delete(self->parsers[i]);
+  }
+  ts_free((void *)self->parsers);
+  ts_free(self);
+}
+
+const TSLanguage *ts_parser_pool_language(const TSParserPool *self) {
+  return self->language;
+}
+
+TSParser *ts_parser_pool_acquire(TSParserPool *self) {
+  for (uint32_t i = 0; i < self->capacity; i++) {
+    void *parser = atomic_load_ptr(&self->parsers[i]);
+    if (parser && atomic_compare_exchange_ptr(&self->parsers[i], parser, NULL)) {
+      return parser;
+    }
+  }
+
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, self->language);
+  return parser;
+}
+
+void ts_parser_pool_release(TSParserPool *self, TSParser *parser) {
+  if (!parser) return;
+
+  // Restore the parser's default configuration, but keep the memory that it
+  // has allocated for parsing.
+  ts_parser_reset(parser);
+  if (parser->language != self->language) {
+    ts_parser_set_language(parser, self->language);
+  }
+  ts_parser_set_included_ranges(parser, NULL, 0);
+  ts_parser_set_timeout_micros(parser, 0);
+  ts_parser_set_memory_limit(parser, 0);
+  ts_parser_set_error_recovery_budget(parser, 0);
+  ts_parser_set_cancellation_flag(parser, NULL);
+  ts_parser_set_arena_allocation(parser, false);
+  ts_parser_set_deferred_balancing(parser, false);
+  ts_parser_set_node_sharing_capacity(parser, 0);
+  ts_parser_set_streaming_callback(parser, (TSStreamingCallback) {NULL, NULL});
+  ts_parser_set_progress_callback(parser, (TSProgressCallback) {NULL, NULL});
+  ts_parser_set_logger(parser, (TSLogger) {NULL, NULL});
+  ts_parser_print_dot_graphs(parser, -1);
+
+  for (uint32_t i = 0; i < self->capacity; i++) {
+    if (atomic_compare_exchange_ptr(&self->parsers[i], NULL, parser)) {
+      return;
+    }
+  }
+  ts_parser_delete(parser);
 }
 
 #undef LOG
@@ -4,7 +4,9 @@
 #include "./language.h"
 #include "./point.h"
 #include "./tree_cursor.h"
+#include "./tree.h"
 #include "./unicode.h"
+#include <stddef.h>
 #include <wctype.h>
 
 // #define DEBUG_ANALYZE_QUERY
@@ -141,8 +143,48 @@ typedef struct {
   Slice steps;
   Slice predicate_steps;
   uint32_t start_byte;
+  uint32_t source_query_index;
+  uint64_t descendant_symbol_mask;
 } QueryPattern;
 
+/*
+ * TextPredicate - A predicate on the text of a pattern's captures that the
+ * query cursor can evaluate itself, compiled from the pattern's `#eq?`,
+ * `#not-eq?`, `#match?` and `#not-match?` predicates. Only regexes that
+ * consist of a literal string, optionally anchored with `^` or `$`, are
+ * compiled. The `text` slice refers to the query's `predicate_values`
+ * characters, and `other_capture_id` is used when comparing two captures.
+ */
+typedef enum {
+  TextPredicateTypeEqString,
+  TextPredicateTypeEqCapture,
+  TextPredicateTypePrefix,
+  TextPredicateTypeSuffix,
+  TextPredicateTypeContains,
+} TextPredicateType;
+
+typedef struct {
+  Slice text;
+  uint16_t capture_id;
+  uint16_t other_capture_id;
+  uint8_t type;
+  bool is_positive;
+} TextPredicate;
+
+/*
+ * SymbolFilter - The symbols that a subtree must contain in order for a
+ * particular pattern to match within it, represented as masks of the bits
+ * returned by `ts_symbol_mask_bit`:
+ * - `first_symbols` - the symbols with which the pattern can start. A subtree
+ *   must contain at least one of these, unless the mask is empty.
+ * - `required_symbols` - the symbols that occur in every match of the pattern.
+ *   A subtree must contain all of these.
+ */
+typedef struct {
+  uint64_t first_symbols;
+  uint64_t required_symbols;
+} SymbolFilter;
+
 typedef struct {
   uint32_t byte_offset;
   uint16_t step_index;
@@ -200,11 +242,11 @@ typedef struct {
   // never allow `list` to allocate more entries than this, dropping pending
   // matches if needed to stay under the limit.
   uint32_t max_capture_list_count;
-  // The number of capture lists allocated in `list` that are not currently in
+  // The ids of the capture lists allocated in `list` that are not currently in
   // use. We reuse those existing-but-unused capture lists before trying to
   // allocate any new ones. We use an invalid value (UINT32_MAX) for a capture
   // list's length to indicate that it's not in use.
-  uint32_t free_capture_list_count;
+  Array(uint16_t) free_list;
 } CaptureListPool;
 
 /*
@@ -265,13 +307,21 @@ struct TSQuery {
   SymbolTable predicate_values;
   Array(QueryStep) steps;
   Array(PatternEntry) pattern_map;
+  Array(uint32_t) pattern_map_index;
   Array(TSQueryPredicateStep) predicate_steps;
   Array(QueryPattern) patterns;
   Array(StepOffset) step_offsets;
   Array(TSFieldId) negated_fields;
   Array(char) string_buffer;
+  Array(SymbolFilter) symbol_filters;
+  Array(TextPredicate) text_predicates;
+  Array(Slice) text_predicates_by_pattern;
   const TSLanguage *language;
+  uint64_t source_hash;
+  uint32_t source_length;
   uint16_t wildcard_root_pattern_count;
+  bool has_unrooted_patterns;
+  bool uses_symbol_masks;
 };
 
 /*
@@ -289,9 +339,15 @@ struct TSQueryCursor {
   TSPoint start_point;
   TSPoint end_point;
   uint32_t next_state_id;
+  TSQueryCursorStats stats;
   bool ascending;
   bool halted;
+  const char *text;
+  uint32_t text_length;
+  uint32_t retained_state_count;
+  uint32_t retained_capture_list_count;
   bool did_exceed_match_limit;
+  bool streaming;
 };
 
 static const TSQueryError PARENT_DONE = -1;
@@ -388,23 +444,27 @@ static CaptureListPool capture_list_pool_new(void) {
     .list = array_new(),
     .empty_list = array_new(),
     .max_capture_list_count = UINT32_MAX,
-    .free_capture_list_count = 0,
+    .free_list = array_new(),
   };
 }
 
 static void capture_list_pool_reset(CaptureListPool *self) {
-  for (uint16_t i = 0; i < self->list.size; i++) {
+  // Push the ids in reverse order, so that the lowest ids are reused first.
+  array_clear(&self->free_list);
+  array_reserve_tracked(&self->free_list, TSAllocationCategoryCaptureList, self->list.size);
+  for (uint16_t i = self->list.size; i > 0; i--) {
     // This invalid size means that the list is not in use.
-    self->list.contents[i].size = UINT32_MAX;
+    self->list.contents[i - 1].size = UINT32_MAX;
+    array_push_tracked(&self->free_list, TSAllocationCategoryCaptureList, i - 1);
   }
-  self->free_capture_list_count = self->list.size;
 }
 
 static void capture_list_pool_delete(CaptureListPool *self) {
   for (uint16_t i = 0; i < self->list.size; i++) {
-    array_delete(&self->list.contents[i]);
+    array_delete_tracked(&self->list.contents[i], TSAllocationCategoryCaptureList);
   }
-  array_delete(&self->list);
+  array_delete_tracked(&self->list, TSAllocationCategoryCaptureList);
+  array_delete_tracked(&self->free_list, TSAllocationCategoryCaptureList);
 }
 
 static const CaptureList *capture_list_pool_get(const CaptureListPool *self, uint16_t id) {
@@ -420,37 +480,65 @@ static CaptureList *capture_list_pool_get_mut(CaptureListPool *self, uint16_t id
 static bool capture_list_pool_is_empty(const CaptureListPool *self) {
   // The capture list pool is empty if all allocated lists are in use, and we
   // have reached the maximum allowed number of allocated lists.
-  return self->free_capture_list_count == 0 && self->list.size >= self->max_capture_list_count;
+  return self->free_list.size == 0 && self->list.size >= self->max_capture_list_count;
 }
 
 static uint16_t capture_list_pool_acquire(CaptureListPool *self) {
   // First see if any already allocated capture list is currently unused.
-  if (self->free_capture_list_count > 0) {
-    for (uint16_t i = 0; i < self->list.size; i++) {
-      if (self->list.contents[i].size == UINT32_MAX) {
-        array_clear(&self->list.contents[i]);
-        self->free_capture_list_count--;
-        return i;
-      }
-    }
+  if (self->free_list.size > 0) {
+    uint16_t i = array_pop(&self->free_list);
+    array_clear(&self->list.contents[i]);
+    return i;
   }
 
   // Otherwise allocate and initialize a new capture list, as long as that
   // doesn't put us over the requested maximum.
   uint32_t i = self->list.size;
-  if (i >= self->max_capture_list_count) {
+  if (i >= self->max_capture_list_count || i >= NONE) {
     return NONE;
   }
   CaptureList list;
   array_init(&list);
-  array_push(&self->list, list);
+  array_push_tracked(&self->list, TSAllocationCategoryCaptureList, list);
   return i;
 }
 
 static void capture_list_pool_release(CaptureListPool *self, uint16_t id) {
-  if (id >= self->list.size) return;
+  if (id >= self->list.size || self->list.contents[id].size == UINT32_MAX) return;
   self->list.contents[id].size = UINT32_MAX;
-  self->free_capture_list_count++;
+  array_push_tracked(&self->free_list, TSAllocationCategoryCaptureList, id);
+}
+
+static uint32_t capture_list_pool_used_count(const CaptureListPool *self) {
+  return self->list.size - self->free_list.size;
+}
+
+// Allocate unused capture lists up front, each with room for a few captures,
+// so that executing a query doesn't need to allocate them one at a time.
+static void capture_list_pool_reserve(CaptureListPool *self, uint32_t count) {
+  if (count > self->max_capture_list_count) count = self->max_capture_list_count;
+  if (count > NONE) count = NONE;
+  array_reserve_tracked(&self->list, TSAllocationCategoryCaptureList, count);
+  while (self->list.size < count) {
+    CaptureList list = array_new();
+    array_reserve_tracked(&list, TSAllocationCategoryCaptureList, 8);
+    list.size = UINT32_MAX;
+    array_push_tracked(&self->free_list, TSAllocationCategoryCaptureList, self->list.size);
+    array_push_tracked(&self->list, TSAllocationCategoryCaptureList, list);
+  }
+}
+
+// Free the capture lists beyond the given count. This must only be called
+// while none of the lists are in use.
+static void capture_list_pool_trim(CaptureListPool *self, uint32_t count) {
+  if (self->list.size <= count) return;
+  for (uint32_t i = count; i < self->list.size; i++) {
+    array_delete_tracked(&self->list.contents[i], TSAllocationCategoryCaptureList);
+  }
+  self->list.size = count;
+  array_shrink_tracked(&self->list, TSAllocationCategoryCaptureList, count);
+  array_clear(&self->free_list);
+  array_shrink_tracked(&self->free_list, TSAllocationCategoryCaptureList, count);
 }
 
 /**************
@@ -741,6 +829,38 @@ static inline bool ts_query__pattern_map_search(
   return needle == symbol;
 }
 
+// Once the pattern map is complete, index it by symbol, so that the query cursor
+// can find the patterns for each node's symbol directly rather than searching.
+// Each symbol's entries start at `pattern_map_index[symbol]` and end where the
+// next symbol's entries start.
+static void ts_query__index_pattern_map(TSQuery *self) {
+  uint32_t symbol_count = ts_language_symbol_count(self->language);
+  array_clear(&self->pattern_map_index);
+  array_reserve(&self->pattern_map_index, symbol_count + 1);
+  uint32_t index = self->wildcard_root_pattern_count;
+  for (uint32_t symbol = 0; symbol <= symbol_count; symbol++) {
+    while (
+      index < self->pattern_map.size &&
+      self->steps.contents[self->pattern_map.contents[index].step_index].symbol < symbol
+    ) index++;
+    array_push(&self->pattern_map_index, index);
+  }
+}
+
+// Find the first pattern map entry for the given symbol, using the symbol index
+// when the symbol belongs to the language's symbol table.
+static inline bool ts_query__pattern_map_find(
+  const TSQuery *self,
+  TSSymbol symbol,
+  uint32_t *result
+) {
+  if ((uint32_t)symbol + 1 < self->pattern_map_index.size) {
+    *result = self->pattern_map_index.contents[symbol];
+    return *result < self->pattern_map_index.contents[symbol + 1];
+  }
+  return ts_query__pattern_map_search(self, symbol, result);
+}
+
 // Insert a new pattern's start index into the pattern map, maintaining
 // the pattern map's ordering invariant.
 static inline void ts_query__pattern_map_insert(
@@ -770,6 +890,100 @@ static inline void ts_query__pattern_map_insert(
   array_insert(&self->pattern_map, index, new_entry);
 }
 
+// Compute masks of the symbols that must be present in the tree in order for
+// the given pattern to match. A step is required unless an alternative, an
+// optional step, or a repeated step allows it to be skipped. `*descendants`
+// only includes the required steps that are nested inside of the pattern's
+// root nodes.
+static void ts_query__pattern_required_symbols(
+  const TSQuery *self,
+  uint32_t pattern_index,
+  uint64_t *required,
+  uint64_t *descendants
+) {
+  *required = 0;
+  *descendants = 0;
+  Slice steps = self->patterns.contents[pattern_index].steps;
+  for (uint32_t i = steps.offset; i < steps.offset + steps.length; i++) {
+    QueryStep *step = &self->steps.contents[i];
+    if (
+      step->depth == PATTERN_DONE_MARKER ||
+      step->symbol == WILDCARD_SYMBOL ||
+      step->is_dead_end ||
+      step->is_pass_through ||
+      ts_language_symbol_metadata(self->language, step->symbol).supertype
+    ) continue;
+
+    bool can_be_skipped = false;
+    for (uint32_t j = steps.offset; j <= i; j++) {
+      uint16_t alternative_index = self->steps.contents[j].alternative_index;
+      if (alternative_index != NONE && alternative_index > i) {
+        can_be_skipped = true;
+        break;
+      }
+    }
+    if (can_be_skipped) continue;
+
+    uint64_t bit = ts_symbol_mask_bit(step->symbol);
+    *required |= bit;
+    if (step->depth > 0) *descendants |= bit;
+  }
+}
+
+// Returns true if every subtree that passes filter `a` also passes filter `b`.
+static inline bool symbol_filter__implies(SymbolFilter a, SymbolFilter b) {
+  return
+    (b.required_symbols & ~a.required_symbols) == 0 &&
+    (!b.first_symbols || (a.first_symbols && (a.first_symbols & ~b.first_symbols) == 0));
+}
+
+// Add a pattern's filter to the query's list of symbol filters. A subtree can
+// only contain a match if it passes at least one of the filters, so any filter
+// that implies another one is redundant.
+static void ts_query__add_symbol_filter(TSQuery *self, SymbolFilter filter) {
+  for (unsigned i = 0; i < self->symbol_filters.size; i++) {
+    if (symbol_filter__implies(filter, self->symbol_filters.contents[i])) return;
+  }
+  for (unsigned i = 0; i < self->symbol_filters.size; i++) {
+    if (symbol_filter__implies(self->symbol_filters.contents[i], filter)) {
+      array_erase(&self->symbol_filters, i);
+      i--;
+    }
+  }
+  array_push(&self->symbol_filters, filter);
+}
+
+// Determine whether a pattern can start at a node whose descendants contain
+// the given symbols. Only rooted patterns can be ruled out, because the other
+// steps of an unrooted pattern may match the node's siblings.
+static inline bool ts_query__pattern_can_start(
+  const TSQuery *self,
+  const PatternEntry *entry,
+  const QueryStep *step,
+  uint64_t descendant_symbols
+) {
+  if (!entry->is_rooted || step->depth > 0) return true;
+  uint64_t mask = self->patterns.contents[entry->pattern_index].descendant_symbol_mask;
+  return (descendant_symbols & mask) == mask;
+}
+
+// Determine whether any pattern could match within a node whose descendants
+// contain the given symbols.
+static inline bool ts_query__can_match_within(
+  const TSQuery *self,
+  uint64_t descendant_symbols
+) {
+  if (self->symbol_filters.size == 0) return true;
+  for (unsigned i = 0; i < self->symbol_filters.size; i++) {
+    SymbolFilter *filter = &self->symbol_filters.contents[i];
+    if (
+      (descendant_symbols & filter->required_symbols) == filter->required_symbols &&
+      (!filter->first_symbols || (descendant_symbols & filter->first_symbols))
+    ) return true;
+  }
+  return false;
+}
+
 static bool ts_query__analyze_patterns(TSQuery *self, unsigned *error_offset) {
   // Walk forward through all of the steps in the query, computing some
   // basic information about each step. Mark all of the steps that contain
@@ -1677,6 +1891,94 @@ static TSQueryError ts_query__parse_predicate(
   return 0;
 }
 
+static bool ts_query__is_literal_regex(const char *regex, uint32_t length) {
+  for (uint32_t i = 0; i < length; i++) {
+    if (strchr("\\.+*?()|[]{}^$", regex[i])) return false;
+  }
+  return true;
+}
+
+// Compile the text predicates that the query cursor can evaluate natively
+// from the query's predicate steps. These are derived data, so they are not
+// serialized, and are recomputed when a query is deserialized.
+static void ts_query__compile_text_predicates(TSQuery *self) {
+  array_clear(&self->text_predicates);
+  array_clear(&self->text_predicates_by_pattern);
+  for (unsigned i = 0; i < self->patterns.size; i++) {
+    Slice predicate_steps = self->patterns.contents[i].predicate_steps;
+    Slice text_predicates = {.offset = self->text_predicates.size, .length = 0};
+    const TSQueryPredicateStep *steps = &self->predicate_steps.contents[predicate_steps.offset];
+    for (unsigned j = 0, start = 0; j < predicate_steps.length; j++) {
+      if (steps[j].type != TSQueryPredicateStepTypeDone) continue;
+      const TSQueryPredicateStep *p = &steps[start];
+      unsigned step_count = j - start;
+      start = j + 1;
+      if (
+        step_count != 3 ||
+        p[0].type != TSQueryPredicateStepTypeString ||
+        p[1].type != TSQueryPredicateStepTypeCapture
+      ) continue;
+
+      uint32_t name_length;
+      const char *name = symbol_table_name_for_id(
+        &self->predicate_values,
+        p[0].value_id,
+        &name_length
+      );
+      TextPredicate predicate = {
+        .capture_id = p[1].value_id,
+        .other_capture_id = NONE,
+      };
+      bool is_eq;
+      if (name_length == 3 && !strncmp(name, "eq?", 3)) {
+        is_eq = predicate.is_positive = true;
+      } else if (name_length == 7 && !strncmp(name, "not-eq?", 7)) {
+        is_eq = true;
+      } else if (name_length == 6 && !strncmp(name, "match?", 6)) {
+        is_eq = false;
+        predicate.is_positive = true;
+      } else if (name_length == 10 && !strncmp(name, "not-match?", 10)) {
+        is_eq = false;
+      } else {
+        continue;
+      }
+
+      if (p[2].type == TSQueryPredicateStepTypeCapture) {
+        if (!is_eq) continue;
+        predicate.type = TextPredicateTypeEqCapture;
+        predicate.other_capture_id = p[2].value_id;
+      } else {
+        predicate.text = self->predicate_values.slices.contents[p[2].value_id];
+        if (is_eq) {
+          predicate.type = TextPredicateTypeEqString;
+        } else {
+          const char *regex = &self->predicate_values.characters.contents[predicate.text.offset];
+          bool is_prefix = predicate.text.length > 0 && regex[0] == '^';
+          bool is_suffix = predicate.text.length > is_prefix && regex[predicate.text.length - 1] == '$';
+          if (is_prefix) {
+            predicate.text.offset++;
+            predicate.text.length--;
+          }
+          if (is_suffix) predicate.text.length--;
+          if (!ts_query__is_literal_regex(regex + is_prefix, predicate.text.length)) continue;
+          if (is_prefix && is_suffix) {
+            predicate.type = TextPredicateTypeEqString;
+          } else if (is_prefix) {
+            predicate.type = TextPredicateTypePrefix;
+          } else if (is_suffix) {
+            predicate.type = TextPredicateTypeSuffix;
+          } else {
+            predicate.type = TextPredicateTypeContains;
+          }
+        }
+      }
+      array_push(&self->text_predicates, predicate);
+      text_predicates.length++;
+    }
+    array_push(&self->text_predicates_by_pattern, text_predicates);
+  }
+}
+
 // Read one S-expression pattern from the stream, and incorporate it into
 // the query's internal state machine representation. For nested patterns,
 // this function calls itself recursively.
@@ -2119,26 +2421,42 @@ static TSQueryError ts_query__parse_pattern(
   return 0;
 }
 
-TSQuery *ts_query_new(
-  const TSLanguage *language,
-  const char *source,
-  uint32_t source_len,
-  uint32_t *error_offset,
-  TSQueryError *error_type
+#define QUERY_HASH_MULTIPLIER 0x100000001b3ull
+
+// A polynomial hash, so that the hash of a concatenation of sources can be
+// computed from the hashes and lengths of the individual sources.
+static uint64_t ts_query__hash(const char *source, uint32_t length) {
+  uint64_t hash = 0;
+  for (uint32_t i = 0; i < length; i++) {
+    hash = hash * QUERY_HASH_MULTIPLIER + (uint8_t)source[i];
+  }
+  return hash;
+}
+
+static uint64_t ts_query__hash_concatenation(
+  uint64_t left_hash,
+  uint64_t right_hash,
+  uint32_t right_length
 ) {
-  if (
-    !language ||
-    language->version > TREE_SITTER_LANGUAGE_VERSION ||
-    language->version < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION
-  ) {
-    *error_type = TSQueryErrorLanguage;
-    return NULL;
+  uint64_t factor = 1;
+  uint64_t power = QUERY_HASH_MULTIPLIER;
+  for (uint32_t n = right_length; n > 0; n >>= 1) {
+    if (n & 1) factor *= power;
+    power *= power;
   }
+  return left_hash * factor + right_hash;
+}
 
+static TSQuery *ts_query__new(
+  const TSLanguage *language,
+  const char *source,
+  uint32_t source_len
+) {
   TSQuery *self = ts_malloc(sizeof(TSQuery));
   *self = (TSQuery) {
     .steps = array_new(),
     .pattern_map = array_new(),
+    .pattern_map_index = array_new(),
     .captures = symbol_table_new(),
     .predicate_values = symbol_table_new(),
     .predicate_steps = array_new(),
@@ -2146,9 +2464,36 @@ TSQuery *ts_query_new(
     .step_offsets = array_new(),
     .string_buffer = array_new(),
     .negated_fields = array_new(),
+    .symbol_filters = array_new(),
+    .text_predicates = array_new(),
+    .text_predicates_by_pattern = array_new(),
     .wildcard_root_pattern_count = 0,
+    .has_unrooted_patterns = false,
+    .uses_symbol_masks = false,
     .language = language,
+    .source_hash = ts_query__hash(source, source_len),
+    .source_length = source_len,
   };
+  return self;
+}
+
+TSQuery *ts_query_new(
+  const TSLanguage *language,
+  const char *source,
+  uint32_t source_len,
+  uint32_t *error_offset,
+  TSQueryError *error_type
+) {
+  if (
+    !language ||
+    language->version > TREE_SITTER_LANGUAGE_VERSION ||
+    language->version < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION
+  ) {
+    *error_type = TSQueryErrorLanguage;
+    return NULL;
+  }
+
+  TSQuery *self = ts_query__new(language, source, source_len);
 
   array_push(&self->negated_fields, 0);
 
@@ -2180,6 +2525,15 @@ TSQuery *ts_query_new(
       return NULL;
     }
 
+    // Determine which symbols must be present in a subtree in order for this
+    // pattern to match within it.
+    uint64_t required_symbols, descendant_symbols;
+    ts_query__pattern_required_symbols(self, pattern_index, &required_symbols, &descendant_symbols);
+    pattern->descendant_symbol_mask = descendant_symbols;
+    if (descendant_symbols) self->uses_symbol_masks = true;
+    SymbolFilter symbol_filter = {.first_symbols = 0, .required_symbols = required_symbols};
+    bool has_wildcard_root = false;
+
     // Maintain a map that can look up patterns for a given root symbol.
     uint16_t wildcard_root_alternative_index = NONE;
     for (;;) {
@@ -2207,6 +2561,7 @@ TSQuery *ts_query_new(
         QueryStep *step = &self->steps.contents[step_index];
         if (step->depth == start_depth) {
           is_rooted = false;
+          self->has_unrooted_patterns = true;
           break;
         }
       }
@@ -2218,6 +2573,9 @@ TSQuery *ts_query_new(
       });
       if (step->symbol == WILDCARD_SYMBOL) {
         self->wildcard_root_pattern_count++;
+        has_wildcard_root = true;
+      } else {
+        symbol_filter.first_symbols |= ts_symbol_mask_bit(step->symbol);
       }
 
       // If there are alternatives or options at the root of the pattern,
@@ -2232,7 +2590,21 @@ TSQuery *ts_query_new(
         break;
       }
     }
+
+    if (has_wildcard_root) symbol_filter.first_symbols = 0;
+    ts_query__add_symbol_filter(self, symbol_filter);
+  }
+
+  // If some pattern can match anywhere, then the symbol filters can never
+  // rule out a subtree.
+  if (
+    self->symbol_filters.size == 1 &&
+    !self->symbol_filters.contents[0].first_symbols &&
+    !self->symbol_filters.contents[0].required_symbols
+  ) {
+    array_clear(&self->symbol_filters);
   }
+  if (self->symbol_filters.size > 0) self->uses_symbol_masks = true;
 
   if (!ts_query__analyze_patterns(self, error_offset)) {
     *error_type = TSQueryErrorStructure;
@@ -2240,19 +2612,145 @@ TSQuery *ts_query_new(
     return NULL;
   }
 
+  ts_query__compile_text_predicates(self);
+  ts_query__index_pattern_map(self);
   array_delete(&self->string_buffer);
   return self;
 }
 
+TSQuery *ts_query_combine(const TSQuery *const *queries, uint32_t count) {
+  if (count == 0) return NULL;
+  const TSLanguage *language = queries[0]->language;
+  for (unsigned i = 1; i < count; i++) {
+    if (queries[i]->language != language) return NULL;
+  }
+
+  TSQuery *self = ts_query__new(language, "", 0);
+  array_push(&self->negated_fields, 0);
+  bool has_symbol_filters = true;
+  Array(uint16_t) capture_ids = array_new();
+  Array(uint16_t) value_ids = array_new();
+
+  for (unsigned i = 0; i < count; i++) {
+    const TSQuery *query = queries[i];
+    uint32_t step_offset = self->steps.size;
+    uint32_t pattern_offset = self->patterns.size;
+    uint32_t predicate_step_offset = self->predicate_steps.size;
+    uint32_t negated_field_offset = self->negated_fields.size - 1;
+    if (step_offset + query->steps.size > NONE) {
+      ts_query_delete(self);
+      self = NULL;
+      break;
+    }
+
+    // Merge the capture names and predicate values, so that equal names
+    // share the same id.
+    array_clear(&capture_ids);
+    for (unsigned j = 0; j < query->captures.slices.size; j++) {
+      uint32_t length;
+      const char *name = symbol_table_name_for_id(&query->captures, j, &length);
+      array_push(&capture_ids, symbol_table_insert_name(&self->captures, name, length));
+    }
+    array_clear(&value_ids);
+    for (unsigned j = 0; j < query->predicate_values.slices.size; j++) {
+      uint32_t length;
+      const char *value = symbol_table_name_for_id(&query->predicate_values, j, &length);
+      array_push(&value_ids, symbol_table_insert_name(&self->predicate_values, value, length));
+    }
+
+    for (unsigned j = 0; j < query->steps.size; j++) {
+      QueryStep step = query->steps.contents[j];
+      if (step.alternative_index != NONE) step.alternative_index += step_offset;
+      if (step.negated_field_list_id) step.negated_field_list_id += negated_field_offset;
+      for (unsigned k = 0; k < MAX_STEP_CAPTURE_COUNT; k++) {
+        if (step.capture_ids[k] == NONE) break;
+        step.capture_ids[k] = capture_ids.contents[step.capture_ids[k]];
+      }
+      array_push(&self->steps, step);
+    }
+    if (query->negated_fields.size > 1) {
+      array_extend(
+        &self->negated_fields,
+        query->negated_fields.size - 1,
+        &query->negated_fields.contents[1]
+      );
+    }
+
+    for (unsigned j = 0; j < query->predicate_steps.size; j++) {
+      TSQueryPredicateStep step = query->predicate_steps.contents[j];
+      if (step.type == TSQueryPredicateStepTypeCapture) {
+        step.value_id = capture_ids.contents[step.value_id];
+      } else if (step.type == TSQueryPredicateStepTypeString) {
+        step.value_id = value_ids.contents[step.value_id];
+      }
+      array_push(&self->predicate_steps, step);
+    }
+
+    for (unsigned j = 0; j < query->patterns.size; j++) {
+      QueryPattern pattern = query->patterns.contents[j];
+      pattern.steps.offset += step_offset;
+      pattern.predicate_steps.offset += predicate_step_offset;
+      pattern.source_query_index = i;
+      array_push(&self->patterns, pattern);
+    }
+
+    for (unsigned j = 0; j < query->pattern_map.size; j++) {
+      PatternEntry entry = query->pattern_map.contents[j];
+      entry.step_index += step_offset;
+      entry.pattern_index += pattern_offset;
+      TSSymbol symbol = self->steps.contents[entry.step_index].symbol;
+      ts_query__pattern_map_insert(self, symbol, entry);
+      if (symbol == WILDCARD_SYMBOL) self->wildcard_root_pattern_count++;
+    }
+
+    // Byte offsets are relative to the concatenation of the queries' sources.
+    for (unsigned j = 0; j < query->step_offsets.size; j++) {
+      StepOffset step_offset_entry = query->step_offsets.contents[j];
+      step_offset_entry.byte_offset += self->source_length;
+      step_offset_entry.step_index += step_offset;
+      array_push(&self->step_offsets, step_offset_entry);
+    }
+
+    // A query without symbol filters can match within any subtree.
+    if (query->symbol_filters.size == 0) has_symbol_filters = false;
+    for (unsigned j = 0; j < query->symbol_filters.size; j++) {
+      ts_query__add_symbol_filter(self, query->symbol_filters.contents[j]);
+    }
+
+    self->has_unrooted_patterns |= query->has_unrooted_patterns;
+    self->uses_symbol_masks |= query->uses_symbol_masks;
+    self->source_hash = ts_query__hash_concatenation(
+      self->source_hash,
+      query->source_hash,
+      query->source_length
+    );
+    self->source_length += query->source_length;
+  }
+
+  array_delete(&capture_ids);
+  array_delete(&value_ids);
+  if (self) {
+    if (!has_symbol_filters) array_clear(&self->symbol_filters);
+    ts_query__compile_text_predicates(self);
+    ts_query__index_pattern_map(self);
+    array_delete(&self->string_buffer);
+  }
+  return self;
+}
+
 void ts_query_delete(TSQuery *self) {
   if (self) {
     array_delete(&self->steps);
     array_delete(&self->pattern_map);
+    array_delete(&self->pattern_map_index);
     array_delete(&self->predicate_steps);
     array_delete(&self->patterns);
     array_delete(&self->step_offsets);
     array_delete(&self->string_buffer);
     array_delete(&self->negated_fields);
+    array_delete(&self->symbol_filters);
+    array_delete(&self->text_predicates);
+    array_delete(&self->text_predicates_by_pattern);
     symbol_table_delete(&self->captures);
     symbol_table_delete(&self->predicate_values);
     ts_free(self);
@@ -2300,6 +2798,13 @@ const TSQueryPredicateStep *ts_query_predicates_for_pattern(
   return &self->predicate_steps.contents[slice.offset];
 }
 
+uint32_t ts_query_source_query_for_pattern(
+  const TSQuery *self,
+  uint32_t pattern_index
+) {
+  return self->patterns.contents[pattern_index].source_query_index;
+}
+
 uint32_t ts_query_start_byte_for_pattern(
   const TSQuery *self,
   uint32_t pattern_index
@@ -2363,10 +2868,256 @@ void ts_query_disable_pattern(
   for (unsigned i = 0; i < self->pattern_map.size; i++) {
     PatternEntry *pattern = &self->pattern_map.contents[i];
     if (pattern->pattern_index == pattern_index) {
+      if (i < self->wildcard_root_pattern_count) self->wildcard_root_pattern_count--;
       array_erase(&self->pattern_map, i);
       i--;
     }
   }
+  ts_query__index_pattern_map(self);
+}
+
+// Serialized queries begin with this header, followed by the contents of
+// each of the query's arrays, in the order of the header's counts. The arrays
+// are copied verbatim, so the header also records the sizes of the structs
+// that they contain, in order to reject data from a different build, along
+// with a checksum of everything after the checksum itself, in order to reject
+// corrupted data.
+typedef struct {
+  char magic[4];
+  uint32_t format_version;
+  uint64_t checksum;
+  uint32_t language_version;
+  uint32_t symbol_count;
+  uint32_t field_count;
+  uint32_t state_count;
+  uint64_t source_hash;
+  uint32_t source_length;
+  uint16_t step_size;
+  uint16_t pattern_size;
+  uint16_t wildcard_root_pattern_count;
+  uint8_t has_unrooted_patterns;
+  uint8_t uses_symbol_masks;
+  uint32_t capture_character_count;
+  uint32_t capture_count;
+  uint32_t predicate_value_character_count;
+  uint32_t predicate_value_count;
+  uint32_t step_count;
+  uint32_t pattern_map_count;
+  uint32_t predicate_step_count;
+  uint32_t pattern_count;
+  uint32_t step_offset_count;
+  uint32_t negated_field_count;
+  uint32_t symbol_filter_count;
+} SerializedQueryHeader;
+
+static const char SERIALIZED_QUERY_MAGIC[4] = {'T', 'S', 'Q', 'Y'};
+static const uint32_t SERIALIZED_QUERY_FORMAT_VERSION = 3;
+#define SERIALIZED_QUERY_CHECKSUMMED_OFFSET \
+  (offsetof(SerializedQueryHeader, checksum) + sizeof(uint64_t))
+
+static bool ts_query__read_array(
+  const char **data,
+  const char *end,
+  VoidArray *array,
+  uint32_t count,
+  size_t element_size
+) {
+  if (count == 0) return true;
+  size_t size = (size_t)count * element_size;
+  if ((size_t)(end - *data) < size) return false;
+  array__reserve(array, element_size, count);
+  memcpy(array->contents, *data, size);
+  array->size = count;
+  *data += size;
+  return true;
+}
+
+#define ts_query__for_each_array(self, f) \
+  f(self->captures.characters)            \
+  f(self->captures.slices)                \
+  f(self->predicate_values.characters)    \
+  f(self->predicate_values.slices)        \
+  f(self->steps)                          \
+  f(self->pattern_map)                    \
+  f(self->predicate_steps)                \
+  f(self->patterns)                       \
+  f(self->step_offsets)                   \
+  f(self->negated_fields)                 \
+  f(self->symbol_filters)
+
+char *ts_query_serialize(const TSQuery *self, uint32_t *length) {
+  SerializedQueryHeader header = {
+    .format_version = SERIALIZED_QUERY_FORMAT_VERSION,
+    .language_version = self->language->version,
+    .symbol_count = self->language->symbol_count,
+    .field_count = self->language->field_count,
+    .state_count = self->language->state_count,
+    .source_hash = self->source_hash,
+    .source_length = self->source_length,
+    .step_size = sizeof(QueryStep),
+    .pattern_size = sizeof(QueryPattern),
+    .wildcard_root_pattern_count = self->wildcard_root_pattern_count,
+    .has_unrooted_patterns = self->has_unrooted_patterns,
+    .uses_symbol_masks = self->uses_symbol_masks,
+    .capture_character_count = self->captures.characters.size,
+    .capture_count = self->captures.slices.size,
+    .predicate_value_character_count = self->predicate_values.characters.size,
+    .predicate_value_count = self->predicate_values.slices.size,
+    .step_count = self->steps.size,
+    .pattern_map_count = self->pattern_map.size,
+    .predicate_step_count = self->predicate_steps.size,
+    .pattern_count = self->patterns.size,
+    .step_offset_count = self->step_offsets.size,
+    .negated_field_count = self->negated_fields.size,
+    .symbol_filter_count = self->symbol_filters.size,
+  };
+  memcpy(header.magic, SERIALIZED_QUERY_MAGIC, sizeof(header.magic));
+
+  Array(char) buffer = array_new();
+  array_extend(&buffer, sizeof(header), (const char *)&header);
+  #define write_array(array)                                              \
+    if ((array).size > 0) array_extend(                                   \
+      &buffer, (array).size * array__elem_size(&(array)),                 \
+      (const char *)(array).contents                                      \
+    );
+  ts_query__for_each_array(self, write_array)
+  #undef write_array
+
+  memcpy(buffer.contents, &header, sizeof(header));
+  header.checksum = ts_query__hash(
+    buffer.contents + SERIALIZED_QUERY_CHECKSUMMED_OFFSET,
+    buffer.size - SERIALIZED_QUERY_CHECKSUMMED_OFFSET
+  );
+  memcpy(buffer.contents, &header, sizeof(header));
+  *length = buffer.size;
+  return buffer.contents;
+}
+
+// Check that all of the indices within a deserialized query refer to valid
+// elements, so that corrupted data cannot cause out-of-bounds accesses.
+static bool ts_query__is_valid(const TSQuery *self) {
+  for (unsigned i = 0; i < 2; i++) {
+    const SymbolTable *table = i == 0 ? &self->captures : &self->predicate_values;
+    for (unsigned j = 0; j < table->slices.size; j++) {
+      Slice slice = table->slices.contents[j];
+      if (slice.offset + (uint64_t)slice.length > table->characters.size) return false;
+    }
+  }
+
+  uint32_t capture_count = self->captures.slices.size;
+  if (self->steps.size == 0 || self->steps.size > NONE) return false;
+  for (unsigned i = 0; i < self->steps.size; i++) {
+    const QueryStep *step = &self->steps.contents[i];
+    if (step->alternative_index != NONE && step->alternative_index >= self->steps.size) return false;
+    if (step->negated_field_list_id >= self->negated_fields.size) return false;
+    for (unsigned j = 0; j < MAX_STEP_CAPTURE_COUNT; j++) {
+      uint16_t capture_id = step->capture_ids[j];
+      if (capture_id != NONE && capture_id >= capture_count) return false;
+    }
+  }
+  if (array_back(&self->steps)->depth != PATTERN_DONE_MARKER) return false;
+
+  for (unsigned i = 0; i < self->patterns.size; i++) {
+    const QueryPattern *pattern = &self->patterns.contents[i];
+    if (
+      pattern->steps.offset + (uint64_t)pattern->steps.length > self->steps.size ||
+      pattern->predicate_steps.offset + (uint64_t)pattern->predicate_steps.length >
+        self->predicate_steps.size
+    ) return false;
+  }
+
+  if (self->wildcard_root_pattern_count > self->pattern_map.size) return false;
+  for (unsigned i = 0; i < self->pattern_map.size; i++) {
+    const PatternEntry *entry = &self->pattern_map.contents[i];
+    if (
+      entry->step_index >= self->steps.size ||
+      entry->pattern_index >= self->patterns.size
+    ) return false;
+  }
+
+  for (unsigned i = 0; i < self->predicate_steps.size; i++) {
+    const TSQueryPredicateStep *step = &self->predicate_steps.contents[i];
+    if (
+      (step->type == TSQueryPredicateStepTypeCapture && step->value_id >= capture_count) ||
+      (step->type == TSQueryPredicateStepTypeString && step->value_id >= self->predicate_values.slices.size)
+    ) return false;
+  }
+
+  for (unsigned i = 0; i < self->step_offsets.size; i++) {
+    if (self->step_offsets.contents[i].step_index >= self->steps.size) return false;
+  }
+
+  return true;
+}
+
+TSQuery *ts_query_deserialize(
+  const char *data,
+  uint32_t length,
+  const TSLanguage *language,
+  const char *source,
+  uint32_t source_len
+) {
+  SerializedQueryHeader header;
+  if (!language || length < sizeof(header)) return NULL;
+  memcpy(&header, data, sizeof(header));
+  if (
+    memcmp(header.magic, SERIALIZED_QUERY_MAGIC, sizeof(header.magic)) ||
+    header.format_version != SERIALIZED_QUERY_FORMAT_VERSION ||
+    header.language_version != language->version ||
+    header.symbol_count != language->symbol_count ||
+    header.field_count != language->field_count ||
+    header.state_count != language->state_count ||
+    header.step_size != sizeof(QueryStep) ||
+    header.pattern_size != sizeof(QueryPattern) ||
+    header.source_length != source_len ||
+    header.checksum != ts_query__hash(
+      data + SERIALIZED_QUERY_CHECKSUMMED_OFFSET,
+      length - SERIALIZED_QUERY_CHECKSUMMED_OFFSET
+    )
+  ) return NULL;
+
+  TSQuery *self = ts_query__new(language, source, source_len);
+  if (self->source_hash != header.source_hash) {
+    ts_query_delete(self);
+    return NULL;
+  }
+  self->wildcard_root_pattern_count = header.wildcard_root_pattern_count;
+  self->has_unrooted_patterns = header.has_unrooted_patterns;
+  self->uses_symbol_masks = header.uses_symbol_masks;
+  array_delete(&self->string_buffer);
+
+  const uint32_t counts[] = {
+    header.capture_character_count,
+    header.capture_count,
+    header.predicate_value_character_count,
+    header.predicate_value_count,
+    header.step_count,
+    header.pattern_map_count,
+    header.predicate_step_count,
+    header.pattern_count,
+    header.step_offset_count,
+    header.negated_field_count,
+    header.symbol_filter_count,
+  };
+  const char *end = data + length;
+  data += sizeof(header);
+  bool is_valid = true;
+  unsigned count_index = 0;
+  #define read_array(array)                                               \
+    is_valid = is_valid && ts_query__read_array(                          \
+      &data, end, (VoidArray *)&(array), counts[count_index++],           \
+      array__elem_size(&(array))                                          \
+    );
+  ts_query__for_each_array(self, read_array)
+  #undef read_array
+
+  if (!is_valid || data != end || !ts_query__is_valid(self)) {
+    ts_query_delete(self);
+    return NULL;
+  }
+  ts_query__compile_text_predicates(self);
+  ts_query__index_pattern_map(self);
+  return self;
 }
 
 /***************
@@ -2377,6 +3128,7 @@ TSQueryCursor *ts_query_cursor_new(void) {
   TSQueryCursor *self = ts_malloc(sizeof(TSQueryCursor));
   *self = (TSQueryCursor) {
     .did_exceed_match_limit = false,
+    .streaming = false,
     .ascending = false,
     .halted = false,
     .states = array_new(),
@@ -2386,15 +3138,19 @@ TSQueryCursor *ts_query_cursor_new(void) {
     .end_byte = UINT32_MAX,
     .start_point = {0, 0},
     .end_point = POINT_MAX,
+    .text = NULL,
+    .text_length = 0,
+    .retained_state_count = UINT32_MAX,
+    .retained_capture_list_count = UINT32_MAX,
   };
-  array_reserve(&self->states, 8);
-  array_reserve(&self->finished_states, 8);
+  array_reserve_tracked(&self->states, TSAllocationCategoryQueryState, 8);
+  array_reserve_tracked(&self->finished_states, TSAllocationCategoryQueryState, 8);
   return self;
 }
 
 void ts_query_cursor_delete(TSQueryCursor *self) {
-  array_delete(&self->states);
-  array_delete(&self->finished_states);
+  array_delete_tracked(&self->states, TSAllocationCategoryQueryState);
+  array_delete_tracked(&self->finished_states, TSAllocationCategoryQueryState);
   ts_tree_cursor_delete(&self->cursor);
   capture_list_pool_delete(&self->capture_list_pool);
   ts_free(self);
@@ -2412,6 +3168,42 @@ void ts_query_cursor_set_match_limit(TSQueryCursor *self, uint32_t limit) {
   self->capture_list_pool.max_capture_list_count = limit;
 }
 
+bool ts_query_cursor_streaming(const TSQueryCursor *self) {
+  return self->streaming;
+}
+
+void ts_query_cursor_set_streaming(TSQueryCursor *self, bool streaming) {
+  self->streaming = streaming;
+}
+
+void ts_query_cursor_set_text(TSQueryCursor *self, const char *text, uint32_t length) {
+  self->text = text;
+  self->text_length = text ? length : 0;
+}
+
+void ts_query_cursor_reserve(
+  TSQueryCursor *self,
+  uint32_t state_count,
+  uint32_t capture_list_count
+) {
+  array_reserve_tracked(&self->states, TSAllocationCategoryQueryState, state_count);
+  array_reserve_tracked(&self->finished_states, TSAllocationCategoryQueryState, state_count);
+  capture_list_pool_reserve(&self->capture_list_pool, capture_list_count);
+}
+
+void ts_query_cursor_set_retained_capacity(
+  TSQueryCursor *self,
+  uint32_t state_count,
+  uint32_t capture_list_count
+) {
+  self->retained_state_count = state_count;
+  self->retained_capture_list_count = capture_list_count;
+}
+
+void ts_query_cursor_stats(const TSQueryCursor *self, TSQueryCursorStats *stats) {
+  *stats = self->stats;
+}
+
 void ts_query_cursor_exec(
   TSQueryCursor *self,
   const TSQuery *query,
@@ -2419,7 +3211,10 @@ void ts_query_cursor_exec(
 ) {
   array_clear(&self->states);
   array_clear(&self->finished_states);
+  array_shrink_tracked(&self->states, TSAllocationCategoryQueryState, self->retained_state_count);
+  array_shrink_tracked(&self->finished_states, TSAllocationCategoryQueryState, self->retained_state_count);
   ts_tree_cursor_reset(&self->cursor, node);
+  capture_list_pool_trim(&self->capture_list_pool, self->retained_capture_list_count);
   capture_list_pool_reset(&self->capture_list_pool);
   self->next_state_id = 0;
   self->depth = 0;
@@ -2427,6 +3222,7 @@ void ts_query_cursor_exec(
   self->halted = false;
   self->query = query;
   self->did_exceed_match_limit = false;
+  self->stats = (TSQueryCursorStats) {0};
 }
 
 void ts_query_cursor_set_byte_range(
@@ -2453,6 +3249,20 @@ void ts_query_cursor_set_point_range(
   self->end_point = end_point;
 }
 
+static inline void ts_query_cursor__record_usage(TSQueryCursor *self) {
+  TSQueryCursorStats *stats = &self->stats;
+  uint32_t capture_list_count = capture_list_pool_used_count(&self->capture_list_pool);
+  if (self->states.size > stats->peak_state_count) {
+    stats->peak_state_count = self->states.size;
+  }
+  if (self->finished_states.size > stats->peak_finished_state_count) {
+    stats->peak_finished_state_count = self->finished_states.size;
+  }
+  if (capture_list_count > stats->peak_capture_list_count) {
+    stats->peak_capture_list_count = capture_list_count;
+  }
+}
+
 // Search through all of the in-progress states, and find the captured
 // node that occurs earliest in the document.
 static bool ts_query_cursor__first_in_progress_capture(
@@ -2636,7 +3446,7 @@ static void ts_query_cursor__add_state(
     pattern->pattern_index,
     pattern->step_index
   );
-  array_insert(&self->states, index, ((QueryState) {
+  array_insert_tracked(&self->states, TSAllocationCategoryQueryState, index, ((QueryState) {
     .id = UINT32_MAX,
     .capture_list_id = NONE,
     .step_index = pattern->step_index,
@@ -2685,6 +3495,7 @@ static CaptureList *ts_query_cursor__prepare_to_capture(
         state->capture_list_id = other_state->capture_list_id;
         other_state->capture_list_id = NONE;
         other_state->dead = true;
+        self->stats.abandoned_match_count++;
         CaptureList *list = capture_list_pool_get_mut(
           &self->capture_list_pool,
           state->capture_list_id
@@ -2693,6 +3504,7 @@ static CaptureList *ts_query_cursor__prepare_to_capture(
         return list;
       } else {
         LOG("  ran out of capture lists");
+        self->stats.abandoned_match_count++;
         return NULL;
       }
     }
@@ -2700,6 +3512,97 @@ static CaptureList *ts_query_cursor__prepare_to_capture(
   return capture_list_pool_get_mut(&self->capture_list_pool, state->capture_list_id);
 }
 
+// Get the index of the first capture with the given id in a capture list.
+static uint32_t ts_query_cursor__first_capture_index(
+  const CaptureList *captures,
+  uint16_t capture_id
+) {
+  for (uint32_t i = 0; i < captures->size; i++) {
+    if (captures->contents[i].index == capture_id) return i;
+  }
+  return UINT32_MAX;
+}
+
+static bool ts_query_cursor__node_text(
+  const TSQueryCursor *self,
+  TSNode node,
+  const char **text,
+  uint32_t *length
+) {
+  uint32_t start_byte = ts_node_start_byte(node);
+  uint32_t end_byte = ts_node_end_byte(node);
+  if (end_byte > self->text_length) return false;
+  *text = &self->text[start_byte];
+  *length = end_byte - start_byte;
+  return true;
+}
+
+// Evaluate any of a pattern's text predicates that could not be decided
+// before the captures starting at `start_capture_count` were added. As in the
+// language bindings, only the first node captured with a given capture name is
+// considered, and a predicate whose captures are missing is satisfied.
+static bool ts_query_cursor__satisfies_text_predicates(
+  const TSQueryCursor *self,
+  uint16_t pattern_index,
+  const CaptureList *captures,
+  uint32_t start_capture_count
+) {
+  if (!self->text) return true;
+  Slice slice = self->query->text_predicates_by_pattern.contents[pattern_index];
+  for (unsigned i = 0; i < slice.length; i++) {
+    const TextPredicate *predicate = &self->query->text_predicates.contents[slice.offset + i];
+    uint32_t index = ts_query_cursor__first_capture_index(captures, predicate->capture_id);
+    if (index == UINT32_MAX) continue;
+
+    const char *text, *other_text;
+    uint32_t length, other_length;
+    if (predicate->type == TextPredicateTypeEqCapture) {
+      uint32_t other_index = ts_query_cursor__first_capture_index(
+        captures,
+        predicate->other_capture_id
+      );
+      if (
+        other_index == UINT32_MAX ||
+        (index < start_capture_count && other_index < start_capture_count) ||
+        !ts_query_cursor__node_text(
+          self,
+          captures->contents[other_index].node,
+          &other_text,
+          &other_length
+        )
+      ) continue;
+    } else {
+      if (index < start_capture_count) continue;
+      other_text = &self->query->predicate_values.characters.contents[predicate->text.offset];
+      other_length = predicate->text.length;
+    }
+    if (!ts_query_cursor__node_text(self, captures->contents[index].node, &text, &length)) continue;
+
+    bool is_match;
+    switch (predicate->type) {
+      case TextPredicateTypePrefix:
+        is_match = length >= other_length && !memcmp(text, other_text, other_length);
+        break;
+      case TextPredicateTypeSuffix:
+        is_match =
+          length >= other_length &&
+          !memcmp(text + length - other_length, other_text, other_length);
+        break;
+      case TextPredicateTypeContains:
+        is_match = other_length == 0;
+        for (uint32_t j = 0; !is_match && j + other_length <= length; j++) {
+          is_match = !memcmp(text + j, other_text, other_length);
+        }
+        break;
+      default:
+        is_match = length == other_length && !memcmp(text, other_text, length);
+        break;
+    }
+    if (is_match != predicate->is_positive) return false;
+  }
+  return true;
+}
+
 static void ts_query_cursor__capture(
   TSQueryCursor *self,
   QueryState *state,
@@ -2713,10 +3616,11 @@ static void ts_query_cursor__capture(
     return;
   }
 
+  uint32_t start_capture_count = capture_list->size;
   for (unsigned j = 0; j < MAX_STEP_CAPTURE_COUNT; j++) {
     uint16_t capture_id = step->capture_ids[j];
     if (step->capture_ids[j] == NONE) break;
-    array_push(capture_list, ((TSQueryCapture) { node, capture_id }));
+    array_push_tracked(capture_list, TSAllocationCategoryCaptureList, ((TSQueryCapture) { node, capture_id }));
     LOG(
       "  capture node. type:%s, pattern:%u, capture_id:%u, capture_count:%u\n",
       ts_node_type(node),
@@ -2725,6 +3629,19 @@ static void ts_query_cursor__capture(
       capture_list->size
     );
   }
+
+  if (!ts_query_cursor__satisfies_text_predicates(
+    self,
+    state->pattern_index,
+    capture_list,
+    start_capture_count
+  )) {
+    LOG("  reject state with text predicate. pattern:%u\n", state->pattern_index);
+    capture_list_pool_release(&self->capture_list_pool, state->capture_list_id);
+    state->capture_list_id = NONE;
+    state->dead = true;
+    self->stats.rejected_match_count++;
+  }
 }
 
 // Duplicate the given state and insert the newly-created state immediately after
@@ -2747,10 +3664,10 @@ static QueryState *ts_query_cursor__copy_state(
       &self->capture_list_pool,
       state->capture_list_id
     );
-    array_push_all(new_captures, old_captures);
+    array_push_all_tracked(new_captures, TSAllocationCategoryCaptureList, old_captures);
   }
 
-  array_insert(&self->states, state_index + 1, copy);
+  array_insert_tracked(&self->states, TSAllocationCategoryQueryState, state_index + 1, copy);
   *state_ref = &self->states.contents[state_index];
   return &self->states.contents[state_index + 1];
 }
@@ -2806,7 +3723,7 @@ static inline bool ts_query_cursor__advance(
         if (step->depth == PATTERN_DONE_MARKER) {
           if (state->start_depth > self->depth || self->halted) {
             LOG("  finish pattern %u\n", state->pattern_index);
-            array_push(&self->finished_states, *state);
+            array_push_tracked(&self->finished_states, TSAllocationCategoryQueryState, *state);
             did_match = true;
             deleted_count++;
             continue;
@@ -2834,6 +3751,7 @@ static inline bool ts_query_cursor__advance(
         }
       }
       self->states.size -= deleted_count;
+      ts_query_cursor__record_usage(self);
     }
 
     // Enter a new node.
@@ -2841,6 +3759,52 @@ static inline bool ts_query_cursor__advance(
       // Get the properties of the current node.
       TSNode node = ts_tree_cursor_current_node(&self->cursor);
       TSNode parent_node = ts_tree_cursor_parent_node(&self->cursor);
+      self->stats.visited_node_count++;
+
+      bool node_intersects_range = (
+        ts_node_end_byte(node) > self->start_byte &&
+        ts_node_start_byte(node) < self->end_byte &&
+        point_gt(ts_node_end_point(node), self->start_point) &&
+        point_lt(ts_node_start_point(node), self->end_point)
+      );
+
+      bool parent_intersects_range = ts_node_is_null(parent_node) || (
+        ts_node_end_byte(parent_node) > self->start_byte &&
+        ts_node_start_byte(parent_node) < self->end_byte &&
+        point_gt(ts_node_end_point(parent_node), self->start_point) &&
+        point_lt(ts_node_start_point(parent_node), self->end_point)
+      );
+
+      // When there are no in-progress matches, a node outside of the range
+      // can only matter if an unrooted pattern could start there. Otherwise,
+      // skip nodes that end before the range without examining them, and
+      // stop walking the tree once the cursor has passed the end of the range,
+      // since every later node starts at or after this one.
+      if (
+        self->states.size == 0 &&
+        !node_intersects_range &&
+        (!parent_intersects_range || !self->query->has_unrooted_patterns)
+      ) {
+        if (
+          !self->query->has_unrooted_patterns && (
+            ts_node_start_byte(node) >= self->end_byte ||
+            !point_lt(ts_node_start_point(node), self->end_point)
+          )
+        ) {
+          LOG("halt after end of range\n");
+          self->halted = true;
+        } else {
+          self->ascending = true;
+        }
+        continue;
+      }
+
+      // Determine which symbols occur within this node, in order to rule out
+      // patterns that cannot match within it.
+      uint64_t descendant_symbols = self->query->uses_symbol_masks
+        ? ts_node_descendant_symbol_mask(node)
+        : UINT64_MAX;
+
       TSSymbol symbol = ts_node_symbol(node);
       bool is_named = ts_node_is_named(node);
       bool has_later_siblings;
@@ -2868,21 +3832,7 @@ static inline bool ts_query_cursor__advance(
         self->finished_states.size
       );
 
-      bool node_intersects_range = (
-        ts_node_end_byte(node) > self->start_byte &&
-        ts_node_start_byte(node) < self->end_byte &&
-        point_gt(ts_node_end_point(node), self->start_point) &&
-        point_lt(ts_node_start_point(node), self->end_point)
-      );
-
-      bool parent_intersects_range = ts_node_is_null(parent_node) || (
-        ts_node_end_byte(parent_node) > self->start_byte &&
-        ts_node_start_byte(parent_node) < self->end_byte &&
-        point_gt(ts_node_end_point(parent_node), self->start_point) &&
-        point_lt(ts_node_start_point(parent_node), self->end_point)
-      );
-
-        // Add new states for any patterns whose root node is a wildcard.
+      // Add new states for any patterns whose root node is a wildcard.
       for (unsigned i = 0; i < self->query->wildcard_root_pattern_count; i++) {
         PatternEntry *pattern = &self->query->pattern_map.contents[i];
 
@@ -2892,7 +3842,8 @@ static inline bool ts_query_cursor__advance(
         if (
           (node_intersects_range || (!pattern->is_rooted && parent_intersects_range)) &&
           (!step->field || field_id == step->field) &&
-          (!step->supertype_symbol || supertype_count > 0)
+          (!step->supertype_symbol || supertype_count > 0) &&
+          ts_query__pattern_can_start(self->query, pattern, step, descendant_symbols)
         ) {
           ts_query_cursor__add_state(self, pattern);
         }
@@ -2900,7 +3851,7 @@ static inline bool ts_query_cursor__advance(
 
       // Add new states for any patterns whose root node matches this node.
       unsigned i;
-      if (ts_query__pattern_map_search(self->query, symbol, &i)) {
+      if (ts_query__pattern_map_find(self->query, symbol, &i)) {
         PatternEntry *pattern = &self->query->pattern_map.contents[i];
 
         QueryStep *step = &self->query->steps.contents[pattern->step_index];
@@ -2909,7 +3860,8 @@ static inline bool ts_query_cursor__advance(
           // state at the start of this pattern.
           if (
             (node_intersects_range || (!pattern->is_rooted && parent_intersects_range)) &&
-            (!step->field || field_id == step->field)
+            (!step->field || field_id == step->field) &&
+            ts_query__pattern_can_start(self->query, pattern, step, descendant_symbols)
           ) {
             ts_query_cursor__add_state(self, pattern);
           }
@@ -2928,6 +3880,7 @@ static inline bool ts_query_cursor__advance(
         QueryStep *step = &self->query->steps.contents[state->step_index];
         state->has_in_progress_alternatives = false;
         copy_count = 0;
+        self->stats.step_count++;
 
         // Check that the node matches all of the criteria for the next
         // step of the pattern.
@@ -3200,7 +4153,7 @@ static inline bool ts_query_cursor__advance(
               LOG("  defer finishing pattern %u\n", state->pattern_index);
             } else {
               LOG("  finish pattern %u\n", state->pattern_index);
-              array_push(&self->finished_states, *state);
+              array_push_tracked(&self->finished_states, TSAllocationCategoryQueryState, *state);
               array_erase(&self->states, state - self->states.contents);
               did_match = true;
               i--;
@@ -3209,9 +4162,14 @@ static inline bool ts_query_cursor__advance(
         }
       }
 
-      // When the current node ends prior to the desired start offset,
+      ts_query_cursor__record_usage(self);
+
+      // When the current node ends prior to the desired start offset, or
+      // when it lacks the symbols needed for any pattern to match within it,
       // only descend for the purpose of continuing in-progress matches.
-      bool should_descend = node_intersects_range;
+      bool should_descend =
+        node_intersects_range &&
+        ts_query__can_match_within(self->query, descendant_symbols);
       if (!should_descend) {
         for (unsigned i = 0; i < self->states.size; i++) {
           QueryState *state = &self->states.contents[i];;
@@ -3234,7 +4192,23 @@ static inline bool ts_query_cursor__advance(
         );
       }
 
-      if (should_descend && ts_tree_cursor_goto_first_child(&self->cursor)) {
+      // When no matches are in progress, the children that end before the
+      // range can never be part of a match, so seek directly to the first
+      // child that reaches the range instead of visiting each one in turn.
+      bool did_descend = false;
+      if (should_descend) {
+        if (self->states.size == 0 && !self->query->has_unrooted_patterns) {
+          did_descend = ts_tree_cursor_goto_first_child_for_byte_and_point(
+            (TreeCursor *)&self->cursor,
+            self->start_byte,
+            self->start_point
+          ) >= 0;
+        } else {
+          did_descend = ts_tree_cursor_goto_first_child(&self->cursor);
+        }
+      }
+
+      if (did_descend) {
         self->depth++;
       } else {
         self->ascending = true;
@@ -3308,10 +4282,15 @@ bool ts_query_cursor_next_capture(
     );
 
     // Then find the earliest capture in a finished match. It must occur
-    // before the first capture in an *unfinished* match.
+    // before the first capture in an *unfinished* match. In streaming mode,
+    // also track the earliest finished capture overall, which can be returned
+    // early in order to free up capture lists.
     QueryState *first_finished_state = NULL;
     uint32_t first_finished_capture_byte = first_unfinished_capture_byte;
     uint32_t first_finished_pattern_index = first_unfinished_pattern_index;
+    QueryState *earliest_finished_state = NULL;
+    uint32_t earliest_finished_capture_byte = UINT32_MAX;
+    uint32_t earliest_finished_pattern_index = UINT32_MAX;
     for (unsigned i = 0; i < self->finished_states.size;) {
       QueryState *state = &self->finished_states.contents[i];
       const CaptureList *captures = capture_list_pool_get(
@@ -3348,6 +4327,17 @@ bool ts_query_cursor_next_capture(
         first_finished_capture_byte = node_start_byte;
         first_finished_pattern_index = state->pattern_index;
       }
+      if (
+        node_start_byte < earliest_finished_capture_byte ||
+        (
+          node_start_byte == earliest_finished_capture_byte &&
+          state->pattern_index < earliest_finished_pattern_index
+        )
+      ) {
+        earliest_finished_state = state;
+        earliest_finished_capture_byte = node_start_byte;
+        earliest_finished_pattern_index = state->pattern_index;
+      }
       i++;
     }
 
@@ -3359,6 +4349,22 @@ bool ts_query_cursor_next_capture(
       state = first_finished_state;
     } else if (first_unfinished_state_is_definite) {
       state = &self->states.contents[first_unfinished_state_index];
+    } else if (
+      self->streaming &&
+      earliest_finished_state &&
+      capture_list_pool_is_empty(&self->capture_list_pool)
+    ) {
+      // In streaming mode, when the match limit has been reached, return a
+      // finished capture out of order, rather than abandoning an unfinished
+      // match. Once all of the match's captures are consumed, its capture
+      // list will be released.
+      LOG(
+        "  return capture out of order. pattern:%u, offset:%u.\n",
+        earliest_finished_pattern_index,
+        earliest_finished_capture_byte
+      );
+      state = earliest_finished_state;
+      self->stats.out_of_order_capture_count++;
     } else {
       state = NULL;
     }
@@ -3390,6 +4396,7 @@ bool ts_query_cursor_next_capture(
         self->states.contents[first_unfinished_state_index].capture_list_id
       );
       array_erase(&self->states, first_unfinished_state_index);
+      self->stats.abandoned_match_count++;
     }
 
     // If there are no finished matches that are ready to be returned, then
@@ -59,6 +59,40 @@ static inline void reusable_node_advance(ReusableNode *self) {
   }));
 }
 
+// Advance past the current node, and past any following nodes that start before
+// the given position and end at or before it, without visiting them one by one.
+static inline void reusable_node_advance_to(ReusableNode *self, uint32_t position) {
+  StackEntry last_entry = *array_back(&self->stack);
+  uint32_t byte_offset = last_entry.byte_offset + ts_subtree_total_bytes(last_entry.tree);
+  if (ts_subtree_has_external_tokens(last_entry.tree)) {
+    self->last_external_token = ts_subtree_last_external_token(last_entry.tree);
+  }
+
+  for (;;) {
+    StackEntry popped_entry = array_pop(&self->stack);
+    if (self->stack.size == 0) return;
+    Subtree tree = array_back(&self->stack)->tree;
+    const Subtree *children = ts_subtree_children(tree);
+    uint32_t child_count = ts_subtree_child_count(tree);
+    for (uint32_t i = popped_entry.child_index + 1; i < child_count; i++) {
+      Subtree child = children[i];
+      uint32_t child_bytes = ts_subtree_total_bytes(child);
+      if (byte_offset >= position || byte_offset + child_bytes > position) {
+        array_push(&self->stack, ((StackEntry) {
+          .tree = child,
+          .child_index = i,
+          .byte_offset = byte_offset,
+        }));
+        return;
+      }
+      if (ts_subtree_has_external_tokens(child)) {
+        self->last_external_token = ts_subtree_last_external_token(child);
+      }
+      byte_offset += child_bytes;
+    }
+  }
+}
+
 static inline bool reusable_node_descend(ReusableNode *self) {
   StackEntry last_entry = *array_back(&self->stack);
   if (ts_subtree_child_count(last_entry.tree) > 0) {
@@ -8,7 +8,8 @@
 #include <stdio.h>
 
 #define MAX_LINK_COUNT 8
-#define MAX_NODE_POOL_SIZE 50
+#define MIN_NODE_SLAB_CAPACITY 16
+#define MAX_NODE_SLAB_CAPACITY 1024
 #define MAX_ITERATOR_COUNT 64
 
 #if defined _WIN32 && !defined __GNUC__
@@ -50,6 +51,17 @@ typedef struct {
 
 typedef Array(StackNode *) StackNodeArray;
 
+// Stack nodes are carved out of slabs whose capacity doubles each time the
+// existing slabs are exhausted, so the parser settles at the number of nodes
+// that its grammar's GLR versions actually need. Released nodes go onto the
+// stack's free list, and the slabs are only freed along with the stack.
+typedef struct StackNodeSlab {
+  struct StackNodeSlab *next;
+  uint32_t size;
+  uint32_t capacity;
+  StackNode nodes[];
+} StackNodeSlab;
+
 typedef enum {
   StackStatusActive,
   StackStatusPaused,
@@ -70,8 +82,10 @@ struct Stack {
   StackSliceArray slices;
   Array(StackIterator) iterators;
   StackNodeArray node_pool;
+  StackNodeSlab *node_slab;
   StackNode *base_node;
   SubtreePool *subtree_pool;
+  StackStats stats;
 };
 
 typedef unsigned StackAction;
@@ -109,11 +123,7 @@ recur:
     first_predecessor = self->links[0].node;
   }
 
-  if (pool->size < MAX_NODE_POOL_SIZE) {
-    array_push(pool, self);
-  } else {
-    ts_free(self);
-  }
+  array_push(pool, self);
 
   if (first_predecessor) {
     self = first_predecessor;
@@ -121,11 +131,35 @@ recur:
   }
 }
 
+static StackNode *stack_node_alloc(Stack *self) {
+  self->stats.node_count++;
+  if (self->node_pool.size > 0) return array_pop(&self->node_pool);
+
+  StackNodeSlab *slab = self->node_slab;
+  if (!slab || slab->size == slab->capacity) {
+    uint32_t capacity = MIN_NODE_SLAB_CAPACITY;
+    if (slab) {
+      capacity = slab->capacity * 2;
+      if (capacity > MAX_NODE_SLAB_CAPACITY) capacity = MAX_NODE_SLAB_CAPACITY;
+    }
+    slab = ts_malloc(sizeof(StackNodeSlab) + capacity * sizeof(StackNode));
+    ts_track_allocate(
+      TSAllocationCategoryStackNode,
+      slab,
+      sizeof(StackNodeSlab) + capacity * sizeof(StackNode)
+    );
+    slab->next = self->node_slab;
+    slab->size = 0;
+    slab->capacity = capacity;
+    self->node_slab = slab;
+    self->stats.node_slab_count++;
+  }
+  return &slab->nodes[slab->size++];
+}
+
 static StackNode *stack_node_new(StackNode *previous_node, Subtree subtree,
-                                 bool is_pending, TSStateId state, StackNodeArray *pool) {
-  StackNode *node = pool->size > 0 ?
-    array_pop(pool) :
-    ts_malloc(sizeof(StackNode));
+                                 bool is_pending, TSStateId state, Stack *stack) {
+  StackNode *node = stack_node_alloc(stack);
   *node = (StackNode){.ref_count = 1, .link_count = 0, .state = state};
 
   if (previous_node) {
@@ -373,10 +407,15 @@ Stack *ts_stack_new(SubtreePool *subtree_pool) {
   array_reserve(&self->heads, 4);
   array_reserve(&self->slices, 4);
   array_reserve(&self->iterators, 4);
-  array_reserve(&self->node_pool, MAX_NODE_POOL_SIZE);
+  array_reserve(&self->node_pool, MIN_NODE_SLAB_CAPACITY);
 
   self->subtree_pool = subtree_pool;
-  self->base_node = stack_node_new(NULL, NULL_SUBTREE, false, 1, &self->node_pool);
+
+  // The base node lives as long as the stack, so it is allocated on its own,
+  // and the slabs are only created once parsing begins.
+  self->base_node = ts_malloc(sizeof(StackNode));
+  ts_track_allocate(TSAllocationCategoryStackNode, self->base_node, sizeof(StackNode));
+  *self->base_node = (StackNode){.ref_count = 1, .state = 1, .position = length_zero()};
   ts_stack_clear(self);
 
   return self;
@@ -392,15 +431,28 @@ void ts_stack_delete(Stack *self) {
     stack_head_delete(&self->heads.contents[i], &self->node_pool, self->subtree_pool);
   }
   array_clear(&self->heads);
-  if (self->node_pool.contents) {
-    for (uint32_t i = 0; i < self->node_pool.size; i++)
-      ts_free(self->node_pool.contents[i]);
+  if (self->node_pool.contents)
     array_delete(&self->node_pool);
+  ts_track_free(TSAllocationCategoryStackNode, self->base_node, sizeof(StackNode));
+  ts_free(self->base_node);
+  while (self->node_slab) {
+    StackNodeSlab *next = self->node_slab->next;
+    ts_track_free(
+      TSAllocationCategoryStackNode,
+      self->node_slab,
+      sizeof(StackNodeSlab) + self->node_slab->capacity * sizeof(StackNode)
+    );
+    ts_free(self->node_slab);
+    self->node_slab = next;
   }
   array_delete(&self->heads);
   ts_free(self);
 }
 
+StackStats ts_stack_stats(const Stack *self) {
+  return self->stats;
+}
+
 uint32_t ts_stack_version_count(const Stack *self) {
   return self->heads.size;
 }
@@ -413,6 +465,34 @@ Length ts_stack_position(const Stack *self, StackVersion version) {
   return array_get(&self->heads, version)->node->position;
 }
 
+Subtree *ts_stack_bottom_subtree(Stack *self, StackVersion version) {
+  StackNode *node = array_get(&self->heads, version)->node;
+  while (node->link_count == 1) {
+    StackLink *link = &node->links[0];
+    if (link->node == self->base_node) {
+      if (!link->subtree.ptr || link->is_pending) return NULL;
+      return &link->subtree;
+    }
+    node = link->node;
+  }
+  return NULL;
+}
+
+SubtreeArray ts_stack_subtrees(const Stack *self, StackVersion version) {
+  SubtreeArray result = array_new();
+  StackNode *node = array_get(&self->heads, version)->node;
+  while (node->link_count > 0) {
+    StackLink *link = &node->links[0];
+    if (link->subtree.ptr) {
+      ts_subtree_retain(link->subtree);
+      array_push(&result, link->subtree);
+    }
+    node = link->node;
+  }
+  ts_subtree_array_reverse(&result);
+  return result;
+}
+
 Subtree ts_stack_last_external_token(const Stack *self, StackVersion version) {
   return array_get(&self->heads, version)->last_external_token;
 }
@@ -446,9 +526,12 @@ unsigned ts_stack_node_count_since_error(const Stack *self, StackVersion version
 void ts_stack_push(Stack *self, StackVersion version, Subtree subtree,
                    bool pending, TSStateId state) {
   StackHead *head = array_get(&self->heads, version);
-  StackNode *new_node = stack_node_new(head->node, subtree, pending, state, &self->node_pool);
+  StackNode *new_node = stack_node_new(head->node, subtree, pending, state, self);
   if (!subtree.ptr) head->node_count_at_last_error = new_node->node_count;
   head->node = new_node;
+  if (self->heads.size > self->stats.max_version_count) {
+    self->stats.max_version_count = self->heads.size;
+  }
 }
 
 inline StackAction iterate_callback(void *payload, const StackIterator *iterator) {
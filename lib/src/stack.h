@@ -28,12 +28,22 @@ typedef struct {
 } StackSummaryEntry;
 typedef Array(StackSummaryEntry) StackSummary;
 
+typedef struct {
+  uint64_t node_count;
+  uint64_t node_slab_count;
+  uint32_t max_version_count;
+} StackStats;
+
 // Create a stack.
 Stack *ts_stack_new(SubtreePool *);
 
 // Release the memory reserved for a given stack.
 void ts_stack_delete(Stack *);
 
+// Get counters describing the stack's version and node usage, accumulated
+// since the stack was created.
+StackStats ts_stack_stats(const Stack *);
+
 // Get the stack's current number of versions.
 uint32_t ts_stack_version_count(const Stack *);
 
@@ -50,6 +60,17 @@ void ts_stack_set_last_external_token(Stack *, StackVersion, Subtree );
 // Get the position of the given version of the stack within the document.
 Length ts_stack_position(const Stack *, StackVersion);
 
+// Get the subtree at the bottom of the given version of the stack, which was
+// pushed onto the stack's base node. This returns NULL if there is more than one
+// path from the version's head to the base node, or if the bottom entry is not a
+// subtree that has been fully parsed.
+Subtree *ts_stack_bottom_subtree(Stack *, StackVersion);
+
+// Get all of the subtrees on the given version of the stack, from the bottom
+// to the top, following the first path where there are several.
+// Each of the subtrees is retained.
+SubtreeArray ts_stack_subtrees(const Stack *, StackVersion);
+
 // Push a tree and state onto the given version of the stack.
 //
 // This transfers ownership of the tree to the Stack. Callers that
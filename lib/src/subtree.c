@@ -20,33 +20,77 @@ typedef struct {
 
 #define TS_MAX_INLINE_TREE_LENGTH UINT8_MAX
 #define TS_MAX_TREE_POOL_SIZE 32
+#define TS_ARENA_SLAB_SIZE (64 * 1024)
+#define TS_ARENA_ALIGNMENT 8
 
-static const ExternalScannerState empty_state = {{.short_data = {0}}, .length = 0};
+struct SubtreeArenaSlab {
+  SubtreeArenaSlab *next;
+  size_t size;
+  size_t capacity;
+};
+
+#define EMPTY_EXTERNAL_SCANNER_STATE_HASH 2166136261u
+
+static const ExternalScannerState empty_state = {
+  {.short_data = {0}},
+  .length = 0,
+  .hash = EMPTY_EXTERNAL_SCANNER_STATE_HASH,
+};
 
 // ExternalScannerState
 
+// The reference-counted storage for a long external scanner state.
+typedef struct {
+  volatile uint32_t ref_count;
+  char data[];
+} ExternalScannerStateData;
+
+static inline ExternalScannerStateData *ts_external_scanner_state__long_data(
+  const ExternalScannerState *self
+) {
+  return (ExternalScannerStateData *)(self->long_data - offsetof(ExternalScannerStateData, data));
+}
+
+uint32_t ts_external_scanner_state_hash(const char *data, unsigned length) {
+  uint32_t hash = EMPTY_EXTERNAL_SCANNER_STATE_HASH;
+  for (unsigned i = 0; i < length; i++) {
+    hash ^= (uint8_t)data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
 void ts_external_scanner_state_init(ExternalScannerState *self, const char *data, unsigned length) {
   self->length = length;
+  self->hash = ts_external_scanner_state_hash(data, length);
   if (length > sizeof(self->short_data)) {
-    self->long_data = ts_malloc(length);
-    memcpy(self->long_data, data, length);
-  } else {
+    ExternalScannerStateData *long_data = ts_malloc(sizeof(ExternalScannerStateData) + length);
+    ts_track_allocate(TSAllocationCategoryExternalScannerState, long_data, sizeof(ExternalScannerStateData) + length);
+    long_data->ref_count = 1;
+    memcpy(long_data->data, data, length);
+    self->long_data = long_data->data;
+  } else if (length > 0) {
     memcpy(self->short_data, data, length);
   }
 }
 
 ExternalScannerState ts_external_scanner_state_copy(const ExternalScannerState *self) {
-  ExternalScannerState result = *self;
   if (self->length > sizeof(self->short_data)) {
-    result.long_data = ts_malloc(self->length);
-    memcpy(result.long_data, self->long_data, self->length);
+    ExternalScannerStateData *long_data = ts_external_scanner_state__long_data(self);
+    if (long_data->ref_count != TS_FROZEN_REF_COUNT) atomic_inc(&long_data->ref_count);
   }
-  return result;
+  return *self;
 }
 
 void ts_external_scanner_state_delete(ExternalScannerState *self) {
   if (self->length > sizeof(self->short_data)) {
-    ts_free(self->long_data);
+    ExternalScannerStateData *long_data = ts_external_scanner_state__long_data(self);
+    if (long_data->ref_count == TS_FROZEN_REF_COUNT) return;
+    assert(long_data->ref_count > 0);
+    if (atomic_dec(&long_data->ref_count) == 0) {
+      ts_track_free(TSAllocationCategoryExternalScannerState, long_data, sizeof(ExternalScannerStateData) + self->length);
+      ts_free(long_data);
+    }
   }
 }
 
@@ -59,10 +103,10 @@ const char *ts_external_scanner_state_data(const ExternalScannerState *self) {
 }
 
 bool ts_external_scanner_state_eq(const ExternalScannerState *a, const ExternalScannerState *b) {
-  return a == b || (
-    a->length == b->length &&
-    !memcmp(ts_external_scanner_state_data(a), ts_external_scanner_state_data(b), a->length)
-  );
+  if (a == b) return true;
+  if (a->length != b->length || a->hash != b->hash) return false;
+  if (a->length > sizeof(a->short_data) && a->long_data == b->long_data) return true;
+  return !memcmp(ts_external_scanner_state_data(a), ts_external_scanner_state_data(b), a->length);
 }
 
 // SubtreeArray
@@ -121,7 +165,7 @@ void ts_subtree_array_reverse(SubtreeArray *self) {
 // SubtreePool
 
 SubtreePool ts_subtree_pool_new(uint32_t capacity) {
-  SubtreePool self = {array_new(), array_new()};
+  SubtreePool self = {array_new(), array_new(), NULL, 0, 0};
   array_reserve(&self.free_trees, capacity);
   return self;
 }
@@ -129,6 +173,7 @@ SubtreePool ts_subtree_pool_new(uint32_t capacity) {
 void ts_subtree_pool_delete(SubtreePool *self) {
   if (self->free_trees.contents) {
     for (unsigned i = 0; i < self->free_trees.size; i++) {
+      ts_track_free(TSAllocationCategorySubtree, self->free_trees.contents[i].ptr, sizeof(SubtreeHeapData));
       ts_free(self->free_trees.contents[i].ptr);
     }
     array_delete(&self->free_trees);
@@ -136,18 +181,112 @@ void ts_subtree_pool_delete(SubtreePool *self) {
   if (self->tree_stack.contents) array_delete(&self->tree_stack);
 }
 
+// SubtreeArena
+
+SubtreeArena *ts_subtree_arena_new(void) {
+  SubtreeArena *self = ts_malloc(sizeof(SubtreeArena));
+  self->ref_count = 1;
+  self->slabs = NULL;
+  self->is_frozen = false;
+  return self;
+}
+
+void ts_subtree_arena_retain(SubtreeArena *self) {
+  assert(self->ref_count > 0);
+  atomic_inc(&self->ref_count);
+}
+
+void ts_subtree_arena_release(SubtreeArena *self) {
+  assert(self->ref_count > 0);
+  if (atomic_dec(&self->ref_count) == 0) {
+    SubtreeArenaSlab *slab = self->slabs;
+    while (slab) {
+      SubtreeArenaSlab *next = slab->next;
+      ts_track_free(TSAllocationCategorySubtree, slab, sizeof(SubtreeArenaSlab) + slab->capacity);
+      ts_free(slab);
+      slab = next;
+    }
+    ts_free(self);
+  }
+}
+
+// Allocate a slab that holds exactly the given number of bytes, and is
+// already full.
+static void *ts_subtree_arena__allocate_exact(SubtreeArena *self, size_t size) {
+  SubtreeArenaSlab *slab = ts_malloc(sizeof(SubtreeArenaSlab) + size);
+  ts_track_allocate(TSAllocationCategorySubtree, slab, sizeof(SubtreeArenaSlab) + size);
+  slab->size = size;
+  slab->capacity = size;
+
+  // Insert the slab behind the head of the list, so that the partially-filled
+  // slab at the head can continue to be used.
+  if (self->slabs) {
+    slab->next = self->slabs->next;
+    self->slabs->next = slab;
+  } else {
+    slab->next = NULL;
+    self->slabs = slab;
+  }
+  return &slab[1];
+}
+
+static void *ts_subtree_arena_allocate(SubtreeArena *self, size_t size) {
+  size = (size + TS_ARENA_ALIGNMENT - 1) & ~(size_t)(TS_ARENA_ALIGNMENT - 1);
+  SubtreeArenaSlab *slab = self->slabs;
+  if (!slab || slab->size + size > slab->capacity) {
+    size_t capacity = TS_ARENA_SLAB_SIZE;
+
+    // Give unusually large nodes their own slab.
+    if (size > TS_ARENA_SLAB_SIZE / 4) {
+      return ts_subtree_arena__allocate_exact(self, size);
+    }
+
+    slab = ts_malloc(sizeof(SubtreeArenaSlab) + capacity);
+    ts_track_allocate(TSAllocationCategorySubtree, slab, sizeof(SubtreeArenaSlab) + capacity);
+    slab->next = self->slabs;
+    slab->size = 0;
+    slab->capacity = capacity;
+    self->slabs = slab;
+  }
+  void *result = (char *)&slab[1] + slab->size;
+  slab->size += size;
+  return result;
+}
+
+void ts_subtree_arena_array_copy(const SubtreeArenaArray *self, SubtreeArenaArray *dest) {
+  for (unsigned i = 0; i < self->size; i++) {
+    ts_subtree_arena_retain(self->contents[i]);
+    array_push(dest, self->contents[i]);
+  }
+}
+
+void ts_subtree_arena_array_clear(SubtreeArenaArray *self) {
+  for (unsigned i = 0; i < self->size; i++) {
+    ts_subtree_arena_release(self->contents[i]);
+  }
+  array_clear(self);
+}
+
 static SubtreeHeapData *ts_subtree_pool_allocate(SubtreePool *self) {
-  if (self->free_trees.size > 0) {
+  self->allocation_count++;
+  self->allocated_bytes += sizeof(SubtreeHeapData);
+  if (self->arena) {
+    return ts_subtree_arena_allocate(self->arena, sizeof(SubtreeHeapData));
+  } else if (self->free_trees.size > 0) {
     return array_pop(&self->free_trees).ptr;
   } else {
-    return ts_malloc(sizeof(SubtreeHeapData));
+    SubtreeHeapData *result = ts_malloc(sizeof(SubtreeHeapData));
+    ts_track_allocate(TSAllocationCategorySubtree, result, sizeof(SubtreeHeapData));
+    return result;
   }
 }
 
 static void ts_subtree_pool_free(SubtreePool *self, SubtreeHeapData *tree) {
+  if (tree->is_arena) return;
   if (self->free_trees.capacity > 0 && self->free_trees.size + 1 <= TS_MAX_TREE_POOL_SIZE) {
     array_push(&self->free_trees, (MutableSubtree) {.ptr = tree});
   } else {
+    ts_track_free(TSAllocationCategorySubtree, tree, sizeof(SubtreeHeapData));
     ts_free(tree);
   }
 }
@@ -217,6 +356,7 @@ Subtree ts_subtree_new_leaf(
       .depends_on_column = depends_on_column,
       .is_missing = false,
       .is_keyword = is_keyword,
+      .is_arena = pool->arena != NULL,
       {{.first_leaf = {.symbol = 0, .parse_state = 0}}}
     };
     return (Subtree) {.ptr = data};
@@ -260,6 +400,7 @@ Subtree ts_subtree_new_error(
 MutableSubtree ts_subtree_clone(Subtree self) {
   size_t alloc_size = ts_subtree_alloc_size(self.ptr->child_count);
   Subtree *new_children = ts_malloc(alloc_size);
+  ts_track_allocate(TSAllocationCategorySubtree, new_children, alloc_size);
   Subtree *old_children = ts_subtree_children(self);
   memcpy(new_children, old_children, alloc_size);
   SubtreeHeapData *result = (SubtreeHeapData *)&new_children[self.ptr->child_count];
@@ -273,6 +414,7 @@ MutableSubtree ts_subtree_clone(Subtree self) {
     );
   }
   result->ref_count = 1;
+  result->is_arena = false;
   return (MutableSubtree) {.ptr = result};
 }
 
@@ -376,6 +518,7 @@ void ts_subtree_summarize_children(
 
   self.ptr->named_child_count = 0;
   self.ptr->visible_child_count = 0;
+  self.ptr->visible_descendant_count = 0;
   self.ptr->error_cost = 0;
   self.ptr->repeat_depth = 0;
   self.ptr->node_count = 1;
@@ -430,11 +573,13 @@ void ts_subtree_summarize_children(
     self.ptr->node_count += ts_subtree_node_count(child);
 
     if (alias_sequence && alias_sequence[structural_index] != 0 && !ts_subtree_extra(child)) {
+      self.ptr->visible_descendant_count++;
       self.ptr->visible_child_count++;
       if (ts_language_symbol_metadata(language, alias_sequence[structural_index]).named) {
         self.ptr->named_child_count++;
       }
     } else if (ts_subtree_visible(child)) {
+      self.ptr->visible_descendant_count++;
       self.ptr->visible_child_count++;
       if (ts_subtree_named(child)) self.ptr->named_child_count++;
     } else if (grandchild_count > 0) {
@@ -442,6 +587,10 @@ void ts_subtree_summarize_children(
       self.ptr->named_child_count += child.ptr->named_child_count;
     }
 
+    if (grandchild_count > 0) {
+      self.ptr->visible_descendant_count += child.ptr->visible_descendant_count;
+    }
+
     if (ts_subtree_has_external_tokens(child)) self.ptr->has_external_tokens = true;
 
     if (ts_subtree_is_error(child)) {
@@ -488,8 +637,11 @@ void ts_subtree_summarize_children(
 
 // Create a new parent node with the given children.
 //
-// This takes ownership of the children array.
+// This takes ownership of the children array. If the pool has an arena, the
+// children are moved into the arena and the array's buffer is freed. The pool
+// may be NULL, in which case the node is always built in place in the array.
 MutableSubtree ts_subtree_new_node(
+  SubtreePool *pool,
   TSSymbol symbol,
   SubtreeArray *children,
   unsigned production_id,
@@ -497,13 +649,27 @@ MutableSubtree ts_subtree_new_node(
 ) {
   TSSymbolMetadata metadata = ts_language_symbol_metadata(language, symbol);
   bool fragile = symbol == ts_builtin_sym_error || symbol == ts_builtin_sym_error_repeat;
+  bool is_arena = pool && pool->arena;
 
   // Allocate the node's data at the end of the array of children.
   size_t new_byte_size = ts_subtree_alloc_size(children->size);
-  if (children->capacity * sizeof(Subtree) < new_byte_size) {
+  if (pool) {
+    pool->allocation_count++;
+    pool->allocated_bytes += new_byte_size;
+  }
+  if (is_arena) {
+    uint32_t child_count = children->size;
+    Subtree *contents = ts_subtree_arena_allocate(pool->arena, new_byte_size);
+    if (child_count > 0) memcpy(contents, children->contents, child_count * sizeof(Subtree));
+    array_delete(children);
+    children->contents = contents;
+    children->size = child_count;
+    children->capacity = child_count;
+  } else if (children->capacity * sizeof(Subtree) < new_byte_size) {
     children->contents = ts_realloc(children->contents, new_byte_size);
     children->capacity = new_byte_size / sizeof(Subtree);
   }
+  if (!is_arena) ts_track_allocate(TSAllocationCategorySubtree, children->contents, new_byte_size);
   SubtreeHeapData *data = (SubtreeHeapData *)&children->contents[children->size];
 
   *data = (SubtreeHeapData) {
@@ -516,6 +682,7 @@ MutableSubtree ts_subtree_new_node(
     .fragile_left = fragile,
     .fragile_right = fragile,
     .is_keyword = false,
+    .is_arena = is_arena,
     {{
       .node_count = 0,
       .production_id = production_id,
@@ -532,12 +699,13 @@ MutableSubtree ts_subtree_new_node(
 // This node is treated as 'extra'. Its children are prevented from having
 // having any effect on the parse state.
 Subtree ts_subtree_new_error_node(
+  SubtreePool *pool,
   SubtreeArray *children,
   bool extra,
   const TSLanguage *language
 ) {
   MutableSubtree result = ts_subtree_new_node(
-    ts_builtin_sym_error, children, 0, language
+    pool, ts_builtin_sym_error, children, 0, language
   );
   result.ptr->extra = extra;
   return ts_subtree_from_mut(result);
@@ -565,15 +733,42 @@ Subtree ts_subtree_new_missing_leaf(
   return result;
 }
 
+// Create a leaf that stands in for the given subtree after its contents have
+// been discarded. It has the same symbol, size and error cost, so the rest of
+// the parse is unaffected. It is marked as changed, so that later incremental
+// parses never try to reuse it.
+Subtree ts_subtree_new_placeholder(SubtreePool *pool, Subtree self) {
+  SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
+  *data = (SubtreeHeapData) {
+    .ref_count = 1,
+    .padding = ts_subtree_padding(self),
+    .size = ts_subtree_size(self),
+    .lookahead_bytes = ts_subtree_lookahead_bytes(self),
+    .error_cost = ts_subtree_error_cost(self),
+    .child_count = 0,
+    .symbol = ts_subtree_symbol(self),
+    .parse_state = ts_subtree_parse_state(self),
+    .visible = false,
+    .named = false,
+    .extra = ts_subtree_extra(self),
+    .fragile_left = true,
+    .fragile_right = true,
+    .has_changes = true,
+    .is_arena = pool->arena != NULL,
+    {{.first_leaf = {.symbol = 0, .parse_state = 0}}}
+  };
+  return (Subtree) {.ptr = data};
+}
+
 void ts_subtree_retain(Subtree self) {
-  if (self.data.is_inline) return;
+  if (self.data.is_inline || self.ptr->ref_count == TS_FROZEN_REF_COUNT) return;
   assert(self.ptr->ref_count > 0);
   atomic_inc((volatile uint32_t *)&self.ptr->ref_count);
   assert(self.ptr->ref_count != 0);
 }
 
 void ts_subtree_release(SubtreePool *pool, Subtree self) {
-  if (self.data.is_inline) return;
+  if (self.data.is_inline || self.ptr->ref_count == TS_FROZEN_REF_COUNT) return;
   array_clear(&pool->tree_stack);
 
   assert(self.ptr->ref_count > 0);
@@ -587,13 +782,16 @@ void ts_subtree_release(SubtreePool *pool, Subtree self) {
       Subtree *children = ts_subtree_children(tree);
       for (uint32_t i = 0; i < tree.ptr->child_count; i++) {
         Subtree child = children[i];
-        if (child.data.is_inline) continue;
+        if (child.data.is_inline || child.ptr->ref_count == TS_FROZEN_REF_COUNT) continue;
         assert(child.ptr->ref_count > 0);
         if (atomic_dec((volatile uint32_t *)&child.ptr->ref_count) == 0) {
           array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(child));
         }
       }
-      ts_free(children);
+      if (!tree.ptr->is_arena) {
+        ts_track_free(TSAllocationCategorySubtree, children, ts_subtree_alloc_size(tree.ptr->child_count));
+        ts_free(children);
+      }
     } else {
       if (tree.ptr->has_external_tokens) {
         ts_external_scanner_state_delete(&tree.ptr->external_scanner_state);
@@ -603,6 +801,461 @@ void ts_subtree_release(SubtreePool *pool, Subtree self) {
   }
 }
 
+// Copy a subtree into an arena, marking all of the copied nodes as frozen.
+// Nodes that are already frozen are not copied, but shared.
+Subtree ts_subtree_freeze(Subtree self, SubtreeArena *arena) {
+  Array(Subtree *) stack = array_new();
+  array_push(&stack, &self);
+  while (stack.size > 0) {
+    Subtree *tree = array_pop(&stack);
+    if (tree->data.is_inline || tree->ptr->ref_count == TS_FROZEN_REF_COUNT) continue;
+
+    uint32_t child_count = tree->ptr->child_count;
+    size_t children_size = child_count * sizeof(Subtree);
+    char *memory = ts_subtree_arena_allocate(arena, children_size + sizeof(SubtreeHeapData));
+    if (child_count > 0) memcpy(memory, (const Subtree *)tree->ptr - child_count, children_size);
+    SubtreeHeapData *data = (SubtreeHeapData *)(memory + children_size);
+    *data = *tree->ptr;
+    data->ref_count = TS_FROZEN_REF_COUNT;
+    data->is_arena = true;
+
+    // Move long external scanner states into the arena as well, because
+    // frozen subtrees are never deleted individually.
+    if (
+      child_count == 0 &&
+      data->has_external_tokens &&
+      data->external_scanner_state.length > sizeof(data->external_scanner_state.short_data)
+    ) {
+      uint32_t length = data->external_scanner_state.length;
+      ExternalScannerStateData *long_data = ts_subtree_arena_allocate(
+        arena,
+        sizeof(ExternalScannerStateData) + length
+      );
+      long_data->ref_count = TS_FROZEN_REF_COUNT;
+      memcpy(long_data->data, data->external_scanner_state.long_data, length);
+      data->external_scanner_state.long_data = long_data->data;
+    }
+
+    *tree = (Subtree) {.ptr = data};
+    for (uint32_t i = 0; i < child_count; i++) {
+      array_push(&stack, &ts_subtree_children(*tree)[i]);
+    }
+  }
+  array_delete(&stack);
+  return self;
+}
+
+// CompactLeafTable - A hash set of the distinct heap-allocated leaves of a
+// tree, used when compacting it. Each entry maps the first occurrence of a
+// leaf to its copy in the compacted tree.
+typedef struct {
+  const SubtreeHeapData *leaf;
+  SubtreeHeapData *copy;
+} CompactLeafEntry;
+
+typedef struct {
+  CompactLeafEntry *entries;
+  uint32_t size;
+  uint32_t capacity;
+} CompactLeafTable;
+
+static inline size_t ts_subtree__compact_align(size_t size) {
+  return (size + TS_ARENA_ALIGNMENT - 1) & ~(size_t)(TS_ARENA_ALIGNMENT - 1);
+}
+
+static inline bool ts_subtree__has_long_external_scanner_state(const SubtreeHeapData *self) {
+  return
+    self->child_count == 0 &&
+    self->has_external_tokens &&
+    self->external_scanner_state.length > sizeof(self->external_scanner_state.short_data);
+}
+
+static uint32_t ts_subtree__leaf_hash(const SubtreeHeapData *self) {
+  uint32_t values[] = {
+    self->symbol,
+    self->parse_state,
+    self->padding.bytes,
+    self->padding.extent.row,
+    self->padding.extent.column,
+    self->size.bytes,
+    self->size.extent.row,
+    self->size.extent.column,
+    self->lookahead_bytes,
+    self->has_external_tokens ? self->external_scanner_state.hash : 0,
+  };
+  uint32_t hash = 2166136261u;
+  for (unsigned i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    hash ^= values[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Whether two nodes have the same properties, apart from those that are
+// specific to leaves or to parent nodes.
+static bool ts_subtree__common_fields_eq(const SubtreeHeapData *a, const SubtreeHeapData *b) {
+  return !(
+    a->symbol != b->symbol ||
+    a->parse_state != b->parse_state ||
+    !length_eq(a->padding, b->padding) ||
+    !length_eq(a->size, b->size) ||
+    a->lookahead_bytes != b->lookahead_bytes ||
+    a->error_cost != b->error_cost ||
+    a->visible != b->visible ||
+    a->named != b->named ||
+    a->extra != b->extra ||
+    a->fragile_left != b->fragile_left ||
+    a->fragile_right != b->fragile_right ||
+    a->has_changes != b->has_changes ||
+    a->has_external_tokens != b->has_external_tokens ||
+    a->depends_on_column != b->depends_on_column ||
+    a->is_missing != b->is_missing ||
+    a->is_keyword != b->is_keyword
+  );
+}
+
+// Whether two leaves are interchangeable in a tree that will never be edited.
+static bool ts_subtree__leaf_eq(const SubtreeHeapData *a, const SubtreeHeapData *b) {
+  if (!ts_subtree__common_fields_eq(a, b)) return false;
+  if (a->has_external_tokens) {
+    return ts_external_scanner_state_eq(&a->external_scanner_state, &b->external_scanner_state);
+  }
+  if (a->symbol == ts_builtin_sym_error) {
+    return a->lookahead_char == b->lookahead_char;
+  }
+  return true;
+}
+
+static CompactLeafEntry *compact_leaf_table_find(
+  const CompactLeafTable *self,
+  const SubtreeHeapData *leaf
+) {
+  uint32_t index_mask = self->capacity - 1;
+  for (uint32_t i = ts_subtree__leaf_hash(leaf) & index_mask;; i = (i + 1) & index_mask) {
+    CompactLeafEntry *entry = &self->entries[i];
+    if (!entry->leaf || ts_subtree__leaf_eq(entry->leaf, leaf)) return entry;
+  }
+}
+
+// Find the entry for a leaf, inserting the leaf if it has not been seen.
+static CompactLeafEntry *compact_leaf_table_insert(
+  CompactLeafTable *self,
+  const SubtreeHeapData *leaf,
+  bool *is_new
+) {
+  if (2 * (self->size + 1) > self->capacity) {
+    CompactLeafTable old = *self;
+    self->capacity = old.capacity ? 2 * old.capacity : 64;
+    self->entries = ts_calloc(self->capacity, sizeof(CompactLeafEntry));
+    for (uint32_t i = 0; i < old.capacity; i++) {
+      if (old.entries[i].leaf) {
+        *compact_leaf_table_find(self, old.entries[i].leaf) = old.entries[i];
+      }
+    }
+    ts_free(old.entries);
+  }
+
+  CompactLeafEntry *entry = compact_leaf_table_find(self, leaf);
+  *is_new = !entry->leaf;
+  if (*is_new) {
+    entry->leaf = leaf;
+    self->size++;
+  }
+  return entry;
+}
+
+// Copy a subtree into a single, exactly-sized block of an arena, marking all
+// of the copied nodes as frozen.
+//
+// Unlike `ts_subtree_freeze`, every node is copied, so the result does not
+// depend on any other arena. The nodes are laid out in the order in which a
+// depth-first traversal visits them, and identical heap-allocated leaves are
+// stored only once. Leaves can be shared because a node is identified by its
+// position within its parent's children, which is never shared.
+Subtree ts_subtree_compact(Subtree self, SubtreeArena *arena) {
+  if (self.data.is_inline) return self;
+
+  // Measure the compacted tree, finding the distinct leaves.
+  CompactLeafTable leaves = {NULL, 0, 0};
+  Array(const SubtreeHeapData *) stack = array_new();
+  size_t total_size = 0;
+  array_push(&stack, self.ptr);
+  while (stack.size > 0) {
+    const SubtreeHeapData *tree = array_pop(&stack);
+    if (tree->child_count > 0) {
+      total_size += ts_subtree__compact_align(ts_subtree_alloc_size(tree->child_count));
+      const Subtree *children = (const Subtree *)tree - tree->child_count;
+      for (uint32_t i = 0; i < tree->child_count; i++) {
+        if (!children[i].data.is_inline) array_push(&stack, children[i].ptr);
+      }
+    } else {
+      bool is_new;
+      compact_leaf_table_insert(&leaves, tree, &is_new);
+      if (!is_new) continue;
+      total_size += ts_subtree__compact_align(sizeof(SubtreeHeapData));
+      if (ts_subtree__has_long_external_scanner_state(tree)) {
+        total_size += ts_subtree__compact_align(
+          sizeof(ExternalScannerStateData) + tree->external_scanner_state.length
+        );
+      }
+    }
+  }
+
+  // Copy the nodes in preorder. Each stack entry is the slot in the already
+  // copied parent that must be pointed at the copy of the child.
+  char *memory = ts_subtree_arena__allocate_exact(arena, total_size);
+  Array(Subtree *) slots = array_new();
+  array_push(&slots, &self);
+  while (slots.size > 0) {
+    Subtree *slot = array_pop(&slots);
+    const SubtreeHeapData *tree = slot->ptr;
+    uint32_t child_count = tree->child_count;
+
+    SubtreeHeapData *data;
+    if (child_count > 0) {
+      size_t children_size = child_count * sizeof(Subtree);
+      memcpy(memory, (const Subtree *)tree - child_count, children_size);
+      data = (SubtreeHeapData *)(memory + children_size);
+      memory += ts_subtree__compact_align(children_size + sizeof(SubtreeHeapData));
+    } else {
+      bool is_new;
+      CompactLeafEntry *entry = compact_leaf_table_insert(&leaves, tree, &is_new);
+      if (entry->copy) {
+        *slot = (Subtree) {.ptr = entry->copy};
+        continue;
+      }
+      data = (SubtreeHeapData *)memory;
+      memory += ts_subtree__compact_align(sizeof(SubtreeHeapData));
+      entry->copy = data;
+    }
+
+    *data = *tree;
+    data->ref_count = TS_FROZEN_REF_COUNT;
+    data->is_arena = true;
+    if (ts_subtree__has_long_external_scanner_state(data)) {
+      uint32_t length = data->external_scanner_state.length;
+      ExternalScannerStateData *long_data = (ExternalScannerStateData *)memory;
+      memory += ts_subtree__compact_align(sizeof(ExternalScannerStateData) + length);
+      long_data->ref_count = TS_FROZEN_REF_COUNT;
+      memcpy(long_data->data, data->external_scanner_state.long_data, length);
+      data->external_scanner_state.long_data = long_data->data;
+    }
+
+    *slot = (Subtree) {.ptr = data};
+    Subtree *children = ts_subtree_children(*slot);
+    for (uint32_t i = child_count; i > 0; i--) {
+      if (!children[i - 1].data.is_inline) array_push(&slots, &children[i - 1]);
+    }
+  }
+
+  array_delete(&stack);
+  array_delete(&slots);
+  ts_free(leaves.entries);
+  return self;
+}
+
+// SubtreeSharingTable - Structural sharing of identical subtrees between the
+// trees produced by one parser.
+//
+// The table is set-associative: a subtree can only be stored in one of the
+// `SUBTREE_SHARING_WAYS` entries of the group selected by its hash, and when
+// the group is full, the entry that was least recently used is evicted.
+#define SUBTREE_SHARING_WAYS 4
+
+static inline uint32_t ts_subtree__hash_value(uint32_t hash, uint32_t value) {
+  hash ^= value;
+  hash *= 16777619u;
+  return hash;
+}
+
+static inline uint32_t ts_subtree__hash_child(uint32_t hash, Subtree child) {
+  if (child.data.is_inline) {
+    uint32_t words[2];
+    memcpy(words, &child.data, sizeof(words));
+    hash = ts_subtree__hash_value(hash, words[0]);
+    return ts_subtree__hash_value(hash, words[1]);
+  } else {
+    uint64_t address = (uintptr_t)child.ptr;
+    hash = ts_subtree__hash_value(hash, (uint32_t)address);
+    return ts_subtree__hash_value(hash, (uint32_t)(address >> 32));
+  }
+}
+
+// Hash a node by its own properties and by the identity of its children, which
+// have already been shared, so that the cost does not depend on its size.
+static uint32_t ts_subtree__shared_node_hash(const SubtreeHeapData *self) {
+  if (self->child_count == 0) return ts_subtree__leaf_hash(self);
+  uint32_t values[] = {
+    self->symbol,
+    self->production_id,
+    self->parse_state,
+    self->padding.bytes,
+    self->size.bytes,
+    self->child_count,
+  };
+  uint32_t hash = 2166136261u;
+  for (unsigned i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    hash = ts_subtree__hash_value(hash, values[i]);
+  }
+  const Subtree *children = (const Subtree *)self - self->child_count;
+  for (uint32_t i = 0; i < self->child_count; i++) {
+    hash = ts_subtree__hash_child(hash, children[i]);
+  }
+  return hash;
+}
+
+static inline bool ts_subtree__child_eq(Subtree a, Subtree b) {
+  if (a.data.is_inline != b.data.is_inline) return false;
+  if (a.data.is_inline) return memcmp(&a.data, &b.data, sizeof(SubtreeInlineData)) == 0;
+  return a.ptr == b.ptr;
+}
+
+// Whether two nodes are interchangeable. Parent nodes are only considered
+// equal if their children are identical, not merely equal.
+static bool ts_subtree__shared_node_eq(const SubtreeHeapData *a, const SubtreeHeapData *b) {
+  if (a->child_count != b->child_count) return false;
+  if (a->child_count == 0) return ts_subtree__leaf_eq(a, b);
+  if (
+    !ts_subtree__common_fields_eq(a, b) ||
+    a->production_id != b->production_id ||
+    a->dynamic_precedence != b->dynamic_precedence ||
+    a->repeat_depth != b->repeat_depth
+  ) return false;
+  const Subtree *a_children = (const Subtree *)a - a->child_count;
+  const Subtree *b_children = (const Subtree *)b - b->child_count;
+  for (uint32_t i = 0; i < a->child_count; i++) {
+    if (!ts_subtree__child_eq(a_children[i], b_children[i])) return false;
+  }
+  return true;
+}
+
+void ts_subtree_sharing_table_clear(SubtreeSharingTable *self, SubtreePool *pool) {
+  for (uint32_t i = 0; i < self->capacity; i++) {
+    SubtreeSharingEntry *entry = &self->entries[i];
+    if (entry->subtree.ptr) {
+      ts_subtree_release(pool, entry->subtree);
+      entry->subtree = NULL_SUBTREE;
+    }
+  }
+}
+
+void ts_subtree_sharing_table_set_capacity(
+  SubtreeSharingTable *self,
+  uint32_t capacity,
+  SubtreePool *pool
+) {
+  ts_subtree_sharing_table_clear(self, pool);
+  ts_free(self->entries);
+  self->entries = NULL;
+  self->capacity = 0;
+  if (capacity == 0) return;
+
+  uint32_t rounded_capacity = SUBTREE_SHARING_WAYS;
+  while (rounded_capacity < capacity && rounded_capacity < (1u << 31)) {
+    rounded_capacity *= 2;
+  }
+  self->entries = ts_calloc(rounded_capacity, sizeof(SubtreeSharingEntry));
+  self->capacity = rounded_capacity;
+}
+
+// Find a node that is identical to the given one, or add the given node to the
+// table. Returns the node that should take the given node's place in the tree.
+static Subtree ts_subtree_sharing_table__intern(
+  SubtreeSharingTable *self,
+  SubtreePool *pool,
+  Subtree tree,
+  uint64_t *shared_count
+) {
+  uint32_t hash = ts_subtree__shared_node_hash(tree.ptr);
+  uint32_t group_start = hash & (self->capacity - 1) & ~(uint32_t)(SUBTREE_SHARING_WAYS - 1);
+  SubtreeSharingEntry *victim = NULL;
+  for (uint32_t i = 0; i < SUBTREE_SHARING_WAYS; i++) {
+    SubtreeSharingEntry *entry = &self->entries[group_start + i];
+    if (!entry->subtree.ptr) {
+      if (!victim || victim->subtree.ptr) victim = entry;
+      continue;
+    }
+
+    if (entry->hash == hash && ts_subtree__shared_node_eq(entry->subtree.ptr, tree.ptr)) {
+      // A parent node can only appear once in a tree, because nodes are
+      // identified by the address of the slot that holds them. Leaves can
+      // be shared freely.
+      if (tree.ptr->child_count > 0 && entry->generation == self->generation) {
+        return tree;
+      }
+      entry->generation = self->generation;
+      ts_subtree_retain(entry->subtree);
+      ts_subtree_release(pool, tree);
+      (*shared_count)++;
+      return entry->subtree;
+    }
+
+    if (!victim || (victim->subtree.ptr && entry->generation < victim->generation)) {
+      victim = entry;
+    }
+  }
+
+  if (victim->subtree.ptr) ts_subtree_release(pool, victim->subtree);
+  ts_subtree_retain(tree);
+  *victim = (SubtreeSharingEntry) {
+    .subtree = tree,
+    .hash = hash,
+    .generation = self->generation,
+  };
+  return tree;
+}
+
+// Replace the nodes of a newly-parsed tree with identical nodes from earlier
+// trees, and remember the remaining nodes so that later trees can share them.
+//
+// Nodes are visited in post-order, so that a parent node can be looked up
+// using the identities of its already-shared children. Only nodes that are
+// exclusively owned by this tree are visited.
+Subtree ts_subtree_share(
+  Subtree self,
+  SubtreeSharingTable *table,
+  SubtreePool *pool,
+  uint64_t *shared_count
+) {
+  if (table->capacity == 0) return self;
+  table->generation++;
+
+  typedef struct {
+    Subtree *slot;
+    bool visited_children;
+  } ShareStackEntry;
+  Array(ShareStackEntry) stack = array_new();
+  array_push(&stack, ((ShareStackEntry) {&self, false}));
+  while (stack.size > 0) {
+    ShareStackEntry *entry = array_back(&stack);
+    Subtree *slot = entry->slot;
+    if (
+      slot->data.is_inline ||
+      slot->ptr->ref_count != 1 ||
+      slot->ptr->has_changes ||
+      slot->ptr->is_arena
+    ) {
+      stack.size--;
+      continue;
+    }
+
+    uint32_t child_count = slot->ptr->child_count;
+    if (child_count > 0 && !entry->visited_children) {
+      entry->visited_children = true;
+      Subtree *children = ts_subtree_children(*slot);
+      for (uint32_t i = child_count; i > 0; i--) {
+        array_push(&stack, ((ShareStackEntry) {&children[i - 1], false}));
+      }
+      continue;
+    }
+
+    stack.size--;
+    *slot = ts_subtree_sharing_table__intern(table, pool, *slot, shared_count);
+  }
+  array_delete(&stack);
+  return self;
+}
+
 bool ts_subtree_eq(Subtree self, Subtree other) {
   if (self.data.is_inline || other.data.is_inline) {
     return memcmp(&self, &other, sizeof(SubtreeInlineData)) == 0;
@@ -659,67 +1312,239 @@ static inline void ts_subtree_set_has_changes(MutableSubtree *self) {
   }
 }
 
+// Resize a subtree's padding and content to reflect an edit, which is expressed
+// relative to the start of the subtree's padding. Returns false if the subtree
+// is not affected by the edit.
+static inline bool ts_subtree__edit_length(
+  Length *padding,
+  Length *size,
+  uint32_t lookahead_bytes,
+  Edit edit
+) {
+  bool is_noop = edit.old_end.bytes == edit.start.bytes && edit.new_end.bytes == edit.start.bytes;
+  bool is_pure_insertion = edit.old_end.bytes == edit.start.bytes;
+  uint32_t end_byte = padding->bytes + size->bytes + lookahead_bytes;
+  if (edit.start.bytes > end_byte || (is_noop && edit.start.bytes == end_byte)) return false;
+
+  // If the edit is entirely within the space before this subtree, then shift this
+  // subtree over according to the edit without changing its size.
+  if (edit.old_end.bytes <= padding->bytes) {
+    *padding = length_add(edit.new_end, length_sub(*padding, edit.old_end));
+  }
+
+  // If the edit starts in the space before this subtree and extends into this subtree,
+  // shrink the subtree's content to compensate for the change in the space before it.
+  else if (edit.start.bytes < padding->bytes) {
+    *size = length_sub(*size, length_sub(edit.old_end, *padding));
+    *padding = edit.new_end;
+  }
+
+  // If the edit is a pure insertion right at the start of the subtree,
+  // shift the subtree over according to the insertion.
+  else if (edit.start.bytes == padding->bytes && is_pure_insertion) {
+    *padding = edit.new_end;
+  }
+
+  // If the edit is within this subtree, resize the subtree to reflect the edit.
+  else {
+    uint32_t total_bytes = padding->bytes + size->bytes;
+    if (edit.start.bytes < total_bytes ||
+       (edit.start.bytes == total_bytes && is_pure_insertion)) {
+      *size = length_add(
+        length_sub(edit.new_end, *padding),
+        length_sub(*size, length_sub(edit.old_end, *padding))
+      );
+    }
+  }
+
+  return true;
+}
+
 Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool) {
+  return ts_subtree_edit_batch(self, edit, 1, pool);
+}
+
+Subtree ts_subtree_edit_batch(
+  Subtree self,
+  const TSInputEdit *edits,
+  uint32_t edit_count,
+  SubtreePool *pool
+) {
   typedef struct {
     Subtree *tree;
-    Edit edit;
+    uint32_t edit_index;
+    uint32_t edit_count;
   } StackEntry;
 
+  typedef struct {
+    Length padding;
+    Length size;
+    Length original_right;
+  } ChildLength;
+
+  typedef struct {
+    uint32_t child_index;
+    Edit edit;
+  } ChildEdit;
+
   Array(StackEntry) stack = array_new();
+  Array(Edit) edit_list = array_new();
+  Array(ChildEdit) child_edits = array_new();
+  Array(ChildLength) child_lengths = array_new();
+
+  array_reserve(&edit_list, edit_count);
+  for (uint32_t i = 0; i < edit_count; i++) {
+    array_push(&edit_list, ((Edit) {
+      .start = {edits[i].start_byte, edits[i].start_point},
+      .old_end = {edits[i].old_end_byte, edits[i].old_end_point},
+      .new_end = {edits[i].new_end_byte, edits[i].new_end_point},
+    }));
+  }
   array_push(&stack, ((StackEntry) {
     .tree = &self,
-    .edit = (Edit) {
-      .start = {edit->start_byte, edit->start_point},
-      .old_end = {edit->old_end_byte, edit->old_end_point},
-      .new_end = {edit->new_end_byte, edit->new_end_point},
-    },
+    .edit_index = 0,
+    .edit_count = edit_count,
   }));
 
   while (stack.size) {
     StackEntry entry = array_pop(&stack);
-    Edit edit = entry.edit;
-    bool is_noop = edit.old_end.bytes == edit.start.bytes && edit.new_end.bytes == edit.start.bytes;
-    bool is_pure_insertion = edit.old_end.bytes == edit.start.bytes;
-    bool invalidate_first_row = ts_subtree_depends_on_column(*entry.tree);
-
-    Length size = ts_subtree_size(*entry.tree);
-    Length padding = ts_subtree_padding(*entry.tree);
-    uint32_t lookahead_bytes = ts_subtree_lookahead_bytes(*entry.tree);
-    uint32_t end_byte = padding.bytes + size.bytes + lookahead_bytes;
-    if (edit.start.bytes > end_byte || (is_noop && edit.start.bytes == end_byte)) continue;
-
-    // If the edit is entirely within the space before this subtree, then shift this
-    // subtree over according to the edit without changing its size.
-    if (edit.old_end.bytes <= padding.bytes) {
-      padding = length_add(edit.new_end, length_sub(padding, edit.old_end));
+    Subtree tree = *entry.tree;
+    bool invalidate_first_row = ts_subtree_depends_on_column(tree);
+    uint32_t child_count = ts_subtree_child_count(tree);
+
+    Length size = ts_subtree_size(tree);
+    Length padding = ts_subtree_padding(tree);
+    uint32_t lookahead_bytes = ts_subtree_lookahead_bytes(tree);
+
+    // When several edits reach this subtree, each one must be split among the
+    // children as they have already been resized by the edits before it.
+    bool track_child_lengths = entry.edit_count > 1 && child_count > 0;
+    uint32_t max_child_lookahead_bytes = 0;
+    uint32_t first_edited_child_index = child_count;
+    if (track_child_lengths) {
+      Length original_right = length_zero();
+      array_clear(&child_lengths);
+      array_reserve(&child_lengths, child_count);
+      for (uint32_t i = 0; i < child_count; i++) {
+        Subtree child = ts_subtree_children(tree)[i];
+        uint32_t child_lookahead_bytes = ts_subtree_lookahead_bytes(child);
+        if (child_lookahead_bytes > max_child_lookahead_bytes) {
+          max_child_lookahead_bytes = child_lookahead_bytes;
+        }
+        original_right = length_add(original_right, ts_subtree_total_size(child));
+        array_push(&child_lengths, ((ChildLength) {
+          .padding = ts_subtree_padding(child),
+          .size = ts_subtree_size(child),
+          .original_right = original_right,
+        }));
+      }
     }
 
-    // If the edit starts in the space before this subtree and extends into this subtree,
-    // shrink the subtree's content to compensate for the change in the space before it.
-    else if (edit.start.bytes < padding.bytes) {
-      size = length_sub(size, length_sub(edit.old_end, padding));
-      padding = edit.new_end;
-    }
+    bool is_affected = false;
+    array_clear(&child_edits);
+    for (uint32_t j = 0; j < entry.edit_count; j++) {
+      Edit edit = edit_list.contents[entry.edit_index + j];
+      if (!ts_subtree__edit_length(&padding, &size, lookahead_bytes, edit)) continue;
+      is_affected = true;
+
+      // Skip over the children that end well before this edit. None of them have
+      // been touched by the previous edits, so their positions are unchanged.
+      uint32_t first_child_index = 0;
+      Length child_left, child_right = length_zero();
+      if (track_child_lengths) {
+        uint32_t search_size = first_edited_child_index;
+        while (search_size > 0) {
+          uint32_t half_size = search_size / 2;
+          uint32_t mid_index = first_child_index + half_size;
+          uint32_t mid_right_bytes = child_lengths.contents[mid_index].original_right.bytes;
+          if (mid_right_bytes + max_child_lookahead_bytes < edit.start.bytes) {
+            first_child_index = mid_index + 1;
+            search_size -= half_size + 1;
+          } else {
+            search_size = half_size;
+          }
+        }
+        if (first_child_index > 0) {
+          child_right = child_lengths.contents[first_child_index - 1].original_right;
+        }
+      }
 
-    // If the edit is a pure insertion right at the start of the subtree,
-    // shift the subtree over according to the insertion.
-    else if (edit.start.bytes == padding.bytes && is_pure_insertion) {
-      padding = edit.new_end;
-    }
+      bool is_pure_insertion = edit.old_end.bytes == edit.start.bytes;
+      for (uint32_t i = first_child_index; i < child_count; i++) {
+        Subtree child = ts_subtree_children(tree)[i];
+        uint32_t child_lookahead_bytes = ts_subtree_lookahead_bytes(child);
+        Length child_size = track_child_lengths
+          ? length_add(child_lengths.contents[i].padding, child_lengths.contents[i].size)
+          : ts_subtree_total_size(child);
+        child_left = child_right;
+        child_right = length_add(child_left, child_size);
+
+        // If this child ends before the edit, it is not affected.
+        if (child_right.bytes + child_lookahead_bytes < edit.start.bytes) continue;
+
+        // Keep editing child nodes until a node is reached that starts after the edit.
+        // Also, if this node's validity depends on its column position, then continue
+        // invaliditing child nodes until reaching a line break.
+        if ((
+          (child_left.bytes > edit.old_end.bytes) ||
+          (child_left.bytes == edit.old_end.bytes && child_size.bytes > 0 && i > 0)
+        ) && (
+          !invalidate_first_row ||
+          child_left.extent.row > padding.extent.row
+        )) {
+          break;
+        }
 
-    // If the edit is within this subtree, resize the subtree to reflect the edit.
-    else {
-      uint32_t total_bytes = padding.bytes + size.bytes;
-      if (edit.start.bytes < total_bytes ||
-         (edit.start.bytes == total_bytes && is_pure_insertion)) {
-        size = length_add(
-          length_sub(edit.new_end, padding),
-          length_sub(size, length_sub(edit.old_end, padding))
-        );
+        // Transform edit into the child's coordinate space.
+        Edit child_edit = {
+          .start = length_sub(edit.start, child_left),
+          .old_end = length_sub(edit.old_end, child_left),
+          .new_end = length_sub(edit.new_end, child_left),
+        };
+
+        // Clamp child_edit to the child's bounds.
+        if (edit.start.bytes < child_left.bytes) child_edit.start = length_zero();
+        if (edit.old_end.bytes < child_left.bytes) child_edit.old_end = length_zero();
+        if (edit.new_end.bytes < child_left.bytes) child_edit.new_end = length_zero();
+        if (edit.old_end.bytes > child_right.bytes) child_edit.old_end = child_size;
+
+        // Interpret all inserted text as applying to the *first* child that touches the edit.
+        // Subsequent children are only never have any text inserted into them; they are only
+        // shrunk to compensate for the edit.
+        if (
+          child_right.bytes > edit.start.bytes ||
+          (child_right.bytes == edit.start.bytes && is_pure_insertion)
+        ) {
+          edit.new_end = edit.start;
+        }
+
+        // Children that occur before the edit are not reshaped by the edit.
+        else {
+          child_edit.old_end = child_edit.start;
+          child_edit.new_end = child_edit.start;
+        }
+
+        if (track_child_lengths) {
+          ChildLength *child_length = &child_lengths.contents[i];
+          if (i < first_edited_child_index) first_edited_child_index = i;
+          ts_subtree__edit_length(
+            &child_length->padding,
+            &child_length->size,
+            child_lookahead_bytes,
+            child_edit
+          );
+        }
+
+        array_push(&child_edits, ((ChildEdit) {
+          .child_index = i,
+          .edit = child_edit,
+        }));
       }
     }
 
-    MutableSubtree result = ts_subtree_make_mut(pool, *entry.tree);
+    if (!is_affected) continue;
+
+    MutableSubtree result = ts_subtree_make_mut(pool, tree);
 
     if (result.data.is_inline) {
       if (ts_subtree_can_inline(padding, size, lookahead_bytes)) {
@@ -747,6 +1572,7 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
         data->depends_on_column = false;
         data->is_missing = result.data.is_missing;
         data->is_keyword = result.data.is_keyword;
+        data->is_arena = pool->arena != NULL;
         result.ptr = data;
       }
     } else {
@@ -757,67 +1583,39 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
     ts_subtree_set_has_changes(&result);
     *entry.tree = ts_subtree_from_mut(result);
 
-    Length child_left, child_right = length_zero();
-    for (uint32_t i = 0, n = ts_subtree_child_count(*entry.tree); i < n; i++) {
-      Subtree *child = &ts_subtree_children(*entry.tree)[i];
-      Length child_size = ts_subtree_total_size(*child);
-      child_left = child_right;
-      child_right = length_add(child_left, child_size);
-
-      // If this child ends before the edit, it is not affected.
-      if (child_right.bytes + ts_subtree_lookahead_bytes(*child) < edit.start.bytes) continue;
-
-      // Keep editing child nodes until a node is reached that starts after the edit.
-      // Also, if this node's validity depends on its column position, then continue
-      // invaliditing child nodes until reaching a line break.
-      if ((
-        (child_left.bytes > edit.old_end.bytes) ||
-        (child_left.bytes == edit.old_end.bytes && child_size.bytes > 0 && i > 0)
-      ) && (
-        !invalidate_first_row ||
-        child_left.extent.row > entry.tree->ptr->padding.extent.row
-      )) {
-        break;
+    // Group the child edits by child, keeping each child's edits in the order that
+    // they were applied. Because the edits are applied from right to left, they
+    // are already almost sorted in descending order of child index.
+    for (uint32_t i = 1; i < child_edits.size; i++) {
+      ChildEdit child_edit = child_edits.contents[i];
+      uint32_t k = i;
+      while (k > 0 && child_edits.contents[k - 1].child_index < child_edit.child_index) {
+        child_edits.contents[k] = child_edits.contents[k - 1];
+        k--;
       }
+      child_edits.contents[k] = child_edit;
+    }
 
-      // Transform edit into the child's coordinate space.
-      Edit child_edit = {
-        .start = length_sub(edit.start, child_left),
-        .old_end = length_sub(edit.old_end, child_left),
-        .new_end = length_sub(edit.new_end, child_left),
+    // Queue processing of each affected child's subtree.
+    for (uint32_t i = 0; i < child_edits.size;) {
+      uint32_t child_index = child_edits.contents[i].child_index;
+      StackEntry child_entry = {
+        .tree = &ts_subtree_children(*entry.tree)[child_index],
+        .edit_index = edit_list.size,
+        .edit_count = 0,
       };
-
-      // Clamp child_edit to the child's bounds.
-      if (edit.start.bytes < child_left.bytes) child_edit.start = length_zero();
-      if (edit.old_end.bytes < child_left.bytes) child_edit.old_end = length_zero();
-      if (edit.new_end.bytes < child_left.bytes) child_edit.new_end = length_zero();
-      if (edit.old_end.bytes > child_right.bytes) child_edit.old_end = child_size;
-
-      // Interpret all inserted text as applying to the *first* child that touches the edit.
-      // Subsequent children are only never have any text inserted into them; they are only
-      // shrunk to compensate for the edit.
-      if (
-        child_right.bytes > edit.start.bytes ||
-        (child_right.bytes == edit.start.bytes && is_pure_insertion)
-      ) {
-        edit.new_end = edit.start;
-      }
-
-      // Children that occur before the edit are not reshaped by the edit.
-      else {
-        child_edit.old_end = child_edit.start;
-        child_edit.new_end = child_edit.start;
+      for (; i < child_edits.size && child_edits.contents[i].child_index == child_index; i++) {
+        array_push(&edit_list, child_edits.contents[i].edit);
+        child_entry.edit_count++;
       }
-
-      // Queue processing of this child's subtree.
-      array_push(&stack, ((StackEntry) {
-        .tree = child,
-        .edit = child_edit,
-      }));
+      array_push(&stack, child_entry);
     }
   }
 
   array_delete(&stack);
+  array_delete(&edit_list);
+  array_delete(&child_edits);
+  array_delete(&child_lengths);
   return self;
 }
 
@@ -966,6 +1764,95 @@ static size_t ts_subtree__write_to_string(
   return cursor - string;
 }
 
+typedef struct {
+  Subtree tree;
+  bool is_shared;
+} MemoryUsageFrame;
+
+// An open-addressing set of the nodes that have already been counted. Only
+// nodes with more than one reference need to be stored, because they are the
+// only ones that can be reached more than once.
+typedef struct {
+  const SubtreeHeapData **entries;
+  uint32_t capacity;
+  uint32_t size;
+} MemoryUsageVisitedSet;
+
+static inline uint32_t ts_subtree__visited_set_slot(const SubtreeHeapData *node, uint32_t capacity) {
+  uint64_t address = (uintptr_t)node;
+  uint32_t hash = ts_subtree__hash_value(2166136261u, (uint32_t)address);
+  hash = ts_subtree__hash_value(hash, (uint32_t)(address >> 32));
+  return hash & (capacity - 1);
+}
+
+// Add a node to the set. Returns false if it was already present.
+static bool ts_subtree__visited_set_insert(MemoryUsageVisitedSet *self, const SubtreeHeapData *node) {
+  if (2 * (self->size + 1) > self->capacity) {
+    uint32_t old_capacity = self->capacity;
+    const SubtreeHeapData **old_entries = self->entries;
+    self->capacity = old_capacity ? old_capacity * 2 : 64;
+    self->entries = ts_calloc(self->capacity, sizeof(SubtreeHeapData *));
+    for (uint32_t i = 0; i < old_capacity; i++) {
+      if (!old_entries[i]) continue;
+      uint32_t slot = ts_subtree__visited_set_slot(old_entries[i], self->capacity);
+      while (self->entries[slot]) slot = (slot + 1) & (self->capacity - 1);
+      self->entries[slot] = old_entries[i];
+    }
+    ts_free(old_entries);
+  }
+
+  uint32_t slot = ts_subtree__visited_set_slot(node, self->capacity);
+  while (self->entries[slot]) {
+    if (self->entries[slot] == node) return false;
+    slot = (slot + 1) & (self->capacity - 1);
+  }
+  self->entries[slot] = node;
+  self->size++;
+  return true;
+}
+
+// Add up the memory used by a subtree's nodes. A node that is referenced more
+// than once, or that is frozen, is shared with other trees, and so is every
+// node beneath it.
+void ts_subtree_memory_usage(Subtree self, TSTreeMemoryUsage *usage) {
+  Array(MemoryUsageFrame) stack = array_new();
+  MemoryUsageVisitedSet visited = {NULL, 0, 0};
+  array_push(&stack, ((MemoryUsageFrame) {self, false}));
+  while (stack.size > 0) {
+    MemoryUsageFrame frame = array_pop(&stack);
+    Subtree tree = frame.tree;
+    if (tree.data.is_inline) continue;
+
+    // Count a node that is referenced in several places, for example a leaf
+    // that was deduplicated by node sharing, only once.
+    if (tree.ptr->ref_count > 1 && !ts_subtree__visited_set_insert(&visited, tree.ptr)) continue;
+
+    bool is_shared = frame.is_shared || tree.ptr->ref_count != 1;
+    size_t size = ts_subtree_alloc_size(tree.ptr->child_count);
+    if (is_shared) {
+      usage->shared_subtree_bytes += size;
+    } else {
+      usage->unique_subtree_bytes += size;
+    }
+
+    if (tree.ptr->child_count > 0) {
+      Subtree *children = ts_subtree_children(tree);
+      for (uint32_t i = 0; i < tree.ptr->child_count; i++) {
+        if (children[i].data.is_inline) continue;
+        array_push(&stack, ((MemoryUsageFrame) {children[i], is_shared}));
+      }
+    } else if (
+      tree.ptr->has_external_tokens &&
+      tree.ptr->external_scanner_state.length > sizeof(tree.ptr->external_scanner_state.short_data)
+    ) {
+      usage->external_scanner_state_bytes +=
+        sizeof(ExternalScannerStateData) + tree.ptr->external_scanner_state.length;
+    }
+  }
+  ts_free(visited.entries);
+  array_delete(&stack);
+}
+
 char *ts_subtree_string(
   Subtree self,
   const TSLanguage *language,
@@ -1057,3 +1944,359 @@ bool ts_subtree_external_scanner_state_eq(Subtree self, Subtree other) {
   }
   return ts_external_scanner_state_eq(state1, state2);
 }
+
+// Serialization
+//
+// Subtrees are written in post-order, so that every node's children precede
+// it. Inline leaves are stored as small fixed-size records. Every other node
+// is stored as a larger record, followed by either a summary of its children,
+// the state of the external scanner that produced it, or the lookahead
+// character of an error leaf. Every record starts with its flags, and all
+// records are 4-byte aligned.
+
+enum {
+  SerializedSubtreeIsInline = 1 << 0,
+  SerializedSubtreeVisible = 1 << 1,
+  SerializedSubtreeNamed = 1 << 2,
+  SerializedSubtreeExtra = 1 << 3,
+  SerializedSubtreeFragileLeft = 1 << 4,
+  SerializedSubtreeFragileRight = 1 << 5,
+  SerializedSubtreeHasChanges = 1 << 6,
+  SerializedSubtreeHasExternalTokens = 1 << 7,
+  SerializedSubtreeDependsOnColumn = 1 << 8,
+  SerializedSubtreeIsMissing = 1 << 9,
+  SerializedSubtreeIsKeyword = 1 << 10,
+};
+
+typedef struct {
+  uint16_t flags;
+  TSSymbol symbol;
+  TSStateId parse_state;
+  uint8_t padding_bytes;
+  uint8_t padding_rows;
+  uint8_t padding_columns;
+  uint8_t size_bytes;
+  uint8_t lookahead_bytes;
+  uint8_t unused;
+} SerializedInlineSubtree;
+
+typedef struct {
+  uint16_t flags;
+  TSSymbol symbol;
+  TSStateId parse_state;
+  uint16_t production_id;
+  uint32_t child_count;
+  Length padding;
+  Length size;
+  uint32_t lookahead_bytes;
+  uint32_t error_cost;
+} SerializedSubtree;
+
+typedef struct {
+  uint32_t visible_child_count;
+  uint32_t named_child_count;
+  uint32_t visible_descendant_count;
+  uint32_t node_count;
+  uint32_t repeat_depth;
+  int32_t dynamic_precedence;
+  TSSymbol first_leaf_symbol;
+  TSStateId first_leaf_parse_state;
+} SerializedSubtreeSummary;
+
+static inline uint32_t ts_subtree__serialized_padding(uint32_t length) {
+  return (4 - (length & 3)) & 3;
+}
+
+// Append some bytes to the buffer, growing it geometrically.
+static inline void ts_subtree__write(SubtreeByteArray *buffer, const void *data, uint32_t length) {
+  if (buffer->size + length > buffer->capacity) {
+    uint32_t capacity = buffer->capacity * 2;
+    if (capacity < buffer->size + length) capacity = buffer->size + length;
+    array_reserve(buffer, capacity);
+  }
+  memcpy(&buffer->contents[buffer->size], data, length);
+  buffer->size += length;
+}
+
+static void ts_subtree__serialize_node(Subtree self, SubtreeByteArray *buffer) {
+  uint16_t flags = 0;
+  if (ts_subtree_visible(self)) flags |= SerializedSubtreeVisible;
+  if (ts_subtree_named(self)) flags |= SerializedSubtreeNamed;
+  if (ts_subtree_extra(self)) flags |= SerializedSubtreeExtra;
+  if (ts_subtree_has_changes(self)) flags |= SerializedSubtreeHasChanges;
+  if (ts_subtree_missing(self)) flags |= SerializedSubtreeIsMissing;
+  if (ts_subtree_is_keyword(self)) flags |= SerializedSubtreeIsKeyword;
+
+  if (self.data.is_inline) {
+    SerializedInlineSubtree node = {
+      .flags = flags | SerializedSubtreeIsInline,
+      .symbol = self.data.symbol,
+      .parse_state = self.data.parse_state,
+      .padding_bytes = self.data.padding_bytes,
+      .padding_rows = self.data.padding_rows,
+      .padding_columns = self.data.padding_columns,
+      .size_bytes = self.data.size_bytes,
+      .lookahead_bytes = self.data.lookahead_bytes,
+      .unused = 0,
+    };
+    ts_subtree__write(buffer, &node, sizeof(node));
+    return;
+  }
+
+  if (self.ptr->fragile_left) flags |= SerializedSubtreeFragileLeft;
+  if (self.ptr->fragile_right) flags |= SerializedSubtreeFragileRight;
+  if (self.ptr->has_external_tokens) flags |= SerializedSubtreeHasExternalTokens;
+  if (self.ptr->depends_on_column) flags |= SerializedSubtreeDependsOnColumn;
+
+  SerializedSubtree node = {
+    .flags = flags,
+    .symbol = self.ptr->symbol,
+    .parse_state = self.ptr->parse_state,
+    .production_id = self.ptr->child_count > 0 ? self.ptr->production_id : 0,
+    .child_count = self.ptr->child_count,
+    .padding = self.ptr->padding,
+    .size = self.ptr->size,
+    .lookahead_bytes = self.ptr->lookahead_bytes,
+    .error_cost = self.ptr->error_cost,
+  };
+  ts_subtree__write(buffer, &node, sizeof(node));
+
+  if (self.ptr->child_count > 0) {
+    SerializedSubtreeSummary summary = {
+      .visible_child_count = self.ptr->visible_child_count,
+      .named_child_count = self.ptr->named_child_count,
+      .visible_descendant_count = self.ptr->visible_descendant_count,
+      .node_count = self.ptr->node_count,
+      .repeat_depth = self.ptr->repeat_depth,
+      .dynamic_precedence = self.ptr->dynamic_precedence,
+      .first_leaf_symbol = self.ptr->first_leaf.symbol,
+      .first_leaf_parse_state = self.ptr->first_leaf.parse_state,
+    };
+    ts_subtree__write(buffer, &summary, sizeof(summary));
+  } else if (self.ptr->has_external_tokens) {
+    const ExternalScannerState *state = &self.ptr->external_scanner_state;
+    uint32_t length = state->length;
+    ts_subtree__write(buffer, &length, sizeof(length));
+    ts_subtree__write(buffer, ts_external_scanner_state_data(state), length);
+    array_grow_by(buffer, ts_subtree__serialized_padding(length));
+  } else if (self.ptr->symbol == ts_builtin_sym_error) {
+    ts_subtree__write(buffer, &self.ptr->lookahead_char, sizeof(int32_t));
+  }
+}
+
+// Append a serialized copy of the given subtree and all of its descendants
+// to the buffer. Returns the number of serialized nodes.
+uint32_t ts_subtree_serialize(Subtree self, SubtreeByteArray *buffer) {
+  typedef struct {
+    Subtree tree;
+    uint32_t child_index;
+  } StackEntry;
+
+  Array(StackEntry) stack = array_new();
+  uint32_t node_count = 0;
+  array_reserve(buffer, buffer->size + ts_subtree_node_count(self) * sizeof(SerializedSubtree));
+  array_push(&stack, ((StackEntry) {self, 0}));
+  while (stack.size > 0) {
+    StackEntry *entry = array_back(&stack);
+    if (entry->child_index < ts_subtree_child_count(entry->tree)) {
+      Subtree child = ts_subtree_children(entry->tree)[entry->child_index++];
+      array_push(&stack, ((StackEntry) {child, 0}));
+    } else {
+      ts_subtree__serialize_node(entry->tree, buffer);
+      node_count++;
+      stack.size--;
+    }
+  }
+  array_delete(&stack);
+  return node_count;
+}
+
+static inline bool ts_subtree__valid_symbol(TSSymbol symbol, const TSLanguage *language) {
+  return
+    symbol < language->symbol_count ||
+    symbol == ts_builtin_sym_error ||
+    symbol == ts_builtin_sym_error_repeat;
+}
+
+static inline bool ts_subtree__valid_parse_state(TSStateId state, const TSLanguage *language) {
+  return state < language->state_count || state == TS_TREE_STATE_NONE;
+}
+
+// Summarizing a node reads an alias for each of its non-extra children, so
+// there can't be more of them than the production's alias sequence holds.
+static bool ts_subtree__valid_alias_sequence_length(const SubtreeHeapData *self, const TSLanguage *language) {
+  if (!ts_language_alias_sequence(language, self->production_id)) return true;
+  const Subtree *children = (const Subtree *)self - self->child_count;
+  uint32_t structural_child_count = 0;
+  for (uint32_t i = 0; i < self->child_count; i++) {
+    if (!ts_subtree_extra(children[i])) structural_child_count++;
+  }
+  return structural_child_count <= language->max_alias_sequence_length;
+}
+
+// Rebuild a subtree from `node_count` nodes that were written by
+// `ts_subtree_serialize`. If the pool has an arena, all of the nodes are
+// allocated from it. Returns a null subtree if the data is malformed.
+Subtree ts_subtree_deserialize(
+  SubtreePool *pool,
+  const char *data,
+  uint32_t length,
+  uint32_t node_count,
+  const TSLanguage *language
+) {
+  SubtreeArray stack = array_new();
+  uint32_t offset = 0;
+
+  #define READ(value)                                              \
+    if (length - offset < sizeof(value)) goto error;               \
+    memcpy(&(value), data + offset, sizeof(value));                \
+    offset += sizeof(value);
+
+  for (uint32_t i = 0; i < node_count; i++) {
+    uint16_t flags;
+    if (length - offset < sizeof(flags)) goto error;
+    memcpy(&flags, data + offset, sizeof(flags));
+
+    if (flags & SerializedSubtreeIsInline) {
+      SerializedInlineSubtree node;
+      READ(node);
+      if (
+        node.symbol > UINT8_MAX ||
+        node.padding_rows > 15 ||
+        node.lookahead_bytes > 15 ||
+        !ts_subtree__valid_symbol(node.symbol, language) ||
+        !ts_subtree__valid_parse_state(node.parse_state, language)
+      ) goto error;
+      array_push(&stack, ((Subtree) {{
+        .is_inline = true,
+        .visible = flags & SerializedSubtreeVisible,
+        .named = flags & SerializedSubtreeNamed,
+        .extra = flags & SerializedSubtreeExtra,
+        .has_changes = flags & SerializedSubtreeHasChanges,
+        .is_missing = flags & SerializedSubtreeIsMissing,
+        .is_keyword = flags & SerializedSubtreeIsKeyword,
+        .symbol = node.symbol,
+        .parse_state = node.parse_state,
+        .padding_columns = node.padding_columns,
+        .padding_rows = node.padding_rows,
+        .lookahead_bytes = node.lookahead_bytes,
+        .padding_bytes = node.padding_bytes,
+        .size_bytes = node.size_bytes,
+      }}));
+      continue;
+    }
+
+    SerializedSubtree node;
+    READ(node);
+    if (
+      !ts_subtree__valid_symbol(node.symbol, language) ||
+      !ts_subtree__valid_parse_state(node.parse_state, language) ||
+      node.child_count > stack.size
+    ) goto error;
+
+    SubtreeHeapData heap_data = {
+      .ref_count = 1,
+      .padding = node.padding,
+      .size = node.size,
+      .lookahead_bytes = node.lookahead_bytes,
+      .error_cost = node.error_cost,
+      .child_count = node.child_count,
+      .symbol = node.symbol,
+      .parse_state = node.parse_state,
+      .visible = flags & SerializedSubtreeVisible,
+      .named = flags & SerializedSubtreeNamed,
+      .extra = flags & SerializedSubtreeExtra,
+      .fragile_left = flags & SerializedSubtreeFragileLeft,
+      .fragile_right = flags & SerializedSubtreeFragileRight,
+      .has_changes = flags & SerializedSubtreeHasChanges,
+      .has_external_tokens = flags & SerializedSubtreeHasExternalTokens,
+      .depends_on_column = flags & SerializedSubtreeDependsOnColumn,
+      .is_missing = flags & SerializedSubtreeIsMissing,
+      .is_keyword = flags & SerializedSubtreeIsKeyword,
+      .is_arena = pool->arena != NULL,
+    };
+
+    SubtreeHeapData *result;
+    if (node.child_count > 0) {
+      SerializedSubtreeSummary summary;
+      READ(summary);
+      if (
+        node.production_id >= language->production_id_count ||
+        !ts_subtree__valid_symbol(summary.first_leaf_symbol, language) ||
+        !ts_subtree__valid_parse_state(summary.first_leaf_parse_state, language)
+      ) goto error;
+      heap_data.visible_child_count = summary.visible_child_count;
+      heap_data.named_child_count = summary.named_child_count;
+      heap_data.visible_descendant_count = summary.visible_descendant_count;
+      heap_data.node_count = summary.node_count;
+      heap_data.repeat_depth = summary.repeat_depth;
+      heap_data.dynamic_precedence = summary.dynamic_precedence;
+      heap_data.production_id = node.production_id;
+      heap_data.first_leaf.symbol = summary.first_leaf_symbol;
+      heap_data.first_leaf.parse_state = summary.first_leaf_parse_state;
+
+      size_t size = ts_subtree_alloc_size(node.child_count);
+      Subtree *children;
+      if (pool->arena) {
+        children = ts_subtree_arena_allocate(pool->arena, size);
+      } else {
+        children = ts_malloc(size);
+        ts_track_allocate(TSAllocationCategorySubtree, children, size);
+      }
+      stack.size -= node.child_count;
+      memcpy(children, &stack.contents[stack.size], node.child_count * sizeof(Subtree));
+      result = (SubtreeHeapData *)&children[node.child_count];
+    } else if (flags & SerializedSubtreeHasExternalTokens) {
+      uint32_t state_length;
+      READ(state_length);
+      uint32_t padded_length = state_length + ts_subtree__serialized_padding(state_length);
+      if (state_length > length - offset || padded_length > length - offset) goto error;
+      ts_external_scanner_state_init(&heap_data.external_scanner_state, data + offset, state_length);
+      offset += padded_length;
+      result = ts_subtree_pool_allocate(pool);
+    } else {
+      if (node.symbol == ts_builtin_sym_error) {
+        READ(heap_data.lookahead_char);
+      }
+      result = ts_subtree_pool_allocate(pool);
+    }
+
+    *result = heap_data;
+    array_push(&stack, ((Subtree) {.ptr = result}));
+
+    // The parser adjusts some of a parent's fields after summarizing its
+    // children, so the summary is stored. The fields that only depend on the
+    // children must still agree with them.
+    if (node.child_count > 0) {
+      if (!ts_subtree__valid_alias_sequence_length(result, language)) goto error;
+      ts_subtree_summarize_children((MutableSubtree) {.ptr = result}, language);
+      SubtreeHeapData computed = *result;
+      *result = heap_data;
+      if (
+        computed.visible_child_count != heap_data.visible_child_count ||
+        computed.named_child_count != heap_data.named_child_count ||
+        computed.visible_descendant_count != heap_data.visible_descendant_count ||
+        computed.node_count != heap_data.node_count ||
+        computed.repeat_depth != heap_data.repeat_depth ||
+        computed.first_leaf.symbol != heap_data.first_leaf.symbol ||
+        computed.first_leaf.parse_state != heap_data.first_leaf.parse_state ||
+        !length_eq(computed.padding, heap_data.padding) ||
+        !length_eq(computed.size, heap_data.size)
+      ) goto error;
+    }
+  }
+
+  #undef READ
+
+  if (stack.size != 1 || offset != length) goto error;
+  Subtree result = stack.contents[0];
+  array_delete(&stack);
+  return result;
+
+error:
+  for (uint32_t i = 0; i < stack.size; i++) {
+    ts_subtree_release(pool, stack.contents[i]);
+  }
+  array_delete(&stack);
+  return NULL_SUBTREE;
+}
@@ -27,13 +27,17 @@ extern "C" {
 // restored using its `deserialize` function.
 //
 // Small byte arrays are stored inline, and long ones are allocated
-// separately on the heap.
+// separately on the heap. Long byte arrays are reference counted, so that
+// the many tokens that often share the same state can also share its memory.
+// The hash of the bytes lets unequal states be told apart without comparing
+// them.
 typedef struct {
   union {
     char *long_data;
     char short_data[24];
   };
   uint32_t length;
+  uint32_t hash;
 } ExternalScannerState;
 
 // A compact representation of a subtree.
@@ -128,12 +132,14 @@ typedef struct {
   bool depends_on_column: 1;
   bool is_missing : 1;
   bool is_keyword : 1;
+  bool is_arena : 1;
 
   union {
     // Non-terminal subtrees (`child_count > 0`)
     struct {
       uint32_t visible_child_count;
       uint32_t named_child_count;
+      uint32_t visible_descendant_count;
       uint32_t node_count;
       uint32_t repeat_depth;
       int32_t dynamic_precedence;
@@ -166,14 +172,56 @@ typedef union {
 
 typedef Array(Subtree) SubtreeArray;
 typedef Array(MutableSubtree) MutableSubtreeArray;
+typedef Array(char) SubtreeByteArray;
+
+// A region of memory from which subtrees are carved during a single parse.
+//
+// Subtrees that are allocated from an arena are never freed individually.
+// Instead, the arena's slabs are all freed at once, when the last tree that
+// may refer to them is deleted.
+typedef struct SubtreeArenaSlab SubtreeArenaSlab;
+
+typedef struct {
+  volatile uint32_t ref_count;
+  SubtreeArenaSlab *slabs;
+  bool is_frozen;
+} SubtreeArena;
+
+// The reference count of a frozen subtree. Frozen subtrees live in an arena
+// for their whole lifetime, so their reference counts are never modified.
+// This lets many threads share them without contending over their memory.
+#define TS_FROZEN_REF_COUNT UINT32_MAX
+
+typedef Array(SubtreeArena *) SubtreeArenaArray;
 
 typedef struct {
   MutableSubtreeArray free_trees;
   MutableSubtreeArray tree_stack;
+  SubtreeArena *arena;
+  uint64_t allocation_count;
+  uint64_t allocated_bytes;
 } SubtreePool;
 
+// A bounded cache of subtrees from earlier parses, keyed by their contents,
+// which lets identical subtrees be shared between trees.
+typedef struct {
+  Subtree subtree;
+  uint32_t hash;
+  uint32_t generation;
+} SubtreeSharingEntry;
+
+typedef struct {
+  SubtreeSharingEntry *entries;
+  uint32_t capacity;
+  uint32_t generation;
+} SubtreeSharingTable;
+
 void ts_external_scanner_state_init(ExternalScannerState *, const char *, unsigned);
+ExternalScannerState ts_external_scanner_state_copy(const ExternalScannerState *);
+void ts_external_scanner_state_delete(ExternalScannerState *);
 const char *ts_external_scanner_state_data(const ExternalScannerState *);
+uint32_t ts_external_scanner_state_hash(const char *, unsigned);
+bool ts_external_scanner_state_eq(const ExternalScannerState *, const ExternalScannerState *);
 
 void ts_subtree_array_copy(SubtreeArray, SubtreeArray *);
 void ts_subtree_array_clear(SubtreePool *, SubtreeArray *);
@@ -184,6 +232,12 @@ void ts_subtree_array_reverse(SubtreeArray *);
 SubtreePool ts_subtree_pool_new(uint32_t capacity);
 void ts_subtree_pool_delete(SubtreePool *);
 
+SubtreeArena *ts_subtree_arena_new(void);
+void ts_subtree_arena_retain(SubtreeArena *);
+void ts_subtree_arena_release(SubtreeArena *);
+void ts_subtree_arena_array_copy(const SubtreeArenaArray *, SubtreeArenaArray *);
+void ts_subtree_arena_array_clear(SubtreeArenaArray *);
+
 Subtree ts_subtree_new_leaf(
   SubtreePool *, TSSymbol, Length, Length, uint32_t,
   TSStateId, bool, bool, bool, const TSLanguage *
@@ -191,9 +245,10 @@ Subtree ts_subtree_new_leaf(
 Subtree ts_subtree_new_error(
   SubtreePool *, int32_t, Length, Length, uint32_t, TSStateId, const TSLanguage *
 );
-MutableSubtree ts_subtree_new_node(TSSymbol, SubtreeArray *, unsigned, const TSLanguage *);
-Subtree ts_subtree_new_error_node(SubtreeArray *, bool, const TSLanguage *);
+MutableSubtree ts_subtree_new_node(SubtreePool *, TSSymbol, SubtreeArray *, unsigned, const TSLanguage *);
+Subtree ts_subtree_new_error_node(SubtreePool *, SubtreeArray *, bool, const TSLanguage *);
 Subtree ts_subtree_new_missing_leaf(SubtreePool *, TSSymbol, Length, const TSLanguage *);
+Subtree ts_subtree_new_placeholder(SubtreePool *, Subtree);
 MutableSubtree ts_subtree_make_mut(SubtreePool *, Subtree);
 void ts_subtree_retain(Subtree);
 void ts_subtree_release(SubtreePool *, Subtree);
@@ -204,10 +259,19 @@ void ts_subtree_summarize(MutableSubtree, const Subtree *, uint32_t, const TSLan
 void ts_subtree_summarize_children(MutableSubtree, const TSLanguage *);
 void ts_subtree_balance(Subtree, SubtreePool *, const TSLanguage *);
 Subtree ts_subtree_edit(Subtree, const TSInputEdit *edit, SubtreePool *);
+Subtree ts_subtree_edit_batch(Subtree, const TSInputEdit *edits, uint32_t, SubtreePool *);
+Subtree ts_subtree_freeze(Subtree, SubtreeArena *);
+Subtree ts_subtree_compact(Subtree, SubtreeArena *);
+void ts_subtree_sharing_table_set_capacity(SubtreeSharingTable *, uint32_t, SubtreePool *);
+void ts_subtree_sharing_table_clear(SubtreeSharingTable *, SubtreePool *);
+Subtree ts_subtree_share(Subtree, SubtreeSharingTable *, SubtreePool *, uint64_t *);
+void ts_subtree_memory_usage(Subtree, TSTreeMemoryUsage *);
 char *ts_subtree_string(Subtree, const TSLanguage *, bool include_all);
 void ts_subtree_print_dot_graph(Subtree, const TSLanguage *, FILE *);
 Subtree ts_subtree_last_external_token(Subtree);
 bool ts_subtree_external_scanner_state_eq(Subtree, Subtree);
+uint32_t ts_subtree_serialize(Subtree, SubtreeByteArray *);
+Subtree ts_subtree_deserialize(SubtreePool *, const char *, uint32_t, uint32_t, const TSLanguage *);
 
 #define SUBTREE_GET(self, name) (self.data.is_inline ? self.data.name : self.ptr->name)
 
@@ -300,6 +364,14 @@ static inline uint32_t ts_subtree_visible_child_count(Subtree self) {
   }
 }
 
+static inline uint32_t ts_subtree_visible_descendant_count(Subtree self) {
+  if (ts_subtree_child_count(self) > 0) {
+    return self.ptr->visible_descendant_count;
+  } else {
+    return 0;
+  }
+}
+
 static inline uint32_t ts_subtree_error_cost(Subtree self) {
   if (ts_subtree_missing(self)) {
     return ERROR_COST_PER_MISSING_TREE + ERROR_COST_PER_RECOVERY;
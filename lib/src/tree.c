@@ -1,6 +1,7 @@
 #include "tree_sitter/api.h"
 #include "./array.h"
 #include "./get_changed_ranges.h"
+#include "./language.h"
 #include "./subtree.h"
 #include "./tree_cursor.h"
 #include "./tree.h"
@@ -15,12 +16,106 @@ TSTree *ts_tree_new(
   result->included_ranges = ts_calloc(included_range_count, sizeof(TSRange));
   memcpy(result->included_ranges, included_ranges, included_range_count * sizeof(TSRange));
   result->included_range_count = included_range_count;
+  array_init(&result->arenas);
+  result->symbol_masks = (SymbolMaskCache) {NULL, 0, 0};
+  result->child_indices = (ChildIndexCache) {NULL, 0, 0};
+  result->parents = (ParentCache) {NULL, 0, 0};
+  result->cache_lock = 0;
+  result->is_balanced = true;
   return result;
 }
 
+static void symbol_mask_cache_clear(SymbolMaskCache *self) {
+  ts_free(self->entries);
+  *self = (SymbolMaskCache) {NULL, 0, 0};
+}
+
+static void parent_cache_clear(ParentCache *self) {
+  ts_free(self->entries);
+  *self = (ParentCache) {NULL, 0, 0};
+}
+
+static void child_index_cache_clear(ChildIndexCache *self) {
+  for (uint32_t i = 0; i < self->capacity; i++) {
+    if (self->entries[i].subtree) ts_free(self->entries[i].children);
+  }
+  ts_free(self->entries);
+  *self = (ChildIndexCache) {NULL, 0, 0};
+}
+
 TSTree *ts_tree_copy(const TSTree *self) {
   ts_subtree_retain(self->root);
-  return ts_tree_new(self->root, self->language, self->included_ranges, self->included_range_count);
+  TSTree *result = ts_tree_new(self->root, self->language, self->included_ranges, self->included_range_count);
+  ts_subtree_arena_array_copy(&self->arenas, &result->arenas);
+  result->is_balanced = self->is_balanced;
+  if (ts_tree_try_lock_caches(self)) {
+    if (self->symbol_masks.capacity > 0) {
+      size_t size = self->symbol_masks.capacity * sizeof(SymbolMaskEntry);
+      result->symbol_masks = self->symbol_masks;
+      result->symbol_masks.entries = ts_malloc(size);
+      memcpy(result->symbol_masks.entries, self->symbol_masks.entries, size);
+    }
+    ts_tree_unlock_caches(self);
+  }
+
+  // Child indices and parents are not copied, because that would make
+  // copying a tree proportional to the number of nodes that have been
+  // visited. They are rebuilt on demand.
+  return result;
+}
+
+TSTree *ts_tree_freeze(const TSTree *self) {
+  SubtreeArena *arena = ts_subtree_arena_new();
+  arena->is_frozen = true;
+  Subtree root = ts_subtree_freeze(self->root, arena);
+  TSTree *result = ts_tree_new(root, self->language, self->included_ranges, self->included_range_count);
+  result->is_balanced = self->is_balanced;
+
+  // Keep alive any frozen subtrees that this tree shares with earlier snapshots.
+  for (uint32_t i = 0; i < self->arenas.size; i++) {
+    SubtreeArena *other_arena = self->arenas.contents[i];
+    if (other_arena->is_frozen) {
+      ts_subtree_arena_retain(other_arena);
+      array_push(&result->arenas, other_arena);
+    }
+  }
+  if (arena->slabs) {
+    array_push(&result->arenas, arena);
+  } else {
+    ts_subtree_arena_release(arena);
+  }
+  return result;
+}
+
+TSTree *ts_tree_compact(const TSTree *self) {
+  SubtreeArena *arena = ts_subtree_arena_new();
+  arena->is_frozen = true;
+  Subtree root = ts_subtree_compact(self->root, arena);
+  TSTree *result = ts_tree_new(root, self->language, self->included_ranges, self->included_range_count);
+  result->is_balanced = self->is_balanced;
+  if (arena->slabs) {
+    array_push(&result->arenas, arena);
+  } else {
+    ts_subtree_arena_release(arena);
+  }
+  return result;
+}
+
+bool ts_tree_balance(TSTree *self) {
+  if (self->is_balanced) return true;
+
+  // Balancing rearranges the tree's nodes in place, so it is only possible
+  // when no other tree shares them.
+  if (!self->root.data.is_inline && self->root.ptr->ref_count != 1) return false;
+
+  SubtreePool pool = ts_subtree_pool_new(0);
+  ts_subtree_balance(self->root, &pool, self->language);
+  ts_subtree_pool_delete(&pool);
+  symbol_mask_cache_clear(&self->symbol_masks);
+  child_index_cache_clear(&self->child_indices);
+  parent_cache_clear(&self->parents);
+  self->is_balanced = true;
+  return true;
 }
 
 void ts_tree_delete(TSTree *self) {
@@ -29,6 +124,11 @@ void ts_tree_delete(TSTree *self) {
   SubtreePool pool = ts_subtree_pool_new(0);
   ts_subtree_release(&pool, self->root);
   ts_subtree_pool_delete(&pool);
+  ts_subtree_arena_array_clear(&self->arenas);
+  array_delete(&self->arenas);
+  symbol_mask_cache_clear(&self->symbol_masks);
+  child_index_cache_clear(&self->child_indices);
+  parent_cache_clear(&self->parents);
   ts_free(self->included_ranges);
   ts_free(self);
 }
@@ -41,7 +141,34 @@ const TSLanguage *ts_tree_language(const TSTree *self) {
   return self->language;
 }
 
-void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
+void ts_tree_memory_usage(const TSTree *self, TSTreeMemoryUsage *usage) {
+  *usage = (TSTreeMemoryUsage) {0};
+  ts_subtree_memory_usage(self->root, usage);
+
+  if (ts_tree_try_lock_caches(self)) {
+    usage->cache_bytes += self->symbol_masks.capacity * sizeof(SymbolMaskEntry);
+    usage->cache_bytes += self->parents.capacity * sizeof(ParentCacheEntry);
+    usage->cache_bytes += self->child_indices.capacity * sizeof(ChildIndex);
+    for (uint32_t i = 0; i < self->child_indices.capacity; i++) {
+      const ChildIndex *entry = &self->child_indices.entries[i];
+      if (entry->subtree) {
+        usage->cache_bytes += (entry->subtree->child_count + 1) * sizeof(ChildIndexEntry);
+      }
+    }
+    ts_tree_unlock_caches(self);
+  }
+
+  usage->total_bytes =
+    sizeof(TSTree) +
+    self->included_range_count * sizeof(TSRange) +
+    self->arenas.capacity * sizeof(SubtreeArena *) +
+    usage->cache_bytes +
+    usage->unique_subtree_bytes +
+    usage->shared_subtree_bytes +
+    usage->external_scanner_state_bytes;
+}
+
+static void ts_tree__edit_included_ranges(TSTree *self, const TSInputEdit *edit) {
   for (unsigned i = 0; i < self->included_range_count; i++) {
     TSRange *range = &self->included_ranges[i];
     if (range->end_byte >= edit->old_end_byte) {
@@ -69,10 +196,50 @@ void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
       }
     }
   }
+}
+
+// Order edits from the end of the document to the start, so that applying
+// each one leaves the positions of the remaining ones unchanged.
+static int ts_tree__compare_edits(const void *a, const void *b) {
+  const TSInputEdit *left = a, *right = b;
+  if (left->start_byte != right->start_byte) {
+    return left->start_byte > right->start_byte ? -1 : 1;
+  }
+  if (left->old_end_byte != right->old_end_byte) {
+    return left->old_end_byte > right->old_end_byte ? -1 : 1;
+  }
+  return 0;
+}
+
+void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
+  ts_tree_edit_batch(self, edit, 1);
+}
+
+void ts_tree_edit_batch(TSTree *self, const TSInputEdit *edits, uint32_t edit_count) {
+  if (edit_count == 0) return;
+
+  TSInputEdit *sorted_edits = NULL;
+  if (edit_count > 1) {
+    sorted_edits = ts_malloc(edit_count * sizeof(TSInputEdit));
+    memcpy(sorted_edits, edits, edit_count * sizeof(TSInputEdit));
+    qsort(sorted_edits, edit_count, sizeof(TSInputEdit), ts_tree__compare_edits);
+    edits = sorted_edits;
+  }
+
+  for (uint32_t i = 0; i < edit_count; i++) {
+    ts_tree__edit_included_ranges(self, &edits[i]);
+  }
 
   SubtreePool pool = ts_subtree_pool_new(0);
-  self->root = ts_subtree_edit(self->root, edit, &pool);
+  self->root = ts_subtree_edit_batch(self->root, edits, edit_count, &pool);
   ts_subtree_pool_delete(&pool);
+  if (sorted_edits) ts_free(sorted_edits);
+
+  // Editing can release subtrees, whose addresses could later be reused, and
+  // can change the positions of subtrees in place.
+  symbol_mask_cache_clear(&self->symbol_masks);
+  child_index_cache_clear(&self->child_indices);
+  parent_cache_clear(&self->parents);
 }
 
 TSRange *ts_tree_get_changed_ranges(const TSTree *self, const TSTree *other, uint32_t *count) {
@@ -95,11 +262,304 @@ TSRange *ts_tree_get_changed_ranges(const TSTree *self, const TSTree *other, uin
   );
 
   array_delete(&included_range_differences);
-  array_delete(&cursor1.stack);
-  array_delete(&cursor2.stack);
+  array_delete_tracked(&cursor1.stack, TSAllocationCategoryCursorStack);
+  array_delete_tracked(&cursor2.stack, TSAllocationCategoryCursorStack);
   return result;
 }
 
 void ts_tree_print_dot_graph(const TSTree *self, FILE *file) {
   ts_subtree_print_dot_graph(self->root, self->language, file);
 }
+
+// Serialized trees begin with this header, followed by the tree's included
+// ranges, followed by its serialized subtrees.
+typedef struct {
+  char magic[4];
+  uint32_t format_version;
+  uint32_t language_version;
+  uint32_t symbol_count;
+  uint32_t state_count;
+  uint32_t production_id_count;
+  uint32_t included_range_count;
+  uint32_t node_count;
+} SerializedTreeHeader;
+
+static const char SERIALIZED_TREE_MAGIC[4] = {'T', 'S', 'T', 'R'};
+static const uint32_t SERIALIZED_TREE_FORMAT_VERSION = 2;
+
+char *ts_tree_serialize(const TSTree *self, uint32_t *length) {
+  SubtreeByteArray buffer = array_new();
+  SerializedTreeHeader header = {
+    .format_version = SERIALIZED_TREE_FORMAT_VERSION,
+    .language_version = self->language->version,
+    .symbol_count = self->language->symbol_count,
+    .state_count = self->language->state_count,
+    .production_id_count = self->language->production_id_count,
+    .included_range_count = self->included_range_count,
+  };
+  memcpy(header.magic, SERIALIZED_TREE_MAGIC, sizeof(header.magic));
+  array_grow_by(&buffer, sizeof(header));
+  array_extend(&buffer, self->included_range_count * sizeof(TSRange), (const char *)self->included_ranges);
+  header.node_count = ts_subtree_serialize(self->root, &buffer);
+  memcpy(buffer.contents, &header, sizeof(header));
+  *length = buffer.size;
+  return buffer.contents;
+}
+
+TSTree *ts_tree_deserialize(const char *data, uint32_t length, const TSLanguage *language) {
+  SerializedTreeHeader header;
+  if (length < sizeof(header)) return NULL;
+  memcpy(&header, data, sizeof(header));
+  if (
+    memcmp(header.magic, SERIALIZED_TREE_MAGIC, sizeof(header.magic)) ||
+    header.format_version != SERIALIZED_TREE_FORMAT_VERSION ||
+    header.language_version != language->version ||
+    header.symbol_count != language->symbol_count ||
+    header.state_count != language->state_count ||
+    header.production_id_count != language->production_id_count ||
+    header.included_range_count == 0 ||
+    header.included_range_count > (length - sizeof(header)) / sizeof(TSRange)
+  ) return NULL;
+
+  uint32_t offset = sizeof(header);
+  uint32_t ranges_length = header.included_range_count * sizeof(TSRange);
+  TSRange *included_ranges = ts_malloc(ranges_length);
+  memcpy(included_ranges, data + offset, ranges_length);
+  offset += ranges_length;
+
+  // Allocate all of the subtrees from a single arena, so that loading a
+  // large tree doesn't require a separate allocation for every node.
+  SubtreePool pool = ts_subtree_pool_new(0);
+  pool.arena = ts_subtree_arena_new();
+  Subtree root = ts_subtree_deserialize(
+    &pool,
+    data + offset,
+    length - offset,
+    header.node_count,
+    language
+  );
+  ts_subtree_pool_delete(&pool);
+
+  TSTree *result = NULL;
+  if (root.ptr) {
+    result = ts_tree_new(root, language, included_ranges, header.included_range_count);
+    array_push(&result->arenas, pool.arena);
+  } else {
+    ts_subtree_arena_release(pool.arena);
+  }
+  ts_free(included_ranges);
+  return result;
+}
+
+static inline uint32_t subtree_cache_hash(const void *subtree) {
+  uint64_t hash = (uint64_t)(uintptr_t)subtree * 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(hash >> 32);
+}
+
+static SymbolMaskEntry *symbol_mask_cache_find(
+  const SymbolMaskCache *self,
+  const SubtreeHeapData *subtree
+) {
+  if (self->capacity == 0) return NULL;
+  uint32_t index_mask = self->capacity - 1;
+  for (uint32_t i = subtree_cache_hash(subtree) & index_mask;; i = (i + 1) & index_mask) {
+    SymbolMaskEntry *entry = &self->entries[i];
+    if (!entry->subtree || entry->subtree == subtree) return entry;
+  }
+}
+
+static void symbol_mask_cache_insert(
+  SymbolMaskCache *self,
+  const SubtreeHeapData *subtree,
+  uint64_t mask
+) {
+  if (2 * (self->size + 1) > self->capacity) {
+    SymbolMaskCache old = *self;
+    self->capacity = old.capacity ? 2 * old.capacity : 64;
+    self->entries = ts_calloc(self->capacity, sizeof(SymbolMaskEntry));
+    for (uint32_t i = 0; i < old.capacity; i++) {
+      if (old.entries[i].subtree) {
+        *symbol_mask_cache_find(self, old.entries[i].subtree) = old.entries[i];
+      }
+    }
+    ts_free(old.entries);
+  }
+
+  SymbolMaskEntry *entry = symbol_mask_cache_find(self, subtree);
+  if (!entry->subtree) self->size++;
+  *entry = (SymbolMaskEntry) {subtree, mask};
+}
+
+// Subtrees with fewer nodes than this are cheap enough to walk that they are
+// not worth tracking, so they are reported as containing every symbol.
+static const uint32_t SYMBOL_MASK_MIN_NODE_COUNT = 64;
+
+typedef struct {
+  Subtree tree;
+  uint32_t child_index;
+  uint32_t structural_child_index;
+  uint64_t mask;
+} SymbolMaskFrame;
+
+// Compute the mask of the symbols that occur among the given subtree's
+// descendants, using the same aliased, public symbols that `ts_node_symbol`
+// would return. The masks of all of the large internal nodes within the
+// subtree are cached along the way.
+static uint64_t ts_tree__descendant_symbol_mask(TSTree *self, Subtree subtree) {
+  if (ts_subtree_child_count(subtree) == 0) return 0;
+  if (subtree.ptr->node_count < SYMBOL_MASK_MIN_NODE_COUNT) return UINT64_MAX;
+  SymbolMaskEntry *entry = symbol_mask_cache_find(&self->symbol_masks, subtree.ptr);
+  if (entry && entry->subtree) return entry->mask;
+
+  uint64_t result = 0;
+  Array(SymbolMaskFrame) stack = array_new();
+  array_push(&stack, ((SymbolMaskFrame) {subtree, 0, 0, 0}));
+  while (stack.size > 0) {
+    SymbolMaskFrame *frame = array_back(&stack);
+    if (frame->child_index == frame->tree.ptr->child_count) {
+      result = frame->mask;
+      if (frame->tree.ptr->node_count >= SYMBOL_MASK_MIN_NODE_COUNT) {
+        symbol_mask_cache_insert(&self->symbol_masks, frame->tree.ptr, result);
+      }
+      stack.size--;
+      if (stack.size > 0) array_back(&stack)->mask |= result;
+      continue;
+    }
+
+    Subtree child = ts_subtree_children(frame->tree)[frame->child_index++];
+    TSSymbol alias_symbol = 0;
+    if (!ts_subtree_extra(child)) {
+      alias_symbol = ts_language_alias_at(
+        self->language,
+        frame->tree.ptr->production_id,
+        frame->structural_child_index++
+      );
+    }
+
+    // Hidden nodes can't be matched by queries, and their symbols may not
+    // have public equivalents.
+    if (alias_symbol) {
+      frame->mask |= ts_symbol_mask_bit(ts_language_public_symbol(self->language, alias_symbol));
+    } else if (ts_subtree_visible(child)) {
+      TSSymbol symbol = ts_language_public_symbol(self->language, ts_subtree_symbol(child));
+      frame->mask |= ts_symbol_mask_bit(symbol);
+    }
+
+    if (ts_subtree_child_count(child) > 0) {
+      SymbolMaskEntry *child_entry = child.ptr->node_count >= SYMBOL_MASK_MIN_NODE_COUNT
+        ? symbol_mask_cache_find(&self->symbol_masks, child.ptr)
+        : NULL;
+      if (child_entry && child_entry->subtree) {
+        frame->mask |= child_entry->mask;
+      } else {
+        array_push(&stack, ((SymbolMaskFrame) {child, 0, 0, 0}));
+      }
+    }
+  }
+  array_delete(&stack);
+  return result;
+}
+
+uint64_t ts_node_descendant_symbol_mask(TSNode node) {
+  // The cache does not affect the tree's contents, so it can be populated
+  // through a const tree.
+  if (!ts_tree_try_lock_caches(node.tree)) return UINT64_MAX;
+  uint64_t result = ts_tree__descendant_symbol_mask((TSTree *)node.tree, *(const Subtree *)node.id);
+  ts_tree_unlock_caches(node.tree);
+  return result;
+}
+
+static ChildIndex *child_index_cache_find(
+  const ChildIndexCache *self,
+  const SubtreeHeapData *subtree
+) {
+  if (self->capacity == 0) return NULL;
+  uint32_t index_mask = self->capacity - 1;
+  for (uint32_t i = subtree_cache_hash(subtree) & index_mask;; i = (i + 1) & index_mask) {
+    ChildIndex *entry = &self->entries[i];
+    if (!entry->subtree || entry->subtree == subtree) return entry;
+  }
+}
+
+const ChildIndexEntry *ts_tree_child_index(const TSTree *self, const SubtreeHeapData *subtree) {
+  ChildIndex *entry = child_index_cache_find(&self->child_indices, subtree);
+  return entry && entry->subtree ? entry->children : NULL;
+}
+
+void ts_tree_set_child_index(
+  const TSTree *tree,
+  const SubtreeHeapData *subtree,
+  ChildIndexEntry *children
+) {
+  // The cache does not affect the tree's contents, so it can be populated
+  // through a const tree.
+  ChildIndexCache *self = &((TSTree *)tree)->child_indices;
+  if (2 * (self->size + 1) > self->capacity) {
+    ChildIndexCache old = *self;
+    self->capacity = old.capacity ? 2 * old.capacity : 16;
+    self->entries = ts_calloc(self->capacity, sizeof(ChildIndex));
+    for (uint32_t i = 0; i < old.capacity; i++) {
+      if (old.entries[i].subtree) {
+        *child_index_cache_find(self, old.entries[i].subtree) = old.entries[i];
+      }
+    }
+    ts_free(old.entries);
+  }
+
+  ChildIndex *entry = child_index_cache_find(self, subtree);
+  if (entry->subtree) {
+    ts_free(entry->children);
+  } else {
+    self->size++;
+  }
+  *entry = (ChildIndex) {subtree, children};
+}
+
+static ParentCacheEntry *parent_cache_find(const ParentCache *self, const Subtree *child) {
+  if (self->capacity == 0) return NULL;
+  uint32_t index_mask = self->capacity - 1;
+  for (uint32_t i = subtree_cache_hash(child) & index_mask;; i = (i + 1) & index_mask) {
+    ParentCacheEntry *entry = &self->entries[i];
+    if (!entry->child || entry->child == child) return entry;
+  }
+}
+
+bool ts_tree_cached_parent(const TSTree *self, const Subtree *child, TSNode *parent) {
+  if (!ts_tree_try_lock_caches(self)) return false;
+  ParentCacheEntry *entry = parent_cache_find(&self->parents, child);
+  bool result = entry && entry->child;
+  if (result) {
+    *parent = ts_node_new(self, entry->parent, entry->position, entry->alias_symbol);
+  }
+  ts_tree_unlock_caches(self);
+  return result;
+}
+
+void ts_tree_cache_parent(const TSTree *tree, const Subtree *child, TSNode parent) {
+  if (!ts_tree_try_lock_caches(tree)) return;
+  ParentCache *self = &((TSTree *)tree)->parents;
+  if (2 * (self->size + 1) > self->capacity) {
+    ParentCache old = *self;
+    self->capacity = old.capacity ? 2 * old.capacity : 64;
+    self->entries = ts_calloc(self->capacity, sizeof(ParentCacheEntry));
+    for (uint32_t i = 0; i < old.capacity; i++) {
+      if (old.entries[i].child) {
+        *parent_cache_find(self, old.entries[i].child) = old.entries[i];
+      }
+    }
+    ts_free(old.entries);
+  }
+
+  ParentCacheEntry *entry = parent_cache_find(self, child);
+  if (!entry->child) self->size++;
+  *entry = (ParentCacheEntry) {
+    .child = child,
+    .parent = parent.id,
+    .position = {
+      ts_node_start_byte(parent),
+      ts_node_start_point(parent),
+    },
+    .alias_symbol = parent.context[3],
+  };
+  ts_tree_unlock_caches(tree);
+}
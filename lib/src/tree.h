@@ -5,6 +5,12 @@
 extern "C" {
 #endif
 
+#include "./atomic.h"
+
+// A lazily-built map from the nodes of a tree to their parent nodes. Each
+// node is identified by the address of its subtree within its parent's
+// children, and its parent is stored in the same form, along with the
+// parent's position and alias.
 typedef struct {
   const Subtree *child;
   const Subtree *parent;
@@ -12,15 +18,98 @@ typedef struct {
   TSSymbol alias_symbol;
 } ParentCacheEntry;
 
+typedef struct {
+  ParentCacheEntry *entries;
+  uint32_t size;
+  uint32_t capacity;
+} ParentCache;
+
+// A lazily-built map from a tree's large internal nodes to bit masks of the
+// symbols that occur among their descendants. Each symbol is represented by
+// the bit returned from `ts_symbol_mask_bit`, so different symbols can share
+// a bit, and the masks can only be used to rule out the presence of a symbol.
+typedef struct {
+  const SubtreeHeapData *subtree;
+  uint64_t mask;
+} SymbolMaskEntry;
+
+typedef struct {
+  SymbolMaskEntry *entries;
+  uint32_t size;
+  uint32_t capacity;
+} SymbolMaskCache;
+
+// Nodes with fewer children than this are cheap enough to iterate that their
+// children are not indexed.
+#define TS_MIN_INDEXED_CHILD_COUNT 32
+
+// An entry in a wide node's child index, describing one of its children: the
+// iterator position before the child, relative to the node's start, the
+// child's structural index, and the number of visible and named descendants
+// that precede the child. A final entry holds the node's size and totals.
+typedef struct {
+  Length position;
+  uint32_t structural_child_index;
+  uint32_t visible_child_count;
+  uint32_t named_child_count;
+} ChildIndexEntry;
+
+// A lazily-built map from a tree's wide internal nodes to their child indices.
+typedef struct {
+  const SubtreeHeapData *subtree;
+  ChildIndexEntry *children;
+} ChildIndex;
+
+typedef struct {
+  ChildIndex *entries;
+  uint32_t size;
+  uint32_t capacity;
+} ChildIndexCache;
+
 struct TSTree {
   Subtree root;
   const TSLanguage *language;
   TSRange *included_ranges;
   unsigned included_range_count;
+  SubtreeArenaArray arenas;
+  SymbolMaskCache symbol_masks;
+  ChildIndexCache child_indices;
+  ParentCache parents;
+  volatile uint32_t cache_lock;
+  bool is_balanced;
 };
 
 TSTree *ts_tree_new(Subtree root, const TSLanguage *language, const TSRange *, unsigned);
 TSNode ts_node_new(const TSTree *, const Subtree *, Length, TSSymbol);
+uint64_t ts_node_descendant_symbol_mask(TSNode);
+
+// These must be called while holding the lock on the tree's caches.
+const ChildIndexEntry *ts_tree_child_index(const TSTree *, const SubtreeHeapData *);
+void ts_tree_set_child_index(const TSTree *, const SubtreeHeapData *, ChildIndexEntry *);
+
+// These acquire the lock on the tree's caches themselves, and do nothing if
+// it is unavailable.
+bool ts_tree_cached_parent(const TSTree *, const Subtree *, TSNode *);
+void ts_tree_cache_parent(const TSTree *, const Subtree *, TSNode);
+
+// A tree's caches are populated through const pointers, possibly while the
+// tree is being read on several threads, so access to them is guarded by a
+// lock. The lock is never waited for: a thread that fails to acquire it
+// simply proceeds without using the caches.
+static inline bool ts_tree_try_lock_caches(const TSTree *self) {
+  volatile uint32_t *lock = &((TSTree *)self)->cache_lock;
+  if (atomic_inc(lock) == 1) return true;
+  atomic_dec(lock);
+  return false;
+}
+
+static inline void ts_tree_unlock_caches(const TSTree *self) {
+  atomic_dec(&((TSTree *)self)->cache_lock);
+}
+
+static inline uint64_t ts_symbol_mask_bit(TSSymbol symbol) {
+  return (uint64_t)1 << (symbol % 64);
+}
 
 #ifdef __cplusplus
 }
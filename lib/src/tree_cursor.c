@@ -10,26 +10,50 @@ typedef struct {
   Length position;
   uint32_t child_index;
   uint32_t structural_child_index;
+  uint32_t descendant_index;
   const TSSymbol *alias_sequence;
 } CursorChildIterator;
 
 // CursorChildIterator
 
+static inline bool ts_tree_cursor_is_entry_visible(const TreeCursor *self, uint32_t index) {
+  TreeCursorEntry *entry = &self->stack.contents[index];
+  if (index == 0 || ts_subtree_visible(*entry->subtree)) {
+    return true;
+  } else if (!ts_subtree_extra(*entry->subtree)) {
+    TreeCursorEntry *parent_entry = &self->stack.contents[index - 1];
+    return ts_language_alias_at(
+      self->tree->language,
+      parent_entry->subtree->ptr->production_id,
+      entry->structural_child_index
+    );
+  } else {
+    return false;
+  }
+}
+
 static inline CursorChildIterator ts_tree_cursor_iterate_children(const TreeCursor *self) {
   TreeCursorEntry *last_entry = array_back(&self->stack);
   if (ts_subtree_child_count(*last_entry->subtree) == 0) {
-    return (CursorChildIterator) {NULL_SUBTREE, self->tree, length_zero(), 0, 0, NULL};
+    return (CursorChildIterator) {NULL_SUBTREE, self->tree, length_zero(), 0, 0, 0, NULL};
   }
   const TSSymbol *alias_sequence = ts_language_alias_sequence(
     self->tree->language,
     last_entry->subtree->ptr->production_id
   );
+
+  uint32_t descendant_index = last_entry->descendant_index;
+  if (ts_tree_cursor_is_entry_visible(self, self->stack.size - 1)) {
+    descendant_index += 1;
+  }
+
   return (CursorChildIterator) {
     .tree = self->tree,
     .parent = *last_entry->subtree,
     .position = last_entry->position,
     .child_index = 0,
     .structural_child_index = 0,
+    .descendant_index = descendant_index,
     .alias_sequence = alias_sequence,
   };
 }
@@ -44,6 +68,7 @@ static inline bool ts_tree_cursor_child_iterator_next(CursorChildIterator *self,
     .position = self->position,
     .child_index = self->child_index,
     .structural_child_index = self->structural_child_index,
+    .descendant_index = self->descendant_index,
   };
   *visible = ts_subtree_visible(*child);
   bool extra = ts_subtree_extra(*child);
@@ -52,6 +77,9 @@ static inline bool ts_tree_cursor_child_iterator_next(CursorChildIterator *self,
     self->structural_child_index++;
   }
 
+  self->descendant_index += ts_subtree_visible_descendant_count(*child);
+  if (*visible) self->descendant_index += 1;
+
   self->position = length_add(self->position, ts_subtree_size(*child));
   self->child_index++;
 
@@ -78,7 +106,7 @@ void ts_tree_cursor_reset(TSTreeCursor *_self, TSNode node) {
 void ts_tree_cursor_init(TreeCursor *self, TSNode node) {
   self->tree = node.tree;
   array_clear(&self->stack);
-  array_push(&self->stack, ((TreeCursorEntry) {
+  array_push_tracked(&self->stack, TSAllocationCategoryCursorStack, ((TreeCursorEntry) {
     .subtree = (const Subtree *)node.id,
     .position = {
       ts_node_start_byte(node),
@@ -86,12 +114,21 @@ void ts_tree_cursor_init(TreeCursor *self, TSNode node) {
     },
     .child_index = 0,
     .structural_child_index = 0,
+    .descendant_index = 0,
   }));
 }
 
 void ts_tree_cursor_delete(TSTreeCursor *_self) {
   TreeCursor *self = (TreeCursor *)_self;
-  array_delete(&self->stack);
+  array_delete_tracked(&self->stack, TSAllocationCategoryCursorStack);
+}
+
+void ts_tree_cursor_reset_to(TSTreeCursor *_dst, const TSTreeCursor *_src) {
+  const TreeCursor *cursor = (const TreeCursor *)_src;
+  TreeCursor *copy = (TreeCursor *)_dst;
+  copy->tree = cursor->tree;
+  array_clear(&copy->stack);
+  array_push_all_tracked(&copy->stack, TSAllocationCategoryCursorStack, &cursor->stack);
 }
 
 // TSTreeCursor - walking the tree
@@ -108,12 +145,12 @@ bool ts_tree_cursor_goto_first_child(TSTreeCursor *_self) {
     CursorChildIterator iterator = ts_tree_cursor_iterate_children(self);
     while (ts_tree_cursor_child_iterator_next(&iterator, &entry, &visible)) {
       if (visible) {
-        array_push(&self->stack, entry);
+        array_push_tracked(&self->stack, TSAllocationCategoryCursorStack, entry);
         return true;
       }
 
       if (ts_subtree_visible_child_count(*entry.subtree) > 0) {
-        array_push(&self->stack, entry);
+        array_push_tracked(&self->stack, TSAllocationCategoryCursorStack, entry);
         did_descend = true;
         break;
       }
@@ -123,8 +160,11 @@ bool ts_tree_cursor_goto_first_child(TSTreeCursor *_self) {
   return false;
 }
 
-int64_t ts_tree_cursor_goto_first_child_for_byte(TSTreeCursor *_self, uint32_t goal_byte) {
-  TreeCursor *self = (TreeCursor *)_self;
+int64_t ts_tree_cursor_goto_first_child_for_byte_and_point(
+  TreeCursor *self,
+  uint32_t goal_byte,
+  TSPoint goal_point
+) {
   uint32_t initial_size = self->stack.size;
   uint32_t visible_child_index = 0;
 
@@ -136,18 +176,20 @@ int64_t ts_tree_cursor_goto_first_child_for_byte(TSTreeCursor *_self, uint32_t g
     TreeCursorEntry entry;
     CursorChildIterator iterator = ts_tree_cursor_iterate_children(self);
     while (ts_tree_cursor_child_iterator_next(&iterator, &entry, &visible)) {
-      uint32_t end_byte = entry.position.bytes + ts_subtree_size(*entry.subtree).bytes;
-      bool at_goal = end_byte > goal_byte;
+      Length entry_end = length_add(entry.position, ts_subtree_size(*entry.subtree));
+      bool at_goal = entry_end.bytes > goal_byte && point_gt(entry_end.extent, goal_point);
       uint32_t visible_child_count = ts_subtree_visible_child_count(*entry.subtree);
 
+      // Children that end before the goal are skipped as a whole, using their
+      // cached sizes, so invisible subtrees are never walked into.
       if (at_goal) {
         if (visible) {
-          array_push(&self->stack, entry);
+          array_push_tracked(&self->stack, TSAllocationCategoryCursorStack, entry);
           return visible_child_index;
         }
 
         if (visible_child_count > 0) {
-          array_push(&self->stack, entry);
+          array_push_tracked(&self->stack, TSAllocationCategoryCursorStack, entry);
           did_descend = true;
           break;
         }
@@ -163,42 +205,20 @@ int64_t ts_tree_cursor_goto_first_child_for_byte(TSTreeCursor *_self, uint32_t g
   return -1;
 }
 
-int64_t ts_tree_cursor_goto_first_child_for_point(TSTreeCursor *_self, TSPoint goal_point) {
-  TreeCursor *self = (TreeCursor *)_self;
-  uint32_t initial_size = self->stack.size;
-  uint32_t visible_child_index = 0;
-
-  bool did_descend;
-  do {
-    did_descend = false;
-
-    bool visible;
-    TreeCursorEntry entry;
-    CursorChildIterator iterator = ts_tree_cursor_iterate_children(self);
-    while (ts_tree_cursor_child_iterator_next(&iterator, &entry, &visible)) {
-      TSPoint end_point = point_add(entry.position.extent, ts_subtree_size(*entry.subtree).extent);
-      bool at_goal = point_gt(end_point, goal_point);
-      uint32_t visible_child_count = ts_subtree_visible_child_count(*entry.subtree);
-      if (at_goal) {
-        if (visible) {
-          array_push(&self->stack, entry);
-          return visible_child_index;
-        }
-        if (visible_child_count > 0) {
-          array_push(&self->stack, entry);
-          did_descend = true;
-          break;
-        }
-      } else if (visible) {
-        visible_child_index++;
-      } else {
-        visible_child_index += visible_child_count;
-      }
-    }
-  } while (did_descend);
+int64_t ts_tree_cursor_goto_first_child_for_byte(TSTreeCursor *self, uint32_t goal_byte) {
+  return ts_tree_cursor_goto_first_child_for_byte_and_point(
+    (TreeCursor *)self,
+    goal_byte,
+    POINT_ZERO
+  );
+}
 
-  self->stack.size = initial_size;
-  return -1;
+int64_t ts_tree_cursor_goto_first_child_for_point(TSTreeCursor *self, TSPoint goal_point) {
+  return ts_tree_cursor_goto_first_child_for_byte_and_point(
+    (TreeCursor *)self,
+    0,
+    goal_point
+  );
 }
 
 bool ts_tree_cursor_goto_next_sibling(TSTreeCursor *_self) {
@@ -210,6 +230,7 @@ bool ts_tree_cursor_goto_next_sibling(TSTreeCursor *_self) {
     CursorChildIterator iterator = ts_tree_cursor_iterate_children(self);
     iterator.child_index = entry.child_index;
     iterator.structural_child_index = entry.structural_child_index;
+    iterator.descendant_index = entry.descendant_index;
     iterator.position = entry.position;
 
     bool visible = false;
@@ -218,12 +239,12 @@ bool ts_tree_cursor_goto_next_sibling(TSTreeCursor *_self) {
 
     while (ts_tree_cursor_child_iterator_next(&iterator, &entry, &visible)) {
       if (visible) {
-        array_push(&self->stack, entry);
+        array_push_tracked(&self->stack, TSAllocationCategoryCursorStack, entry);
         return true;
       }
 
       if (ts_subtree_visible_child_count(*entry.subtree)) {
-        array_push(&self->stack, entry);
+        array_push_tracked(&self->stack, TSAllocationCategoryCursorStack, entry);
         ts_tree_cursor_goto_first_child(_self);
         return true;
       }
@@ -257,6 +278,59 @@ bool ts_tree_cursor_goto_parent(TSTreeCursor *_self) {
   return false;
 }
 
+void ts_tree_cursor_goto_descendant(TSTreeCursor *_self, uint32_t goal_descendant_index) {
+  TreeCursor *self = (TreeCursor *)_self;
+  uint32_t initial_size = self->stack.size;
+
+  // Ascend to the lowest ancestor that contains the goal node.
+  for (;;) {
+    uint32_t i = self->stack.size - 1;
+    TreeCursorEntry *entry = &self->stack.contents[i];
+    uint32_t next_descendant_index =
+      entry->descendant_index +
+      (ts_tree_cursor_is_entry_visible(self, i) ? 1 : 0) +
+      ts_subtree_visible_descendant_count(*entry->subtree);
+    if (
+      entry->descendant_index <= goal_descendant_index &&
+      next_descendant_index > goal_descendant_index
+    ) {
+      break;
+    } else if (self->stack.size <= 1) {
+      self->stack.size = initial_size;
+      return;
+    } else {
+      self->stack.size--;
+    }
+  }
+
+  // Descend to the goal node, skipping over every child whose descendants
+  // all precede it.
+  bool did_descend;
+  do {
+    did_descend = false;
+
+    bool visible;
+    TreeCursorEntry entry;
+    CursorChildIterator iterator = ts_tree_cursor_iterate_children(self);
+    if (iterator.descendant_index > goal_descendant_index) return;
+
+    while (ts_tree_cursor_child_iterator_next(&iterator, &entry, &visible)) {
+      if (iterator.descendant_index > goal_descendant_index) {
+        array_push_tracked(&self->stack, TSAllocationCategoryCursorStack, entry);
+        if (visible && entry.descendant_index == goal_descendant_index) return;
+        did_descend = true;
+        break;
+      }
+    }
+  } while (did_descend);
+}
+
+uint32_t ts_tree_cursor_current_descendant_index(const TSTreeCursor *_self) {
+  const TreeCursor *self = (const TreeCursor *)_self;
+  TreeCursorEntry *last_entry = array_back(&self->stack);
+  return last_entry->descendant_index;
+}
+
 TSNode ts_tree_cursor_current_node(const TSTreeCursor *_self) {
   const TreeCursor *self = (const TreeCursor *)_self;
   TreeCursorEntry *last_entry = array_back(&self->stack);
@@ -480,6 +554,109 @@ TSTreeCursor ts_tree_cursor_copy(const TSTreeCursor *_cursor) {
   TreeCursor *copy = (TreeCursor *)&res;
   copy->tree = cursor->tree;
   array_init(&copy->stack);
-  array_push_all(&copy->stack, &cursor->stack);
+  array_push_all_tracked(&copy->stack, TSAllocationCategoryCursorStack, &cursor->stack);
   return res;
 }
+
+// TSNodeExporter
+
+struct TSNodeExporter {
+  TSTreeCursor cursor;
+  Array(uint32_t) ancestor_indices;
+  uint32_t max_depth;
+  uint32_t node_count;
+  bool named_only;
+  bool visited_children;
+  bool done;
+};
+
+TSNodeExporter *ts_node_exporter_new(TSNode node, bool named_only, uint32_t max_depth) {
+  TSNodeExporter *self = ts_malloc(sizeof(TSNodeExporter));
+  *self = (TSNodeExporter) {
+    .cursor = ts_tree_cursor_new(node),
+    .ancestor_indices = array_new(),
+    .max_depth = max_depth,
+    .node_count = 0,
+    .named_only = named_only,
+    .visited_children = false,
+    .done = false,
+  };
+  return self;
+}
+
+void ts_node_exporter_delete(TSNodeExporter *self) {
+  ts_tree_cursor_delete(&self->cursor);
+  array_delete(&self->ancestor_indices);
+  ts_free(self);
+}
+
+static inline void ts_node_exporter__write(
+  const TSNodeExporter *self,
+  TSNodeArray *array,
+  uint32_t i,
+  TSNode node,
+  uint32_t parent_index
+) {
+  if (array->symbols) array->symbols[i] = ts_node_symbol(node);
+  if (array->field_ids) {
+    array->field_ids[i] = self->ancestor_indices.size > 0
+      ? ts_tree_cursor_current_field_id(&self->cursor)
+      : 0;
+  }
+  if (array->start_bytes) array->start_bytes[i] = ts_node_start_byte(node);
+  if (array->end_bytes) array->end_bytes[i] = ts_node_end_byte(node);
+  if (array->start_points) array->start_points[i] = ts_node_start_point(node);
+  if (array->end_points) array->end_points[i] = ts_node_end_point(node);
+  if (array->parent_indices) array->parent_indices[i] = parent_index;
+  if (array->flags) {
+    Subtree subtree = *(const Subtree *)node.id;
+    uint8_t flags = 0;
+    if (ts_node_is_named(node)) flags |= TSNodeFlagNamed;
+    if (ts_subtree_extra(subtree)) flags |= TSNodeFlagExtra;
+    if (ts_subtree_missing(subtree)) flags |= TSNodeFlagMissing;
+    if (ts_subtree_error_cost(subtree) > 0) flags |= TSNodeFlagHasError;
+    if (ts_subtree_has_changes(subtree)) flags |= TSNodeFlagHasChanges;
+    if (ts_subtree_visible_child_count(subtree) > 0) flags |= TSNodeFlagHasChildren;
+    array->flags[i] = flags;
+  }
+}
+
+uint32_t ts_node_exporter_next(TSNodeExporter *self, TSNodeArray *array) {
+  uint32_t count = 0;
+  while (!self->done && count < array->capacity) {
+    // Export the current node, unless it is filtered out, and then descend
+    // into its children. The ancestor stack has one entry for each level above
+    // the current node, holding the index of the nearest exported node.
+    if (!self->visited_children) {
+      TSNode node = ts_tree_cursor_current_node(&self->cursor);
+      uint32_t index = self->ancestor_indices.size > 0
+        ? *array_back(&self->ancestor_indices)
+        : UINT32_MAX;
+      if (!self->named_only || ts_node_is_named(node)) {
+        ts_node_exporter__write(self, array, count, node, index);
+        index = self->node_count++;
+        count++;
+      }
+
+      if (
+        self->ancestor_indices.size < self->max_depth &&
+        ts_tree_cursor_goto_first_child(&self->cursor)
+      ) {
+        array_push(&self->ancestor_indices, index);
+        continue;
+      }
+      self->visited_children = true;
+    }
+
+    // Stop at the starting node instead of moving on to its siblings.
+    if (self->ancestor_indices.size == 0) {
+      self->done = true;
+    } else if (ts_tree_cursor_goto_next_sibling(&self->cursor)) {
+      self->visited_children = false;
+    } else {
+      ts_tree_cursor_goto_parent(&self->cursor);
+      self->ancestor_indices.size--;
+    }
+  }
+  return count;
+}
@@ -8,6 +8,7 @@ typedef struct {
   Length position;
   uint32_t child_index;
   uint32_t structural_child_index;
+  uint32_t descendant_index;
 } TreeCursorEntry;
 
 typedef struct {
@@ -27,5 +28,6 @@ void ts_tree_cursor_current_status(
 );
 
 TSNode ts_tree_cursor_parent_node(const TSTreeCursor *);
+int64_t ts_tree_cursor_goto_first_child_for_byte_and_point(TreeCursor *, uint32_t, TSPoint);
 
 #endif  // TREE_SITTER_TREE_CURSOR_H_
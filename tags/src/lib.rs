@@ -2,12 +2,14 @@ pub mod c_lib;
 
 use memchr::memchr;
 use regex::Regex;
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 use std::ffi::{CStr, CString};
 use std::ops::Range;
 use std::os::raw::c_char;
-use std::sync::atomic::{AtomicUsize, Ordering};
-use std::{char, mem, str};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::mpsc;
+use std::time::{Duration, Instant};
+use std::{char, mem, str, thread};
 use thiserror::Error;
 use tree_sitter::{
     Language, LossyUtf8, Parser, Point, Query, QueryCursor, QueryError, QueryPredicateArg, Tree,
@@ -57,6 +59,15 @@ pub struct Tag {
     pub syntax_type_id: u32,
 }
 
+/// The tags computed for a single file by `generate_tags_in_parallel`.
+#[derive(Debug)]
+pub struct FileTags {
+    pub source: Vec<u8>,
+    pub tags: Vec<Tag>,
+    pub has_error: bool,
+    pub duration: Duration,
+}
+
 #[derive(Debug, Error, PartialEq)]
 pub enum Error {
     #[error(transparent)]
@@ -79,16 +90,21 @@ struct PatternInfo {
     doc_strip_regex: Option<Regex>,
 }
 
-#[derive(Debug)]
-struct LocalDef<'a> {
-    name: &'a [u8],
-}
-
 #[derive(Debug)]
 struct LocalScope<'a> {
     inherits: bool,
     range: Range<usize>,
-    local_defs: Vec<LocalDef<'a>>,
+    parent: Option<usize>,
+    children: Vec<usize>,
+    local_defs: HashSet<&'a [u8]>,
+}
+
+// The local scopes found so far in a file, nested according to their ranges. The
+// children of each scope are disjoint and sorted by position, so the innermost scope
+// containing a given range can be found by binary search at each level.
+#[derive(Debug)]
+struct LocalScopeTree<'a> {
+    scopes: Vec<LocalScope<'a>>,
 }
 
 struct TagsIter<'a, I>
@@ -103,7 +119,7 @@ where
     cancellation_flag: Option<&'a AtomicUsize>,
     iter_count: usize,
     tag_queue: Vec<(Tag, usize)>,
-    scopes: Vec<LocalScope<'a>>,
+    scopes: LocalScopeTree<'a>,
 }
 
 struct LineInfo {
@@ -244,6 +260,11 @@ impl TagsConfiguration {
     }
 }
 
+// The C-compatible syntax type names point into the configuration's own
+// `syntax_type_names`, which are never modified after construction.
+unsafe impl Send for TagsConfiguration {}
+unsafe impl Sync for TagsConfiguration {}
+
 impl TagsContext {
     pub fn new() -> Self {
         TagsContext {
@@ -281,17 +302,89 @@ impl TagsContext {
                 prev_line_info: None,
                 tag_queue: Vec::new(),
                 iter_count: 0,
-                scopes: vec![LocalScope {
-                    range: 0..source.len(),
-                    inherits: false,
-                    local_defs: Vec::new(),
-                }],
+                scopes: LocalScopeTree::new(source.len()),
             },
             tree_ref.root_node().has_error(),
         ))
     }
 }
 
+/// Compute the tags for many files using a pool of `thread_count` threads, each with
+/// its own `TagsContext`.
+///
+/// Each file is given as a configuration along with some value, such as a path, that
+/// `read_source` turns into the file's contents. Files are handed out to the threads
+/// one at a time, but `callback` is invoked on the calling thread in the same order as
+/// `files`. If the callback returns an error, the remaining files are skipped and that
+/// error is returned.
+pub fn generate_tags_in_parallel<'a, T, E, R, F>(
+    files: &[(&'a TagsConfiguration, T)],
+    thread_count: usize,
+    cancellation_flag: Option<&AtomicUsize>,
+    read_source: R,
+    mut callback: F,
+) -> Result<(), E>
+where
+    T: Sync,
+    E: From<Error> + Send,
+    R: Fn(&T) -> Result<Vec<u8>, E> + Sync,
+    F: FnMut(usize, Result<FileTags, E>) -> Result<(), E>,
+{
+    let thread_count = thread_count.max(1).min(files.len());
+    let next_index = AtomicUsize::new(0);
+    let stopped = AtomicBool::new(false);
+    let (next_index, stopped, read_source) = (&next_index, &stopped, &read_source);
+
+    thread::scope(|scope| {
+        let (sender, receiver) = mpsc::channel();
+        for _ in 0..thread_count {
+            let sender = sender.clone();
+            scope.spawn(move || {
+                let mut context = TagsContext::new();
+                while !stopped.load(Ordering::Relaxed) {
+                    let index = next_index.fetch_add(1, Ordering::Relaxed);
+                    let (config, file) = match files.get(index) {
+                        Some(entry) => entry,
+                        None => break,
+                    };
+                    let result = read_source(file).and_then(|source| {
+                        let start_time = Instant::now();
+                        let (tags, has_error) =
+                            context.generate_tags(config, &source, cancellation_flag)?;
+                        let tags = tags.collect::<Result<Vec<_>, _>>()?;
+                        Ok(FileTags {
+                            tags,
+                            has_error,
+                            duration: start_time.elapsed(),
+                            source,
+                        })
+                    });
+                    if sender.send((index, result)).is_err() {
+                        break;
+                    }
+                }
+            });
+        }
+        drop(sender);
+
+        // Results arrive in the order in which they finish. Hold on to any that arrive
+        // early until all of the preceding files have been reported.
+        let mut pending_results = HashMap::new();
+        let mut next_result_index = 0;
+        for (index, result) in receiver {
+            pending_results.insert(index, result);
+            while let Some(result) = pending_results.remove(&next_result_index) {
+                if let Err(error) = callback(next_result_index, result) {
+                    stopped.store(true, Ordering::Relaxed);
+                    return Err(error);
+                }
+                next_result_index += 1;
+            }
+        }
+        Ok(())
+    })
+}
+
 impl<'a, I> Iterator for TagsIter<'a, I>
 where
     I: Iterator<Item = tree_sitter::QueryMatch<'a, 'a>>,
@@ -337,19 +430,11 @@ where
                         let index = Some(capture.index);
                         let range = capture.node.byte_range();
                         if index == self.config.local_scope_capture_index {
-                            self.scopes.push(LocalScope {
-                                range,
-                                inherits: pattern_info.local_scope_inherits,
-                                local_defs: Vec::new(),
-                            });
+                            self.scopes
+                                .add_scope(range, pattern_info.local_scope_inherits);
                         } else if index == self.config.local_definition_capture_index {
-                            if let Some(scope) = self.scopes.iter_mut().rev().find(|scope| {
-                                scope.range.start <= range.start && scope.range.end >= range.end
-                            }) {
-                                scope.local_defs.push(LocalDef {
-                                    name: &self.source[range.clone()],
-                                });
-                            }
+                            self.scopes
+                                .add_local_def(&range, &self.source[range.clone()]);
                         }
                     }
                     continue;
@@ -397,28 +482,12 @@ where
                             continue;
                         }
 
-                        if pattern_info.name_must_be_non_local {
-                            let mut is_local = false;
-                            for scope in self.scopes.iter().rev() {
-                                if scope.range.start <= name_range.start
-                                    && scope.range.end >= name_range.end
-                                {
-                                    if scope
-                                        .local_defs
-                                        .iter()
-                                        .any(|d| d.name == &self.source[name_range.clone()])
-                                    {
-                                        is_local = true;
-                                        break;
-                                    }
-                                    if !scope.inherits {
-                                        break;
-                                    }
-                                }
-                            }
-                            if is_local {
-                                continue;
-                            }
+                        if pattern_info.name_must_be_non_local
+                            && self
+                                .scopes
+                                .is_local(&name_range, &self.source[name_range.clone()])
+                        {
+                            continue;
                         }
 
                         // If needed, filter the doc nodes based on their ranges, selecting
@@ -547,6 +616,84 @@ where
     }
 }
 
+impl<'a> LocalScopeTree<'a> {
+    fn new(source_len: usize) -> Self {
+        LocalScopeTree {
+            scopes: vec![LocalScope {
+                range: 0..source_len,
+                inherits: false,
+                parent: None,
+                children: Vec::new(),
+                local_defs: HashSet::new(),
+            }],
+        }
+    }
+
+    // Find the most deeply nested scope that contains the given range. When several
+    // scopes have the same range, the one that was added last is considered innermost.
+    fn innermost_scope(&self, range: &Range<usize>) -> usize {
+        let mut index = 0;
+        loop {
+            let children = &self.scopes[index].children;
+            let candidate =
+                children.partition_point(|child| self.scopes[*child].range.start <= range.start);
+            match candidate.checked_sub(1).map(|i| children[i]) {
+                Some(child) if self.scopes[child].range.end >= range.end => index = child,
+                _ => return index,
+            }
+        }
+    }
+
+    fn add_scope(&mut self, range: Range<usize>, inherits: bool) {
+        let parent = self.innermost_scope(&range);
+        let new_index = self.scopes.len();
+
+        // Scopes that were added earlier, but that lie within the new scope, become its
+        // children.
+        let siblings = &self.scopes[parent].children;
+        let start = siblings.partition_point(|child| self.scopes[*child].range.start < range.start);
+        let end = start
+            + siblings[start..]
+                .iter()
+                .take_while(|child| self.scopes[**child].range.end <= range.end)
+                .count();
+        let children = self.scopes[parent]
+            .children
+            .splice(start..end, Some(new_index))
+            .collect::<Vec<_>>();
+        for child in &children {
+            self.scopes[*child].parent = Some(new_index);
+        }
+
+        self.scopes.push(LocalScope {
+            range,
+            inherits,
+            parent: Some(parent),
+            children,
+            local_defs: HashSet::new(),
+        });
+    }
+
+    fn add_local_def(&mut self, range: &Range<usize>, name: &'a [u8]) {
+        let index = self.innermost_scope(range);
+        self.scopes[index].local_defs.insert(name);
+    }
+
+    fn is_local(&self, range: &Range<usize>, name: &[u8]) -> bool {
+        let mut index = self.innermost_scope(range);
+        loop {
+            let scope = &self.scopes[index];
+            if scope.local_defs.contains(name) {
+                return true;
+            }
+            match scope.parent {
+                Some(parent) if scope.inherits => index = parent,
+                _ => return false,
+            }
+        }
+    }
+}
+
 impl Tag {
     fn ignored(name_range: Range<usize>) -> Self {
         Tag {
@@ -0,0 +1,416 @@
+// A benchmark harness for the individual operations of the Tree-sitter
+// library. It is compiled together with one grammar, runs every benchmark on
+// each of the given example files, and prints the results as JSON.
+//
+// Usage: benchmark <language-name> <repetitions> <query-path> <example-path>...
+//
+// An empty query path skips the query benchmarks. See `script/benchmark-lib`.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tree_sitter/api.h"
+#include "./lexer.h"
+#include "./language.h"
+
+extern const TSLanguage *TS_LANG(void);
+
+// The number of random edits that are applied in each repetition of the
+// incremental parsing benchmarks.
+#define EDIT_COUNT 20
+
+typedef struct {
+  const char *path;
+  char *source;
+  uint32_t length;
+  TSParser *parser;
+  TSTree *tree;
+  TSQuery *query;
+  uint32_t random_seed;
+} Example;
+
+typedef uint64_t (*BenchmarkFn)(Example *, uint64_t *);
+
+static uint64_t now_ns(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+static uint32_t next_random(Example *self) {
+  self->random_seed = self->random_seed * 1103515245 + 12345;
+  return self->random_seed >> 8;
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t left = *(const uint64_t *)a, right = *(const uint64_t *)b;
+  return left < right ? -1 : left > right ? 1 : 0;
+}
+
+static char *read_file(const char *path, uint32_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (!file) return NULL;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *result = malloc(size + 1);
+  if (fread(result, 1, size, file) != (size_t)size) {
+    free(result);
+    fclose(file);
+    return NULL;
+  }
+  result[size] = '\0';
+  fclose(file);
+  *length = size;
+  return result;
+}
+
+static void print_json_string(const char *string) {
+  putchar('"');
+  for (const char *c = string; *c; c++) {
+    if (*c == '"' || *c == '\\') putchar('\\');
+    putchar(*c);
+  }
+  putchar('"');
+}
+
+// Run a benchmark the given number of times, and print the minimum and median
+// durations of its timed portion, along with the amount of work that it did.
+static void run_benchmark(
+  Example *example,
+  const char *name,
+  const char *unit,
+  unsigned repetitions,
+  BenchmarkFn fn,
+  bool is_first
+) {
+  uint64_t *durations = malloc(repetitions * sizeof(uint64_t));
+  uint64_t unit_count = 0;
+  for (unsigned i = 0; i < repetitions; i++) {
+    durations[i] = fn(example, &unit_count);
+  }
+  qsort(durations, repetitions, sizeof(uint64_t), compare_u64);
+  uint64_t min_ns = durations[0];
+  uint64_t median_ns = durations[repetitions / 2];
+  double units_per_second = min_ns > 0 ? (double)unit_count * 1e9 / (double)min_ns : 0;
+
+  printf("%s{\"name\": ", is_first ? "" : ", ");
+  print_json_string(name);
+  printf(
+    ", \"iterations\": %u, \"min_ns\": %llu, \"median_ns\": %llu, "
+    "\"units\": %llu, \"unit\": \"%s\", \"units_per_second\": %.0f}",
+    repetitions,
+    (unsigned long long)min_ns,
+    (unsigned long long)median_ns,
+    (unsigned long long)unit_count,
+    unit,
+    units_per_second
+  );
+  free(durations);
+}
+
+/*************
+ * Benchmarks
+ *************/
+
+// Lex the whole file in the error-recovery lex state, which recognizes every
+// token in the grammar. Characters that don't begin a token are skipped.
+// Only the generated lexer is measured, not the external scanner.
+static uint64_t benchmark_lex(Example *self, uint64_t *unit_count) {
+  const TSLanguage *language = TS_LANG();
+  TSLexMode lex_mode = language->lex_modes[0];
+  Lexer lexer;
+  ts_lexer_init(&lexer);
+  ts_lexer_set_input_buffer(&lexer, self->source, self->length, TSInputEncodingUTF8);
+  ts_lexer_reset(&lexer, length_zero());
+
+  uint64_t start = now_ns();
+  for (;;) {
+    Length position = lexer.current_position;
+    if (lexer.data.eof(&lexer.data)) break;
+    uint32_t lookahead_end_byte;
+    ts_lexer_start(&lexer);
+    bool found_token = language->lex_fn(&lexer.data, lex_mode.lex_state);
+    ts_lexer_finish(&lexer, &lookahead_end_byte);
+    if (found_token && lexer.token_end_position.bytes > position.bytes) {
+      ts_lexer_reset(&lexer, lexer.token_end_position);
+    } else {
+      ts_lexer_reset(&lexer, position);
+      ts_lexer_start(&lexer);
+      lexer.data.advance(&lexer.data, true);
+      ts_lexer_reset(&lexer, lexer.current_position);
+    }
+  }
+  uint64_t duration = now_ns() - start;
+
+  ts_lexer_delete(&lexer);
+  *unit_count = self->length;
+  return duration;
+}
+
+static uint64_t benchmark_parse(Example *self, uint64_t *unit_count) {
+  uint64_t start = now_ns();
+  TSTree *tree = ts_parser_parse_string(self->parser, NULL, self->source, self->length);
+  uint64_t duration = now_ns() - start;
+  ts_tree_delete(tree);
+  *unit_count = self->length;
+  return duration;
+}
+
+// Insert a character at a random position, reparse, then remove it again and
+// reparse, so that the source is unchanged after each pair of edits.
+static uint64_t apply_random_edits(
+  Example *self,
+  bool time_changed_ranges,
+  uint64_t *unit_count
+) {
+  char *source = malloc(self->length + 2);
+  uint64_t duration = 0;
+  for (unsigned i = 0; i < EDIT_COUNT; i++) {
+    uint32_t position = next_random(self) % (self->length + 1);
+    for (unsigned j = 0; j < 2; j++) {
+      bool is_insertion = j == 0;
+      uint32_t new_length = is_insertion ? self->length + 1 : self->length;
+      memcpy(source, self->source, position);
+      if (is_insertion) source[position] = ' ';
+      memcpy(
+        source + position + is_insertion,
+        self->source + position,
+        self->length - position
+      );
+
+      TSPoint point = {0, 0};
+      const char *text = is_insertion ? source : self->source;
+      for (uint32_t k = 0; k < position; k++) {
+        if (text[k] == '\n') {
+          point.row++;
+          point.column = 0;
+        } else {
+          point.column++;
+        }
+      }
+      TSPoint next_point = {point.row, point.column + 1};
+      TSInputEdit edit = {
+        .start_byte = position,
+        .old_end_byte = is_insertion ? position : position + 1,
+        .new_end_byte = is_insertion ? position + 1 : position,
+        .start_point = point,
+        .old_end_point = is_insertion ? point : next_point,
+        .new_end_point = is_insertion ? next_point : point,
+      };
+
+      TSTree *old_tree = self->tree;
+      ts_tree_edit(old_tree, &edit);
+      const char *new_source = is_insertion ? source : self->source;
+      uint64_t start = now_ns();
+      TSTree *new_tree = ts_parser_parse_string(self->parser, old_tree, new_source, new_length);
+      uint64_t parse_duration = now_ns() - start;
+
+      start = now_ns();
+      uint32_t range_count;
+      TSRange *ranges = ts_tree_get_changed_ranges(old_tree, new_tree, &range_count);
+      uint64_t changed_ranges_duration = now_ns() - start;
+      free(ranges);
+
+      duration += time_changed_ranges ? changed_ranges_duration : parse_duration;
+      ts_tree_delete(old_tree);
+      self->tree = new_tree;
+    }
+  }
+  free(source);
+  *unit_count = EDIT_COUNT * 2;
+  return duration;
+}
+
+static uint64_t benchmark_reparse(Example *self, uint64_t *unit_count) {
+  return apply_random_edits(self, false, unit_count);
+}
+
+static uint64_t benchmark_changed_ranges(Example *self, uint64_t *unit_count) {
+  return apply_random_edits(self, true, unit_count);
+}
+
+static uint64_t benchmark_tree_cursor(Example *self, uint64_t *unit_count) {
+  uint64_t node_count = 0;
+  uint64_t start = now_ns();
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(self->tree));
+  for (;;) {
+    node_count++;
+    if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) goto done;
+    }
+  }
+done:
+  ts_tree_cursor_delete(&cursor);
+  *unit_count = node_count;
+  return now_ns() - start;
+}
+
+static uint64_t count_nodes_by_child_index(TSNode node) {
+  uint64_t result = 1;
+  uint32_t child_count = ts_node_child_count(node);
+  for (uint32_t i = 0; i < child_count; i++) {
+    result += count_nodes_by_child_index(ts_node_child(node, i));
+  }
+  return result;
+}
+
+static uint64_t count_nodes_by_sibling(TSNode node) {
+  uint64_t result = 1;
+  for (TSNode child = ts_node_child(node, 0); !ts_node_is_null(child); child = ts_node_next_sibling(child)) {
+    result += count_nodes_by_sibling(child);
+  }
+  return result;
+}
+
+static uint64_t benchmark_node_child(Example *self, uint64_t *unit_count) {
+  uint64_t start = now_ns();
+  *unit_count = count_nodes_by_child_index(ts_tree_root_node(self->tree));
+  return now_ns() - start;
+}
+
+static uint64_t benchmark_node_next_sibling(Example *self, uint64_t *unit_count) {
+  uint64_t start = now_ns();
+  *unit_count = count_nodes_by_sibling(ts_tree_root_node(self->tree));
+  return now_ns() - start;
+}
+
+static uint64_t benchmark_query_captures(Example *self, uint64_t *unit_count) {
+  uint64_t capture_count = 0;
+  uint64_t start = now_ns();
+  TSQueryCursor *cursor = ts_query_cursor_new();
+  ts_query_cursor_exec(cursor, self->query, ts_tree_root_node(self->tree));
+  TSQueryMatch match;
+  uint32_t capture_index;
+  while (ts_query_cursor_next_capture(cursor, &match, &capture_index)) {
+    capture_count++;
+  }
+  ts_query_cursor_delete(cursor);
+  *unit_count = capture_count;
+  return now_ns() - start;
+}
+
+static uint64_t benchmark_query_matches(Example *self, uint64_t *unit_count) {
+  uint64_t match_count = 0;
+  uint64_t start = now_ns();
+  TSQueryCursor *cursor = ts_query_cursor_new();
+  ts_query_cursor_exec(cursor, self->query, ts_tree_root_node(self->tree));
+  TSQueryMatch match;
+  while (ts_query_cursor_next_match(cursor, &match)) {
+    match_count++;
+  }
+  ts_query_cursor_delete(cursor);
+  *unit_count = match_count;
+  return now_ns() - start;
+}
+
+static uint64_t benchmark_tree_delete(Example *self, uint64_t *unit_count) {
+  TSTree *tree = ts_parser_parse_string(self->parser, NULL, self->source, self->length);
+  *unit_count = count_nodes_by_sibling(ts_tree_root_node(tree));
+  uint64_t start = now_ns();
+  ts_tree_delete(tree);
+  return now_ns() - start;
+}
+
+static const char *query_source;
+static uint32_t query_source_length;
+
+static uint64_t benchmark_query_compile(Example *self, uint64_t *unit_count) {
+  uint32_t error_offset;
+  TSQueryError error_type;
+  uint64_t start = now_ns();
+  TSQuery *query = ts_query_new(
+    TS_LANG(),
+    query_source,
+    query_source_length,
+    &error_offset,
+    &error_type
+  );
+  uint64_t duration = now_ns() - start;
+  ts_query_delete(query);
+  (void)self;
+  *unit_count = query_source_length;
+  return duration;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    fprintf(stderr, "Usage: %s <language-name> <repetitions> <query-path> <example-path>...\n", argv[0]);
+    return 1;
+  }
+
+  const char *language_name = argv[1];
+  unsigned repetitions = atoi(argv[2]);
+  if (repetitions == 0) repetitions = 1;
+
+  TSQuery *query = NULL;
+  if (argv[3][0]) {
+    char *source = read_file(argv[3], &query_source_length);
+    if (!source) {
+      fprintf(stderr, "Could not read query %s\n", argv[3]);
+      return 1;
+    }
+    uint32_t error_offset;
+    TSQueryError error_type;
+    query = ts_query_new(TS_LANG(), source, query_source_length, &error_offset, &error_type);
+    if (!query) {
+      fprintf(stderr, "Invalid query %s at offset %u\n", argv[3], error_offset);
+      return 1;
+    }
+    query_source = source;
+  }
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, TS_LANG())) {
+    fprintf(stderr, "Invalid language\n");
+    return 1;
+  }
+
+  printf("{\"language\": ");
+  print_json_string(language_name);
+  printf(", \"examples\": [");
+
+  for (int i = 4; i < argc; i++) {
+    Example example = {.path = argv[i], .parser = parser, .query = query, .random_seed = 1};
+    example.source = read_file(example.path, &example.length);
+    if (!example.source) {
+      fprintf(stderr, "Could not read example %s\n", example.path);
+      return 1;
+    }
+    example.tree = ts_parser_parse_string(parser, NULL, example.source, example.length);
+
+    printf("%s{\"path\": ", i == 4 ? "" : ", ");
+    print_json_string(example.path);
+    printf(", \"bytes\": %u, \"benchmarks\": [", example.length);
+    run_benchmark(&example, "lex", "bytes", repetitions, benchmark_lex, true);
+    run_benchmark(&example, "parse", "bytes", repetitions, benchmark_parse, false);
+    run_benchmark(&example, "reparse", "edits", repetitions, benchmark_reparse, false);
+    run_benchmark(&example, "changed_ranges", "edits", repetitions, benchmark_changed_ranges, false);
+    run_benchmark(&example, "tree_cursor", "nodes", repetitions, benchmark_tree_cursor, false);
+    run_benchmark(&example, "node_child", "nodes", repetitions, benchmark_node_child, false);
+    run_benchmark(&example, "node_next_sibling", "nodes", repetitions, benchmark_node_next_sibling, false);
+    if (query) {
+      run_benchmark(&example, "query_compile", "bytes", repetitions, benchmark_query_compile, false);
+      run_benchmark(&example, "query_matches", "matches", repetitions, benchmark_query_matches, false);
+      run_benchmark(&example, "query_captures", "captures", repetitions, benchmark_query_captures, false);
+    }
+    run_benchmark(&example, "tree_delete", "nodes", repetitions, benchmark_tree_delete, false);
+    printf("]}");
+    fflush(stdout);
+
+    ts_tree_delete(example.tree);
+    free(example.source);
+  }
+
+  printf("]}\n");
+  ts_parser_delete(parser);
+  if (query) {
+    ts_query_delete(query);
+    free((char *)query_source);
+  }
+  return 0;
+}
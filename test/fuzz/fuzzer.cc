@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include "tree_sitter/api.h"
 
@@ -6,7 +9,41 @@ extern "C" const TSLanguage *TS_LANG();
 
 static TSQuery *lang_query;
 
+#ifdef TS_PERF_FUZZER
+// In the performance fuzzing mode, inputs are also rejected if they require a
+// disproportionate amount of work to parse or to query. The work is measured
+// by counting the parser's and the query cursor's operations rather than by
+// timing them, so that the results are deterministic. The limit can be set
+// with the `TS_FUZZ_MAX_OPS_PER_BYTE` environment variable. Inputs shorter
+// than `MIN_INPUT_SIZE` are treated as having that size, so that the fixed
+// cost of a parse does not count against very short inputs.
+static const size_t MIN_INPUT_SIZE = 64;
+static uint64_t max_ops_per_byte = 100;
+
+static void check_operation_count(const char *kind, uint64_t count, size_t size) {
+  uint64_t limit = max_ops_per_byte * std::max(size, MIN_INPUT_SIZE);
+  if (count > limit) {
+    fprintf(
+      stderr,
+      "Operation limit exceeded: the %s performed %llu operations on %zu bytes (limit: %llu per byte)\n",
+      kind,
+      (unsigned long long)count,
+      size,
+      (unsigned long long)max_ops_per_byte
+    );
+    abort();
+  }
+}
+#endif
+
 extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv) {
+#ifdef TS_PERF_FUZZER
+  if (const char *value = getenv("TS_FUZZ_MAX_OPS_PER_BYTE")) {
+    max_ops_per_byte = strtoull(value, NULL, 10);
+    assert(max_ops_per_byte > 0);
+  }
+#endif
+
   if(TS_LANG_QUERY_FILENAME[0]) {
     // The query filename is relative to the fuzzing binary. Convert it
     // to an absolute path first
@@ -47,6 +84,12 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
   TSTree *tree = ts_parser_parse_string(parser, NULL, str, size);
   TSNode root_node = ts_tree_root_node(tree);
 
+#ifdef TS_PERF_FUZZER
+  TSParserStats parser_stats;
+  ts_parser_stats(parser, &parser_stats);
+  check_operation_count("parser", parser_stats.advance_count, size);
+#endif
+
   if (lang_query) {
     {
       TSQueryCursor *cursor = ts_query_cursor_new();
@@ -56,6 +99,12 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
       while (ts_query_cursor_next_match(cursor, &match)) {
       }
 
+#ifdef TS_PERF_FUZZER
+      TSQueryCursorStats cursor_stats;
+      ts_query_cursor_stats(cursor, &cursor_stats);
+      check_operation_count("query cursor", cursor_stats.visited_node_count + cursor_stats.step_count, size);
+#endif
+
       ts_query_cursor_delete(cursor);
     }
 
@@ -68,6 +117,12 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
       while (ts_query_cursor_next_capture(cursor, &match, &capture_index)) {
       }
 
+#ifdef TS_PERF_FUZZER
+      TSQueryCursorStats cursor_stats;
+      ts_query_cursor_stats(cursor, &cursor_stats);
+      check_operation_count("query cursor", cursor_stats.visited_node_count + cursor_stats.step_count, size);
+#endif
+
       ts_query_cursor_delete(cursor);
     }
   }